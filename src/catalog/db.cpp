@@ -34,6 +34,7 @@ class DB::Impl {
         schema.GetName(), LockMode::X, TxnManager::GetTxn(txn_id).value());
     table_storage_.Create(schema);
     tick_table_[std::string(schema.GetName())] = 1;
+    catalog_version_.fetch_add(1, std::memory_order_relaxed);
   }
 
   void DropTable(txn_id_t txn_id, std::string_view table_name) {
@@ -42,6 +43,7 @@ class DB::Impl {
         table_name, LockMode::X, TxnManager::GetTxn(txn_id).value());
     table_storage_.Drop(table_name);
     tick_table_.erase(tick_table_.find(table_name));
+    catalog_version_.fetch_add(1, std::memory_order_relaxed);
   }
 
   void requireS(txn_id_t txn_id, std::string_view table_name)
@@ -83,6 +85,13 @@ class DB::Impl {
     // P4 DONE
   }
 
+  std::unique_ptr<MorselSource> GetMorsels(txn_id_t txn_id,
+      std::string_view table_name, std::tuple<std::string_view, bool, bool> L,
+      std::tuple<std::string_view, bool, bool> R, size_t n) {
+    requireS(txn_id, table_name);
+    return table_storage_.GetMorsels(table_name, L, R, n);
+  }
+
   std::unique_ptr<ModifyHandle> GetModifyHandle(
       txn_id_t txn_id, std::string_view table_name) {
     requireIX(txn_id,table_name);
@@ -99,6 +108,13 @@ class DB::Impl {
     // P4 DONE
   }
 
+  std::unique_ptr<SearchHandle> GetReadSearchHandle(
+      txn_id_t txn_id, std::string_view table_name) {
+    requireS(txn_id,table_name);
+    return table_storage_.GetSearchHandle(std::make_unique<TxnExecCtx>(
+        txn_id, std::string(table_name), &txn_manager_.GetLockManager()));
+  }
+
   // No need to handle txn logic.
   GenPKHandle GetGenPKHandle(txn_id_t txn_id, std::string_view table_name) {
     (void)txn_id;
@@ -124,6 +140,11 @@ class DB::Impl {
   void UpdateStats(std::string_view table_name, TableStatistics&& stat) {
     table_stats_[std::string(table_name)] =
         std::make_unique<TableStatistics>(std::move(stat));
+    catalog_version_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  size_t GetCatalogVersion() const {
+    return catalog_version_.load(std::memory_order_relaxed);
   }
 
   // Return the pointer to the statistic data. Return null if there is no stats.
@@ -149,6 +170,8 @@ class DB::Impl {
 
   std::map<std::string, std::atomic<int64_t>, std::less<>> tick_table_;
 
+  std::atomic<size_t> catalog_version_{0};
+
   // global txn manager and lock manager (inside txn_manager_).
   TxnManager txn_manager_;
 };
@@ -183,6 +206,12 @@ std::unique_ptr<Iterator<const uint8_t*>> DB::GetRangeIterator(txn_id_t txn_id,
   return ptr_->GetRangeIterator(txn_id, table_name, L, R);
 }
 
+std::unique_ptr<MorselSource> DB::GetMorsels(txn_id_t txn_id,
+    std::string_view table_name, std::tuple<std::string_view, bool, bool> L,
+    std::tuple<std::string_view, bool, bool> R, size_t n) {
+  return ptr_->GetMorsels(txn_id, table_name, L, R, n);
+}
+
 std::unique_ptr<ModifyHandle> DB::GetModifyHandle(
     txn_id_t txn_id, std::string_view table_name) {
   return ptr_->GetModifyHandle(txn_id, table_name);
@@ -199,6 +228,11 @@ std::unique_ptr<SearchHandle> DB::GetSearchHandle(
   return ptr_->GetSearchHandle(txn_id, table_name);
 }
 
+std::unique_ptr<SearchHandle> DB::GetReadSearchHandle(
+    txn_id_t txn_id, std::string_view table_name) {
+  return ptr_->GetReadSearchHandle(txn_id, table_name);
+}
+
 void DB::UpdateStats(std::string_view table_name, TableStatistics&& stat) {
   ptr_->UpdateStats(table_name, std::move(stat));
 }
@@ -207,6 +241,8 @@ const TableStatistics* DB::GetTableStat(std::string_view table_name) const {
   return ptr_->GetTableStat(table_name);
 }
 
+size_t DB::GetCatalogVersion() const { return ptr_->GetCatalogVersion(); }
+
 TxnManager& DB::GetTxnManager() { return ptr_->GetTxnManager(); }
 
 }  // namespace wing
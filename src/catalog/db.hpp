@@ -44,6 +44,14 @@ class DB {
       std::string_view table_name, std::tuple<std::string_view, bool, bool> L,
       std::tuple<std::string_view, bool, bool> R);
 
+  /* Split the same interval as GetRangeIterator into at most "n" morsels, which
+   * can be scanned by several threads in parallel. See storage.hpp for
+   * definition of MorselSource.
+   */
+  std::unique_ptr<MorselSource> GetMorsels(txn_id_t txn_id,
+      std::string_view table_name, std::tuple<std::string_view, bool, bool> L,
+      std::tuple<std::string_view, bool, bool> R, size_t n);
+
   /* Get a handle for modifying table. See storage.hpp for definition of
    * ModifyHandle. */
   std::unique_ptr<ModifyHandle> GetModifyHandle(
@@ -54,6 +62,12 @@ class DB {
   std::unique_ptr<SearchHandle> GetSearchHandle(
       txn_id_t txn_id, std::string_view table_name);
 
+  /* Get a handle which only searches the table, e.g. to find the rows of an
+   * index nestloop join. Like the range iterator, it holds the S lock on the
+   * whole table. */
+  std::unique_ptr<SearchHandle> GetReadSearchHandle(
+      txn_id_t txn_id, std::string_view table_name);
+
   // Generate auto_increment keys (i.e. primary key)
   GenPKHandle GetGenPKHandle(txn_id_t txn_id, std::string_view table_name);
 
@@ -65,6 +79,10 @@ class DB {
 
   const DBSchema& GetDBSchema() const;
 
+  /* It is incremented when a table is created or dropped, or the statistics
+   * are updated, which may change the plans of queries. */
+  size_t GetCatalogVersion() const;
+
   TxnManager& GetTxnManager();
 
   // Used for generating referred table name. These tables are used for storing
@@ -15,6 +15,7 @@ class BlockAllocator {
     if (offset_ + size > BlockSize) {
       ptrs_.push_back(
           std::unique_ptr<uint8_t[]>(new uint8_t[std::max(size, BlockSize)]));
+      allocated_ += std::max(size, BlockSize);
       offset_ = 0;
     }
     auto ret = ptrs_.back().get() + offset_;
@@ -24,11 +25,17 @@ class BlockAllocator {
   void Clear() {
     ptrs_.clear();
     offset_ = BlockSize + 1;
+    allocated_ = 0;
   }
+  /* The total size of the allocated blocks. */
+  size_t Allocated() const { return allocated_; }
+  /* The number of allocated blocks. */
+  size_t Blocks() const { return ptrs_.size(); }
 
  private:
   std::vector<std::unique_ptr<uint8_t[]>> ptrs_;
   size_t offset_{BlockSize + 1};
+  size_t allocated_{0};
 };
 
 }  // namespace wing
@@ -83,6 +83,17 @@ static size_t Hash8(const void* _data, size_t seed) {
 
 static size_t Hash8(size_t data, size_t seed) { return Hash8(&data, seed); }
 
+// The finalizer of MurmurHash3. It mixes all bits of "h" into all bits of the
+// result, e.g., for a multiplicative hash whose low bits are all zero.
+inline uint64_t Fmix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdLLU;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53LLU;
+  h ^= h >> 33;
+  return h;
+}
+
 }  // namespace wing::utils
 
 #endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "common/thread_pool.hpp"
+
+#include <exception>
+
+namespace wing {
+
+namespace {
+
+/* The pool of the worker running on this thread, and its index. */
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  for (size_t i = 0; i < num_threads; i++)
+    queues_.push_back(std::make_unique<Queue>());
+  for (size_t i = 0; i < num_threads; i++)
+    workers_.emplace_back([this, i] { Work(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_)
+    worker.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  size_t index = current_pool == this
+                     ? current_index
+                     : next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                           queues_.size();
+  {
+    std::unique_lock lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  {
+    // Under mutex_, so that a worker cannot miss it between checking pending_
+    // and sleeping.
+    std::unique_lock lock(mutex_);
+    pending_.fetch_add(1);
+  }
+  cv_.notify_one();
+}
+
+bool ThreadPool::Take(size_t index, std::function<void()>& task) {
+  {
+    auto& q = *queues_[index];
+    std::unique_lock lock(q.mutex);
+    if (!q.tasks.empty()) {
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+      pending_.fetch_sub(1);
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues_.size(); i++) {
+    auto& q = *queues_[(index + i) % queues_.size()];
+    std::unique_lock lock(q.mutex);
+    if (!q.tasks.empty()) {
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+      pending_.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Work(size_t index) {
+  current_pool = this;
+  current_index = index;
+  std::function<void()> task;
+  for (;;) {
+    if (Take(index, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] { return stop_ || pending_.load() > 0; });
+    if (stop_ && pending_.load() == 0)
+      return;
+  }
+}
+
+void ThreadPool::ParallelFor(
+    size_t n, const std::function<void(size_t)>& func) {
+  struct State {
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    size_t done{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+  auto state = std::make_shared<State>();
+  // The helpers that start after all indexes are taken return at once, so
+  // they never use "func" after ParallelFor returns.
+  auto run = [state, &func, n] {
+    for (size_t i; (i = state->next.fetch_add(1)) < n;) {
+      std::exception_ptr error;
+      if (!state->failed.load()) {
+        try {
+          func(i);
+        } catch (...) {
+          error = std::current_exception();
+          state->failed.store(true);
+        }
+      }
+      std::unique_lock lock(state->mutex);
+      if (error && !state->error)
+        state->error = error;
+      if (++state->done == n)
+        state->cv.notify_all();
+    }
+  };
+  for (size_t i = 0; i + 1 < n && i < Size(); i++)
+    Submit(run);
+  run();
+  std::unique_lock lock(state->mutex);
+  state->cv.wait(lock, [&] { return state->done == n; });
+  if (state->error)
+    std::rethrow_exception(state->error);
+}
+
+}  // namespace wing
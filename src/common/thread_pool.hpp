@@ -0,0 +1,67 @@
+#ifndef SAKURA_THREAD_POOL_H__
+#define SAKURA_THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wing {
+
+/**
+ * A work-stealing thread pool.
+ *
+ * Each worker has a queue of tasks. A task submitted by a worker is pushed to
+ * the back of its own queue, and the other tasks are distributed round-robin.
+ * A worker runs the tasks at the back of its own queue first, which are likely
+ * to be hot in its cache, and steals from the front of the others' queues when
+ * its own is empty. Idle workers sleep until a task is submitted.
+ *
+ * Tasks should not block waiting for other tasks, because the workers may all
+ * be busy. Use ParallelFor() instead, in which the calling thread does the work
+ * itself if no worker is free.
+ */
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t num_threads);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  /* Wait for the submitted tasks and stop the workers. */
+  ~ThreadPool();
+
+  /* The number of workers. */
+  size_t Size() const { return workers_.size(); }
+  void Submit(std::function<void()> task);
+  /* Run func(0), ..., func(n - 1) in parallel on the calling thread and the
+   * workers, and return after all of them have completed. If some of them
+   * throw, the rest that have not started are skipped, and the first exception
+   * is rethrown. */
+  void ParallelFor(size_t n, const std::function<void(size_t)>& func);
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void Work(size_t index);
+  /* Take a task from the queue of worker "index", or steal one. */
+  bool Take(size_t index, std::function<void()>& task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> next_queue_{0};
+  /* The number of tasks in the queues. Workers sleep on cv_ when it is 0. */
+  std::atomic<size_t> pending_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_{false};
+};
+
+}  // namespace wing
+
+#endif
@@ -4,10 +4,12 @@
 #include "execution/delete_executor.hpp"
 #include "execution/filter_executor.hpp"
 #include "execution/insert_executor.hpp"
+#include "execution/parallel_executor.hpp"
 #include "execution/print_executor.hpp"
 #include "execution/project_executor.hpp"
 #include "execution/seqscan_executor.hpp"
 #include"functions/functions.hpp"
+#include "plan/expr_utils.hpp"
 #include <iostream>
 #include <cstring>
 #include <memory>
@@ -17,24 +19,41 @@
 
 namespace wing {
 
-std::unique_ptr<Executor> ExecutorGenerator::Generate(
-    const PlanNode* plan, DB& db, txn_id_t txn_id) {
+TupleBatch& Executor::NextBatch() {
+  if (single_batch_ == nullptr)
+    single_batch_ = std::make_unique<TupleBatch>();
+  auto ret = Next();
+  single_batch_->Tuples()[0] = ret.Data();
+  single_batch_->SetSize(ret ? 1 : 0);
+  return *single_batch_;
+}
+
+std::unique_ptr<Executor> ExecutorGenerator::Generate(const PlanNode* plan,
+    DB& db, txn_id_t txn_id, const ExecOptions& options) {
   if (plan == nullptr) {
     throw DBException("Invalid PlanNode.");
   }
 
+  else if (options.pool != nullptr && IsPipeline(plan)) {
+    std::vector<std::shared_ptr<JoinBuild>> builds;
+    auto copies = GeneratePipeline(
+        plan, db, txn_id, options, options.pool->Size(), builds);
+    return std::make_unique<GatherExecutor>(
+        std::move(copies), std::move(builds), *options.pool);
+  }
+
   else if (plan->type_ == PlanType::Project) {
     auto project_plan = static_cast<const ProjectPlanNode*>(plan);
     return std::make_unique<ProjectExecutor>(project_plan->output_exprs_,
         project_plan->ch_->output_schema_,
-        Generate(project_plan->ch_.get(), db, txn_id));
+        Generate(project_plan->ch_.get(), db, txn_id, options));
   }
 
   else if (plan->type_ == PlanType::Filter) {
     auto filter_plan = static_cast<const FilterPlanNode*>(plan);
     return std::make_unique<FilterExecutor>(filter_plan->predicate_.GenExpr(),
         filter_plan->ch_->output_schema_,
-        Generate(filter_plan->ch_.get(), db, txn_id));
+        Generate(filter_plan->ch_.get(), db, txn_id, options));
   }
 
   else if (plan->type_ == PlanType::Print) {
@@ -55,7 +74,7 @@ std::unique_ptr<Executor> ExecutorGenerator::Generate(
                       : nullptr;
     return std::make_unique<InsertExecutor>(
         db.GetModifyHandle(txn_id, tab.GetName()),
-        Generate(insert_plan->ch_.get(), db, txn_id),
+        Generate(insert_plan->ch_.get(), db, txn_id, options),
         FKChecker(tab.GetFK(), tab, txn_id, db), gen_pk, tab);
   }
 
@@ -66,9 +85,12 @@ std::unique_ptr<Executor> ExecutorGenerator::Generate(
       throw DBException("Cannot find table \'{}\'", seqscan_plan->table_name_);
     }
     auto& tab = db.GetDBSchema()[table_schema_index.value()];
-    return std::make_unique<SeqScanExecutor>(
-        db.GetIterator(txn_id, tab.GetName()),
-        seqscan_plan->predicate_.GenExpr(), seqscan_plan->output_schema_);
+    return AddRuntimeFilters(plan,
+        PruneScanColumns(plan,
+            std::make_unique<SeqScanExecutor>(
+                db.GetIterator(txn_id, tab.GetName()),
+                seqscan_plan->predicate_.GenExpr(), ScanTableSchema(plan))),
+        options);
   }
 
   else if (plan->type_ == PlanType::RangeScan) {
@@ -78,9 +100,9 @@ std::unique_ptr<Executor> ExecutorGenerator::Generate(
       throw DBException("Cannot find table \'{}\'", rangescan_plan->table_name_);
     }
     // putchar('/');
-    return std::make_unique<SeqScanExecutor>(
+    return AddRuntimeFilters(plan, PruneScanColumns(plan, std::make_unique<SeqScanExecutor>(
         db.GetRangeIterator(txn_id, rangescan_plan->table_name_,convert_bound_from_pair_to_tuple(rangescan_plan->range_l_),convert_bound_from_pair_to_tuple(rangescan_plan->range_r_)),
-        rangescan_plan->predicate_.GenExpr(), rangescan_plan->output_schema_);
+        rangescan_plan->predicate_.GenExpr(), ScanTableSchema(plan))), options);
   }
 
   else if (plan->type_ == PlanType::Delete) {
@@ -92,7 +114,7 @@ std::unique_ptr<Executor> ExecutorGenerator::Generate(
     auto& tab = db.GetDBSchema()[table_schema_index.value()];
     return std::make_unique<DeleteExecutor>(
         db.GetModifyHandle(txn_id, tab.GetName()),
-        Generate(delete_plan->ch_.get(), db, txn_id),
+        Generate(delete_plan->ch_.get(), db, txn_id, options),
         FKChecker(tab.GetFK(), tab, txn_id, db),
         PKChecker(tab.GetName(), tab.GetHidePKFlag(), txn_id, db), tab);
   }
@@ -101,41 +123,247 @@ std::unique_ptr<Executor> ExecutorGenerator::Generate(
     auto join_plan = static_cast<const JoinPlanNode*>(plan);
     // std::cout<<join_plan->ToString()<<std::endl;
     return std::make_unique<NestloopJoinExecutor>(join_plan->predicate_.GenExpr(), join_plan->ch_->output_schema_, join_plan->ch2_->output_schema_,join_plan->output_schema_,
-                                                  Generate(join_plan->ch_.get(), db, txn_id), Generate(join_plan->ch2_.get(), db, txn_id));
+                                                  Generate(join_plan->ch_.get(), db, txn_id, options), Generate(join_plan->ch2_.get(), db, txn_id, options));
   }
   else if (plan->type_ == PlanType::HashJoin) {
     auto join_plan = static_cast<const HashJoinPlanNode*>(plan);
     //  std::cout<<join_plan->ToString()<<std::endl;
     // return std::make_unique<NestloopJoinExecutor>(join_plan->predicate_.GenExpr(), join_plan->ch_->output_schema_, join_plan->ch2_->output_schema_,join_plan->output_schema_,
     //                                           Generate(join_plan->ch_.get(), db, txn_id), Generate(join_plan->ch2_.get(), db, txn_id));
-    return std::make_unique<HashJoinExecutor>(join_plan->predicate_.GenExpr(), join_plan->ch_->output_schema_, join_plan->ch2_->output_schema_,join_plan->output_schema_,
-                                              Generate(join_plan->ch_.get(), db, txn_id), Generate(join_plan->ch2_.get(), db, txn_id),
-                                              join_plan->left_hash_exprs_,join_plan->right_hash_exprs_);
+    // The build side publishes a filter of its keys to a scan on the probe side.
+    std::shared_ptr<RuntimeFilter> filter; ExecOptions probe_options=options;
+    std::vector<RetType> types; bool same_types=true;
+    for(size_t i=0;i<join_plan->left_hash_exprs_.size();i++){ types.push_back(join_plan->left_hash_exprs_[i]->ret_type_); same_types&=types[i]==join_plan->right_hash_exprs_[i]->ret_type_; }
+    if(auto scan=same_types?FindRuntimeFilterScan(join_plan->ch2_.get(),join_plan->right_hash_exprs_):nullptr)
+    {
+      filter=std::make_shared<RuntimeFilter>(std::move(types)); probe_options.runtime_filters.push_back({scan,filter,&join_plan->right_hash_exprs_});
+    }
+    auto ret=std::make_unique<HashJoinExecutor>(join_plan->predicate_.GenExpr(), join_plan->ch_->output_schema_, join_plan->ch2_->output_schema_,join_plan->output_schema_,
+                                                Generate(join_plan->ch_.get(), db, txn_id, options), Generate(join_plan->ch2_.get(), db, txn_id, probe_options),
+                                                join_plan->left_hash_exprs_,join_plan->right_hash_exprs_,options);
+    ret->SetRuntimeFilter(std::move(filter)); return ret;
+  }
+  else if (plan->type_ == PlanType::MergeSortJoin) {
+    auto join_plan = static_cast<const MergeSortJoinPlanNode*>(plan);
+    return std::make_unique<MergeSortJoinExecutor>(join_plan->predicate_.GenExpr(), join_plan->ch_->output_schema_, join_plan->ch2_->output_schema_,join_plan->output_schema_,
+                                                   Generate(join_plan->ch_.get(), db, txn_id, options), Generate(join_plan->ch2_.get(), db, txn_id, options),
+                                                   join_plan->left_merge_key_,join_plan->right_merge_key_);
+  }
+  else if (plan->type_ == PlanType::IndexNestloopJoin) {
+    auto join_plan = static_cast<const IndexNestloopJoinPlanNode*>(plan);
+    auto scan = join_plan->ch2_.get();
+    auto [table_name, scan_predicate] = scan->type_ == PlanType::SeqScan
+        ? std::pair(static_cast<const SeqScanPlanNode*>(scan)->table_name_, static_cast<const SeqScanPlanNode*>(scan)->predicate_.GenExpr())
+        : std::pair(static_cast<const RangeScanPlanNode*>(scan)->table_name_, static_cast<const RangeScanPlanNode*>(scan)->predicate_.GenExpr());
+    return std::make_unique<IndexNestloopJoinExecutor>(join_plan->predicate_.GenExpr(), join_plan->ch_->output_schema_, scan->output_schema_,join_plan->output_schema_,
+                                                       Generate(join_plan->ch_.get(), db, txn_id, options), db.GetReadSearchHandle(txn_id, table_name),
+                                                       join_plan->left_key_,scan_predicate);
   }
 
   else if (plan->type_ == PlanType::Aggregate) {
     auto aggregate_plan = static_cast<const AggregatePlanNode*>(plan);
     // std::cout<<aggregate_plan->ToString()<<std::endl;
+    if (options.pool != nullptr && IsPipeline(aggregate_plan->ch_.get())) {
+      std::vector<std::shared_ptr<JoinBuild>> builds;
+      auto copies = GeneratePipeline(aggregate_plan->ch_.get(), db, txn_id,
+          options, options.pool->Size(), builds);
+      return std::make_unique<ParallelAggregateExecutor>(
+          aggregate_plan->group_predicate_.GenExpr(),
+          aggregate_plan->ch_->output_schema_, aggregate_plan->output_schema_,
+          std::move(copies), std::move(builds), aggregate_plan->output_exprs_,
+          aggregate_plan->group_by_exprs_, *options.pool);
+    }
     return std::make_unique<HashAggregateExecutor>(aggregate_plan->group_predicate_.GenExpr(),aggregate_plan->ch_->output_schema_,aggregate_plan->output_schema_,
-                                                   Generate(aggregate_plan->ch_.get(), db, txn_id),aggregate_plan->output_exprs_,aggregate_plan->group_by_exprs_);
+                                                   Generate(aggregate_plan->ch_.get(), db, txn_id, options),aggregate_plan->output_exprs_,aggregate_plan->group_by_exprs_);
   }
 
   else if (plan->type_ == PlanType::Order) {
     auto order_plan = static_cast<const OrderByPlanNode*>(plan);
     // std::cout<<order_plan->ToString()<<std::endl;
-    return std::make_unique<OrderExecutor>(order_plan->ch_->output_schema_,order_plan->output_schema_,Generate(order_plan->ch_.get(),db,txn_id),order_plan->order_by_exprs_);
+    return std::make_unique<OrderExecutor>(order_plan->ch_->output_schema_,order_plan->output_schema_,Generate(order_plan->ch_.get(),db,txn_id,options),order_plan->order_by_exprs_,options);
+  }
+  else if (plan->type_ == PlanType::TopN) {
+    auto topn_plan = static_cast<const TopNPlanNode*>(plan);
+    return std::make_unique<TopNExecutor>(topn_plan->ch_->output_schema_,topn_plan->output_schema_,Generate(topn_plan->ch_.get(),db,txn_id,options),topn_plan->order_by_exprs_,topn_plan->limit_size_,topn_plan->offset_);
   }
   else if (plan->type_ == PlanType::Limit) {
     auto limit_plan = static_cast<const LimitPlanNode*>(plan);
     // std::cout<<limit_plan->ToString()<<std::endl;
-    return std::make_unique<LimitExecutor>(Generate(limit_plan->ch_.get(),db,txn_id),limit_plan->offset_,limit_plan->limit_size_);
+    return std::make_unique<LimitExecutor>(Generate(limit_plan->ch_.get(),db,txn_id,options),limit_plan->offset_,limit_plan->limit_size_);
   }
   else if (plan->type_ == PlanType::Distinct) {
     auto distinct_plan = static_cast<const DistinctPlanNode*>(plan);
-    return std::make_unique<DistinctExecutor>(Generate(distinct_plan->ch_.get(),db,txn_id),distinct_plan->output_schema_);
+    return std::make_unique<DistinctExecutor>(Generate(distinct_plan->ch_.get(),db,txn_id,options),distinct_plan->output_schema_);
+  }
+  else if (plan->type_ == PlanType::HashDistinct) {
+    auto distinct_plan = static_cast<const HashDistinctPlanNode*>(plan);
+    return std::make_unique<HashDistinctExecutor>(Generate(distinct_plan->ch_.get(),db,txn_id,options),distinct_plan->ch_->output_schema_,options);
   }
   
   throw DBException("Unsupported plan node.");
 }
 
+const PlanNode* ExecutorGenerator::FindRuntimeFilterScan(
+    const PlanNode* plan, const std::vector<std::unique_ptr<Expr>>& keys) {
+  BitVector bits;
+  for (auto& key : keys)
+    bits = bits | ExprUtils::GetExprBitVector(key.get());
+  if (!bits)
+    return nullptr;
+  // The tables of "bits" are in "node".
+  auto in = [&](const PlanNode* node) {
+    return node && !((bits | node->table_bitset_) ^ node->table_bitset_);
+  };
+  while (in(plan)) {
+    switch (plan->type_) {
+      case PlanType::SeqScan:
+      case PlanType::RangeScan:
+        return plan;
+      case PlanType::Filter:
+        plan = plan->ch_.get();
+        break;
+      case PlanType::Join:
+      case PlanType::HashJoin:
+      case PlanType::MergeSortJoin:
+        plan = in(plan->ch_.get()) ? plan->ch_.get() : plan->ch2_.get();
+        break;
+      case PlanType::IndexNestloopJoin:
+        // The scan of the second child is not executed.
+        plan = plan->ch_.get();
+        break;
+      default:
+        return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<Executor> ExecutorGenerator::AddRuntimeFilters(
+    const PlanNode* plan, std::unique_ptr<SeqScanExecutor> scan,
+    const ExecOptions& options) {
+  for (auto& target : options.runtime_filters) {
+    if (target.scan == plan)
+      scan->AddRuntimeFilter(
+          target.filter, *target.keys, ScanTableSchema(plan));
+  }
+  return scan;
+}
+
+const OutputSchema& ExecutorGenerator::ScanTableSchema(const PlanNode* plan) {
+  auto& table_schema =
+      plan->type_ == PlanType::SeqScan
+          ? static_cast<const SeqScanPlanNode*>(plan)->table_schema_
+          : static_cast<const RangeScanPlanNode*>(plan)->table_schema_;
+  return table_schema.Size() ? table_schema : plan->output_schema_;
+}
+
+std::unique_ptr<SeqScanExecutor> ExecutorGenerator::PruneScanColumns(
+    const PlanNode* plan, std::unique_ptr<SeqScanExecutor> scan) {
+  auto& table_schema = ScanTableSchema(plan);
+  if (&table_schema != &plan->output_schema_)
+    scan->SetOutputColumns(table_schema, plan->output_schema_);
+  return scan;
+}
+
+bool ExecutorGenerator::IsPipeline(const PlanNode* plan) {
+  switch (plan->type_) {
+    case PlanType::SeqScan:
+    case PlanType::RangeScan:
+      return true;
+    case PlanType::Filter:
+    case PlanType::Project:
+      return IsPipeline(plan->ch_.get());
+    case PlanType::HashJoin:
+      // The build side is read before, so only the probe side matters.
+      return IsPipeline(plan->ch2_.get());
+    default:
+      return false;
+  }
+}
+
+std::vector<std::unique_ptr<Executor>> ExecutorGenerator::GeneratePipeline(
+    const PlanNode* plan, DB& db, txn_id_t txn_id, const ExecOptions& options,
+    size_t n, std::vector<std::shared_ptr<JoinBuild>>& builds) {
+  std::vector<std::unique_ptr<Executor>> ret;
+  if (plan->type_ == PlanType::SeqScan || plan->type_ == PlanType::RangeScan) {
+    std::shared_ptr<MorselSource> morsels;
+    const PredicateVec* predicate;
+    if (plan->type_ == PlanType::SeqScan) {
+      auto seqscan_plan = static_cast<const SeqScanPlanNode*>(plan);
+      if (!db.GetDBSchema().Find(seqscan_plan->table_name_)) {
+        throw DBException(
+            "Cannot find table \'{}\'", seqscan_plan->table_name_);
+      }
+      morsels = db.GetMorsels(txn_id, seqscan_plan->table_name_,
+          {std::string_view(), true, true}, {std::string_view(), true, true},
+          n * MORSELS_PER_THREAD);
+      predicate = &seqscan_plan->predicate_;
+    } else {
+      auto rangescan_plan = static_cast<const RangeScanPlanNode*>(plan);
+      if (!db.GetDBSchema().Find(rangescan_plan->table_name_)) {
+        throw DBException(
+            "Cannot find table \'{}\'", rangescan_plan->table_name_);
+      }
+      morsels = db.GetMorsels(txn_id, rangescan_plan->table_name_,
+          convert_bound_from_pair_to_tuple(rangescan_plan->range_l_),
+          convert_bound_from_pair_to_tuple(rangescan_plan->range_r_),
+          n * MORSELS_PER_THREAD);
+      predicate = &rangescan_plan->predicate_;
+    }
+    for (size_t i = 0; i < n; i++) {
+      ret.push_back(PruneScanColumns(plan,
+          std::make_unique<SeqScanExecutor>(
+              morsels, predicate->GenExpr(), ScanTableSchema(plan))));
+    }
+  }
+
+  else if (plan->type_ == PlanType::Filter) {
+    auto filter_plan = static_cast<const FilterPlanNode*>(plan);
+    for (auto& ch : GeneratePipeline(
+             filter_plan->ch_.get(), db, txn_id, options, n, builds)) {
+      ret.push_back(std::make_unique<FilterExecutor>(
+          filter_plan->predicate_.GenExpr(), filter_plan->ch_->output_schema_,
+          std::move(ch)));
+    }
+  }
+
+  else if (plan->type_ == PlanType::Project) {
+    auto project_plan = static_cast<const ProjectPlanNode*>(plan);
+    for (auto& ch : GeneratePipeline(
+             project_plan->ch_.get(), db, txn_id, options, n, builds)) {
+      ret.push_back(std::make_unique<ProjectExecutor>(
+          project_plan->output_exprs_, project_plan->ch_->output_schema_,
+          std::move(ch)));
+    }
+  }
+
+  else if (plan->type_ == PlanType::HashJoin) {
+    auto join_plan = static_cast<const HashJoinPlanNode*>(plan);
+    std::vector<std::unique_ptr<Executor>> inputs;
+    if (IsPipeline(join_plan->ch_.get())) {
+      inputs = GeneratePipeline(
+          join_plan->ch_.get(), db, txn_id, options, n, builds);
+    } else {
+      inputs.push_back(Generate(join_plan->ch_.get(), db, txn_id, options));
+    }
+    auto build = std::make_shared<JoinBuild>(std::move(inputs),
+        join_plan->ch_->output_schema_, join_plan->left_hash_exprs_,
+        options.memory_budget);
+    builds.push_back(build);
+    for (auto& ch : GeneratePipeline(
+             join_plan->ch2_.get(), db, txn_id, options, n, builds)) {
+      ret.push_back(std::make_unique<HashJoinExecutor>(
+          join_plan->predicate_.GenExpr(), join_plan->ch_->output_schema_,
+          join_plan->ch2_->output_schema_, join_plan->output_schema_,
+          std::move(ch), join_plan->left_hash_exprs_,
+          join_plan->right_hash_exprs_, JoinBuild::Table(build)));
+    }
+  }
+
+  else {
+    DB_ERR("Not a pipeline.");
+  }
+  return ret;
+}
+
 }  // namespace wing
\ No newline at end of file
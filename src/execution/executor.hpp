@@ -1,10 +1,18 @@
 #ifndef SAKURA_EXECUTOR_H__
 #define SAKURA_EXECUTOR_H__
 
+#include <algorithm>
+#include <array>
 #include <numeric>
 
 #include "catalog/db.hpp"
 #include "execution/exprdata.hpp"
+#include "execution/group_table.hpp"
+#include "execution/join_hash_table.hpp"
+#include "execution/runtime_filter.hpp"
+#include "execution/spill_file.hpp"
+#include "execution/tuple_sorter.hpp"
+#include "execution/vec_expr.hpp"
 #include "parser/expr.hpp"
 #include "plan/plan.hpp"
 #include "storage/storage.hpp"
@@ -16,6 +24,69 @@
 
 namespace wing {
 
+/**
+ * A batch of at most CAPACITY tuples, which is the unit of NextBatch().
+ *
+ * The executor producing the batch fills Tuples() and calls SetSize(). The
+ * selection vector stores the indexes of the tuples that are still in the
+ * batch, so that filters remove tuples by shrinking it instead of copying
+ * tuples. The i-th tuple of the batch is Tuples()[sel[i]].
+ */
+class TupleBatch {
+ public:
+  static constexpr size_t CAPACITY = 1024;
+
+  size_t Size() const { return size_; }
+  InputTuplePtr operator[](size_t i) const { return tuples_[sel_[i]]; }
+  const uint8_t** Tuples() { return tuples_.data(); }
+  // Select the first "num" tuples in Tuples().
+  void SetSize(size_t num) {
+    std::iota(sel_.begin(), sel_.begin() + num, 0);
+    size_ = num;
+  }
+  void Clear() { size_ = 0; }
+  // Keep the tuples that satisfy "pred".
+  template <typename F>
+  void Select(F&& pred) {
+    size_t num = 0;
+    for (size_t i = 0; i < size_; i++) {
+      // Branch-free, so that the selectivity does not matter.
+      sel_[num] = sel_[i];
+      num += pred(InputTuplePtr(tuples_[sel_[i]])) ? 1 : 0;
+    }
+    size_ = num;
+  }
+  // Keep the i-th tuple iff mask[i] is nonzero.
+  void SelectMask(const uint8_t* mask) {
+    size_t num = 0;
+    for (size_t i = 0; i < size_; i++) {
+      sel_[num] = sel_[i];
+      num += mask[i] != 0;
+    }
+    size_ = num;
+  }
+  // Move the tuples in the batch to the front of Tuples(), so that the i-th
+  // tuple is Tuples()[i]. Column-at-a-time evaluation reads them from there.
+  void Compact() {
+    // The selection vector is increasing, so sel_[i] >= i.
+    for (size_t i = 0; i < size_; i++)
+      tuples_[i] = tuples_[sel_[i]];
+    std::iota(sel_.begin(), sel_.begin() + size_, 0);
+  }
+  // Keep the tuples in [begin, end).
+  void Slice(size_t begin, size_t end) {
+    end = std::min(end, size_);
+    begin = std::min(begin, end);
+    std::copy(sel_.begin() + begin, sel_.begin() + end, sel_.begin());
+    size_ = end - begin;
+  }
+
+ private:
+  std::array<const uint8_t*, CAPACITY> tuples_;
+  std::array<uint16_t, CAPACITY> sel_;
+  size_t size_{0};
+};
+
 /**
  * Init(): Only allocate memory and set some flags, don't evaluate expressions
  * or read/write tuples. Next(): Do operations for each tuple. Return invalid
@@ -33,14 +104,78 @@ class Executor {
   virtual ~Executor() = default;
   virtual void Init() = 0;
   virtual InputTuplePtr Next() = 0;
+  /**
+   * Return the next batch of tuples, or an empty batch if it has completed.
+   * The batch and its tuples are valid until NextBatch() is invoked again. The
+   * caller may shrink the batch, e.g., by Select().
+   *
+   * An executor is driven by either Next() or NextBatch(), but not both. The
+   * default implementation returns batches of one tuple from Next(). Executors
+   * on the hot path of queries override it to process a batch at a time.
+   */
+  virtual TupleBatch& NextBatch();
+
+ private:
+  std::unique_ptr<TupleBatch> single_batch_;
+};
+
+class JoinBuild;
+class SeqScanExecutor;
+class ThreadPool;
+
+/* A runtime filter of a hash join, which is checked by the scan "scan" on
+ * its probe side. "keys" are the probe keys of the join. */
+struct RuntimeFilterTarget {
+  const PlanNode* scan;
+  std::shared_ptr<RuntimeFilter> filter;
+  const std::vector<std::unique_ptr<Expr>>* keys;
+};
+
+/* Options of the executors of a query. */
+struct ExecOptions {
+  /* The memory that an executor may use for the data it holds, e.g., the
+   * build side of a hash join or the tuples of a sort. Beyond it, the data is
+   * spilled to disk. 0 means unlimited. */
+  size_t memory_budget{size_t(2) << 30};
+  /* If not null, the pipelines of scans, filters, projections and hash join
+   * probes are run by the threads of the pool in parallel. */
+  ThreadPool* pool{nullptr};
+  /* The runtime filters of the hash joins above, which are passed down to
+   * the scans they target. */
+  std::vector<RuntimeFilterTarget> runtime_filters;
 };
 
 class ExecutorGenerator {
  public:
-  static std::unique_ptr<Executor> Generate(
-      const PlanNode* plan, DB& db, txn_id_t txn_id);
+  static std::unique_ptr<Executor> Generate(const PlanNode* plan, DB& db,
+      txn_id_t txn_id, const ExecOptions& options = {});
 
  private:
+  /* The number of morsels of a parallel scan per thread. More morsels balance
+   * the load better. */
+  static constexpr size_t MORSELS_PER_THREAD = 16;
+  /* The scan in the probe side "plan" of a hash join whose table has all
+   * columns of the probe keys "keys", or nullptr if there is none. Only inner
+   * joins and filters are above the scan, so a tuple of the scan whose keys
+   * are not on the build side is never joined. */
+  static const PlanNode* FindRuntimeFilterScan(
+      const PlanNode* plan, const std::vector<std::unique_ptr<Expr>>& keys);
+  /* Add the runtime filters of "options" which target "plan" to "scan". */
+  static std::unique_ptr<Executor> AddRuntimeFilters(const PlanNode* plan,
+      std::unique_ptr<SeqScanExecutor> scan, const ExecOptions& options);
+  /* The schema of the raw rows that the scan "plan" reads, on which its
+   * predicate and runtime filters are evaluated. */
+  static const OutputSchema& ScanTableSchema(const PlanNode* plan);
+  /* Make "scan" output only the columns of "plan" if they are pruned. */
+  static std::unique_ptr<SeqScanExecutor> PruneScanColumns(
+      const PlanNode* plan, std::unique_ptr<SeqScanExecutor> scan);
+  /* Whether "plan" is a pipeline, which can be run by several copies. */
+  static bool IsPipeline(const PlanNode* plan);
+  /* Generate "n" copies of the pipeline "plan". The JoinBuilds of its hash
+   * joins are appended to "builds" in the order to build them. */
+  static std::vector<std::unique_ptr<Executor>> GeneratePipeline(
+      const PlanNode* plan, DB& db, txn_id_t txn_id, const ExecOptions& options,
+      size_t n, std::vector<std::shared_ptr<JoinBuild>>& builds);
 };
 
 // TASK1
@@ -75,14 +210,16 @@ private:
   bool read;
   InputTuplePtr v2;
   InputTuplePtr v1; TupleStore t; size_t p;
-  StaticFieldRef *out;
-  void merge()
+  StaticFieldRef *out; bool raw2=is2.IsRaw();
+  void merge(){ merge(out); }
+  void merge(StaticFieldRef *o)
   {
-    memcpy(out,v1.Data(),sizeof(StaticFieldRef*)*is1.Size());
-    if(is2.IsRaw()) Tuple::DeSerialize(out+is1.Size(),v2.Data(),is2.GetCols());
-    else memcpy(out+is1.Size(),v2.Data(),sizeof(StaticFieldRef*)*is2.Size());
+    memcpy(o,v1.Data(),sizeof(StaticFieldRef*)*is1.Size());
+    if(raw2) Tuple::DeSerialize(o+is1.Size(),v2.Data(),is2.GetCols());
+    else memcpy(o+is1.Size(),v2.Data(),sizeof(StaticFieldRef*)*is2.Size());
   }
   friend class HashJoinExecutor;
+  friend class MergeSortJoinExecutor;
 };
 
 class naive_hash
@@ -105,205 +242,617 @@ public:
     uint64_t ret=sed; for(auto i:e) ret=hash_(in,i,ret); return ret;
   }
 };
-class HashJoinExecutor:public NestloopJoinExecutor,public naive_hash
+// The build side (the first child) is read into a JoinHashTable, and the second child probes it a batch at a time. Next() returns the tuples of
+// the batches one by one.
+// If the build side exceeds the memory budget, it becomes a hybrid hash join. The build rows are radix-partitioned by the hash of their keys,
+// and the largest partitions are spilled to disk until the rest fit in the budget. The probe tuples of the partitions in memory are joined at
+// once, and the others are spilled. Then the spilled partitions are joined one at a time, and those that still do not fit are partitioned
+// again with the next bits of the hash.
+class HashJoinExecutor:public NestloopJoinExecutor
 {
  public:
-  HashJoinExecutor(const std::unique_ptr<Expr>& expr, const OutputSchema& In1, const OutputSchema& In2, const OutputSchema& Out, std::unique_ptr<Executor> ch1,std::unique_ptr<Executor> ch2,const std::vector<std::unique_ptr<Expr>> &ex1,const std::vector<std::unique_ptr<Expr>> &ex2)
-      :NestloopJoinExecutor(expr,In1,In2,Out,std::move(ch1),std::move(ch2)){ for(size_t i=0;i<ex1.size();i++)
-        { e1.push_back(std::make_pair(ExprFunction(ex1[i].get(),In1),ex1[i]->ret_type_));
-          e2.push_back(std::make_pair(ExprFunction(ex2[i].get(),In2),ex2[i]->ret_type_)); } }
+  HashJoinExecutor(const std::unique_ptr<Expr>& expr, const OutputSchema& In1, const OutputSchema& In2, const OutputSchema& Out, std::unique_ptr<Executor> ch1,std::unique_ptr<Executor> ch2,const std::vector<std::unique_ptr<Expr>> &ex1,const std::vector<std::unique_ptr<Expr>> &ex2,const ExecOptions& options)
+      :NestloopJoinExecutor(expr,In1,In2,Out,std::move(ch1),std::move(ch2)),s1(In1),s2(In2),budget(options.memory_budget)
+  {
+    // The build keys are evaluated on the copies of the rows, whose strings stay valid, and which are arrays of StaticFieldRef. So are the
+    // keys of the spilled probe tuples.
+    s1.SetRaw(false); s2.SetRaw(false);
+    for(size_t i=0;i<ex1.size();i++)
+    {
+      ve1.emplace_back(ex1[i].get(),s1); ve2.emplace_back(ex2[i].get(),In2); ve2s.emplace_back(ex2[i].get(),s2); types.push_back(ex1[i]->ret_type_);
+    }
+    ht=JoinHashTable(types); k.resize(TupleBatch::CAPACITY*types.size());
+  }
+  // A copy of a parallel hash join, which only probes "table". The table is built by a JoinBuild, which it keeps alive.
+  HashJoinExecutor(const std::unique_ptr<Expr>& expr, const OutputSchema& In1, const OutputSchema& In2, const OutputSchema& Out, std::unique_ptr<Executor> ch2,const std::vector<std::unique_ptr<Expr>> &ex1,const std::vector<std::unique_ptr<Expr>> &ex2,std::shared_ptr<const JoinHashTable> table)
+      :HashJoinExecutor(expr,In1,In2,Out,nullptr,std::move(ch2),ex1,ex2,ExecOptions{}){ shared=std::move(table); H=shared.get(); read=true; }
+  void Init()override{ if(c1) c1->Init(); c2->Init(); }
+  // The keys of the build side are inserted into "filter", which is published before the probe side is read.
+  void SetRuntimeFilter(std::shared_ptr<RuntimeFilter> filter){ rf=std::move(filter); }
   InputTuplePtr Next()override
   {
-    if(!read)
+    if(oi==ob->Size()){ ob=&NextBatch(); oi=0; if(!ob->Size()) return InputTuplePtr(); }
+    return (*ob)[oi++];
+  }
+  TupleBatch& NextBatch()override
+  {
+    if(!read){ read=true; build(); }
+    size_t w=os.Size(),n=0,nk=types.size(); if(rows.size()<TupleBatch::CAPACITY*w) rows.resize(TupleBatch::CAPACITY*w);
+    while(n<TupleBatch::CAPACITY)
+    {
+      if(p<pe)
+      {
+        size_t i=p++;
+        if(!H->Match(i,ph[cur],pk.data()+cur*nk))
+          continue;
+        v1=H->Row(i);
+        StaticFieldRef *o=rows.data()+n*w;
+        merge(o);
+        if(predicate_&&predicate_.Evaluate(o).ReadInt()==false)
+          continue;
+        batch_.Tuples()[n++]=(const uint8_t*)o;
+        continue;
+      }
+      if(probe!=nullptr&&pi<probe->Size())
+      {
+        cur=pi++;
+        v2=probe->Tuples()[cur];
+        p=pb[cur];
+        pe=pend[cur];
+        continue;
+      }
+      // The output refers to the strings of the probe batch and the build rows, so they are replaced in the next call.
+      if(n||probe_done) break;
+      next_probe();
+    }
+    batch_.SetSize(n); return batch_;
+  }
+ private:
+  static constexpr int FANOUT_BITS=5,MAX_LEVEL=3;
+  // The build rows of a partition are in memory unless it is spilled.
+  struct Part
+  {
+    Part(const OutputSchema& b,const OutputSchema& pr,int l):rows(b),build(b),probe(pr),level(l){}
+    TupleStore rows; SpillFile build,probe; bool spilled=false; int level;
+  };
+  // The buckets use the high bits of the hash, and the other bits are zero for e.g. integer-valued floats, so the
+  // partitions use the high bits of the remixed hash, which are independent of the buckets.
+  size_t part_of(uint64_t hash,int level){ return (utils::Fmix64(hash)>>(64-(level+1)*FANOUT_BITS))&((1<<FANOUT_BITS)-1); }
+  // The memory of the build rows and their hash table.
+  size_t footprint(size_t bytes,size_t num){ return bytes+num*(types.size()+2)*sizeof(StaticFieldRef)*2; }
+  size_t footprint(const TupleStore& s){ return footprint(s.MemoryUsage(),s.GetPointerVec().size()); }
+  // Evaluate the keys of the build rows into k.
+  void keys(const uint8_t* const* r,size_t m){ for(size_t j=0;j<types.size();j++) ve1[j].Evaluate(r,m,k.data()+j,types.size()); }
+  void add(const TupleStore& s)
+  {
+    auto &r=s.GetPointerVec();
+    for(size_t i=0;i<r.size();i+=TupleBatch::CAPACITY)
+    {
+      size_t m=std::min(TupleBatch::CAPACITY,r.size()-i); keys(r.data()+i,m);
+      for(size_t j=0;j<m;j++) ht.Append(k.data()+j*types.size(),r[i+j]);
+    }
+  }
+  void build()
+  {
+    auto &r=t.GetPointerVec();
+    // Nobody checks the filter if no scan is generated for it.
+    if(rf.use_count()==1) rf=nullptr;
+    for(TupleBatch *b;(b=&c1->NextBatch())->Size();)
+    {
+      size_t s=r.size(),m=b->Size(); for(size_t i=0;i<m;i++) t.Append((*b)[i].Data());
+      if(rf){ keys(r.data()+s,m); for(size_t i=0;i<m;i++) rf->Insert(k.data()+i*types.size()); }
+      if(!parts.empty()){ distribute(); continue; }
+      if(!rf) keys(r.data()+s,m);
+      for(size_t i=0;i<m;i++) ht.Append(k.data()+i*types.size(),r[s+i]);
+      if(budget&&footprint(t)>budget)
+      {
+        for(int i=0;i<(1<<FANOUT_BITS);i++) parts.push_back(std::make_unique<Part>(s1,is2,0));
+        ht=JoinHashTable(types); distribute();
+      }
+    }
+    for(auto &q:parts) if(!q->spilled) add(q->rows);
+    ht.Build(); p=pe=0; if(rf) rf->Publish();
+  }
+  // Move the rows in t to the partitions, and spill the largest partitions until the rest fit in the budget.
+  void distribute()
+  {
+    auto &r=t.GetPointerVec();
+    for(size_t i=0;i<r.size();i+=TupleBatch::CAPACITY)
     {
-      std::vector<uint64_t> H;
-      std::vector<StaticFieldRef*> refs;
-      read=true; while((v1=c1->Next())){ H.push_back(hash(v1,e1)); t.Append(v1.Data()); refs.push_back((StaticFieldRef*)t.GetPointerVec().back()); }
-      while(hash_map_size<H.size()) hash_map_size<<=1;; h.resize(hash_map_size); std::vector<size_t> map_size(hash_map_size); hash_map_size--;
-      for(size_t i=0;i<H.size();i++) map_size[H[i]&hash_map_size]++;
-      for(size_t i=0;i<hash_map_size;i++) h[i].reserve(map_size[i]);
-      for(size_t i=0;i<H.size();i++) h[H[i]&hash_map_size].push_back({H[i],refs[i]});
-      Next2();
+      size_t m=std::min(TupleBatch::CAPACITY,r.size()-i); keys(r.data()+i,m);
+      for(size_t j=0;j<m;j++)
+      {
+        auto &q=*parts[part_of(ht.Hash(k.data()+j*types.size()),0)];
+        if(q.spilled) q.build.Append(r[i+j]); else q.rows.Append(r[i+j]);
+      }
     }
+    t=TupleStore(is1);
     while(true)
     {
-      if(!v2)
+      size_t total=0; Part *big=nullptr;
+      for(auto &q:parts) if(!q->spilled){ total+=footprint(q->rows); if(!big||footprint(q->rows)>footprint(big->rows)) big=q.get(); }
+      if(total<=budget||!big) break;
+      for(auto row:big->rows.GetPointerVec()) big->build.Append(row);
+      big->rows=TupleStore(s1); big->spilled=true;
+    }
+  }
+  // Read the next batch of probe tuples: from the second child, and then from the spilled partitions.
+  void next_probe()
+  {
+    pi=0;
+    if(!c2_done){ probe=&c2->NextBatch(); if(probe->Size()){ lookup(ve2); return; } c2_done=true; raw2=false; }
+    while(true)
+    {
+      if(part!=nullptr)
       {
-        // if(output_size){ printf("Hash join finish, output size= %lu\n",output_size); fflush(stdout); output_size=0; }
-        return v2;
+        ps=TupleStore(s2); size_t m=part->probe.Read(ps,TupleBatch::CAPACITY);
+        if(m){ std::copy_n(ps.GetPointerVec().begin(),m,pbatch.Tuples()); pbatch.SetSize(m); probe=&pbatch; lookup(ve2s); return; }
       }
-      if(T==nullptr||p==T->size()){ Next2(); continue; } auto V1=(*T)[p++];
-      if(V1.first!=H2) continue; v1=V1.second;
-      merge(); if(predicate_&&predicate_.Evaluate(out).ReadInt()==false) continue;
-      output_size++;
-      return out;
+      if(!next_part()){ probe=nullptr; probe_done=true; return; }
+    }
+  }
+  // Load the next spilled partition into the hash table.
+  bool next_part()
+  {
+    for(auto &q:parts) if(q->spilled) todo.push_back(std::move(q));
+    parts.clear(); part=nullptr; loaded=TupleStore(s1); ht=JoinHashTable(types);
+    while(!todo.empty())
+    {
+      auto q=std::move(todo.back()); todo.pop_back();
+      if(!q->build.Size()||!q->probe.Size()) continue;
+      if(q->level<MAX_LEVEL&&footprint(q->build.Bytes(),q->build.Size())>budget){ repartition(*q); continue; }
+      while(q->build.Read(loaded,TupleBatch::CAPACITY));
+      add(loaded); ht.Build(); part=std::move(q); return true;
+    }
+    return false;
+  }
+  // Partition the spilled rows and probe tuples again with the next bits of their hashes.
+  void repartition(Part &q)
+  {
+    std::vector<std::unique_ptr<Part>> sub;
+    for(int i=0;i<(1<<FANOUT_BITS);i++) sub.push_back(std::make_unique<Part>(s1,s2,q.level+1));
+    for(TupleStore s(s1);q.build.Read(s,TupleBatch::CAPACITY);s=TupleStore(s1))
+    {
+      auto &r=s.GetPointerVec(); keys(r.data(),r.size());
+      for(size_t i=0;i<r.size();i++) sub[part_of(ht.Hash(k.data()+i*types.size()),q.level+1)]->build.Append(r[i]);
+    }
+    for(TupleStore s(s2);q.probe.Read(s,TupleBatch::CAPACITY);s=TupleStore(s2))
+    {
+      auto &r=s.GetPointerVec(); for(size_t j=0;j<types.size();j++) ve2s[j].Evaluate(r.data(),r.size(),k.data()+j,types.size());
+      for(size_t i=0;i<r.size();i++) sub[part_of(ht.Hash(k.data()+i*types.size()),q.level+1)]->probe.Append(r[i]);
+    }
+    for(auto &x:sub) todo.push_back(std::move(x));
+  }
+  // Evaluate the keys of the probe batch and find their buckets. The buckets, and then the first entries, of all tuples are prefetched
+  // before they are used, so that the cache misses overlap. The tuples of the spilled partitions are spilled instead.
+  void lookup(std::vector<VecExprFunction> &ve)
+  {
+    probe->Compact(); size_t m=probe->Size(),nk=types.size(); pk.resize(m*nk); ph.resize(m); pb.resize(m); pend.resize(m);
+    for(size_t j=0;j<nk;j++) ve[j].Evaluate(probe->Tuples(),m,pk.data()+j,nk);
+    for(size_t i=0;i<m;i++){ ph[i]=H->Hash(pk.data()+i*nk); H->Prefetch(H->Bucket(ph[i])); }
+    for(size_t i=0;i<m;i++){ size_t b=H->Bucket(ph[i]); pb[i]=H->Begin(b); pend[i]=H->End(b); H->PrefetchEntry(pb[i]); }
+    if(parts.empty()) return;
+    for(size_t i=0;i<m;i++)
+    {
+      auto &q=*parts[part_of(ph[i],0)];
+      if(q.spilled){ q.probe.Append(probe->Tuples()[i]); pb[i]=pend[i]=0; }
+    }
+  }
+  OutputSchema s1,s2; size_t budget; std::vector<RetType> types;
+  std::vector<VecExprFunction> ve1,ve2,ve2s; std::vector<StaticFieldRef> k;
+  std::shared_ptr<RuntimeFilter> rf;
+  // The probe tuple is matched against the entries [p, pe) of the hash table H, which is ht unless it is shared by the copies of a parallel
+  // hash join.
+  JoinHashTable ht; size_t pe=0; const JoinHashTable *H=&ht; std::shared_ptr<const JoinHashTable> shared;
+  // The output rows, the probe batch being read, and the keys, hashes and entries of its tuples.
+  std::vector<StaticFieldRef> rows; TupleBatch batch_;
+  TupleBatch *probe=nullptr; size_t pi=0,cur=0; bool c2_done=false,probe_done=false;
+  std::vector<StaticFieldRef> pk; std::vector<uint64_t> ph; std::vector<size_t> pb,pend;
+  // The partitions of the build side if it exceeds the budget, the spilled partitions to join, and the one being joined, whose build rows
+  // are in loaded and whose probe tuples are read into ps.
+  std::vector<std::unique_ptr<Part>> parts,todo; std::unique_ptr<Part> part;
+  TupleStore loaded,ps; TupleBatch pbatch;
+  // State of Next().
+  TupleBatch *ob=&batch_; size_t oi=0;
+};
+
+// Both children are sorted by their merge keys. For each probe tuple from the second child, the first child is read up to its key, and the
+// run of build tuples with that key is copied, so that the following probe tuples with the same key are joined with the run again. A
+// build tuple is only compared with the probe tuples around its key, and no hash table is built. The copies of the old runs are dropped
+// from time to time.
+class MergeSortJoinExecutor:public NestloopJoinExecutor
+{
+ public:
+  MergeSortJoinExecutor(const std::unique_ptr<Expr>& expr, const OutputSchema& In1, const OutputSchema& In2, const OutputSchema& Out, std::unique_ptr<Executor> ch1,std::unique_ptr<Executor> ch2,const std::unique_ptr<Expr> &ex1,const std::unique_ptr<Expr> &ex2)
+      :NestloopJoinExecutor(expr,In1,In2,Out,std::move(ch1),std::move(ch2)),s1(In1.GetCols()),k1(ex1.get(),In1),k1s(ex1.get(),s1),k2(ex2.get(),In2),type(ex1->ret_type_){}
+  void Init()override{ c1->Init(); c2->Init(); t=TupleStore(is1); old.clear(); lb=rb=&empty; li=ri=0; l=v2=InputTuplePtr(); lo=hi=p=0; started=done=false; ob=&batch_; oi=0; }
+  InputTuplePtr Next()override
+  {
+    if(oi==ob->Size()){ ob=&NextBatch(); oi=0; if(!ob->Size()) return InputTuplePtr(); }
+    return (*ob)[oi++];
+  }
+  TupleBatch& NextBatch()override
+  {
+    if(!started){ started=true; next_left(); }
+    // The output refers to the copies of the runs and the strings of the probe batch, so they are dropped in the next call.
+    old.clear();
+    size_t w=os.Size(),n=0; if(rows.size()<TupleBatch::CAPACITY*w) rows.resize(TupleBatch::CAPACITY*w);
+    while(n<TupleBatch::CAPACITY&&!done)
+    {
+      if(p<hi)
+      {
+        v1=t.GetPointerVec()[p++];
+        StaticFieldRef *o=rows.data()+n*w; merge(o); if(predicate_&&predicate_.Evaluate(o).ReadInt()==false) continue;
+        batch_.Tuples()[n++]=(const uint8_t*)o; continue;
+      }
+      if(ri==rb->Size())
+      {
+        if(n) break;
+        rb=&c2->NextBatch(); ri=0; if(!rb->Size()){ done=true; break; }
+      }
+      v2=(*rb)[ri++]; StaticFieldRef k=k2.Evaluate(v2);
+      if(lo<hi&&cmp(rk,k)==0){ p=lo; continue; }
+      while(l&&cmp(lk,k)<0) next_left();
+      if(!l||cmp(lk,k)>0)
+      {
+        // The probe keys are ascending, so nothing is joined after the build side ends.
+        if(!l) done=true;
+        lo=hi=p=0; continue;
+      }
+      if(t.GetPointerVec().size()>=TupleBatch::CAPACITY){ old.push_back(std::move(t)); t=TupleStore(is1); }
+      lo=t.GetPointerVec().size(); while(l&&cmp(lk,k)==0){ t.Append(l.Data()); next_left(); }
+      hi=t.GetPointerVec().size(); p=lo; rk=k1s.Evaluate(t.GetPointerVec()[lo]);
     }
+    batch_.SetSize(n); return batch_;
   }
  private:
-  size_t hash_map_size=1;
-  std::vector<std::pair<ExprFunction,RetType>> e1,e2;
-  std::vector<std::vector<std::pair<uint64_t,StaticFieldRef*> > > h;
-  std::vector<std::pair<uint64_t,StaticFieldRef*> > *T;
-  uint64_t H2;
-  void Next2()
+  int cmp(StaticFieldRef a,StaticFieldRef b)
   {
-    v2=c2->Next(); if(!v2){ T=nullptr; return; }
-    p=0; H2=hash(v2,e2); T=&h[H2&hash_map_size];
+    switch(type)
+    {
+    case RetType::INT: return (a.ReadInt()>b.ReadInt())-(a.ReadInt()<b.ReadInt());
+    case RetType::FLOAT: return (a.ReadFloat()>b.ReadFloat())-(a.ReadFloat()<b.ReadFloat());
+    case RetType::STRING: return a.ReadStringView().compare(b.ReadStringView());
+    }
+    return 0;
   }
+  // Read the next build tuple into l, and its key into lk.
+  void next_left()
+  {
+    if(li==lb->Size()){ lb=&c1->NextBatch(); li=0; if(!lb->Size()){ l=InputTuplePtr(); return; } }
+    l=(*lb)[li++]; lk=k1.Evaluate(l);
+  }
+
+  OutputSchema s1; // the schema of the copies of the build tuples
+  ExprFunction k1,k1s,k2; // the merge keys of the build tuples, their copies and the probe tuples
+  RetType type;
+  TupleBatch empty,*lb=&empty,*rb=&empty; size_t li=0,ri=0; // the current batches of the children
+  InputTuplePtr l; StaticFieldRef lk,rk; // the next build tuple and its key, and the key of the run
+  size_t lo=0,hi=0; // the run is [lo, hi) in t, and p is the next tuple of the run to join with v2
+  std::vector<TupleStore> old;
+  std::vector<StaticFieldRef> rows; TupleBatch batch_;
+  bool started=false,done=false;
+  TupleBatch *ob=&batch_; size_t oi=0;
+};
+
+// The second child is a scan of a table whose primary key equals the key of the first child, so it is not executed. Instead, the keys of each
+// batch of the first child are sorted, and the rows with them are found by SearchHandle::SearchSorted, which goes down the B+tree only when
+// a key is beyond the current leaf. Each probe tuple joins at most one row, so a probe batch gives at most one output batch. The predicate
+// of the scan is checked on the rows found.
+class IndexNestloopJoinExecutor:public Executor
+{
+ public:
+  IndexNestloopJoinExecutor(const std::unique_ptr<Expr>& expr, const OutputSchema& In1, const OutputSchema& In2, const OutputSchema& Out, std::unique_ptr<Executor> ch1,std::unique_ptr<SearchHandle> handle,const std::unique_ptr<Expr> &key,const std::unique_ptr<Expr> &pred2)
+      :predicate_(expr.get(),Out),k1(key.get(),In1),p2(pred2.get(),In2),is1(In1),is2(In2),os(Out),c1(std::move(ch1)),h(std::move(handle)),type(key->ret_type_){}
+  void Init()override{ c1->Init(); h->Init(); ob=&batch_; oi=0; }
+  InputTuplePtr Next()override
+  {
+    if(oi==ob->Size()){ ob=&NextBatch(); oi=0; if(!ob->Size()) return InputTuplePtr(); }
+    return (*ob)[oi++];
+  }
+  TupleBatch& NextBatch()override
+  {
+    size_t w=os.Size(),w1=is1.Size(); if(rows.size()<TupleBatch::CAPACITY*w) rows.resize(TupleBatch::CAPACITY*w);
+    while(true)
+    {
+      auto &b=c1->NextBatch(); size_t m=b.Size(); if(!m){ batch_.Clear(); return batch_; }
+      keys.resize(m); strs.resize(m); idx.resize(m); pos.resize(m); views.clear();
+      // The views refer to keys and strs, so they are made after both are filled.
+      for(size_t i=0;i<m;i++){ keys[i]=k1.Evaluate(b[i]); if(type==RetType::STRING) strs[i]=keys[i].ReadStringView(); idx[i]=i; }
+      auto view=[&](size_t i){ return type==RetType::STRING?std::string_view(strs[i]):std::string_view((const char*)&keys[i],sizeof(StaticFieldRef)); };
+      std::sort(idx.begin(),idx.end(),[&](size_t x,size_t y){ return cmp(x,y)<0; });
+      // Equal keys are searched once.
+      for(size_t j=0;j<m;j++){ if(!j||cmp(idx[j-1],idx[j])) views.push_back(view(idx[j])); pos[idx[j]]=views.size()-1; }
+      found.resize(views.size()); h->SearchSorted(views.data(),views.size(),found.data());
+      size_t n=0;
+      for(size_t i=0;i<m;i++)
+      {
+        const uint8_t *r=found[pos[i]]; if(!r||(p2&&p2.Evaluate(r).ReadInt()==false)) continue;
+        StaticFieldRef *o=rows.data()+n*w;
+        if(is1.IsRaw()) Tuple::DeSerialize(o,b[i].Data(),is1.GetCols()); else memcpy(o,b[i].Data(),sizeof(StaticFieldRef)*w1);
+        Tuple::DeSerialize(o+w1,r,is2.GetCols()); if(predicate_&&predicate_.Evaluate(o).ReadInt()==false) continue;
+        batch_.Tuples()[n++]=(const uint8_t*)o;
+      }
+      // Do not return an empty batch unless the first child has completed.
+      if(n){ batch_.SetSize(n); return batch_; }
+    }
+  }
+ private:
+  int cmp(size_t x,size_t y)
+  {
+    switch(type)
+    {
+    case RetType::INT: return (keys[x].ReadInt()>keys[y].ReadInt())-(keys[x].ReadInt()<keys[y].ReadInt());
+    case RetType::FLOAT: return (keys[x].ReadFloat()>keys[y].ReadFloat())-(keys[x].ReadFloat()<keys[y].ReadFloat());
+    case RetType::STRING: return strs[x].compare(strs[y]);
+    }
+    return 0;
+  }
+
+  ExprFunction predicate_,k1,p2; // the join predicate, the key of the probe tuples and the predicate of the scan
+  const OutputSchema is1,is2,os;
+  std::unique_ptr<Executor> c1;
+  std::unique_ptr<SearchHandle> h;
+  RetType type;
+  std::vector<StaticFieldRef> keys; std::vector<std::string> strs; // the keys of the probe batch, and the copies of the string keys
+  std::vector<size_t> idx,pos; // the probe tuples in the order of their keys, and the index of the key of each probe tuple in views
+  std::vector<std::string_view> views; std::vector<const uint8_t*> found; // the distinct keys in ascending order and the rows with them
+  std::vector<StaticFieldRef> rows; TupleBatch batch_;
+  TupleBatch *ob=&batch_; size_t oi=0;
 };
 
 // TASK2
-class HashAggregateExecutor:public Executor,public naive_hash
+// Groups are stored in a GroupTable: the keys are evaluated once per tuple and compared as bytes, and the aggregate states of a group are
+// in one arena row with them, so no memory is allocated per group. Only the first tuple of each group is stored, for LastEvaluate.
+class HashAggregateExecutor:public Executor
 {
  public:
   HashAggregateExecutor(const std::unique_ptr<Expr>& Gc, const OutputSchema& Is, const OutputSchema& Os, std::unique_ptr<Executor> ch1,
                         const std::vector<std::unique_ptr<Expr>> &Oe,const std::vector<std::unique_ptr<Expr>> &Ge)
-      : is(Is.GetCols()), os(Os), gc(Gc.get(),Is), e(std::move(ch1)), t(Is)
+      : is(Is), os(Os), gc(Gc.get(),Is), e(std::move(ch1)), t(Is), g(types(Ge),states(Oe,Gc,Is))
       {
-        // print_log;
-        //assert(Oe.size()==Os.Size()); assert(Os.IsRaw()==false);
+        // The tuples are aggregated as they are, maybe raw, and LastEvaluate reads the stored rows, which are not raw.
         for(size_t i=0;i<Oe.size();i++) oe.push_back(AggregateExprFunction(Oe[i].get(),is));
-        for(size_t i=0;i<Ge.size();i++) ge.push_back(std::make_pair(ExprFunction(Ge[i].get(),is),Ge[i]->ret_type_));
-        out=new StaticFieldRef[Os.Size()]; _gc=(bool)gc;
+        for(size_t i=0;i<Ge.size();i++) ge.push_back(ExprFunction(Ge[i].get(),is));
+        _gc=(bool)gc; k.resize(ge.size()); out.resize(Os.Size());
+        off.push_back(0); for(auto &i:oe) off.push_back(off.back()+i.GetImmediateDataSize());
       }
-  ~HashAggregateExecutor()override{ delete[] out; for(auto i:a) for(auto j:i.second) delete[] j; }
   void Init()override{ e->Init(); calculated=false; }
-  void calc()
+  void calc(bool batch=false)
   {
-    InputTuplePtr v;
-    while((v=e->Next()))
+    if(batch){ for(TupleBatch *b;(b=&e->NextBatch())->Size();) for(size_t i=0;i<b->Size();i++) add((*b)[i]); }
+    else{ InputTuplePtr v; while((v=e->Next())) add(v); }
+    ptr=0;
+  }
+  void add(InputTuplePtr in)
+  {
+    for(size_t i=0;i<ge.size();i++) k[i]=ge[i].Evaluate(in);
+    auto [p,inserted]=g.FindOrInsert(k.data()); AggregateIntermediateData *d=GroupTable::States(p);
+    if(inserted)
     {
-      input_size++;
-      t.Append(v.Data()); StaticFieldRef* v=(StaticFieldRef*)t.GetPointerVec().back();
-      std::vector<size_t> &H=h[hash(v,ge)]; int id=-1;
-      for(auto i:H) if(in_same_group(ge,v,a[i].first)) id=i;
-      if(id==-1)
-      {
-        H.push_back(id=a.size());
-        std::vector<AggregateIntermediateData*> m;
-        for(auto i:oe) m.push_back(new AggregateIntermediateData[i.GetImmediateDataSize()]);
-        if(_gc) m.push_back(new AggregateIntermediateData[gc.GetImmediateDataSize()]);
-        a.push_back({v,m});
-        for(size_t i=0;i<oe.size();i++) oe[i].FirstEvaluate(a[id].second[i],v);
-        if(_gc) gc.FirstEvaluate(a[id].second.back(),v);
-      }
-      else
-      {
-        for(size_t i=0;i<oe.size();i++) oe[i].Aggregate(a[id].second[i],v);
-        if(_gc) gc.Aggregate(a[id].second.back(),v);
-      }
+      t.Append(in.Data()); GroupTable::Row(p)=t.GetPointerVec().back();
+      for(size_t i=0;i<oe.size();i++) oe[i].FirstEvaluate(d+off[i],in);
+      if(_gc) gc.FirstEvaluate(d+off.back(),in);
+    }
+    else
+    {
+      for(size_t i=0;i<oe.size();i++) oe[i].Aggregate(d+off[i],in);
+      if(_gc) gc.Aggregate(d+off.back(),in);
     }
-    // std::cout<<"Aggregate init finished, input size= "<<input_size<<std::endl;
-    ptr=0;
+  }
+  // Evaluate the outputs of the group to o, or return false if it is filtered by the group checker
+  bool eval(uint8_t *p,StaticFieldRef *o)
+  {
+    AggregateIntermediateData *d=GroupTable::States(p); InputTuplePtr r=GroupTable::Row(p);
+    if(_gc&&gc.LastEvaluate(d+off.back(),r).ReadInt()==0) return false;
+    for(size_t i=0;i<oe.size();i++) o[i]=oe[i].LastEvaluate(d+off[i],r);
+    return true;
   }
   InputTuplePtr Next()override
   {
     if(!calculated){ calc(); calculated=true; }
-    while(true)
+    while(ptr<g.Size()) if(eval(g.Groups()[ptr++],out.data())) return out.data();
+    return InputTuplePtr();
+  }
+  TupleBatch& NextBatch()override
+  {
+    if(!calculated){ calc(true); calculated=true; }
+    size_t w=os.Size(),n=0; if(rows.size()<TupleBatch::CAPACITY*w) rows.resize(TupleBatch::CAPACITY*w);
+    while(n<TupleBatch::CAPACITY&&ptr<g.Size())
     {
-      if(ptr==a.size()) return InputTuplePtr();
-      auto &ret=a[ptr++];
-      if(_gc&&gc.LastEvaluate(ret.second.back(),ret.first).ReadInt()==0) continue;
-      for(size_t i=0;i<oe.size();i++) out[i]=oe[i].LastEvaluate(ret.second[i],ret.first);
-      return out;
+      StaticFieldRef *o=rows.data()+n*w;
+      if(eval(g.Groups()[ptr++],o)) batch_.Tuples()[n++]=(const uint8_t*)o;
     }
+    batch_.SetSize(n); return batch_;
   }
 private:
-  size_t input_size=0;
+  static std::vector<RetType> types(const std::vector<std::unique_ptr<Expr>> &Ge){ std::vector<RetType> r; for(auto &i:Ge) r.push_back(i->ret_type_); return r; }
+  static size_t states(const std::vector<std::unique_ptr<Expr>> &Oe,const std::unique_ptr<Expr>& Gc,const OutputSchema& Is)
+  {
+    size_t r=AggregateExprFunction(Gc.get(),Is).GetImmediateDataSize();
+    for(auto &i:Oe) r+=AggregateExprFunction(i.get(),Is).GetImmediateDataSize();
+    return r;
+  }
+
+  std::vector<StaticFieldRef> rows; TupleBatch batch_; // Output of NextBatch()
 
   OutputSchema is,os; // Input/Output Schema
   AggregateExprFunction gc; // Group Checker
   bool _gc;
   std::unique_ptr<Executor> e; // child Executor
   std::vector<AggregateExprFunction> oe; // Output Expr (Function), return type is equal to output schema
-  std::vector<std::pair<ExprFunction,RetType> > ge; // Group Expr (Function)
-  TupleStore t; // Tuple store
-
-  std::unordered_map<uint64_t,std::vector<size_t> > h; // Hash map
-  std::vector<std::pair<StaticFieldRef*,std::vector<AggregateIntermediateData*> > > a; // groups store: first tuple in the group, and all the intermediatedata. the intermediatedata of checker is the last one.
+  std::vector<ExprFunction> ge; // Group Expr (Function)
+  TupleStore t; // first tuple of each group
+  GroupTable g; // groups: the intermediatedata of output exprs at off[i], and that of the checker at off.back()
+  std::vector<size_t> off;
+  std::vector<StaticFieldRef> k; // keys of the current tuple
 
   bool calculated; size_t ptr;
 
-  StaticFieldRef* out;
-
-  bool in_same_group(std::vector<std::pair<ExprFunction,RetType> > e,StaticFieldRef* a,StaticFieldRef* b)
-  {
-    for(auto i:e)
-    {
-      switch (i.second)
-      {
-      case RetType::INT:
-        if(i.first.Evaluate(a).ReadInt()!=i.first.Evaluate(b).ReadInt()) return false;
-        break;
-      case RetType::FLOAT:
-        if(i.first.Evaluate(a).ReadFloat()!=i.first.Evaluate(b).ReadFloat()) return false;
-        break;
-      case RetType::STRING:
-        if(i.first.Evaluate(a).ReadStringView()!=i.first.Evaluate(b).ReadStringView()) return false;
-        break;
-      default:
-        assert(false);
-      }
-    }
-    return true;
-  }
+  std::vector<StaticFieldRef> out;
 };
 
 // TASK3
-namespace _SORT_
+// The tuples are sorted by a TupleSorter. If the stored tuples exceed the memory budget, it becomes an external merge sort. The tuples
+// read so far are sorted and spilled as a run, and then the next run starts. With a thread pool, each run is split into one slice per
+// thread, and the slices are sorted and spilled in parallel as separate runs. At the end, the runs are merged with a loser tree, reading
+// a chunk of each run at a time.
+class OrderExecutor:public Executor
 {
-  static std::vector<std::pair<RetType, bool>> oe;
-  static int cmp(StaticFieldRef *a,StaticFieldRef *b)
+public:
+  OrderExecutor(const OutputSchema& Is,const OutputSchema& Os,std::unique_ptr<Executor> ch,std::vector<std::pair<RetType, bool>> Oe,const ExecOptions& options={})
+      :is(Is),os(Os),e(std::move(ch)),oe(Oe),sorter(Oe),t(Is),budget(options.memory_budget),pool(options.pool){ out.resize(Os.Size()); ss=Is; ss.SetRaw(false); }
+  void Init()override{ e->Init(); calculated=false; }
+  void calc(bool batch=false)
+  {
+    t=TupleStore(is); t_.clear(); runs.clear(); bufs.clear(); old.clear();
+    auto add=[&](InputTuplePtr v){ t.Append(v.Data()); t_.push_back((StaticFieldRef*)(t.GetPointerVec().back())); if(budget&&t.MemoryUsage()+t_.capacity()*sizeof(StaticFieldRef*)>budget) spill(); };
+    if(batch){ for(TupleBatch *b;(b=&e->NextBatch())->Size();) for(size_t i=0;i<b->Size();i++) add((*b)[i]); }
+    else{ InputTuplePtr v; while((v=e->Next())) add(v); }
+    if(runs.empty()) sorter.Sort(t_.data(),t_.data()+t_.size());
+    else{ if(!t_.empty()) spill(); merge_init(); }
+    ptr=0;
+  }
+  InputTuplePtr Next() override
+  {
+    if(!calculated){ calc(); calculated=true; }
+    old.clear(); StaticFieldRef *v=next(); if(!v) return InputTuplePtr();
+    memcpy(out.data(),v+oe.size(),sizeof(StaticFieldRef)*os.Size());
+    return out.data();
+  }
+  TupleBatch& NextBatch()override
+  {
+    if(!calculated){ calc(true); calculated=true; }
+    // The sorted tuples are stored, so the output points to them directly. The chunks of the runs are kept until the next call.
+    old.clear(); size_t n=0;
+    for(StaticFieldRef *v;n<TupleBatch::CAPACITY&&(v=next());) batch_.Tuples()[n++]=(const uint8_t*)(v+oe.size());
+    batch_.SetSize(n); return batch_;
+  }
+private:
+  // Sort the stored tuples and spill them as runs.
+  void spill()
   {
-    for(int i=0;i<oe.size();i++)
+    size_t m=pool&&pool->Size()>1?pool->Size():1,n=t_.size(),b=runs.size();
+    for(size_t i=0;i<m;i++) runs.push_back(std::make_unique<SpillFile>(ss));
+    auto f=[&](size_t i)
     {
-      switch (oe[i].first)
-      {
-      case RetType::INT:
-        if(a[i].ReadInt()!=b[i].ReadInt()) return (a[i].ReadInt()>b[i].ReadInt())^oe[i].second;
-        break;
-      case RetType::FLOAT:
-        if(a[i].ReadFloat()!=b[i].ReadFloat()) return (a[i].ReadFloat()>b[i].ReadFloat())^oe[i].second;
-        break;
-      case RetType::STRING:
-      {
-        auto d=(a[i].ReadStringView()<=>b[i].ReadStringView());
-        if(d!=d.equivalent) return (d==d.greater)^oe[i].second;
-        break;
-      }
-      default:
-        assert(false);
-      }
-    }
-    return false;
+      auto l=t_.data()+n*i/m,r=t_.data()+n*(i+1)/m; sorter.Sort(l,r);
+      for(auto j=l;j<r;j++) runs[b+i]->Append((const uint8_t*)*j);
+    };
+    if(m>1) pool->ParallelFor(m,f); else f(0);
+    t=TupleStore(is); t_.clear(); t_.shrink_to_fit();
+  }
+  // Read the next chunk of run i into bufs[i]. The old chunk is kept in old.
+  bool fill(size_t i)
+  {
+    old.push_back(std::move(bufs[i])); bufs[i]=TupleStore(ss); pos[i]=0;
+    return runs[i]->Read(bufs[i],chunk)>0;
+  }
+  StaticFieldRef* head(size_t i){ return pos[i]<bufs[i].GetPointerVec().size()?(StaticFieldRef*)bufs[i].GetPointerVec()[pos[i]]:nullptr; }
+  // Whether run a goes before run b. Exhausted runs go last.
+  bool before(size_t a,size_t b)
+  {
+    auto x=head(a),y=head(b); if(!x||!y) return x!=nullptr;
+    return sorter.Less(x,y)||(!sorter.Less(y,x)&&a<b);
+  }
+  void merge_init()
+  {
+    size_t k=runs.size(),bytes=0,num=0;
+    for(auto &r:runs) bytes+=r->Bytes(),num+=r->Size();
+    chunk=std::clamp<size_t>(budget/k/std::max<size_t>(bytes/std::max<size_t>(num,1),1),16,TupleBatch::CAPACITY);
+    for(size_t i=0;i<k;i++) bufs.emplace_back(ss);
+    pos.assign(k,0); for(size_t i=0;i<k;i++) fill(i);
+    // Node j of the loser tree has children 2j and 2j+1, and leaf k+i is run i. lt[j] is the loser at node j, and lt[0] is the winner.
+    std::vector<size_t> w(2*k); lt.assign(k,0);
+    for(size_t i=0;i<k;i++) w[k+i]=i;
+    for(size_t j=k-1;j>=1;j--){ size_t a=w[2*j],b=w[2*j+1]; if(before(b,a)) std::swap(a,b); w[j]=a; lt[j]=b; }
+    lt[0]=k>1?w[1]:0;
+    old.clear();
+  }
+  StaticFieldRef* next()
+  {
+    if(runs.empty()) return ptr<t_.size()?t_[ptr++]:nullptr;
+    size_t r=lt[0],k=runs.size(); StaticFieldRef *v=head(r); if(!v) return nullptr;
+    if(++pos[r]==bufs[r].GetPointerVec().size()) fill(r);
+    for(size_t j=(k+r)/2;j>=1;j/=2) if(before(lt[j],r)) std::swap(lt[j],r);
+    lt[0]=r; return v;
   }
-}
 
-class OrderExecutor:public Executor
+  TupleBatch batch_;
+  OutputSchema is,os,ss; // Input/Output Schema, and the schema of the stored tuples
+  std::unique_ptr<Executor> e; // child Executor
+  std::vector<std::pair<RetType, bool>> oe; // Orderby Expr
+  TupleSorter sorter;
+  TupleStore t; std::vector<StaticFieldRef *> t_;
+  size_t budget; ThreadPool *pool;
+  std::vector<std::unique_ptr<SpillFile>> runs; // sorted runs
+  std::vector<TupleStore> bufs,old; std::vector<size_t> pos,lt; size_t chunk; // merge state
+  std::vector<StaticFieldRef> out;
+  size_t ptr;
+  bool calculated;
+};
+
+// Keep the first offset+limit tuples of the sorted input in a max-heap, whose top is the last of them. A tuple that does not go before the
+// top is rejected before it is copied. The replaced tuples stay in the store until it is twice the size of the heap, and then the heap
+// tuples are copied to a new store.
+class TopNExecutor:public Executor
 {
 public:
-  OrderExecutor(const OutputSchema& Is,const OutputSchema& Os,std::unique_ptr<Executor> ch,std::vector<std::pair<RetType, bool>> Oe):is(Is),os(Os),e(std::move(ch)),oe(Oe),t(Is){ out=new StaticFieldRef[Os.Size()]; }
-  ~OrderExecutor()override{ delete[] out; }
+  TopNExecutor(const OutputSchema& Is,const OutputSchema& Os,std::unique_ptr<Executor> ch,std::vector<std::pair<RetType, bool>> Oe,size_t limit,size_t offset)
+      :is(Is),os(Os),e(std::move(ch)),oe(Oe),sorter(Oe),k(limit+offset),drop(offset),t(ss){ out.resize(Os.Size()); f.resize(Is.Size()); }
   void Init()override{ e->Init(); calculated=false; }
-  void calc()
+  void calc(bool batch=false)
   {
-    InputTuplePtr v; while((v=e->Next())){ t.Append(v.Data()); t_.push_back((StaticFieldRef*)(t.GetPointerVec().back())); }
-    _SORT_::oe=oe; std::sort(t_.begin(),t_.end(),_SORT_::cmp);
-    ptr=0;
+    t=TupleStore(ss); h.clear(); stored=0;
+    if(k)
+    {
+      if(batch){ for(TupleBatch *b;(b=&e->NextBatch())->Size();) for(size_t i=0;i<b->Size();i++) add((*b)[i]); }
+      else{ InputTuplePtr v; while((v=e->Next())) add(v); }
+    }
+    std::sort_heap(h.begin(),h.end(),Less{this});
+    ptr=std::min(drop,h.size());
+  }
+  // The tuples are stored deserialized, so a raw input tuple is deserialized before it is compared and stored.
+  void add(InputTuplePtr in)
+  {
+    StaticFieldRef *v=(StaticFieldRef*)in.Data(); if(is.IsRaw()){ Tuple::DeSerialize(f.data(),in.Data(),is.GetCols()); v=f.data(); }
+    if(h.size()==k)
+    {
+      if(!sorter.Less(v,h.front())) return;
+      std::pop_heap(h.begin(),h.end(),Less{this}); h.pop_back();
+    }
+    t.Append((const uint8_t*)v); h.push_back((StaticFieldRef*)t.GetPointerVec().back()); std::push_heap(h.begin(),h.end(),Less{this});
+    if(++stored>=2*k+TupleBatch::CAPACITY)
+    {
+      TupleStore n(ss); for(auto &v:h){ n.Append((const uint8_t*)v); v=(StaticFieldRef*)n.GetPointerVec().back(); }
+      t=std::move(n); stored=h.size();
+    }
   }
   InputTuplePtr Next() override
   {
     if(!calculated){ calc(); calculated=true; }
-    if(ptr==t_.size()) return InputTuplePtr();
-    memcpy(out,t_[ptr++]+oe.size(),sizeof(StaticFieldRef*)*os.Size());
-    return out;
+    if(ptr==h.size()) return InputTuplePtr();
+    memcpy(out.data(),h[ptr++]+oe.size(),sizeof(StaticFieldRef)*os.Size());
+    return out.data();
+  }
+  TupleBatch& NextBatch()override
+  {
+    if(!calculated){ calc(true); calculated=true; }
+    size_t n=0; while(n<TupleBatch::CAPACITY&&ptr<h.size()) batch_.Tuples()[n++]=(const uint8_t*)(h[ptr++]+oe.size());
+    batch_.SetSize(n); return batch_;
   }
 private:
-  OutputSchema is,os; // Input/Output Schema
+  struct Less{ const TopNExecutor *e; bool operator()(StaticFieldRef *a,StaticFieldRef *b)const{ return e->sorter.Less(a,b); } };
+
+  TupleBatch batch_;
+  OutputSchema is,os,ss{is.GetCols()}; // Input/Output Schema, and the schema of the stored tuples
   std::unique_ptr<Executor> e; // child Executor
   std::vector<std::pair<RetType, bool>> oe; // Orderby Expr
-  TupleStore t; std::vector<StaticFieldRef *> t_;
-  StaticFieldRef* out;
+  TupleSorter sorter;
+  size_t k,drop; // the number of tuples to keep, and to drop from the front
+  TupleStore t; std::vector<StaticFieldRef *> h; size_t stored; // the heap, and the number of tuples in t
+  std::vector<StaticFieldRef> f; // a deserialized raw input tuple
+  std::vector<StaticFieldRef> out;
   size_t ptr;
   bool calculated;
 };
@@ -315,9 +864,20 @@ public:
   void Init()override{ e->Init(); }
   InputTuplePtr Next_(){ auto v=e->Next(); if(!v) drop=rest=0; return v; }
   InputTuplePtr Next()override{ while(drop){ drop--; Next_(); } if(rest){ rest--; return Next_(); } return InputTuplePtr(); }
+  TupleBatch& NextBatch()override
+  {
+    while(rest)
+    {
+      auto &b=e->NextBatch(); if(!b.Size()){ drop=rest=0; break; }
+      size_t d=std::min(drop,b.Size()); drop-=d; b.Slice(d,d+rest); rest-=b.Size();
+      if(b.Size()) return b;
+    }
+    empty.Clear(); return empty;
+  }
 private:
   std::unique_ptr<Executor> e;
   size_t drop,rest;
+  TupleBatch empty;
 };
 
 class DistinctExecutor:public Executor
@@ -357,6 +917,8 @@ public:
         }
       }
       if(!flag) continue;
+      // Only the last tuple is compared, so the older ones are dropped from time to time.
+      if(t.GetPointerVec().size()>=TupleBatch::CAPACITY) t=TupleStore(s);
       t.Append(v.Data());
       return v;
     }
@@ -366,6 +928,79 @@ private:
   OutputSchema s;
   TupleStore t;
 };
+
+// DISTINCT of unsorted input. The keys of the returned tuples are kept in a GroupTable, which stores only their hashes and the keys
+// materialized as bytes, and a tuple is returned as soon as its keys are inserted, so the tuples are streamed in the order of the input.
+// If the table exceeds the memory budget, no more keys are inserted, and the tuples whose keys are not in the table are spilled to
+// partitions by their hashes. They are not duplicates of any returned tuple, so after the input ends, each partition is deduplicated in the
+// same way with a new table, and the tuples that still do not fit are partitioned again with the next bits of their hashes.
+class HashDistinctExecutor:public Executor
+{
+public:
+  HashDistinctExecutor(std::unique_ptr<Executor> ch,const OutputSchema &S,const ExecOptions& options={})
+      :e(std::move(ch)),s(S),ss(S.GetCols()),budget(options.memory_budget),g(types(S),0),rows(ss){ f.resize(S.Size()); }
+  void Init()override{ e->Init(); g=GroupTable(types(s),0); parts.clear(); todo.clear(); part=nullptr; level=0; child_done=false; ob=&batch_; oi=0; batch_.Clear(); }
+  InputTuplePtr Next()override{ if(oi==ob->Size()){ ob=&NextBatch(); oi=0; if(!ob->Size()) return InputTuplePtr(); } return (*ob)[oi++]; }
+  TupleBatch& NextBatch()override
+  {
+    // The new tuples of a batch of the child are returned in that batch.
+    while(!child_done)
+    {
+      auto &b=e->NextBatch(); if(!b.Size()){ child_done=true; next_part(); break; }
+      b.Select([&](InputTuplePtr v){ return add(v.Data(),s.IsRaw()); }); if(b.Size()) return b;
+    }
+    while(part)
+    {
+      rows=TupleStore(ss); if(!part->Read(rows,TupleBatch::CAPACITY)){ next_part(); continue; }
+      size_t n=0; for(auto r:rows.GetPointerVec()) if(add(r,false)) batch_.Tuples()[n++]=r;
+      batch_.SetSize(n); if(n) return batch_;
+    }
+    batch_.Clear(); return batch_;
+  }
+private:
+  static constexpr int FANOUT_BITS=5,MAX_LEVEL=3;
+  static std::vector<RetType> types(const OutputSchema& S)
+  {
+    std::vector<RetType> ret;
+    for(size_t i=0;i<S.Size();i++) ret.push_back(S[i].type_==FieldType::FLOAT64?RetType::FLOAT:S[i].type_==FieldType::CHAR||S[i].type_==FieldType::VARCHAR?RetType::STRING:RetType::INT);
+    return ret;
+  }
+  // The slots of the table are chosen by the low bits of the hashes, so the partitions are chosen by the high bits.
+  size_t part_of(uint64_t hash,int level){ return (hash>>(64-(level+1)*FANOUT_BITS))&((1<<FANOUT_BITS)-1); }
+  // Return whether the tuple is new.
+  bool add(const uint8_t* data,bool raw)
+  {
+    const StaticFieldRef *v=(const StaticFieldRef*)data; if(raw){ Tuple::DeSerialize(f.data(),data,s.GetCols()); v=f.data(); }
+    if(parts.empty())
+    {
+      if(!g.FindOrInsert(v).second) return false;
+      if(budget&&level<MAX_LEVEL&&g.MemoryUsage()>budget) for(int i=0;i<(1<<FANOUT_BITS);i++) parts.push_back(std::make_unique<SpillFile>(raw?s:ss));
+      return true;
+    }
+    if(!g.Find(v)) parts[part_of(g.Hash(v),level)]->Append(data);
+    return false;
+  }
+  // Start to deduplicate the next spilled partition.
+  void next_part()
+  {
+    for(auto &q:parts) if(q->Size()) todo.push_back({std::move(q),level+1});
+    parts.clear(); part=nullptr; g=GroupTable(types(s),0);
+    if(todo.empty()) return;
+    part=std::move(todo.back().first); level=todo.back().second; todo.pop_back();
+  }
+
+  std::unique_ptr<Executor> e;
+  OutputSchema s,ss; // the schema of the input, and that of the spilled tuples read back
+  size_t budget;
+  GroupTable g;
+  std::vector<std::unique_ptr<SpillFile>> parts; // the partitions of the tuples spilled from the current input, empty if it fits in the budget
+  std::vector<std::pair<std::unique_ptr<SpillFile>,int>> todo; // the spilled partitions to deduplicate, and their levels
+  std::unique_ptr<SpillFile> part; int level; // the partition being deduplicated, and its level (0 for the input of the child)
+  TupleStore rows; // the tuples read from the partition
+  std::vector<StaticFieldRef> f; // a deserialized raw input tuple
+  TupleBatch batch_,*ob; size_t oi; // the batch returned by Next()
+  bool child_done;
+};
 }  // namespace wing
 
 #endif
\ No newline at end of file
@@ -522,6 +522,65 @@ AggregateExprFunction::AggregateExprFunction(
     for (const auto& a : aggregate_exprs) {
       aggregate_exprfunction_.push_back(ExprFunction(a, input_schema));
     }
+    // The aggregate functions are found in the same order as above, i.e., the
+    // first child before the second.
+    std::function<void(const Expr*)> gen_merge = [&](const Expr* e) {
+      if (e == nullptr)
+        return;
+      if (e->type_ != ExprType::AGGR) {
+        gen_merge(e->ch0_.get());
+        gen_merge(e->ch1_.get());
+        return;
+      }
+      auto this_expr = static_cast<const AggregateFunctionExpr*>(e);
+#define MERGE_FUNC(statement)                                   \
+  merge_func_.push_back([](AggregateIntermediateData& x,        \
+                            const AggregateIntermediateData& y) { \
+    statement;                                                  \
+  })
+      bool is_int = this_expr->ret_type_ == RetType::INT;
+      if (this_expr->func_name_ == "max") {
+        if (is_int) {
+          MERGE_FUNC({
+            x.data_.int_data = std::max(x.data_.int_data, y.data_.int_data);
+          });
+        } else {
+          MERGE_FUNC({
+            x.data_.double_data =
+                std::max(x.data_.double_data, y.data_.double_data);
+          });
+        }
+      } else if (this_expr->func_name_ == "min") {
+        if (is_int) {
+          MERGE_FUNC({
+            x.data_.int_data = std::min(x.data_.int_data, y.data_.int_data);
+          });
+        } else {
+          MERGE_FUNC({
+            x.data_.double_data =
+                std::min(x.data_.double_data, y.data_.double_data);
+          });
+        }
+      } else if (this_expr->func_name_ == "count") {
+        MERGE_FUNC({ x.size_ += y.size_; });
+      } else if (this_expr->func_name_ == "sum") {
+        if (is_int) {
+          MERGE_FUNC({ x.data_.int_data += y.data_.int_data; });
+        } else {
+          MERGE_FUNC({ x.data_.double_data += y.data_.double_data; });
+        }
+      } else if (this_expr->func_name_ == "avg") {
+        MERGE_FUNC({
+          x.data_.double_data += y.data_.double_data;
+          x.size_ += y.size_;
+        });
+      } else {
+        DB_ERR("Internal Error: Invalid Aggregate Function.");
+      }
+#undef MERGE_FUNC
+    };
+    gen_merge(expr);
+    DB_ASSERT(merge_func_.size() == aggregate_exprfunction_.size());
   }
 }
 
@@ -546,6 +605,12 @@ StaticFieldRef AggregateExprFunction::LastEvaluate(
   return func_(stored_parameter, aggregate_data);
 }
 
+void AggregateExprFunction::Merge(AggregateIntermediateData* dst,
+    const AggregateIntermediateData* src) const {
+  for (uint32_t id = 0; id < merge_func_.size(); id++)
+    merge_func_[id](dst[id], src[id]);
+}
+
 AggregateExprFunction::operator bool() const { return bool(func_); }
 
 //
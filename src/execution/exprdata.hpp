@@ -132,6 +132,11 @@ class AggregateExprFunction {
       AggregateIntermediateData* aggregate_data, InputTuplePtr input);
   StaticFieldRef LastEvaluate(AggregateIntermediateData* aggregate_data,
       InputTuplePtr stored_parameter);
+  /* Merge the intermediate data "src" of some tuples into "dst" of the other
+   * tuples, so that "dst" is as if all of them were aggregated into it. Used
+   * to combine the partial results of parallel aggregation. */
+  void Merge(AggregateIntermediateData* dst,
+      const AggregateIntermediateData* src) const;
   operator bool() const;
 
  private:
@@ -144,6 +149,10 @@ class AggregateExprFunction {
   /* Aggregate functions. i.e. sum(x), max(x), min(x) and so on. */
   std::vector<std::function<void(AggregateIntermediateData&, StaticFieldRef)>>
       aggregate_func_;
+  /* Functions for Merge, one for each aggregate function. */
+  std::vector<std::function<void(
+      AggregateIntermediateData&, const AggregateIntermediateData&)>>
+      merge_func_;
 };
 
 }  // namespace wing
@@ -2,6 +2,7 @@
 #define SAKURA_FILTER_EXECUTOR_H__
 
 #include "execution/executor.hpp"
+#include "execution/vec_expr.hpp"
 
 namespace wing {
 
@@ -9,7 +10,9 @@ class FilterExecutor : public Executor {
  public:
   FilterExecutor(const std::unique_ptr<Expr>& expr,
       const OutputSchema& input_schema, std::unique_ptr<Executor> ch)
-    : predicate_(ExprFunction(expr.get(), input_schema)), ch_(std::move(ch)) {}
+    : predicate_(ExprFunction(expr.get(), input_schema)),
+      vec_predicate_(expr.get(), input_schema),
+      ch_(std::move(ch)) {}
   void Init() override { ch_->Init(); }
   InputTuplePtr Next() override {
     auto ch_ret = ch_->Next();
@@ -18,10 +21,24 @@ class FilterExecutor : public Executor {
       ch_ret = ch_->Next();
     return ch_ret;
   }
+  TupleBatch& NextBatch() override {
+    for (;;) {
+      auto& batch = ch_->NextBatch();
+      if (batch.Size() == 0 || !predicate_)
+        return batch;
+      batch.Compact();
+      vec_predicate_.EvaluateMask(batch.Tuples(), batch.Size(), mask_.data());
+      batch.SelectMask(mask_.data());
+      if (batch.Size() > 0)
+        return batch;
+    }
+  }
 
  private:
   ExprFunction predicate_;
+  VecExprFunction vec_predicate_;
   std::unique_ptr<Executor> ch_;
+  std::array<uint8_t, TupleBatch::CAPACITY> mask_;
 };
 
 }  // namespace wing
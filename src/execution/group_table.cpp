@@ -0,0 +1,87 @@
+#include "execution/group_table.hpp"
+
+#include <memory>
+
+namespace wing {
+
+void GroupTable::Materialize(const StaticFieldRef* keys) {
+  key_.clear();
+  for (size_t i = 0; i < key_types_.size(); i++) {
+    if (key_types_[i] == RetType::STRING) {
+      auto str = keys[i].ReadStringView();
+      uint32_t size = str.size();
+      key_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+      key_.append(str);
+    } else {
+      auto data = keys[i].data_.int_data;
+      if (key_types_[i] == RetType::FLOAT && keys[i].ReadFloat() == 0)
+        data = 0;
+      key_.append(reinterpret_cast<const char*>(&data), sizeof(data));
+    }
+  }
+}
+
+uint8_t* GroupTable::Lookup(uint64_t hash) const {
+  size_t mask = slots_.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    auto& slot = slots_[i];
+    if (slot.group == nullptr)
+      return nullptr;
+    if (slot.hash != hash)
+      continue;
+    auto header = reinterpret_cast<const Header*>(slot.group);
+    if (header->key_size == key_.size() &&
+        std::memcmp(slot.group + stride_, key_.data(), key_.size()) == 0)
+      return slot.group;
+  }
+}
+
+uint8_t* GroupTable::Find(const StaticFieldRef* keys) {
+  if (slots_.empty())
+    return nullptr;
+  Materialize(keys);
+  return Lookup(utils::Hash(key_, SEED));
+}
+
+std::pair<uint8_t*, bool> GroupTable::FindOrInsert(
+    const StaticFieldRef* keys) {
+  if (slots_.empty())
+    slots_.resize(INITIAL_SLOTS);
+  Materialize(keys);
+  uint64_t hash = utils::Hash(key_, SEED);
+  if (auto group = Lookup(hash))
+    return {group, false};
+  // Rows are 8-byte aligned, so that the states are aligned.
+  size_t size = (stride_ + key_.size() + 7) & ~size_t(7);
+  uint8_t* group = arena_.Allocate(size);
+  auto header = reinterpret_cast<Header*>(group);
+  header->row = nullptr;
+  header->key_size = key_.size();
+  std::uninitialized_value_construct_n(States(group), state_size_);
+  std::memcpy(group + stride_, key_.data(), key_.size());
+  groups_.push_back(group);
+  if (groups_.size() * 2 > slots_.size())
+    Grow();
+  size_t mask = slots_.size() - 1;
+  size_t i = hash & mask;
+  while (slots_[i].group != nullptr)
+    i = (i + 1) & mask;
+  slots_[i] = {hash, group};
+  return {group, true};
+}
+
+void GroupTable::Grow() {
+  std::vector<Slot> slots(slots_.size() * 2);
+  size_t mask = slots.size() - 1;
+  for (auto& slot : slots_) {
+    if (slot.group == nullptr)
+      continue;
+    size_t i = slot.hash & mask;
+    while (slots[i].group != nullptr)
+      i = (i + 1) & mask;
+    slots[i] = slot;
+  }
+  slots_ = std::move(slots);
+}
+
+}  // namespace wing
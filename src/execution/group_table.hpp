@@ -0,0 +1,103 @@
+#ifndef SAKURA_GROUP_TABLE_H__
+#define SAKURA_GROUP_TABLE_H__
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/allocator.hpp"
+#include "common/murmurhash.hpp"
+#include "execution/exprdata.hpp"
+#include "parser/expr.hpp"
+#include "type/static_field.hpp"
+
+namespace wing {
+
+/**
+ * The hash table of HashAggregateExecutor and HashDistinctExecutor, which maps
+ * the group keys to the groups.
+ *
+ * Each group is one row in an arena: a header, the aggregate states, and the
+ * keys materialized as bytes. The header and the states have a fixed size,
+ * which is known when the table is constructed, and the keys follow them.
+ * Integers and floats take 8 bytes each, and strings take their lengths and
+ * contents. Floats are normalized so that 0.0 and -0.0 are the same group.
+ * So two groups have the same keys iff their key bytes are equal, and keys
+ * are compared with memcmp. The arena allocates in large blocks, so there is
+ * no heap allocation per group.
+ *
+ * The slots of the table are open addressed with linear probing, and store
+ * the hashes of the groups, which are compared before the keys.
+ */
+class GroupTable {
+ public:
+  /* "state_size" is the number of AggregateIntermediateData of a group. */
+  GroupTable(std::vector<RetType> key_types, size_t state_size)
+    : key_types_(std::move(key_types)),
+      stride_(sizeof(Header) + state_size * sizeof(AggregateIntermediateData)),
+      state_size_(state_size) {}
+
+  /* Find the group of "keys", which has a key for each key type, or insert a
+   * new group with zeroed states if there is none. Return the group and
+   * whether it is new. */
+  std::pair<uint8_t*, bool> FindOrInsert(const StaticFieldRef* keys);
+  /* Find the group of "keys", or return nullptr if there is none. */
+  uint8_t* Find(const StaticFieldRef* keys);
+  /* The hash of "keys". Slots are chosen by its low bits, so its high bits
+   * can partition the keys. */
+  uint64_t Hash(const StaticFieldRef* keys) {
+    Materialize(keys);
+    return utils::Hash(key_, SEED);
+  }
+  /* The groups in the order they are inserted. */
+  const std::vector<uint8_t*>& Groups() const { return groups_; }
+  size_t Size() const { return groups_.size(); }
+  static AggregateIntermediateData* States(uint8_t* group) {
+    return reinterpret_cast<AggregateIntermediateData*>(group + sizeof(Header));
+  }
+  /* A row stored with the group, e.g. its first tuple. */
+  static const uint8_t*& Row(uint8_t* group) {
+    return reinterpret_cast<Header*>(group)->row;
+  }
+  /* The memory of the groups and the slots. */
+  size_t MemoryUsage() const {
+    return arena_.Allocated() + slots_.capacity() * sizeof(Slot) +
+           groups_.capacity() * sizeof(uint8_t*);
+  }
+  /* The number of blocks allocated by the arena for the groups. */
+  size_t ArenaBlocks() const { return arena_.Blocks(); }
+
+ private:
+  static constexpr uint64_t SEED = 0x9e3779b97f4a7c15ULL;
+  static constexpr size_t INITIAL_SLOTS = 1 << 10;
+
+  struct Header {
+    const uint8_t* row;
+    uint32_t key_size;
+  };
+  struct Slot {
+    uint64_t hash;
+    uint8_t* group;
+  };
+
+  /* Materialize "keys" into key_. */
+  void Materialize(const StaticFieldRef* keys);
+  /* Find the group of key_, whose hash is "hash". */
+  uint8_t* Lookup(uint64_t hash) const;
+  /* Double the slots. */
+  void Grow();
+
+  std::vector<RetType> key_types_;
+  /* The size of the header and the states. */
+  size_t stride_;
+  size_t state_size_;
+  BlockAllocator<1 << 16> arena_;
+  std::vector<Slot> slots_;
+  std::vector<uint8_t*> groups_;
+  /* The materialized keys being looked up. */
+  std::string key_;
+};
+
+}  // namespace wing
+
+#endif
@@ -0,0 +1,119 @@
+#include "execution/join_hash_table.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "common/logging.hpp"
+#include "common/murmurhash.hpp"
+
+namespace wing {
+
+uint64_t JoinHashTable::HashString(std::string_view str) {
+  return utils::Hash(str, SEED);
+}
+
+void JoinHashTable::Build(ThreadPool* pool) {
+  size_t size = 0;
+  for (auto& pending : pending_)
+    size += pending.size() / width_;
+  if (size >= std::numeric_limits<uint32_t>::max()) {
+    DB_ERR("Too many rows in the hash table: {}", size);
+  }
+  int bits = 1;
+  while ((size_t(1) << bits) < size)
+    bits += 1;
+  shift_ = 64 - bits;
+  entries_.resize(size * width_);
+  directory_.assign((size_t(1) << bits) + 1, 0);
+  if (pool != nullptr && pool->Size() > 1 && size >= PARALLEL_THRESHOLD) {
+    BuildParallel(*pool, size, bits);
+  } else {
+    // Count the entries of each bucket, and then place each entry after the
+    // entries of the previous buckets.
+    std::vector<uint32_t> buckets(size);
+    for (size_t i = 0; auto& pending : pending_) {
+      for (size_t j = 0; j < pending.size(); j += width_, i++) {
+        buckets[i] = Bucket(EntryHash(&pending[j]));
+        directory_[buckets[i] + 1] += 1;
+      }
+    }
+    for (size_t b = 1; b < directory_.size(); b++)
+      directory_[b] += directory_[b - 1];
+    std::vector<uint32_t> next(directory_.begin(), directory_.end() - 1);
+    for (size_t i = 0; auto& pending : pending_) {
+      for (size_t j = 0; j < pending.size(); j += width_, i++) {
+        std::copy_n(
+            &pending[j], width_, &entries_[next[buckets[i]]++ * width_]);
+      }
+    }
+  }
+  for (auto& pending : pending_) {
+    pending.clear();
+    pending.shrink_to_fit();
+  }
+}
+
+/**
+ * The buckets are divided into partitions by their high bits. Each worker
+ * counts and scatters its entries into the partitions, and then the
+ * partitions are sorted by bucket independently. Partition p occupies the same
+ * range in tmp as in entries_.
+ */
+void JoinHashTable::BuildParallel(ThreadPool& pool, size_t size, int bits) {
+  int part_bits = std::min(bits, PARTITION_BITS);
+  int part_shift = bits - part_bits;
+  size_t parts = size_t(1) << part_bits, workers = pending_.size();
+  std::vector<std::vector<uint32_t>> buckets(workers);
+  std::vector<std::vector<uint32_t>> offsets(
+      workers, std::vector<uint32_t>(parts, 0));
+  pool.ParallelFor(workers, [&](size_t w) {
+    auto& pending = pending_[w];
+    buckets[w].resize(pending.size() / width_);
+    for (size_t i = 0; i < buckets[w].size(); i++) {
+      buckets[w][i] = Bucket(EntryHash(&pending[i * width_]));
+      offsets[w][buckets[w][i] >> part_shift] += 1;
+    }
+  });
+  // Partition p of worker w starts after partitions < p, and after partition
+  // p of workers < w.
+  std::vector<uint32_t> begin(parts + 1, 0);
+  for (size_t p = 0, sum = 0; p < parts; p++) {
+    begin[p] = sum;
+    for (size_t w = 0; w < workers; w++) {
+      size_t count = offsets[w][p];
+      offsets[w][p] = sum;
+      sum += count;
+    }
+  }
+  begin[parts] = size;
+  std::vector<StaticFieldRef> tmp(size * width_);
+  std::vector<uint32_t> tmp_buckets(size);
+  pool.ParallelFor(workers, [&](size_t w) {
+    auto& pending = pending_[w];
+    for (size_t i = 0; i < buckets[w].size(); i++) {
+      uint32_t pos = offsets[w][buckets[w][i] >> part_shift]++;
+      std::copy_n(&pending[i * width_], width_, &tmp[pos * width_]);
+      tmp_buckets[pos] = buckets[w][i];
+    }
+    pending.clear();
+    pending.shrink_to_fit();
+  });
+  pool.ParallelFor(parts, [&](size_t p) {
+    size_t lo = p << part_shift, hi = (p + 1) << part_shift;
+    std::vector<uint32_t> next(hi - lo, 0);
+    for (size_t i = begin[p]; i < begin[p + 1]; i++)
+      next[tmp_buckets[i] - lo] += 1;
+    for (size_t b = lo, sum = begin[p]; b < hi; b++) {
+      size_t count = next[b - lo];
+      directory_[b] = next[b - lo] = sum;
+      sum += count;
+    }
+    for (size_t i = begin[p]; i < begin[p + 1]; i++) {
+      std::copy_n(&tmp[i * width_], width_,
+          &entries_[next[tmp_buckets[i] - lo]++ * width_]);
+    }
+  });
+  directory_.back() = size;
+}
+
+}  // namespace wing
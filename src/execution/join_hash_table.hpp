@@ -0,0 +1,172 @@
+#ifndef SAKURA_JOIN_HASH_TABLE_H__
+#define SAKURA_JOIN_HASH_TABLE_H__
+
+#include <algorithm>
+#include <bit>
+#include <string_view>
+#include <vector>
+
+#include "common/thread_pool.hpp"
+#include "parser/expr.hpp"
+#include "type/static_field.hpp"
+
+namespace wing {
+
+/**
+ * The hash table of HashJoinExecutor, which maps the keys of the build rows to
+ * the rows.
+ *
+ * The entries are sorted by bucket and stored contiguously, and a directory
+ * stores the first entry of each bucket. So the entries of a bucket are
+ * [Begin(bucket), End(bucket)), and scanning them reads consecutive memory. An
+ * entry stores the row and the keys in consecutive StaticFieldRef. If there
+ * are string keys, the entry also stores the hash, which is compared before the
+ * strings. There are at least as many buckets as entries.
+ *
+ * Rows are appended with their keys, and then Build() sorts all of them into
+ * the table. Several threads may append rows in parallel, each to its own
+ * worker slot, and Build() may sort them in parallel. To find the rows of some
+ * keys, check the entries of Bucket(Hash(keys)) with Match(). Probing a batch
+ * of keys should Prefetch() the buckets of all of them, and then
+ * PrefetchEntry() the first entries, before looking them up, so that the cache
+ * misses overlap.
+ *
+ * Keys are StaticFieldRef. Strings are compared by their contents, and the
+ * others by their bits, where -0.0 is taken as 0.0, because they are equal.
+ * The string keys of the build rows must be valid until the table is
+ * destroyed.
+ */
+class JoinHashTable {
+ public:
+  JoinHashTable() = default;
+  explicit JoinHashTable(std::vector<RetType> key_types, size_t workers = 1)
+    : key_types_(std::move(key_types)),
+      has_string_(std::find(key_types_.begin(), key_types_.end(),
+                      RetType::STRING) != key_types_.end()),
+      has_float_(std::find(key_types_.begin(), key_types_.end(),
+                     RetType::FLOAT) != key_types_.end()),
+      keys_offset_(has_string_ ? 2 : 1),
+      width_(key_types_.size() + keys_offset_),
+      pending_(workers) {}
+
+  /* Append a row. "keys" has a key for each key type. Rows of different
+   * workers can be appended concurrently. */
+  void Append(
+      const StaticFieldRef* keys, const uint8_t* row, size_t worker = 0) {
+    auto& pending = pending_[worker];
+    pending.push_back(
+        StaticFieldRef::CreateInt(reinterpret_cast<int64_t>(row)));
+    if (has_string_)
+      pending.push_back(StaticFieldRef::CreateInt(Hash(keys)));
+    for (size_t i = 0; i < key_types_.size(); i++) {
+      pending.push_back(keys[i]);
+      if (key_types_[i] != RetType::STRING)
+        pending.back().data_.int_data = Bits(keys, i);
+    }
+  }
+  /* Build the table after all rows are appended. With "pool", large tables
+   * are sorted in parallel. */
+  void Build(ThreadPool* pool = nullptr);
+  /* The number of rows. */
+  size_t Size() const { return entries_.size() / width_; }
+
+  uint64_t Hash(const StaticFieldRef* keys) const {
+    uint64_t h = 0;
+    if (!has_string_) {
+      for (size_t i = 0; i < key_types_.size(); i++)
+        h = Mix(std::rotl(h, 26) ^ Bits(keys, i));
+      return h;
+    }
+    for (size_t i = 0; i < key_types_.size(); i++) {
+      if (key_types_[i] == RetType::STRING) {
+        h = Mix(std::rotl(h, 26) ^ HashString(keys[i].ReadStringView()));
+      } else {
+        h = Mix(std::rotl(h, 26) ^ Bits(keys, i));
+      }
+    }
+    return h;
+  }
+  size_t Bucket(uint64_t hash) const { return hash >> shift_; }
+  /* The entries of the bucket are [Begin(bucket), End(bucket)). */
+  size_t Begin(size_t bucket) const { return directory_[bucket]; }
+  size_t End(size_t bucket) const { return directory_[bucket + 1]; }
+  void Prefetch(size_t bucket) const {
+    __builtin_prefetch(&directory_[bucket]);
+  }
+  void PrefetchEntry(size_t entry) const {
+    __builtin_prefetch(entries_.data() + entry * width_);
+  }
+  /* Whether the keys of the row in the entry are "keys". */
+  bool Match(size_t entry, uint64_t hash, const StaticFieldRef* keys) const {
+    const StaticFieldRef* e = entries_.data() + entry * width_;
+    if (!has_string_) {
+      // Without branches, because whether an entry matches is unpredictable.
+      int64_t diff = 0;
+      for (size_t i = 0; i < key_types_.size(); i++)
+        diff |= e[i + 1].data_.int_data ^ Bits(keys, i);
+      return diff == 0;
+    }
+    if (e[1].data_.int_data != static_cast<int64_t>(hash))
+      return false;
+    for (size_t i = 0; i < key_types_.size(); i++) {
+      if (key_types_[i] == RetType::STRING) {
+        if (e[i + 2].ReadStringView() != keys[i].ReadStringView())
+          return false;
+      } else if (e[i + 2].data_.int_data != Bits(keys, i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  /* The row in the entry. */
+  const uint8_t* Row(size_t entry) const {
+    return reinterpret_cast<const uint8_t*>(
+        entries_[entry * width_].data_.int_data);
+  }
+
+ private:
+  static constexpr uint64_t SEED = 0x2545f4914f6cdd1dULL;
+  /* Smaller tables are built by one thread. */
+  static constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+  /* The number of partitions in parallel build is at most 2^PARTITION_BITS. */
+  static constexpr int PARTITION_BITS = 8;
+
+  /**
+   * Fibonacci hashing. Bucket() uses the high bits of the product, which are
+   * well mixed, and consecutive integer keys (e.g. ids) go to evenly spaced
+   * buckets, so dense keys do not collide.
+   */
+  static uint64_t Mix(uint64_t h) { return h * 0x9e3779b97f4a7c15ULL; }
+  static uint64_t HashString(std::string_view str);
+  /* The bits of a key that is not a string. */
+  int64_t Bits(const StaticFieldRef* keys, size_t i) const {
+    if (has_float_ && key_types_[i] == RetType::FLOAT &&
+        keys[i].data_.double_data == 0)
+      return 0;
+    return keys[i].data_.int_data;
+  }
+  uint64_t EntryHash(const StaticFieldRef* e) const {
+    return has_string_ ? e[1].data_.int_data : Hash(e + keys_offset_);
+  }
+  void BuildParallel(ThreadPool& pool, size_t size, int bits);
+
+  std::vector<RetType> key_types_;
+  bool has_string_{false};
+  bool has_float_{false};
+  /* An entry is the row, the hash if has_string_, and the keys. */
+  size_t keys_offset_{1};
+  size_t width_{1};
+  /* The entries of the appended rows of each worker, which are sorted by
+   * Build(). */
+  std::vector<std::vector<StaticFieldRef>> pending_ =
+      std::vector<std::vector<StaticFieldRef>>(1);
+  std::vector<StaticFieldRef> entries_;
+  /* The index of the first entry of each bucket, and the number of entries. */
+  std::vector<uint32_t> directory_ = std::vector<uint32_t>(2);
+  /* The high bits of the hash select the bucket. */
+  int shift_{63};
+};
+
+}  // namespace wing
+
+#endif
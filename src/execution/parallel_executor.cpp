@@ -0,0 +1,389 @@
+#include "execution/parallel_executor.hpp"
+
+#include <bit>
+
+#include "common/murmurhash.hpp"
+
+namespace wing {
+
+JoinBuild::JoinBuild(std::vector<std::unique_ptr<Executor>> inputs,
+    const OutputSchema& schema,
+    const std::vector<std::unique_ptr<Expr>>& keys, size_t memory_budget)
+  : inputs_(std::move(inputs)),
+    num_keys_(keys.size()),
+    memory_budget_(memory_budget) {
+  // The keys are evaluated on the stored rows, which are not raw.
+  OutputSchema stored = schema;
+  stored.SetRaw(false);
+  std::vector<RetType> types;
+  for (auto& key : keys)
+    types.push_back(key->ret_type_);
+  table_ = JoinHashTable(types, inputs_.size());
+  for (size_t i = 0; i < inputs_.size(); i++) {
+    rows_.emplace_back(schema);
+    keys_.emplace_back();
+    for (auto& key : keys)
+      keys_[i].emplace_back(key.get(), stored);
+  }
+}
+
+void JoinBuild::Init() {
+  for (auto& input : inputs_)
+    input->Init();
+}
+
+void JoinBuild::Build(ThreadPool& pool) {
+  // A single input is not a pipeline, and may wait for the pool itself, so it
+  // is read on the calling thread.
+  if (inputs_.size() == 1) {
+    Read(0);
+  } else {
+    pool.ParallelFor(inputs_.size(), [this](size_t i) { Read(i); });
+  }
+  table_.Build(&pool);
+}
+
+void JoinBuild::Read(size_t input) {
+  auto& rows = rows_[input];
+  auto& r = rows.GetPointerVec();
+  std::vector<StaticFieldRef> keys(TupleBatch::CAPACITY * num_keys_);
+  size_t footprint = 0;
+  for (TupleBatch* batch; (batch = &inputs_[input]->NextBatch())->Size();) {
+    if (aborted_.load(std::memory_order_relaxed))
+      return;
+    size_t begin = r.size(), num = batch->Size();
+    for (size_t i = 0; i < num; i++)
+      rows.Append((*batch)[i].Data());
+    for (size_t j = 0; j < num_keys_; j++)
+      keys_[input][j].Evaluate(
+          r.data() + begin, num, keys.data() + j, num_keys_);
+    for (size_t i = 0; i < num; i++)
+      table_.Append(keys.data() + i * num_keys_, r[begin + i], input);
+    // The same estimation as HashJoinExecutor.
+    size_t now = rows.MemoryUsage() +
+                 r.size() * (num_keys_ + 2) * sizeof(StaticFieldRef) * 2;
+    size_t total = footprint_.fetch_add(now - footprint) + now - footprint;
+    footprint = now;
+    if (memory_budget_ && total > memory_budget_) {
+      aborted_.store(true);
+      throw MemoryBudgetExceeded(
+          "The build side of a parallel hash join exceeds the memory budget.");
+    }
+  }
+}
+
+GatherExecutor::GatherExecutor(std::vector<std::unique_ptr<Executor>> copies,
+    std::vector<std::shared_ptr<JoinBuild>> builds, ThreadPool& pool)
+  : copies_(std::move(copies)),
+    builds_(std::move(builds)),
+    pool_(pool),
+    batches_(copies_.size(), nullptr) {}
+
+GatherExecutor::~GatherExecutor() {
+  std::unique_lock lock(mutex_);
+  cancelled_ = true;
+  cv_.wait(lock, [this] { return tasks_ == 0; });
+}
+
+void GatherExecutor::Init() {
+  for (auto& build : builds_)
+    build->Init();
+  for (auto& copy : copies_)
+    copy->Init();
+}
+
+InputTuplePtr GatherExecutor::Next() {
+  if (oi_ == ob_->Size()) {
+    ob_ = &NextBatch();
+    oi_ = 0;
+    if (!ob_->Size())
+      return {};
+  }
+  return (*ob_)[oi_++];
+}
+
+TupleBatch& GatherExecutor::NextBatch() {
+  if (!started_) {
+    started_ = true;
+    for (auto& build : builds_)
+      build->Build(pool_);
+    running_ = copies_.size();
+    for (size_t i = 0; i < copies_.size(); i++)
+      Schedule(i);
+  }
+  // The caller is done with the last batch, so its copy can go on.
+  if (current_) {
+    Schedule(*current_);
+    current_.reset();
+  }
+  std::unique_lock lock(mutex_);
+  cv_.wait(lock, [this] {
+    return !ready_.empty() || running_ == 0 || error_ != nullptr;
+  });
+  if (error_ != nullptr)
+    std::rethrow_exception(error_);
+  if (ready_.empty()) {
+    empty_.Clear();
+    return empty_;
+  }
+  current_ = ready_.front();
+  ready_.pop_front();
+  return *batches_[*current_];
+}
+
+void GatherExecutor::Schedule(size_t copy) {
+  {
+    std::unique_lock lock(mutex_);
+    tasks_ += 1;
+  }
+  pool_.Submit([this, copy] { Produce(copy); });
+}
+
+void GatherExecutor::Produce(size_t copy) {
+  TupleBatch* batch = nullptr;
+  std::exception_ptr error;
+  bool cancelled;
+  {
+    std::unique_lock lock(mutex_);
+    cancelled = cancelled_ || error_ != nullptr;
+  }
+  if (!cancelled) {
+    try {
+      batch = &copies_[copy]->NextBatch();
+    } catch (...) {
+      error = std::current_exception();
+    }
+  }
+  std::unique_lock lock(mutex_);
+  if (error != nullptr && error_ == nullptr)
+    error_ = error;
+  if (batch != nullptr && batch->Size() > 0) {
+    batches_[copy] = batch;
+    ready_.push_back(copy);
+  } else {
+    running_ -= 1;
+  }
+  tasks_ -= 1;
+  // Notify under the lock, because the destructor may destroy cv_ as soon as
+  // it sees tasks_ == 0.
+  cv_.notify_all();
+}
+
+ParallelAggregateExecutor::ParallelAggregateExecutor(
+    const std::unique_ptr<Expr>& group_predicate,
+    const OutputSchema& input_schema, const OutputSchema& output_schema,
+    std::vector<std::unique_ptr<Executor>> copies,
+    std::vector<std::shared_ptr<JoinBuild>> builds,
+    const std::vector<std::unique_ptr<Expr>>& output_exprs,
+    const std::vector<std::unique_ptr<Expr>>& group_by_exprs, ThreadPool& pool)
+  : copies_(std::move(copies)),
+    builds_(std::move(builds)),
+    pool_(pool),
+    output_schema_(output_schema),
+    predicate_(group_predicate.get(), input_schema),
+    groups_(size_t(1) << PARTITION_BITS) {
+  // The stored rows are not raw.
+  OutputSchema row_schema = input_schema;
+  row_schema.SetRaw(false);
+  for (auto& expr : group_by_exprs)
+    key_types_.push_back(expr->ret_type_);
+  offsets_.push_back(0);
+  for (auto& expr : output_exprs) {
+    outputs_.emplace_back(expr.get(), input_schema);
+    offsets_.push_back(
+        offsets_.back() + outputs_.back().GetImmediateDataSize());
+  }
+  if (predicate_)
+    offsets_.push_back(offsets_.back() + predicate_.GetImmediateDataSize());
+  for (size_t i = 0; i < copies_.size(); i++) {
+    auto w = std::make_unique<Worker>(group_predicate.get(), input_schema);
+    for (auto& expr : output_exprs)
+      w->outputs.emplace_back(expr.get(), input_schema);
+    for (auto& expr : group_by_exprs) {
+      w->input_keys.emplace_back(expr.get(), input_schema);
+      w->row_keys.emplace_back(expr.get(), row_schema);
+    }
+    w->table.assign(TABLE_SIZE, EMPTY);
+    w->partitions.resize(size_t(1) << PARTITION_BITS);
+    workers_.push_back(std::move(w));
+  }
+}
+
+void ParallelAggregateExecutor::Init() {
+  for (auto& build : builds_)
+    build->Init();
+  for (auto& copy : copies_)
+    copy->Init();
+}
+
+InputTuplePtr ParallelAggregateExecutor::Next() {
+  if (oi_ == ob_->Size()) {
+    ob_ = &NextBatch();
+    oi_ = 0;
+    if (!ob_->Size())
+      return {};
+  }
+  return (*ob_)[oi_++];
+}
+
+TupleBatch& ParallelAggregateExecutor::NextBatch() {
+  if (!calculated_) {
+    calculated_ = true;
+    for (auto& build : builds_)
+      build->Build(pool_);
+    pool_.ParallelFor(copies_.size(), [this](size_t i) { Aggregate(i); });
+    pool_.ParallelFor(groups_.size(), [this](size_t i) { Merge(i); });
+  }
+  size_t w = output_schema_.Size(), n = 0;
+  if (rows_.size() < TupleBatch::CAPACITY * w)
+    rows_.resize(TupleBatch::CAPACITY * w);
+  while (n < TupleBatch::CAPACITY && partition_ < groups_.size()) {
+    if (index_ == groups_[partition_].size()) {
+      partition_ += 1;
+      index_ = 0;
+      continue;
+    }
+    auto& g = groups_[partition_][index_++];
+    if (predicate_ &&
+        predicate_.LastEvaluate(g.data + offsets_[outputs_.size()], g.row)
+                .ReadInt() == 0)
+      continue;
+    StaticFieldRef* o = rows_.data() + n * w;
+    for (size_t i = 0; i < outputs_.size(); i++)
+      o[i] = outputs_[i].LastEvaluate(g.data + offsets_[i], g.row);
+    batch_.Tuples()[n++] = reinterpret_cast<const uint8_t*>(o);
+  }
+  batch_.SetSize(n);
+  return batch_;
+}
+
+void ParallelAggregateExecutor::Aggregate(size_t copy) {
+  auto& w = *workers_[copy];
+  std::vector<StaticFieldRef> keys(key_types_.size());
+  for (TupleBatch* batch; (batch = &copies_[copy]->NextBatch())->Size();) {
+    for (size_t i = 0; i < batch->Size(); i++) {
+      auto tuple = (*batch)[i];
+      for (size_t j = 0; j < keys.size(); j++)
+        keys[j] = w.input_keys[j].Evaluate(tuple);
+      Add(w, tuple, keys.data());
+    }
+  }
+  Flush(w);
+}
+
+void ParallelAggregateExecutor::Add(
+    Worker& w, InputTuplePtr tuple, const StaticFieldRef* keys) {
+  uint64_t hash = Hash(keys);
+  size_t slot = hash & (TABLE_SIZE - 1);
+  for (; w.table[slot] != EMPTY; slot = (slot + 1) & (TABLE_SIZE - 1)) {
+    auto& g = w.groups[w.table[slot]];
+    if (g.hash == hash && SameKeys(g.keys, keys)) {
+      for (size_t i = 0; i < w.outputs.size(); i++)
+        w.outputs[i].Aggregate(g.data + offsets_[i], tuple);
+      if (w.predicate)
+        w.predicate.Aggregate(g.data + offsets_[w.outputs.size()], tuple);
+      return;
+    }
+  }
+  // A new group. Its keys are evaluated again on the stored row, because the
+  // strings of the tuple are not valid later.
+  size_t num_data = offsets_.back(), num_keys = key_types_.size();
+  auto mem = w.arena.Allocate(num_data * sizeof(AggregateIntermediateData) +
+                              num_keys * sizeof(StaticFieldRef));
+  auto data = std::uninitialized_value_construct_n(
+                  reinterpret_cast<AggregateIntermediateData*>(mem), num_data) -
+              num_data;
+  auto row_keys = reinterpret_cast<StaticFieldRef*>(data + num_data);
+  w.rows.Append(tuple.Data());
+  const uint8_t* row = w.rows.GetPointerVec().back();
+  for (size_t j = 0; j < num_keys; j++)
+    row_keys[j] = w.row_keys[j].Evaluate(row);
+  for (size_t i = 0; i < w.outputs.size(); i++)
+    w.outputs[i].FirstEvaluate(data + offsets_[i], tuple);
+  if (w.predicate)
+    w.predicate.FirstEvaluate(data + offsets_[w.outputs.size()], tuple);
+  w.table[slot] = w.groups.size();
+  w.groups.push_back(Group{hash, row, row_keys, data});
+  // Keep the table at most half full, so that probes are short.
+  if (w.groups.size() * 2 >= TABLE_SIZE)
+    Flush(w);
+}
+
+void ParallelAggregateExecutor::Flush(Worker& w) {
+  for (auto& g : w.groups)
+    w.partitions[g.hash >> (64 - PARTITION_BITS)].push_back(g);
+  w.groups.clear();
+  std::fill(w.table.begin(), w.table.end(), EMPTY);
+}
+
+void ParallelAggregateExecutor::Merge(size_t partition) {
+  size_t num = 0;
+  for (auto& w : workers_)
+    num += w->partitions[partition].size();
+  size_t size = 1;
+  while (size < num * 2)
+    size *= 2;
+  std::vector<uint32_t> table(size, EMPTY);
+  auto& groups = groups_[partition];
+  for (auto& w : workers_) {
+    for (auto& g : w->partitions[partition]) {
+      size_t slot = g.hash & (size - 1);
+      for (; table[slot] != EMPTY; slot = (slot + 1) & (size - 1)) {
+        auto& dst = groups[table[slot]];
+        if (dst.hash == g.hash && SameKeys(dst.keys, g.keys))
+          break;
+      }
+      if (table[slot] == EMPTY) {
+        table[slot] = groups.size();
+        groups.push_back(g);
+        continue;
+      }
+      auto& dst = groups[table[slot]];
+      for (size_t i = 0; i < outputs_.size(); i++)
+        outputs_[i].Merge(dst.data + offsets_[i], g.data + offsets_[i]);
+      if (predicate_) {
+        predicate_.Merge(dst.data + offsets_[outputs_.size()],
+            g.data + offsets_[outputs_.size()]);
+      }
+    }
+    w->partitions[partition].clear();
+    w->partitions[partition].shrink_to_fit();
+  }
+}
+
+uint64_t ParallelAggregateExecutor::Hash(const StaticFieldRef* keys) const {
+  uint64_t h = 0;
+  for (size_t i = 0; i < key_types_.size(); i++) {
+    uint64_t x;
+    if (key_types_[i] == RetType::STRING) {
+      x = utils::Hash(keys[i].ReadStringView(), 0x2545f4914f6cdd1dULL);
+    } else if (key_types_[i] == RetType::FLOAT) {
+      // 0.0 and -0.0 are the same group.
+      x = keys[i].ReadFloat() == 0 ? 0 : keys[i].data_.int_data;
+    } else {
+      x = keys[i].data_.int_data;
+    }
+    h = (std::rotl(h, 26) ^ x) * 0x9e3779b97f4a7c15ULL;
+  }
+  // The low bits of the product select the slot, but they are all zero for
+  // e.g. integer-valued floats, so they are mixed with the high bits.
+  return utils::Fmix64(h);
+}
+
+bool ParallelAggregateExecutor::SameKeys(
+    const StaticFieldRef* a, const StaticFieldRef* b) const {
+  for (size_t i = 0; i < key_types_.size(); i++) {
+    if (key_types_[i] == RetType::STRING) {
+      if (a[i].ReadStringView() != b[i].ReadStringView())
+        return false;
+    } else if (key_types_[i] == RetType::FLOAT) {
+      if (a[i].ReadFloat() != b[i].ReadFloat())
+        return false;
+    } else if (a[i].data_.int_data != b[i].data_.int_data) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace wing
@@ -0,0 +1,216 @@
+#ifndef SAKURA_PARALLEL_EXECUTOR_H__
+#define SAKURA_PARALLEL_EXECUTOR_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+
+#include "common/allocator.hpp"
+#include "common/exception.hpp"
+#include "common/thread_pool.hpp"
+#include "execution/executor.hpp"
+#include "execution/join_hash_table.hpp"
+
+namespace wing {
+
+/**
+ * Morsel-driven parallel execution.
+ *
+ * A pipeline is a chain of scans, filters, projections and hash join probes,
+ * which process each tuple independently. It is run by several copies, one
+ * per thread. The copies of a scan share a MorselSource, so each of them
+ * takes the next range of leaves when it finishes one, and fast copies take
+ * more. A GatherExecutor runs the copies on a ThreadPool and returns their
+ * batches, so the operators above it are not aware of the parallelism.
+ *
+ * The copies of a hash join share the hash table built by a JoinBuild. The
+ * build side is read in parallel if it is a pipeline too. An aggregation of a
+ * pipeline is done in parallel by a ParallelAggregateExecutor.
+ */
+
+/* Thrown if the hash tables of a parallel query exceed the memory budget.
+ * Parallel hash joins do not spill, so the query should be run again
+ * serially, which does. */
+class MemoryBudgetExceeded : public DBException {
+ public:
+  using DBException::DBException;
+};
+
+/* The build side of a parallel hash join. */
+class JoinBuild {
+ public:
+  /* "inputs" are the copies of the build side, or a single executor if it is
+   * not a pipeline. "schema" is their output schema. */
+  JoinBuild(std::vector<std::unique_ptr<Executor>> inputs,
+      const OutputSchema& schema,
+      const std::vector<std::unique_ptr<Expr>>& keys, size_t memory_budget);
+  void Init();
+  /* Read the inputs and build the hash table. The JoinBuilds of the hash
+   * joins in the inputs must be built before. */
+  void Build(ThreadPool& pool);
+  /* The hash table, which keeps "build" alive. It is valid after Build(). */
+  static std::shared_ptr<const JoinHashTable> Table(
+      std::shared_ptr<JoinBuild> build) {
+    return std::shared_ptr<const JoinHashTable>(build, &build->table_);
+  }
+
+ private:
+  void Read(size_t input);
+
+  std::vector<std::unique_ptr<Executor>> inputs_;
+  /* The rows read from each input. */
+  std::vector<TupleStore> rows_;
+  /* The keys of each input, which are evaluated on its rows. */
+  std::vector<std::vector<VecExprFunction>> keys_;
+  size_t num_keys_;
+  JoinHashTable table_;
+  size_t memory_budget_;
+  /* The memory of the rows and the hash table. */
+  std::atomic<size_t> footprint_{0};
+  std::atomic<bool> aborted_{false};
+};
+
+/**
+ * Run the copies of a pipeline in parallel, and return their batches one at a
+ * time. Before that, build the hash tables that the copies probe.
+ *
+ * Each copy runs as a task that computes one batch. The batch is returned
+ * as is, and the next batch of the copy is computed after the caller is done
+ * with it, i.e., in the next NextBatch(). So at most one batch per copy is
+ * buffered, and no tuple is copied.
+ */
+class GatherExecutor : public Executor {
+ public:
+  GatherExecutor(std::vector<std::unique_ptr<Executor>> copies,
+      std::vector<std::shared_ptr<JoinBuild>> builds, ThreadPool& pool);
+  /* Wait for the running tasks. */
+  ~GatherExecutor() override;
+  void Init() override;
+  InputTuplePtr Next() override;
+  TupleBatch& NextBatch() override;
+
+ private:
+  void Schedule(size_t copy);
+  void Produce(size_t copy);
+
+  std::vector<std::unique_ptr<Executor>> copies_;
+  std::vector<std::shared_ptr<JoinBuild>> builds_;
+  ThreadPool& pool_;
+  bool started_{false};
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  /* The last batch of each copy. */
+  std::vector<TupleBatch*> batches_;
+  /* The copies whose batches are ready to be returned. */
+  std::deque<size_t> ready_;
+  /* The number of copies that have not completed. */
+  size_t running_{0};
+  /* The number of tasks that have not finished. */
+  size_t tasks_{0};
+  bool cancelled_{false};
+  std::exception_ptr error_;
+
+  /* The copy whose batch is returned last. */
+  std::optional<size_t> current_;
+  TupleBatch empty_;
+  /* State of Next(). */
+  TupleBatch* ob_{&empty_};
+  size_t oi_{0};
+};
+
+/**
+ * Two-phase hash aggregation of the copies of a pipeline.
+ *
+ * In the first phase, each copy is read by one thread, which pre-aggregates
+ * its tuples in a small table of its own that fits in the cache. When the
+ * table is full, its groups are moved to partitions by the high bits of their
+ * hashes, and the table starts over. So a group may have several partial
+ * results, from different threads or evictions. In the second phase, the
+ * partitions are merged in parallel, one by each thread, with
+ * AggregateExprFunction::Merge().
+ */
+class ParallelAggregateExecutor : public Executor {
+ public:
+  ParallelAggregateExecutor(const std::unique_ptr<Expr>& group_predicate,
+      const OutputSchema& input_schema, const OutputSchema& output_schema,
+      std::vector<std::unique_ptr<Executor>> copies,
+      std::vector<std::shared_ptr<JoinBuild>> builds,
+      const std::vector<std::unique_ptr<Expr>>& output_exprs,
+      const std::vector<std::unique_ptr<Expr>>& group_by_exprs,
+      ThreadPool& pool);
+  void Init() override;
+  InputTuplePtr Next() override;
+  TupleBatch& NextBatch() override;
+
+ private:
+  /* The number of slots of the table of a thread. */
+  static constexpr size_t TABLE_SIZE = 1 << 10;
+  static constexpr int PARTITION_BITS = 6;
+  static constexpr uint32_t EMPTY = ~0u;
+
+  /* A partial result of a group. */
+  struct Group {
+    uint64_t hash;
+    /* The first tuple of the group, and its keys evaluated on it. */
+    const uint8_t* row;
+    const StaticFieldRef* keys;
+    /* The intermediate data of each output expression, and then that of the
+     * group predicate. */
+    AggregateIntermediateData* data;
+  };
+  /* The state of a thread in the first phase. */
+  struct Worker {
+    Worker(const Expr* group_predicate, const OutputSchema& input_schema)
+      : predicate(group_predicate, input_schema), rows(input_schema) {}
+    std::vector<AggregateExprFunction> outputs;
+    AggregateExprFunction predicate;
+    /* The keys evaluated on the input tuples and on the stored rows. */
+    std::vector<ExprFunction> input_keys, row_keys;
+    /* The first tuple of each group. */
+    TupleStore rows;
+    /* The keys and the intermediate data of the groups. */
+    BlockAllocator<1 << 16> arena;
+    /* The slots of the table, which are indexes into groups. */
+    std::vector<uint32_t> table;
+    std::vector<Group> groups;
+    std::vector<std::vector<Group>> partitions;
+  };
+
+  void Aggregate(size_t copy);
+  void Add(Worker& w, InputTuplePtr tuple, const StaticFieldRef* keys);
+  /* Move the groups in the table to the partitions. */
+  void Flush(Worker& w);
+  void Merge(size_t partition);
+  uint64_t Hash(const StaticFieldRef* keys) const;
+  bool SameKeys(const StaticFieldRef* a, const StaticFieldRef* b) const;
+
+  std::vector<std::unique_ptr<Executor>> copies_;
+  std::vector<std::shared_ptr<JoinBuild>> builds_;
+  ThreadPool& pool_;
+  OutputSchema output_schema_;
+  std::vector<RetType> key_types_;
+  /* Used to merge the groups and evaluate the outputs. */
+  std::vector<AggregateExprFunction> outputs_;
+  AggregateExprFunction predicate_;
+  /* The offset of the intermediate data of each output expression in
+   * Group::data, and then that of the group predicate and the total size. */
+  std::vector<size_t> offsets_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  /* The merged groups of each partition. */
+  std::vector<std::vector<Group>> groups_;
+  bool calculated_{false};
+  size_t partition_{0}, index_{0};
+  std::vector<StaticFieldRef> rows_;
+  TupleBatch batch_;
+  /* State of Next(). */
+  TupleBatch* ob_{&batch_};
+  size_t oi_{0};
+};
+
+}  // namespace wing
+
+#endif
@@ -2,6 +2,7 @@
 #define SAKURA_PROJECT_EXECUTOR_H__
 
 #include "execution/executor.hpp"
+#include "execution/vec_expr.hpp"
 
 namespace wing {
 
@@ -11,13 +12,37 @@ class ProjectExecutor : public Executor {
       const OutputSchema& input_schema, std::unique_ptr<Executor> ch)
     : ch_(std::move(ch)) {
     data_.reserve(exprs.size());
-    for (auto& a : exprs)
+    vec_data_.reserve(exprs.size());
+    for (auto& a : exprs) {
       data_.push_back(ExprFunction(a.get(), input_schema));
+      vec_data_.push_back(VecExprFunction(a.get(), input_schema));
+    }
   }
   void Init() override {
     result_.resize(data_.size());
     ch_->Init();
   }
+  TupleBatch& NextBatch() override {
+    auto& ch_batch = ch_->NextBatch();
+    size_t num = ch_batch.Size();
+    size_t width = data_.size();
+    if (batch_result_.size() < TupleBatch::CAPACITY * width)
+      batch_result_.resize(TupleBatch::CAPACITY * width);
+    // Evaluate an expression for all tuples before the next one. The strings
+    // in the results are valid as long as the batch of the child, i.e., until
+    // the next NextBatch().
+    ch_batch.Compact();
+    for (uint32_t i = 0; i < width; i++) {
+      vec_data_[i].Evaluate(
+          ch_batch.Tuples(), num, batch_result_.data() + i, width);
+    }
+    for (size_t j = 0; j < num; j++) {
+      batch_.Tuples()[j] =
+          reinterpret_cast<const uint8_t*>(batch_result_.data() + j * width);
+    }
+    batch_.SetSize(num);
+    return batch_;
+  }
   InputTuplePtr Next() override {
     if (auto ch_ret = ch_->Next(); ch_ret) {
       for (uint32_t i = 0; i < data_.size(); i++) {
@@ -37,8 +62,11 @@ class ProjectExecutor : public Executor {
 
  private:
   std::vector<ExprFunction> data_;
+  std::vector<VecExprFunction> vec_data_;
   std::vector<StaticFieldRef> result_;
   std::unique_ptr<Executor> ch_;
+  std::vector<StaticFieldRef> batch_result_;
+  TupleBatch batch_;
 };
 }  // namespace wing
 
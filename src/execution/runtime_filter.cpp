@@ -0,0 +1,73 @@
+#include "execution/runtime_filter.hpp"
+
+#include <bit>
+
+#include "common/murmurhash.hpp"
+
+namespace wing {
+
+RuntimeFilter::RuntimeFilter(std::vector<RetType> key_types)
+  : key_types_(std::move(key_types)),
+    min_(key_types_.size(), std::numeric_limits<int64_t>::max()),
+    max_(key_types_.size(), std::numeric_limits<int64_t>::min()) {}
+
+uint64_t RuntimeFilter::Hash(const StaticFieldRef* keys) const {
+  uint64_t h = 0;
+  for (size_t i = 0; i < key_types_.size(); i++) {
+    uint64_t v = key_types_[i] == RetType::STRING
+                     ? utils::Hash(keys[i].ReadStringView(), 0)
+                     : keys[i].data_.int_data;
+    // -0.0 equals 0.0.
+    if (key_types_[i] == RetType::FLOAT && keys[i].data_.double_data == 0)
+      v = 0;
+    h = (std::rotl(h, 26) ^ v) * 0x9e3779b97f4a7c15ULL;
+  }
+  // The low bits of the product are not mixed, and they select the bits.
+  h ^= h >> 32;
+  h *= 0xd6e8feb86659fd93ULL;
+  return h ^ (h >> 32);
+}
+
+void RuntimeFilter::Insert(const StaticFieldRef* keys) {
+  hashes_.push_back(Hash(keys));
+  for (size_t i = 0; i < key_types_.size(); i++) {
+    if (key_types_[i] == RetType::INT) {
+      min_[i] = std::min(min_[i], keys[i].ReadInt());
+      max_[i] = std::max(max_[i], keys[i].ReadInt());
+    }
+  }
+}
+
+void RuntimeFilter::Publish() {
+  size_t words = std::bit_ceil(hashes_.size() * BITS_PER_KEY / 64 + 1);
+  shift_ = 64 - std::countr_zero(words);
+  words_.assign(words, 0);
+  for (auto h : hashes_)
+    words_[shift_ == 64 ? 0 : h >> shift_] |= Mask(h);
+  hashes_.clear();
+  hashes_.shrink_to_fit();
+  published_ = true;
+}
+
+bool RuntimeFilter::Check(const StaticFieldRef* keys) const {
+  for (size_t i = 0; i < key_types_.size(); i++) {
+    if (key_types_[i] == RetType::INT &&
+        (keys[i].ReadInt() < min_[i] || keys[i].ReadInt() > max_[i]))
+      return false;
+  }
+  uint64_t h = Hash(keys), mask = Mask(h);
+  return (words_[shift_ == 64 ? 0 : h >> shift_] & mask) == mask;
+}
+
+void RuntimeFilter::Check(
+    const StaticFieldRef* keys, size_t num, uint8_t* mask) {
+  size_t dropped = 0;
+  for (size_t i = 0; i < num; i++) {
+    bool pass = Check(keys + i * key_types_.size());
+    dropped += !pass;
+    mask[i] = pass;
+  }
+  Count(num, dropped);
+}
+
+}  // namespace wing
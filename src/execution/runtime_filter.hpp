@@ -0,0 +1,74 @@
+#ifndef SAKURA_RUNTIME_FILTER_H__
+#define SAKURA_RUNTIME_FILTER_H__
+
+#include <atomic>
+#include <limits>
+#include <vector>
+
+#include "parser/expr.hpp"
+#include "type/static_field.hpp"
+
+namespace wing {
+
+/**
+ * A filter on the keys of the build side of a hash join. The join publishes
+ * it after reading the build side, and a scan on the probe side checks its
+ * tuples against it, so the tuples that cannot be joined are dropped before
+ * they go up the tree.
+ *
+ * It is a Bloom filter: each key sets 3 bits of one 64-bit word, so checking
+ * a key reads one word. Like JoinHashTable, keys are equal iff the strings or
+ * the bits of the other types are equal (-0.0 is taken as 0.0), so a key of
+ * the build side always passes. Integer keys are also checked against the
+ * minimum and the maximum of the build keys.
+ *
+ * Keys are inserted before Publish(), and checked after it. Several scans may
+ * check keys concurrently, and count the tuples they check and drop.
+ */
+class RuntimeFilter {
+ public:
+  explicit RuntimeFilter(std::vector<RetType> key_types);
+
+  /* Insert "keys", which has a key for each key type. */
+  void Insert(const StaticFieldRef* keys);
+  /* Build the filter after all keys are inserted. */
+  void Publish();
+  bool Published() const { return published_; }
+  /* Whether "keys" may be a key of the build side. */
+  bool Check(const StaticFieldRef* keys) const;
+  /* Check keys[i * KeySize()...] for i in [0, num), and set mask[i] to
+   * whether they may be a key of the build side. Count the keys. */
+  void Check(const StaticFieldRef* keys, size_t num, uint8_t* mask);
+  size_t KeySize() const { return key_types_.size(); }
+  /* The numbers of keys checked and dropped. */
+  size_t Checked() const { return checked_.load(std::memory_order_relaxed); }
+  size_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  void Count(size_t checked, size_t dropped) {
+    checked_.fetch_add(checked, std::memory_order_relaxed);
+    dropped_.fetch_add(dropped, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t BITS_PER_KEY = 16;
+
+  uint64_t Hash(const StaticFieldRef* keys) const;
+  static uint64_t Mask(uint64_t hash) {
+    return (1ULL << (hash & 63)) | (1ULL << ((hash >> 6) & 63)) |
+           (1ULL << ((hash >> 12) & 63));
+  }
+
+  std::vector<RetType> key_types_;
+  /* The hashes of the inserted keys, which are put into words_ by
+   * Publish(). */
+  std::vector<uint64_t> hashes_;
+  std::vector<uint64_t> words_;
+  /* The high bits of the hash select the word. */
+  int shift_{63};
+  std::vector<int64_t> min_, max_;
+  bool published_{false};
+  std::atomic<size_t> checked_{0}, dropped_{0};
+};
+
+}  // namespace wing
+
+#endif
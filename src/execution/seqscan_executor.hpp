@@ -2,7 +2,10 @@
 #define SAKURA_SEQSCAN_EXECUTOR_H__
 
 #include "execution/executor.hpp"
+#include "execution/runtime_filter.hpp"
+#include "execution/vec_expr.hpp"
 #include"functions/functions.hpp"
+#include "type/tuple.hpp"
 #include <iostream>
 
 namespace wing {
@@ -11,27 +14,195 @@ class SeqScanExecutor : public Executor {
  public:
   SeqScanExecutor(std::unique_ptr<Iterator<const uint8_t*>> iter,
       const std::unique_ptr<Expr>& predicate, const OutputSchema& input_schema)
-    : iter_(std::move(iter)), predicate_(predicate.get(), input_schema) {}
-  void Init() override { iter_->Init(); }
+    : iter_(std::move(iter)),
+      predicate_(predicate.get(), input_schema),
+      vec_predicate_(predicate.get(), input_schema) {}
+  // A copy of a parallel scan, which reads the morsels of "morsels" that are
+  // not taken by the other copies.
+  SeqScanExecutor(std::shared_ptr<MorselSource> morsels,
+      const std::unique_ptr<Expr>& predicate, const OutputSchema& input_schema)
+    : morsels_(std::move(morsels)),
+      predicate_(predicate.get(), input_schema),
+      vec_predicate_(predicate.get(), input_schema) {}
+  void Init() override {
+    if (iter_)
+      iter_->Init();
+  }
+  /* Drop the tuples whose "keys" are not in "filter", after it is published.
+   * "keys" are evaluated on the tuples of the scan. */
+  void AddRuntimeFilter(std::shared_ptr<RuntimeFilter> filter,
+      const std::vector<std::unique_ptr<Expr>>& keys,
+      const OutputSchema& input_schema) {
+    RuntimeFilterKeys f;
+    f.filter = std::move(filter);
+    for (auto& key : keys) {
+      f.keys.emplace_back(key.get(), input_schema);
+      f.vec_keys.emplace_back(key.get(), input_schema);
+    }
+    runtime_filters_.push_back(std::move(f));
+  }
+  /* Output only the columns of "output_schema" of the rows of
+   * "table_schema". They are deserialized from the rows that pass the
+   * predicate and the runtime filters, which are evaluated on the raw rows,
+   * and the strings are not read until they are used. */
+  void SetOutputColumns(
+      const OutputSchema& table_schema, const OutputSchema& output_schema) {
+    columns_.clear();
+    for (auto& out : output_schema.GetCols()) {
+      uint32_t offset = 0, str_id = 0;
+      for (auto& col : table_schema.GetCols()) {
+        bool is_str =
+            col.type_ == FieldType::CHAR || col.type_ == FieldType::VARCHAR;
+        if (col.id_ == out.id_) {
+          // Strings are behind static fields, as in the raw tuple layout.
+          columns_.push_back({col.type_, col.size_, is_str,
+              is_str ? Tuple::GetOffsetsOfStrings(offset, str_id)
+                     : Tuple::GetOffsetOfStaticField(offset)});
+          break;
+        }
+        if (is_str)
+          str_id += 1;
+        else
+          offset += col.size_;
+      }
+    }
+    rows_.resize(TupleBatch::CAPACITY * columns_.size());
+  }
   InputTuplePtr Next() override {
+    if (!iter_ && !NextMorsel())
+      return {};
     auto result = iter_->Next();
-    while (
-        result && (predicate_ && predicate_.Evaluate(result).ReadInt() == 0)) {
+    while ((result && ((predicate_ &&
+                           predicate_.Evaluate(result).ReadInt() == 0) ||
+                          !CheckRuntimeFilters(result))) ||
+           (!result && NextMorsel())) {
       result = iter_->Next();
     }
     if (result) {
       output_size++;
+      if (!columns_.empty()) {
+        Materialize(result, rows_.data());
+        return reinterpret_cast<const uint8_t*>(rows_.data());
+      }
       return result;
     } else {
       // if(output_size){ printf("Scan finish, output size= %lu\n",output_size); fflush(stdout); output_size=0; }
       return {};
     }
   }
+  TupleBatch& NextBatch() override {
+    if (!iter_ && !NextMorsel()) {
+      batch_.Clear();
+      return batch_;
+    }
+    for (;;) {
+      batch_.SetSize(iter_->NextBatch(batch_.Tuples(), TupleBatch::CAPACITY));
+      if (batch_.Size() == 0 && NextMorsel())
+        continue;
+      if (batch_.Size() == 0)
+        return batch_;
+      if (vec_predicate_) {
+        vec_predicate_.EvaluateMask(
+            batch_.Tuples(), batch_.Size(), mask_.data());
+        batch_.SelectMask(mask_.data());
+      }
+      for (auto& f : runtime_filters_) {
+        if (batch_.Size() == 0 || !f.filter->Published())
+          continue;
+        size_t n = batch_.Size(), k = f.keys.size();
+        batch_.Compact();
+        keys_.resize(n * k);
+        for (size_t i = 0; i < k; i++)
+          f.vec_keys[i].Evaluate(batch_.Tuples(), n, keys_.data() + i, k);
+        f.filter->Check(keys_.data(), n, mask_.data());
+        batch_.SelectMask(mask_.data());
+      }
+      // Do not return an empty batch unless the scan has completed.
+      if (batch_.Size() > 0) {
+        if (!columns_.empty())
+          MaterializeBatch();
+        return batch_;
+      }
+    }
+  }
 
  private:
+  // Move to the next morsel. Return false if there are no more morsels.
+  bool NextMorsel() {
+    if (!morsels_)
+      return false;
+    iter_ = morsels_->Next();
+    if (!iter_)
+      return false;
+    iter_->Init();
+    return true;
+  }
+
+  bool CheckRuntimeFilters(InputTuplePtr tuple) {
+    for (auto& f : runtime_filters_) {
+      if (!f.filter->Published())
+        continue;
+      keys_.resize(f.keys.size());
+      for (size_t i = 0; i < f.keys.size(); i++)
+        keys_[i] = f.keys[i].Evaluate(tuple);
+      bool pass = f.filter->Check(keys_.data());
+      f.filter->Count(1, !pass);
+      if (!pass)
+        return false;
+    }
+    return true;
+  }
+
+  void Materialize(const uint8_t* in, StaticFieldRef* out) const {
+    for (size_t i = 0; i < columns_.size(); i++) {
+      auto& c = columns_[i];
+      if (c.is_str) {
+        out[i] = StaticFieldRef::CreateStringRef(
+            reinterpret_cast<const StaticStringField*>(
+                in + *reinterpret_cast<const uint32_t*>(in + c.offset)));
+      } else {
+        out[i].Read(c.type, c.size, in + c.offset);
+      }
+    }
+  }
+
+  void MaterializeBatch() {
+    batch_.Compact();
+    auto tuples = batch_.Tuples();
+    for (size_t i = 0; i < batch_.Size(); i++) {
+      auto out = rows_.data() + i * columns_.size();
+      Materialize(tuples[i], out);
+      tuples[i] = reinterpret_cast<const uint8_t*>(out);
+    }
+  }
+
+  /* An output column. "offset" is the offset of the field in the raw row, or
+   * of its offset if it is a string. */
+  struct OutputColumn {
+    FieldType type;
+    uint32_t size;
+    bool is_str;
+    uint32_t offset;
+  };
+
+  struct RuntimeFilterKeys {
+    std::shared_ptr<RuntimeFilter> filter;
+    std::vector<ExprFunction> keys;
+    std::vector<VecExprFunction> vec_keys;
+  };
+
   size_t output_size=0;
+  std::shared_ptr<MorselSource> morsels_;
   std::unique_ptr<Iterator<const uint8_t*>> iter_;
   ExprFunction predicate_;
+  VecExprFunction vec_predicate_;
+  TupleBatch batch_;
+  std::array<uint8_t, TupleBatch::CAPACITY> mask_;
+  std::vector<RuntimeFilterKeys> runtime_filters_;
+  std::vector<StaticFieldRef> keys_;
+  /* The output columns if not all columns are output, and the output rows. */
+  std::vector<OutputColumn> columns_;
+  std::vector<StaticFieldRef> rows_;
 };
 
 }  // namespace wing
@@ -0,0 +1,147 @@
+#include "execution/spill_file.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+
+#include "common/exception.hpp"
+#include "type/tuple.hpp"
+
+namespace wing {
+
+SpillFile::SpillFile(const OutputSchema& schema)
+  : schema_(schema), fields_(schema.Size()) {
+  for (uint32_t i = 0; i < schema.Size(); i++) {
+    if (schema[i].type_ == FieldType::CHAR ||
+        schema[i].type_ == FieldType::VARCHAR)
+      str_indexes_.push_back(i);
+  }
+  auto dir = std::filesystem::temp_directory_path();
+  fd_ = open(dir.c_str(), O_TMPFILE | O_RDWR, 0600);
+  if (fd_ < 0) {
+    // The file system does not support O_TMPFILE.
+    std::string path = (dir / "wing-spill-XXXXXX").string();
+    fd_ = mkstemp(path.data());
+    if (fd_ >= 0)
+      unlink(path.c_str());
+  }
+  if (fd_ < 0) {
+    throw DBException("Fail to create spill file in {}: {}", dir.string(),
+        strerror(errno));
+  }
+  write_buf_.reserve(BUFFER_SIZE);
+}
+
+SpillFile::SpillFile(SpillFile&& f)
+  : fd_(f.fd_),
+    schema_(std::move(f.schema_)),
+    str_indexes_(std::move(f.str_indexes_)),
+    fields_(std::move(f.fields_)),
+    num_(f.num_),
+    write_buf_(std::move(f.write_buf_)),
+    write_offset_(f.write_offset_),
+    read_buf_(std::move(f.read_buf_)),
+    read_pos_(f.read_pos_),
+    read_offset_(f.read_offset_) {
+  f.fd_ = -1;
+}
+
+SpillFile::~SpillFile() {
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+void SpillFile::Append(const uint8_t* tuple) {
+  auto fields = reinterpret_cast<const StaticFieldRef*>(tuple);
+  if (schema_.IsRaw()) {
+    // The strings of the deserialized fields point to the raw tuple.
+    Tuple::DeSerialize(fields_.data(), tuple, schema_.GetCols());
+    fields = fields_.data();
+  }
+  uint32_t len = schema_.Size() * sizeof(StaticFieldRef);
+  for (auto i : str_indexes_)
+    len += fields[i].Size(FieldType::VARCHAR, 0);
+  if (write_buf_.size() + sizeof(len) + len > BUFFER_SIZE)
+    Flush();
+  size_t pos = write_buf_.size();
+  write_buf_.resize(pos + sizeof(len) + len);
+  uint8_t* out = write_buf_.data() + pos;
+  std::memcpy(out, &len, sizeof(len));
+  out += sizeof(len);
+  std::memcpy(out, fields, schema_.Size() * sizeof(StaticFieldRef));
+  uint64_t offset = schema_.Size() * sizeof(StaticFieldRef);
+  for (auto i : str_indexes_) {
+    size_t size = fields[i].Size(FieldType::VARCHAR, 0);
+    std::memcpy(out + offset, fields[i].data_.str_data, size);
+    std::memcpy(out + i * sizeof(StaticFieldRef), &offset, sizeof(offset));
+    offset += size;
+  }
+  num_ += 1;
+}
+
+size_t SpillFile::Read(TupleStore& store, size_t max) {
+  Flush();
+  size_t num = 0;
+  for (; num < max; num++) {
+    uint32_t len;
+    if (!Fill(sizeof(len)))
+      break;
+    std::memcpy(&len, read_buf_.data() + read_pos_, sizeof(len));
+    if (!Fill(sizeof(len) + len))
+      throw DBException("Spill file is truncated.");
+    uint8_t* tuple = read_buf_.data() + read_pos_ + sizeof(len);
+    auto fields = reinterpret_cast<StaticFieldRef*>(tuple);
+    for (auto i : str_indexes_) {
+      uint64_t offset;
+      std::memcpy(&offset, &fields[i], sizeof(offset));
+      fields[i].data_.str_data =
+          reinterpret_cast<const StaticStringField*>(tuple + offset);
+    }
+    store.Append(tuple);
+    read_pos_ += sizeof(len) + len;
+  }
+  return num;
+}
+
+void SpillFile::Flush() {
+  size_t done = 0;
+  while (done < write_buf_.size()) {
+    ssize_t ret = pwrite(fd_, write_buf_.data() + done,
+        write_buf_.size() - done, write_offset_ + done);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret < 0)
+      throw DBException("Fail to write spill file: {}", strerror(errno));
+    done += ret;
+  }
+  write_offset_ += done;
+  write_buf_.clear();
+}
+
+bool SpillFile::Fill(size_t len) {
+  size_t avail = read_buf_.size() - read_pos_;
+  if (avail >= len)
+    return true;
+  // Move the remaining bytes to the front, and read after them.
+  std::memmove(read_buf_.data(), read_buf_.data() + read_pos_, avail);
+  read_buf_.resize(std::max(len, BUFFER_SIZE));
+  read_pos_ = 0;
+  while (avail < len) {
+    ssize_t ret = pread(fd_, read_buf_.data() + avail,
+        read_buf_.size() - avail, read_offset_);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret < 0)
+      throw DBException("Fail to read spill file: {}", strerror(errno));
+    if (ret == 0)
+      break;
+    avail += ret;
+    read_offset_ += ret;
+  }
+  read_buf_.resize(avail);
+  return avail >= len;
+}
+
+}  // namespace wing
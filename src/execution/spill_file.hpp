@@ -0,0 +1,68 @@
+#ifndef SAKURA_SPILL_FILE_H__
+#define SAKURA_SPILL_FILE_H__
+
+#include <vector>
+
+#include "plan/output_schema.hpp"
+#include "type/static_field.hpp"
+#include "type/vector.hpp"
+
+namespace wing {
+
+/**
+ * A temporary file of tuples, which executors use to move data that does not
+ * fit in their memory budget to disk.
+ *
+ * Tuples are appended, and then read back in the same order. Both are buffered,
+ * so the file is accessed in large sequential I/Os. The file is created in the
+ * temporary directory and unlinked at once, so it is removed when the
+ * SpillFile is destroyed, even if the process crashes.
+ *
+ * A tuple is stored as its StaticFieldRefs, with the string fields replaced
+ * by offsets, followed by the strings. The input tuples have the schema of
+ * the constructor, which may be raw. The tuples read back are not raw.
+ *
+ * It throws DBException if an I/O fails.
+ */
+class SpillFile {
+ public:
+  explicit SpillFile(const OutputSchema& schema);
+  SpillFile(SpillFile&& f);
+  SpillFile(const SpillFile&) = delete;
+  SpillFile& operator=(const SpillFile&) = delete;
+  ~SpillFile();
+
+  void Append(const uint8_t* tuple);
+  /* Read at most "max" tuples that are not read yet, and append them to
+   * "store". Return the number of tuples read. Tuples cannot be appended
+   * after reading. */
+  size_t Read(TupleStore& store, size_t max);
+  /* The number of tuples. */
+  size_t Size() const { return num_; }
+  /* The size of the file. */
+  size_t Bytes() const { return write_offset_ + write_buf_.size(); }
+
+ private:
+  void Flush();
+  /* Make sure that there are "len" bytes in read_buf_ from read_pos_. Return
+   * false if the file ends before. */
+  bool Fill(size_t len);
+
+  static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+  int fd_{-1};
+  OutputSchema schema_;
+  std::vector<uint32_t> str_indexes_;
+  /* Deserialized raw tuple. */
+  std::vector<StaticFieldRef> fields_;
+  size_t num_{0};
+  std::vector<uint8_t> write_buf_;
+  size_t write_offset_{0};
+  std::vector<uint8_t> read_buf_;
+  size_t read_pos_{0};
+  size_t read_offset_{0};
+};
+
+}  // namespace wing
+
+#endif
@@ -0,0 +1,74 @@
+#include "execution/tuple_sorter.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace wing {
+
+uint64_t TupleSorter::NormalizedKey(const StaticFieldRef* tuple) const {
+  constexpr uint64_t SIGN = uint64_t(1) << 63;
+  uint64_t key = 0;
+  switch (order_[0].first) {
+    case RetType::INT:
+      key = static_cast<uint64_t>(tuple[0].ReadInt()) ^ SIGN;
+      break;
+    case RetType::FLOAT: {
+      // -0.0 is equal to 0.0, so it must have the same key.
+      double x = tuple[0].ReadFloat();
+      key = x == 0 ? SIGN : std::bit_cast<uint64_t>(x);
+      key = key & SIGN ? ~key : key ^ SIGN;
+      break;
+    }
+    case RetType::STRING: {
+      auto str = tuple[0].ReadStringView();
+      uint8_t bytes[8] = {};
+      std::memcpy(bytes, str.data(), std::min<size_t>(str.size(), 8));
+      for (auto b : bytes)
+        key = key << 8 | b;
+      break;
+    }
+  }
+  return order_[0].second ? key : ~key;
+}
+
+void TupleSorter::Sort(StaticFieldRef** begin, StaticFieldRef** end) const {
+  size_t n = end - begin;
+  auto less = [this](const StaticFieldRef* a, const StaticFieldRef* b) {
+    return Less(a, b);
+  };
+  if (order_.empty())
+    return;
+  if (n < RADIX_THRESHOLD) {
+    std::sort(begin, end, less);
+    return;
+  }
+  std::vector<Entry> entries(n), tmp(n);
+  for (size_t i = 0; i < n; i++)
+    entries[i] = {NormalizedKey(begin[i]), begin[i]};
+  // LSD radix sort by bytes, skipping the bytes that all keys share.
+  for (int shift = 0; shift < 64; shift += 8) {
+    size_t count[257] = {};
+    for (auto& e : entries)
+      count[(e.key >> shift & 0xff) + 1] += 1;
+    if (std::find(count + 1, count + 257, n) != count + 257)
+      continue;
+    for (int i = 0; i < 256; i++)
+      count[i + 1] += count[i];
+    for (auto& e : entries)
+      tmp[count[e.key >> shift & 0xff]++] = e;
+    entries.swap(tmp);
+  }
+  for (size_t i = 0; i < n; i++)
+    begin[i] = entries[i].tuple;
+  if (exact_)
+    return;
+  for (size_t i = 0, j; i < n; i = j) {
+    for (j = i + 1; j < n && entries[j].key == entries[i].key; j++) {
+    }
+    if (j - i > 1)
+      std::sort(begin + i, begin + j, less);
+  }
+}
+
+}  // namespace wing
@@ -0,0 +1,77 @@
+#ifndef SAKURA_TUPLE_SORTER_H__
+#define SAKURA_TUPLE_SORTER_H__
+
+#include <vector>
+
+#include "parser/expr.hpp"
+#include "type/static_field.hpp"
+
+namespace wing {
+
+/**
+ * Sort tuples by their first fields, which are the sort keys.
+ *
+ * Sort() encodes the first key of each tuple into a normalized key: 8 bytes
+ * whose unsigned order is the order of the key. Integers flip their sign bit,
+ * and floats flip their sign bit if positive and all bits if negative. So
+ * they compare as unsigned integers. Strings take their first 8 bytes, in big
+ * endian, padded with 0. Descending keys invert all bits. The tuples are radix
+ * sorted by their normalized keys, and then the tuples with the same
+ * normalized key, which may differ in the other keys or after the string
+ * prefixes, are sorted by Less().
+ *
+ * It has no global state, so several sorts can run concurrently.
+ */
+class TupleSorter {
+ public:
+  TupleSorter() = default;
+  /* The type of each key, and whether it is ascending. */
+  explicit TupleSorter(std::vector<std::pair<RetType, bool>> order)
+    : order_(std::move(order)),
+      exact_(order_.size() == 1 && order_[0].first != RetType::STRING) {}
+
+  /* Whether tuple a goes before tuple b. */
+  bool Less(const StaticFieldRef* a, const StaticFieldRef* b) const {
+    for (size_t i = 0; i < order_.size(); i++) {
+      int c = 0;
+      switch (order_[i].first) {
+        case RetType::INT:
+          c = (a[i].ReadInt() > b[i].ReadInt()) -
+              (a[i].ReadInt() < b[i].ReadInt());
+          break;
+        case RetType::FLOAT:
+          c = (a[i].ReadFloat() > b[i].ReadFloat()) -
+              (a[i].ReadFloat() < b[i].ReadFloat());
+          break;
+        case RetType::STRING:
+          c = a[i].ReadStringView().compare(b[i].ReadStringView());
+          break;
+      }
+      if (c != 0)
+        return (c < 0) == order_[i].second;
+    }
+    return false;
+  }
+  /* The normalized key of the first key of the tuple. */
+  uint64_t NormalizedKey(const StaticFieldRef* tuple) const;
+  /* Sort the tuples in [begin, end). */
+  void Sort(StaticFieldRef** begin, StaticFieldRef** end) const;
+  const std::vector<std::pair<RetType, bool>>& Order() const { return order_; }
+
+ private:
+  /* Shorter ranges are sorted by std::sort instead of radix sort. */
+  static constexpr size_t RADIX_THRESHOLD = 256;
+
+  struct Entry {
+    uint64_t key;
+    StaticFieldRef* tuple;
+  };
+
+  std::vector<std::pair<RetType, bool>> order_;
+  /* Whether equal normalized keys mean equal tuples. */
+  bool exact_{false};
+};
+
+}  // namespace wing
+
+#endif
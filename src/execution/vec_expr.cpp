@@ -0,0 +1,396 @@
+#include "execution/vec_expr.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "type/tuple.hpp"
+
+namespace wing {
+
+namespace __detail {
+
+/* Kernels process at most VEC_CHUNK tuples at a time, so that the vectors of
+ * intermediate results have fixed sizes and stay in the cache. */
+static constexpr size_t VEC_CHUNK = 1024;
+
+/**
+ * A kernel producing a vector of T. T is int64_t for INT, double for FLOAT,
+ * and StaticFieldRef for STRING.
+ */
+template <typename T>
+class VecExpr {
+ public:
+  virtual ~VecExpr() = default;
+  /* Write the results of input[0...num - 1] to out[0...num - 1]. num is at
+   * most VEC_CHUNK. */
+  virtual void Evaluate(const uint8_t* const* input, size_t num, T* out) = 0;
+};
+
+template <typename T>
+class ConstantVecExpr : public VecExpr<T> {
+ public:
+  ConstantVecExpr(T x) : x_(x) {}
+  void Evaluate(const uint8_t* const*, size_t num, T* out) override {
+    std::fill_n(out, num, x_);
+  }
+
+ private:
+  T x_;
+};
+
+class StringConstantVecExpr : public VecExpr<StaticFieldRef> {
+ public:
+  StringConstantVecExpr(std::string_view str)
+    : str_(StaticStringField::Generate(str)) {}
+  ~StringConstantVecExpr() { StaticStringField::FreeFromGenerate(str_); }
+  void Evaluate(
+      const uint8_t* const*, size_t num, StaticFieldRef* out) override {
+    std::fill_n(out, num, StaticFieldRef::CreateStringRef(str_));
+  }
+
+ private:
+  StaticStringField* str_;
+};
+
+/* Read the field of type S at "offset" of each tuple, and convert it to T. */
+template <typename T, typename S>
+class ColumnVecExpr : public VecExpr<T> {
+ public:
+  ColumnVecExpr(uint32_t offset) : offset_(offset) {}
+  void Evaluate(const uint8_t* const* input, size_t num, T* out) override {
+    for (size_t i = 0; i < num; i++)
+      out[i] = static_cast<T>(InputTuplePtr(input[i]).Read<S>(offset_));
+  }
+
+ private:
+  uint32_t offset_;
+};
+
+/* Read a VARCHAR from raw tuples. See InputTuplePtr::CreateStringRef. */
+class StringColumnVecExpr : public VecExpr<StaticFieldRef> {
+ public:
+  StringColumnVecExpr(uint32_t offset) : offset_(offset) {}
+  void Evaluate(
+      const uint8_t* const* input, size_t num, StaticFieldRef* out) override {
+    for (size_t i = 0; i < num; i++)
+      out[i] = InputTuplePtr(input[i]).CreateStringRef(offset_);
+  }
+
+ private:
+  uint32_t offset_;
+};
+
+/* out[i] = op(x[i]), where x is the vector of the child. */
+template <typename T, typename C, typename Op>
+class UnaryVecExpr : public VecExpr<T> {
+ public:
+  UnaryVecExpr(std::unique_ptr<VecExpr<C>> ch, Op op)
+    : ch_(std::move(ch)), x_(new C[VEC_CHUNK]), op_(op) {}
+  void Evaluate(const uint8_t* const* input, size_t num, T* out) override {
+    ch_->Evaluate(input, num, x_.get());
+    const C* __restrict x = x_.get();
+    T* __restrict o = out;
+    for (size_t i = 0; i < num; i++)
+      o[i] = static_cast<T>(op_(x[i]));
+  }
+
+ private:
+  std::unique_ptr<VecExpr<C>> ch_;
+  std::unique_ptr<C[]> x_;
+  Op op_;
+};
+
+/* out[i] = op(x[i], y[i]), where x and y are the vectors of the children. */
+template <typename T, typename C, typename Op>
+class BinaryVecExpr : public VecExpr<T> {
+ public:
+  BinaryVecExpr(
+      std::unique_ptr<VecExpr<C>> ch0, std::unique_ptr<VecExpr<C>> ch1, Op op)
+    : ch0_(std::move(ch0)),
+      ch1_(std::move(ch1)),
+      x_(new C[VEC_CHUNK]),
+      y_(new C[VEC_CHUNK]),
+      op_(op) {}
+  void Evaluate(const uint8_t* const* input, size_t num, T* out) override {
+    ch0_->Evaluate(input, num, x_.get());
+    ch1_->Evaluate(input, num, y_.get());
+    const C* __restrict x = x_.get();
+    const C* __restrict y = y_.get();
+    T* __restrict o = out;
+    for (size_t i = 0; i < num; i++)
+      o[i] = static_cast<T>(op_(x[i], y[i]));
+  }
+
+ private:
+  std::unique_ptr<VecExpr<C>> ch0_, ch1_;
+  std::unique_ptr<C[]> x_, y_;
+  Op op_;
+};
+
+template <typename T, typename C, typename Op>
+std::unique_ptr<VecExpr<T>> MakeUnary(std::unique_ptr<VecExpr<C>> ch, Op op) {
+  return std::make_unique<UnaryVecExpr<T, C, Op>>(std::move(ch), op);
+}
+
+template <typename T, typename C, typename Op>
+std::unique_ptr<VecExpr<T>> MakeBinary(
+    std::unique_ptr<VecExpr<C>> ch0, std::unique_ptr<VecExpr<C>> ch1, Op op) {
+  return std::make_unique<BinaryVecExpr<T, C, Op>>(
+      std::move(ch0), std::move(ch1), op);
+}
+
+template <typename T>
+std::unique_ptr<VecExpr<T>> GenerateVecExpr(
+    const Expr* expr, const OutputSchema& input_schema);
+
+std::unique_ptr<VecExpr<StaticFieldRef>> GenerateStringVecExpr(
+    const Expr* expr, const OutputSchema& input_schema);
+
+/* Generate the kernels of the binary operator "expr", whose children are
+ * evaluated as C. It follows GenerateExprFunction in exprdata.cpp. */
+template <typename T, typename C>
+std::unique_ptr<VecExpr<T>> GenerateBinaryVecExpr(
+    const Expr* expr, OpType op_type, const OutputSchema& input_schema) {
+  auto ch0 = GenerateVecExpr<C>(expr->ch0_.get(), input_schema);
+  auto ch1 = GenerateVecExpr<C>(expr->ch1_.get(), input_schema);
+#define GEN_KERNEL(op_name, op)                                     \
+  {                                                                 \
+    if (op_type == OpType::op_name) {                               \
+      return MakeBinary<T, C>(std::move(ch0), std::move(ch1),       \
+          [](C x, C y) { return op; });                             \
+    }                                                               \
+  }
+  GEN_KERNEL(ADD, x + y);
+  GEN_KERNEL(SUB, x - y);
+  GEN_KERNEL(MUL, x * y);
+  GEN_KERNEL(DIV, x / y);
+  GEN_KERNEL(LT, x < y);
+  GEN_KERNEL(GT, x > y);
+  GEN_KERNEL(LEQ, x <= y);
+  GEN_KERNEL(GEQ, x >= y);
+  GEN_KERNEL(EQ, x == y);
+  GEN_KERNEL(NEQ, x != y);
+  if constexpr (std::is_same_v<C, int64_t>) {
+    GEN_KERNEL(MOD, x % y);
+    GEN_KERNEL(BITAND, x & y);
+    GEN_KERNEL(BITOR, x | y);
+    GEN_KERNEL(BITXOR, x ^ y);
+    GEN_KERNEL(BITLSH, x << y);
+    GEN_KERNEL(BITRSH, x >> y);
+    // Both sides are evaluated anyway, so use bitwise operators to avoid
+    // branches.
+    GEN_KERNEL(AND, (x != 0) & (y != 0));
+    GEN_KERNEL(OR, (x != 0) | (y != 0));
+    DB_ERR("Internal Error: Invalid operator between two integer numbers.");
+  }
+#undef GEN_KERNEL
+  DB_ERR("Internal Error: Invalid operator between two real numbers.");
+}
+
+template <typename T>
+std::unique_ptr<VecExpr<T>> GenerateStringCompareVecExpr(
+    const BinaryConditionExpr* expr, const OutputSchema& input_schema) {
+  auto ch0 = GenerateStringVecExpr(expr->ch0_.get(), input_schema);
+  auto ch1 = GenerateStringVecExpr(expr->ch1_.get(), input_schema);
+#define GEN_STR_KERNEL(op_name, op)                                          \
+  {                                                                          \
+    if (expr->op_ == OpType::op_name) {                                      \
+      return MakeBinary<T, StaticFieldRef>(std::move(ch0), std::move(ch1),   \
+          [](StaticFieldRef x, StaticFieldRef y) {                           \
+            return x.ReadStringView() op y.ReadStringView();                 \
+          });                                                                \
+    }                                                                        \
+  }
+  GEN_STR_KERNEL(LT, <);
+  GEN_STR_KERNEL(GT, >);
+  GEN_STR_KERNEL(LEQ, <=);
+  GEN_STR_KERNEL(GEQ, >=);
+  GEN_STR_KERNEL(EQ, ==);
+  GEN_STR_KERNEL(NEQ, !=);
+#undef GEN_STR_KERNEL
+  DB_ERR("Internal Error: Invalid operator on strings.");
+}
+
+template <typename T>
+std::unique_ptr<VecExpr<T>> GenerateVecExpr(
+    const Expr* expr, const OutputSchema& input_schema) {
+  if (expr->type_ == ExprType::LITERAL_INTEGER) {
+    return std::make_unique<ConstantVecExpr<T>>(static_cast<T>(
+        static_cast<const LiteralIntegerExpr*>(expr)->literal_value_));
+  } else if (expr->type_ == ExprType::LITERAL_FLOAT) {
+    return std::make_unique<ConstantVecExpr<T>>(static_cast<T>(
+        static_cast<const LiteralFloatExpr*>(expr)->literal_value_));
+  } else if (expr->type_ == ExprType::UNARYOP) {
+    return MakeUnary<T, T>(GenerateVecExpr<T>(expr->ch0_.get(), input_schema),
+        [](T x) { return -x; });
+  } else if (expr->type_ == ExprType::UNARYCONDOP) {
+    return MakeUnary<T, T>(GenerateVecExpr<T>(expr->ch0_.get(), input_schema),
+        [](T x) { return !x; });
+  } else if (expr->type_ == ExprType::BINOP) {
+    auto this_expr = static_cast<const BinaryExpr*>(expr);
+    if (this_expr->ch0_->ret_type_ == RetType::FLOAT) {
+      return GenerateBinaryVecExpr<T, double>(
+          this_expr, this_expr->op_, input_schema);
+    } else if (this_expr->ch0_->ret_type_ == RetType::INT) {
+      return GenerateBinaryVecExpr<T, int64_t>(
+          this_expr, this_expr->op_, input_schema);
+    }
+  } else if (expr->type_ == ExprType::BINCONDOP) {
+    auto this_expr = static_cast<const BinaryConditionExpr*>(expr);
+    if (this_expr->ch0_->ret_type_ == RetType::STRING) {
+      return GenerateStringCompareVecExpr<T>(this_expr, input_schema);
+    } else if (this_expr->ch0_->ret_type_ == RetType::FLOAT) {
+      return GenerateBinaryVecExpr<T, double>(
+          this_expr, this_expr->op_, input_schema);
+    } else if (this_expr->ch0_->ret_type_ == RetType::INT) {
+      return GenerateBinaryVecExpr<T, int64_t>(
+          this_expr, this_expr->op_, input_schema);
+    }
+  } else if (expr->type_ == ExprType::COLUMN) {
+    auto this_expr = static_cast<const ColumnExpr*>(expr);
+    uint32_t offset = 0;
+    for (uint32_t index = 0; auto& col : input_schema.GetCols()) {
+      if (col.id_ == this_expr->id_in_column_name_table_) {
+        if (!input_schema.IsRaw()) {
+          // The input is an array of StaticFieldRef.
+          return std::make_unique<ColumnVecExpr<T, T>>(
+              index * sizeof(StaticFieldRef));
+        } else if (col.type_ == FieldType::INT32) {
+          return std::make_unique<ColumnVecExpr<T, int32_t>>(
+              Tuple::GetOffsetOfStaticField(offset));
+        } else {
+          return std::make_unique<ColumnVecExpr<T, T>>(
+              Tuple::GetOffsetOfStaticField(offset));
+        }
+      }
+      offset += col.size_;
+      index += 1;
+    }
+    DB_ERR("Internal Error: Expression contains invalid parameters.");
+  } else if (expr->type_ == ExprType::CAST) {
+    if (expr->ret_type_ == RetType::FLOAT &&
+        expr->ch0_->ret_type_ == RetType::INT) {
+      return MakeUnary<T, int64_t>(
+          GenerateVecExpr<int64_t>(expr->ch0_.get(), input_schema),
+          [](int64_t x) { return x; });
+    } else if (expr->ret_type_ == RetType::INT &&
+               expr->ch0_->ret_type_ == RetType::FLOAT) {
+      return MakeUnary<T, double>(
+          GenerateVecExpr<double>(expr->ch0_.get(), input_schema),
+          [](double x) { return x; });
+    } else
+      DB_ERR("Internal Error: Invalid CastExpr.");
+  }
+  DB_ERR("Internal Error: Invalid Expr.");
+}
+
+std::unique_ptr<VecExpr<StaticFieldRef>> GenerateStringVecExpr(
+    const Expr* expr, const OutputSchema& input_schema) {
+  if (expr->type_ == ExprType::LITERAL_STRING) {
+    return std::make_unique<StringConstantVecExpr>(
+        static_cast<const LiteralStringExpr*>(expr)->literal_value_);
+  } else if (expr->type_ == ExprType::COLUMN) {
+    auto this_expr = static_cast<const ColumnExpr*>(expr);
+    uint32_t offset = 0, id_in_str = 0;
+    for (uint32_t index = 0; auto& col : input_schema.GetCols()) {
+      if (col.id_ == this_expr->id_in_column_name_table_) {
+        if (!input_schema.IsRaw()) {
+          return std::make_unique<ColumnVecExpr<StaticFieldRef,
+              StaticFieldRef>>(index * sizeof(StaticFieldRef));
+        }
+        return std::make_unique<StringColumnVecExpr>(
+            Tuple::GetOffsetsOfStrings(offset, id_in_str));
+      }
+      if (col.type_ == FieldType::VARCHAR || col.type_ == FieldType::CHAR) {
+        id_in_str += 1;
+      } else {
+        offset += col.size_;
+      }
+      index += 1;
+    }
+    DB_ERR("Internal Error: Expression contains invalid parameters.");
+  }
+  DB_ERR("Internal Error: Invalid Expr.");
+}
+
+/* Whether the result is regarded as true, i.e., ReadInt() != 0. */
+inline bool IsTrue(int64_t x) { return x != 0; }
+inline bool IsTrue(double x) { return std::bit_cast<int64_t>(x) != 0; }
+inline bool IsTrue(StaticFieldRef x) { return x.ReadInt() != 0; }
+
+class VecExprRoot {
+ public:
+  virtual ~VecExprRoot() = default;
+  virtual void Evaluate(const uint8_t* const* input, size_t num,
+      StaticFieldRef* out, size_t stride) = 0;
+  virtual void EvaluateMask(
+      const uint8_t* const* input, size_t num, uint8_t* mask) = 0;
+};
+
+/* Split the input into chunks, and convert the results of the kernels. */
+template <typename T>
+class VecExprRootImpl : public VecExprRoot {
+ public:
+  VecExprRootImpl(std::unique_ptr<VecExpr<T>> expr)
+    : expr_(std::move(expr)), buf_(new T[VEC_CHUNK]) {}
+  void Evaluate(const uint8_t* const* input, size_t num, StaticFieldRef* out,
+      size_t stride) override {
+    for (size_t begin = 0; begin < num; begin += VEC_CHUNK) {
+      size_t len = std::min(VEC_CHUNK, num - begin);
+      expr_->Evaluate(input + begin, len, buf_.get());
+      for (size_t i = 0; i < len; i++)
+        out[(begin + i) * stride] = StaticFieldRef(buf_[i]);
+    }
+  }
+  void EvaluateMask(
+      const uint8_t* const* input, size_t num, uint8_t* mask) override {
+    for (size_t begin = 0; begin < num; begin += VEC_CHUNK) {
+      size_t len = std::min(VEC_CHUNK, num - begin);
+      expr_->Evaluate(input + begin, len, buf_.get());
+      for (size_t i = 0; i < len; i++)
+        mask[begin + i] = IsTrue(buf_[i]);
+    }
+  }
+
+ private:
+  std::unique_ptr<VecExpr<T>> expr_;
+  std::unique_ptr<T[]> buf_;
+};
+
+}  // namespace __detail
+
+VecExprFunction::VecExprFunction(
+    const Expr* expr, const OutputSchema& input_schema) {
+  if (expr == nullptr)
+    return;
+  if (expr->ret_type_ == RetType::STRING) {
+    root_ = std::make_unique<__detail::VecExprRootImpl<StaticFieldRef>>(
+        __detail::GenerateStringVecExpr(expr, input_schema));
+  } else if (expr->ret_type_ == RetType::INT) {
+    root_ = std::make_unique<__detail::VecExprRootImpl<int64_t>>(
+        __detail::GenerateVecExpr<int64_t>(expr, input_schema));
+  } else if (expr->ret_type_ == RetType::FLOAT) {
+    root_ = std::make_unique<__detail::VecExprRootImpl<double>>(
+        __detail::GenerateVecExpr<double>(expr, input_schema));
+  } else {
+    DB_ERR("Internal Error: Invalid Expr.");
+  }
+}
+
+VecExprFunction::VecExprFunction(VecExprFunction&&) = default;
+VecExprFunction& VecExprFunction::operator=(VecExprFunction&&) = default;
+VecExprFunction::~VecExprFunction() = default;
+
+void VecExprFunction::Evaluate(const uint8_t* const* input, size_t num,
+    StaticFieldRef* out, size_t stride) {
+  root_->Evaluate(input, num, out, stride);
+}
+
+void VecExprFunction::EvaluateMask(
+    const uint8_t* const* input, size_t num, uint8_t* mask) {
+  root_->EvaluateMask(input, num, mask);
+}
+
+VecExprFunction::operator bool() const { return bool(root_); }
+
+}  // namespace wing
@@ -0,0 +1,52 @@
+#ifndef SAKURA_VEC_EXPR_H__
+#define SAKURA_VEC_EXPR_H__
+
+#include <memory>
+
+#include "execution/exprdata.hpp"
+
+namespace wing {
+
+namespace __detail {
+class VecExprRoot;
+}
+
+/**
+ * This data structure evaluates an expression with no aggregate functions for
+ * many tuples at a time. It is the columnar counterpart of ExprFunction, and
+ * gives the same results.
+ *
+ * The expression is compiled into a tree of kernels in its constructor. Each
+ * kernel produces a vector of results: a column read from the tuples, or an
+ * operator applied to the vectors of its children. A kernel is a tight loop
+ * without indirect calls, so the loops of INT and FLOAT arithmetic and
+ * comparisons are vectorized by the compiler. Conditions produce vectors of 0
+ * and 1, and AND/OR combine them without branches, so a predicate produces a
+ * selection mask of the tuples.
+ *
+ * Like ExprFunction, it assumes that the input has the same schema as
+ * input_schema. It uses internal buffers, so it is not thread-safe.
+ */
+class VecExprFunction {
+ public:
+  VecExprFunction(const Expr* expr, const OutputSchema& input_schema);
+  VecExprFunction(VecExprFunction&&);
+  VecExprFunction& operator=(VecExprFunction&&);
+  ~VecExprFunction();
+  /* Evaluate the expression for input[0...num - 1]. The result of input[i] is
+   * written to out[i * stride]. */
+  void Evaluate(const uint8_t* const* input, size_t num, StaticFieldRef* out,
+      size_t stride = 1);
+  /* Evaluate the expression as a condition. mask[i] is set to 1 if it holds
+   * for input[i], i.e., ExprFunction::Evaluate(input[i]).ReadInt() != 0, and
+   * 0 otherwise. */
+  void EvaluateMask(const uint8_t* const* input, size_t num, uint8_t* mask);
+  operator bool() const;
+
+ private:
+  std::unique_ptr<__detail::VecExprRoot> root_;
+};
+
+}  // namespace wing
+
+#endif
@@ -23,7 +23,7 @@ namespace wing
 		auto id=dbs.Find(table_name); assert(id.has_value());
 		return dbs[id.value()].GetPrimaryKeySchema().name_;
 	}
-	static std::tuple<std::string_view, bool, bool> convert_bound_from_pair_to_tuple(std::pair<Field,bool> p)
+	static std::tuple<std::string_view, bool, bool> convert_bound_from_pair_to_tuple(const std::pair<Field,bool>& p)
 	{
 		if(p.first.type_==FieldType::EMPTY) return {std::string_view(),true,false};
 		return {p.first.GetView(),false,p.second};
@@ -8,10 +8,13 @@
 #include "common/exception.hpp"
 #include "common/logging.hpp"
 #include "common/stopwatch.hpp"
+#include "common/thread_pool.hpp"
 #include "execution/executor.hpp"
+#include "execution/parallel_executor.hpp"
 #include "jit/jitexecutor.hpp"
 #include "parser/parser.hpp"
 #include "plan/optimizer.hpp"
+#include "plan/plan_cache.hpp"
 #include "transaction/txn.hpp"
 #include "transaction/txn_manager.hpp"
 #include "type/tuple.hpp"
@@ -21,6 +24,45 @@
 
 namespace wing {
 
+/**
+ * The cursor of a streaming query. It pulls a batch of rows from the executor
+ * at a time, so the rows are not materialized. The locks of the query are
+ * held by its transaction, which is committed after the executor is
+ * destroyed, if the cursor owns it.
+ */
+class ExecutorCursor : public ResultSet::Cursor {
+ public:
+  ExecutorCursor(std::unique_ptr<Executor> exe, bool vectorized,
+      TxnManager& txn_manager, Txn* txn)
+    : exe_(std::move(exe)),
+      vectorized_(vectorized),
+      txn_manager_(txn_manager),
+      txn_(txn) {}
+  ~ExecutorCursor() {
+    exe_.reset();
+    if (txn_ != nullptr)
+      txn_manager_.Commit(txn_);
+  }
+  bool Fill(TupleStore& store) override {
+    if (vectorized_) {
+      auto& batch = exe_->NextBatch();
+      for (size_t i = 0; i < batch.Size(); i++)
+        store.Append(batch[i].Data());
+      return batch.Size() > 0;
+    }
+    auto result = exe_->Next();
+    if (result)
+      store.Append(result.Data());
+    return bool(result);
+  }
+
+ private:
+  std::unique_ptr<Executor> exe_;
+  bool vectorized_;
+  TxnManager& txn_manager_;
+  Txn* txn_;
+};
+
 class Instance::Impl {
  public:
   Impl(std::string_view db_file, bool use_jit_flag)
@@ -42,9 +84,7 @@ class Instance::Impl {
       } else if (ret.GetPlan() != nullptr) {
         out << ret.GetAST()->ToString() << std::endl;
         out << "=======================" << std::endl;
-        auto plan = ret.GetPlan()->clone();
-        plan = LogicalOptimizer::Optimize(std::move(plan), db_);
-        plan = CostBasedOptimizer::Optimize(std::move(plan), db_);
+        auto plan = Optimize(ret.GetPlan()->clone());
         out << plan->ToString() << std::endl;
       } else {
         out << ret.GetAST()->ToString() << std::endl;
@@ -173,15 +213,20 @@ class Instance::Impl {
             }
           } else {
             // Query
-            auto [exe, use_jit] = GenerateExecutor(ret.GetPlan()->clone(),
-                txn->txn_id_, ret.GetAST()->type_ == StatementType::SELECT);
+            bool select = ret.GetAST()->type_ == StatementType::SELECT;
+            auto plan = Optimize(ret.GetPlan()->clone());
+            auto [exe, use_jit] =
+                GenerateExecutor(plan.get(), txn->txn_id_, select, select);
             err << fmt::format(
                 "Generate executor in {} seconds.\n", watch.GetTimeInSeconds());
             auto output_schema = ret.GetPlan()->output_schema_;
+            if (!IsParallel(select, use_jit))
+              plan = nullptr;
             // Release unused memory
             ret.Clear();
             watch.Reset();
-            auto result = GetResultFromExecutor(exe, use_jit, output_schema);
+            auto result = GetResultFromExecutor(
+                exe, use_jit, output_schema, std::move(plan), txn->txn_id_);
             err << fmt::format(
                 "Execute in {} seconds.\n", watch.GetTimeInSeconds());
             out << FormatOutputTable(result, output_schema) << std::endl;
@@ -205,31 +250,30 @@ class Instance::Impl {
   }
 
   ResultSet Execute(std::string_view statement, txn_id_t txn_id) {
-    auto ret = parser_.Parse(statement, db_.GetDBSchema());
-    if (!ret.Valid()) {
-      DB_INFO("{}", ret.GetErrorMsg());
-      return ResultSet(ret.GetErrorMsg(), "");
-    } else {
-      try {
-        if (ret.GetPlan() == nullptr) {
-          ExecuteMetadataOperation(ret, txn_id);
-          return ResultSet("", "");
-        } else {
-          // Query
-          auto [exe, use_jit] = GenerateExecutor(ret.GetPlan()->clone(), txn_id,
-              ret.GetAST()->type_ == StatementType::SELECT);
-          auto output_schema = ret.GetPlan()->output_schema_;
-          // Release unused memory
-          ret.Clear();
-          auto result = GetResultFromExecutor(exe, use_jit, output_schema);
-          return ResultSet(std::move(result));
-        }
-      } catch (const DBException& e) {
-        DB_INFO("{}", e.what());
-        return ResultSet(
-            "", fmt::format("DBException occurs. what(): {}\n", e.what()));
-      }
-    }
+    return Execute(statement, CacheKey(statement), {}, txn_id);
+  }
+
+  // If "txn" is not null, it is committed when the rows are exhausted or the
+  // ResultSet is destroyed, or at once if the statement is not a SELECT.
+  ResultSet ExecuteStream(
+      std::string_view statement, txn_id_t txn_id, Txn* txn) {
+    auto ret = Execute(statement, CacheKey(statement), {}, txn_id, true, txn);
+    if (txn != nullptr && !ret.Streaming())
+      GetTxnManager().Commit(txn);
+    return ret;
+  }
+
+  PreparedStatement Prepare(std::string_view statement) {
+    PreparedStatement ret;
+    ret.statement_ = parser_.Normalize(statement, ret.num_params_);
+    return ret;
+  }
+
+  ResultSet ExecuteBound(const PreparedStatement& statement,
+      const std::vector<Field>& params, txn_id_t txn_id) {
+    return Execute(statement.statement_,
+        IsCacheable(statement.statement_) ? statement.statement_ : "", params,
+        txn_id);
   }
 
   std::unique_ptr<PlanNode> GetPlan(std::string_view statement) {
@@ -240,10 +284,7 @@ class Instance::Impl {
     } else {
       if (ret.GetPlan() == nullptr)
         return nullptr;
-      auto plan = ret.GetPlan()->clone();
-      plan = LogicalOptimizer::Optimize(std::move(plan), db_);
-      plan = CostBasedOptimizer::Optimize(std::move(plan), db_);
-      return plan;
+      return Optimize(ret.GetPlan()->clone());
     }
   }
 
@@ -254,7 +295,7 @@ class Instance::Impl {
     auto&tab=db_.GetDBSchema()[index.value()];
     // First use a 'select * from table_name' to read all data
     auto ret=parser_.Parse(fmt::format("select * from {};", table_name),db_.GetDBSchema());
-    auto exe=GenerateExecutor(ret.GetPlan()->clone(), 0, false);
+    auto exe=GenerateExecutor(Optimize(ret.GetPlan()->clone()).get(), txn_id, false);
     exe.first->Init();// You should use something to calculate statistics.
 
     size_t size=0;
@@ -281,6 +322,14 @@ class Instance::Impl {
   }
 
   TxnManager& GetTxnManager() { return db_.GetTxnManager(); }
+  void SetJit(bool use_jit) { use_jit_flag_ = use_jit; }
+  void SetJitAdaptive(bool adaptive) { jit_adaptive_ = adaptive; }
+  void SetVectorized(bool vectorized) { vectorized_ = vectorized; }
+  void SetMemoryBudget(size_t bytes) { exec_options_.memory_budget = bytes; }
+  void SetThreads(size_t threads) {
+    pool_ = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+  }
+  void SetPlanCacheSize(size_t size) { plan_cache_.SetCapacity(size); }
 
  private:
   void CreateTable(const ParserResult& result, txn_id_t txn_id) {
@@ -393,7 +442,8 @@ class Instance::Impl {
               DB::GenRefTableName(stmt->table_name_),
               DB::GenRefColumnName(tab.GetPrimaryKeySchema().name_)),
           db_.GetDBSchema());
-      auto exe = GenerateExecutor(ret.GetPlan()->clone(), txn_id, false);
+      auto plan = Optimize(ret.GetPlan()->clone());
+      auto exe = GenerateExecutor(plan.get(), txn_id, false);
       exe.first->Init();
       if (auto ret = exe.first->Next(); ret) {
         throw DBException("Drop table error: exists reference to {}={}",
@@ -408,7 +458,8 @@ class Instance::Impl {
     if (tab.GetFK().size() > 0) {
       auto ret = parser_.Parse(
           fmt::format("delete from {};", stmt->table_name_), db_.GetDBSchema());
-      auto exe = GenerateExecutor(ret.GetPlan()->clone(), txn_id, false);
+      auto plan = Optimize(ret.GetPlan()->clone());
+      auto exe = GenerateExecutor(plan.get(), txn_id, false);
       GetResultFromExecutor(
           exe.first, exe.second, ret.GetPlan()->output_schema_);
     }
@@ -434,8 +485,12 @@ class Instance::Impl {
 
   // After this function returns, std::unique_ptr<Executor> should be released
   // immediately!! Because TupleStore in JitExecutor has been moved.
+  // "plan" is the optimized plan of a parallel query. If the query exceeds the
+  // memory budget, it is executed again serially, whose hash joins spill to
+  // disk. It only reads, so running it again is safe.
   TupleStore GetResultFromExecutor(std::unique_ptr<Executor>& exe, bool use_jit,
-      const OutputSchema& output_schema) {
+      const OutputSchema& output_schema,
+      std::unique_ptr<PlanNode> plan = nullptr, txn_id_t txn_id = 0) {
     if (use_jit) {
       exe->Init();
       auto result = const_cast<TupleStore*>(
@@ -443,28 +498,150 @@ class Instance::Impl {
       return std::move(*result);
     } else {
       exe->Init();
-      auto result = GetTuplesFromNext(exe, output_schema);
-      return result;
+      try {
+        return GetTuplesFromNext(exe, output_schema);
+      } catch (const MemoryBudgetExceeded& e) {
+        if (plan == nullptr)
+          throw;
+        DB_INFO("{} Execute the query serially.", e.what());
+        exe.reset();
+        exe = GenerateExecutor(plan.get(), txn_id, false).first;
+        exe->Init();
+        return GetTuplesFromNext(exe, output_schema);
+      }
+    }
+  }
+
+  // Execute a statement with "params" bound to its placeholders. If
+  // "normalized" is not empty, it is the normalized text of the statement,
+  // and the plan is cached by it and the types of the parameters.
+  // If "stream", a SELECT returns a ResultSet that pulls its rows from the
+  // executor, which is interpreted serially. See ExecutorCursor.
+  ResultSet Execute(std::string_view statement, const std::string& normalized,
+      const std::vector<Field>& params, txn_id_t txn_id, bool stream = false,
+      Txn* txn = nullptr) {
+    std::string key;
+    if (!normalized.empty()) {
+      key = normalized + '\n';
+      for (auto& a : params)
+        key += a.type_ == FieldType::FLOAT64  ? 'f'
+               : a.type_ == FieldType::INT32 ||
+                       a.type_ == FieldType::INT64
+                   ? 'i'
+               : a.type_ == FieldType::EMPTY ? '_'
+                                             : 's';
+    }
+    // Get the version before parsing, so that the plan is not cached if the
+    // catalog changes meanwhile.
+    auto version = db_.GetCatalogVersion();
+    std::optional<PlanCache::Entry> entry;
+    if (!key.empty())
+      entry = plan_cache_.Get(key, version);
+    try {
+      if (entry) {
+        PlanCache::BindParameters(entry->plan_.get(), params, db_);
+      } else {
+        auto ret = parser_.Parse(statement, db_.GetDBSchema(), params);
+        if (!ret.Valid()) {
+          DB_INFO("{}", ret.GetErrorMsg());
+          return ResultSet(ret.GetErrorMsg(), "");
+        }
+        if (ret.GetPlan() == nullptr) {
+          ExecuteMetadataOperation(ret, txn_id);
+          return ResultSet("", "");
+        }
+        entry = PlanCache::Entry{Optimize(ret.GetPlan()->clone()),
+            ret.GetPlan()->output_schema_,
+            ret.GetAST()->type_ == StatementType::SELECT};
+        if (!key.empty())
+          plan_cache_.Put(key, version, entry->clone());
+        // Release unused memory
+        ret.Clear();
+      }
+      // Query
+      bool select = entry->select_;
+      if (stream && select) {
+        auto exe = GenerateExecutor(entry->plan_.get(), txn_id, false).first;
+        exe->Init();
+        return ResultSet(std::make_unique<ExecutorCursor>(std::move(exe),
+                             vectorized_, GetTxnManager(), txn),
+            entry->output_schema_);
+      }
+      auto [exe, use_jit] =
+          GenerateExecutor(entry->plan_.get(), txn_id, select, select);
+      auto plan =
+          IsParallel(select, use_jit) ? std::move(entry->plan_) : nullptr;
+      auto result = GetResultFromExecutor(
+          exe, use_jit, entry->output_schema_, std::move(plan), txn_id);
+      return ResultSet(std::move(result));
+    } catch (const DBException& e) {
+      DB_INFO("{}", e.what());
+      return ResultSet(
+          "", fmt::format("DBException occurs. what(): {}\n", e.what()));
+    }
+  }
+
+  // The normalized text of "statement" if its plan is cached, otherwise "".
+  std::string CacheKey(std::string_view statement) {
+    if (!IsCacheable(statement) || plan_cache_.Capacity() == 0)
+      return "";
+    size_t num_params;
+    return parser_.Normalize(statement, num_params);
+  }
+
+  // Whether the plan of "statement" is cached, i.e. it is a SELECT, UPDATE or
+  // DELETE. The other statements have no plans, or their plans are cheap.
+  static bool IsCacheable(std::string_view statement) {
+    size_t i = 0;
+    while (i < statement.size() && std::isspace(statement[i]))
+      i++;
+    auto word = statement.substr(i, 6);
+    for (std::string_view keyword : {"select", "update", "delete"}) {
+      if (word.size() == keyword.size() &&
+          std::equal(word.begin(), word.end(), keyword.begin(),
+              [](char a, char b) { return std::tolower(a) == b; }))
+        return true;
     }
+    return false;
+  }
+
+  // Optimize a logical plan.
+  std::unique_ptr<PlanNode> Optimize(std::unique_ptr<PlanNode> plan) {
+    plan = LogicalOptimizer::Optimize(std::move(plan), db_);
+    return CostBasedOptimizer::Optimize(std::move(plan), db_);
   }
 
-  // Generate executor by a logical plan.
-  // This plan is released after executor is generated.
+  // Generate executor by an optimized plan.
+  // The plan can be released after executor is generated.
+  // If "parallel", it may be executed in parallel. See IsParallel().
   std::pair<std::unique_ptr<Executor>, bool> GenerateExecutor(
-      std::unique_ptr<PlanNode> plan, txn_id_t txn_id, bool use_jit) {
+      const PlanNode* plan, txn_id_t txn_id, bool use_jit,
+      bool parallel = false) {
     std::unique_ptr<Executor> exe;
     if (!use_jit_flag_)
       use_jit = false;
-    plan = LogicalOptimizer::Optimize(std::move(plan), db_);
-    plan = CostBasedOptimizer::Optimize(std::move(plan), db_);
     if (use_jit) {
-      exe = JitExecutorGenerator::Generate(plan.get(), db_, txn_id);
-    } else {
-      exe = ExecutorGenerator::Generate(plan.get(), db_, txn_id);
+      exe = JitExecutorGenerator::Generate(
+          plan, db_, txn_id, !jit_adaptive_);
+      // The plans that the JIT cannot compile, or that are being compiled in
+      // the adaptive mode, are interpreted.
+      use_jit = exe != nullptr;
+    }
+    if (!use_jit) {
+      auto options = exec_options_;
+      if (IsParallel(parallel, use_jit))
+        options.pool = pool_.get();
+      exe = ExecutorGenerator::Generate(plan, db_, txn_id, options);
     }
     return {std::move(exe), use_jit};
   }
 
+  // Whether a query is executed in parallel. Only SELECT is, because
+  // executing it again is safe, and the JIT executors are not parallel.
+  bool IsParallel(bool select, bool use_jit) const {
+    return select && !use_jit && pool_ != nullptr;
+  }
+
   /**
    * Collect all the tuples from executor.
    * For jit executor, the result is returned in one call.
@@ -474,6 +651,16 @@ class Instance::Impl {
   TupleStore GetTuplesFromNext(
       std::unique_ptr<Executor>& exe, const OutputSchema& schema) {
     TupleStore ret(schema);
+    if (vectorized_) {
+      for (;;) {
+        auto& batch = exe->NextBatch();
+        if (batch.Size() == 0)
+          break;
+        for (size_t i = 0; i < batch.Size(); i++)
+          ret.Append(batch[i].Data());
+      }
+      return ret;
+    }
     auto result = exe->Next();
     while (result) {
       ret.Append(result.Data());
@@ -558,6 +745,12 @@ class Instance::Impl {
     return ret;
   }
   bool use_jit_flag_{false};
+  bool jit_adaptive_{false};
+  PlanCache plan_cache_{128};
+  bool vectorized_{true};
+  ExecOptions exec_options_;
+  // Used by parallel queries if there are several threads.
+  std::unique_ptr<ThreadPool> pool_;
   DB db_;
   Parser parser_;
 };
@@ -575,6 +768,28 @@ ResultSet Instance::Execute(std::string_view statement) {
 ResultSet Instance::Execute(std::string_view statement, txn_id_t txn_id) {
   return ptr_->Execute(statement, txn_id);
 }
+ResultSet Instance::ExecuteStream(std::string_view statement) {
+  Txn* txn = ptr_->GetTxnManager().Begin();
+  return ptr_->ExecuteStream(statement, txn->txn_id_, txn);
+}
+ResultSet Instance::ExecuteStream(
+    std::string_view statement, txn_id_t txn_id) {
+  return ptr_->ExecuteStream(statement, txn_id, nullptr);
+}
+PreparedStatement Instance::Prepare(std::string_view statement) {
+  return ptr_->Prepare(statement);
+}
+ResultSet Instance::ExecuteBound(
+    const PreparedStatement& statement, const std::vector<Field>& params) {
+  Txn* txn = ptr_->GetTxnManager().Begin();
+  auto res = ptr_->ExecuteBound(statement, params, txn->txn_id_);
+  ptr_->GetTxnManager().Commit(txn);
+  return res;
+}
+ResultSet Instance::ExecuteBound(const PreparedStatement& statement,
+    const std::vector<Field>& params, txn_id_t txn_id) {
+  return ptr_->ExecuteBound(statement, params, txn_id);
+}
 void Instance::ExecuteShell() { ptr_->ExecuteShell(); }
 void Instance::Analyze(std::string_view table_name) {
   Txn* txn = ptr_->GetTxnManager().Begin();
@@ -586,5 +801,13 @@ std::unique_ptr<PlanNode> Instance::GetPlan(std::string_view statement) {
 }
 
 TxnManager& Instance::GetTxnManager() { return ptr_->GetTxnManager(); }
+void Instance::SetJit(bool use_jit) { ptr_->SetJit(use_jit); }
+void Instance::SetJitAdaptive(bool adaptive) { ptr_->SetJitAdaptive(adaptive); }
+void Instance::SetVectorized(bool vectorized) {
+  ptr_->SetVectorized(vectorized);
+}
+void Instance::SetMemoryBudget(size_t bytes) { ptr_->SetMemoryBudget(bytes); }
+void Instance::SetPlanCacheSize(size_t size) { ptr_->SetPlanCacheSize(size); }
+void Instance::SetThreads(size_t threads) { ptr_->SetThreads(threads); }
 
 }  // namespace wing
\ No newline at end of file
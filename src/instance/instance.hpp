@@ -4,6 +4,7 @@
 #include <future>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "instance/resultset.hpp"
 #include "plan/plan.hpp"
@@ -12,15 +13,69 @@
 
 namespace wing {
 
+// A statement whose literals may be placeholders "?". It is executed by
+// Instance::ExecuteBound with the values of the placeholders.
+struct PreparedStatement {
+  // The normalized text of the statement. See Parser::Normalize.
+  std::string statement_;
+  // The number of placeholders.
+  size_t num_params_{0};
+};
+
 class Instance {
  public:
   Instance(std::string_view db_file, bool use_jit_flag);
   ~Instance();
   ResultSet Execute(std::string_view statement);
   ResultSet Execute(std::string_view statement, txn_id_t txn_id);
+  // Execute a statement like Execute(), but a SELECT returns a ResultSet
+  // that pulls its rows from the executor while they are read, instead of
+  // storing all of them. The query holds its transaction, and thus its locks,
+  // until the last row is read or the ResultSet is destroyed, which must be
+  // before the Instance is destroyed. It is not compiled by the JIT or
+  // executed in parallel.
+  ResultSet ExecuteStream(std::string_view statement);
+  // The transaction "txn_id" must not be committed before the rows are read.
+  ResultSet ExecuteStream(std::string_view statement, txn_id_t txn_id);
+  // Prepare a statement with placeholders, e.g.,
+  // "select * from t where id = ?;".
+  PreparedStatement Prepare(std::string_view statement);
+  // Execute a prepared statement with the values of its placeholders, which
+  // are INT32, INT64, FLOAT64, CHAR or VARCHAR fields. The plans of SELECT,
+  // UPDATE and DELETE are cached, so executing them again skips parsing and
+  // optimization.
+  ResultSet ExecuteBound(
+      const PreparedStatement& statement, const std::vector<Field>& params);
+  ResultSet ExecuteBound(const PreparedStatement& statement,
+      const std::vector<Field>& params, txn_id_t txn_id);
   void ExecuteShell();
   void Analyze(std::string_view table_name);
   TxnManager &GetTxnManager();
+  // Whether SELECTs are compiled by the JIT, like "use_jit_flag". It only
+  // works if Wing is built with the JIT. The plans that the JIT cannot
+  // compile are interpreted.
+  void SetJit(bool use_jit);
+  // Whether a query whose code is not compiled yet is interpreted while its
+  // code is compiled in the background, instead of waiting for the
+  // compilation. The later executions of the query use the compiled code.
+  // Disabled by default.
+  void SetJitAdaptive(bool adaptive);
+  // Whether non-JIT queries are executed a batch of tuples at a time with
+  // Executor::NextBatch(). Enabled by default.
+  void SetVectorized(bool vectorized);
+  // The memory in bytes that an executor may use for the data it holds, e.g.,
+  // the build side of a hash join, before spilling it to disk. 0 means
+  // unlimited. The default is 2 GiB.
+  void SetMemoryBudget(size_t bytes);
+  // The number of threads that execute a SELECT. With more than one thread,
+  // its scans, filters, projections and hash joins run in parallel. The
+  // default is 1.
+  void SetThreads(size_t threads);
+  // The number of plans cached by the normalized text of their statements.
+  // The plans are optimized for their first parameters, and are dropped when
+  // a table is created or dropped or the statistics are updated. 0 disables
+  // the cache. The default is 128.
+  void SetPlanCacheSize(size_t size);
 
   // Give a SQL statement, return the optimized plan.
   // Used for testing optimizer.
@@ -4,6 +4,7 @@
 #include <memory>
 #include <string>
 
+#include "common/exception.hpp"
 #include "type/field.hpp"
 #include "type/vector.hpp"
 
@@ -30,17 +31,53 @@ class ResultSet {
    private:
     const uint8_t* data_{nullptr};
   };
+  // The source of the rows of a streaming ResultSet, e.g., the executor of a
+  // query. It holds the resources of the query, such as its transaction and
+  // locks, until it is destroyed.
+  class Cursor {
+   public:
+    virtual ~Cursor() = default;
+    // Append the next rows to "store". Return false if there are no more
+    // rows.
+    virtual bool Fill(TupleStore& store) = 0;
+  };
+
   ResultSet() { parse_error_msg_ = "null resultset"; }
   ResultSet(TupleStore&& store) : tuple_store_(std::move(store)) {}
   ResultSet(std::string_view parser_error, std::string_view execute_error)
     : parse_error_msg_(parser_error), execute_error_msg_(execute_error) {}
+  // A streaming ResultSet. Only a batch of rows is stored at a time, and the
+  // cursor is destroyed after the last row.
+  ResultSet(std::unique_ptr<Cursor> cursor, const OutputSchema& schema)
+    : tuple_store_(schema), cursor_(std::move(cursor)) {}
+  // For a streaming ResultSet, the row is valid until the next call. If the
+  // query fails, it returns nullptr and the ResultSet becomes invalid.
   ResultData Next() {
+    while (offset_ == tuple_store_.GetPointerVec().size() && cursor_) {
+      tuple_store_.Clear();
+      offset_ = 0;
+      try {
+        if (!cursor_->Fill(tuple_store_))
+          cursor_ = nullptr;
+      } catch (const DBException& e) {
+        cursor_ = nullptr;
+        execute_error_msg_ =
+            fmt::format("DBException occurs. what(): {}\n", e.what());
+        return nullptr;
+      } catch (...) {
+        cursor_ = nullptr;
+        throw;
+      }
+    }
     if (offset_ < tuple_store_.GetPointerVec().size()) {
       return tuple_store_.GetPointerVec()[offset_++];
     }
     return nullptr;
   }
 
+  // Whether the rows are still pulled from a cursor.
+  bool Streaming() const { return cursor_ != nullptr; }
+
   bool Valid() const {
     return parse_error_msg_ == "" && execute_error_msg_ == "";
   }
@@ -56,6 +93,7 @@ class ResultSet {
   std::string execute_error_msg_;
   TupleStore tuple_store_;
   size_t offset_{0};
+  std::unique_ptr<Cursor> cursor_;
 };
 
 }  // namespace wing
@@ -0,0 +1,236 @@
+#ifndef SAKURA_JIT_AGGREGATE_H__
+#define SAKURA_JIT_AGGREGATE_H__
+
+#include "execution/exprdata.hpp"
+#include "execution/group_table.hpp"
+#include "jit/jitscan.hpp"
+
+namespace wing {
+
+/**
+ * The groups of an aggregation in the generated code. Like
+ * HashAggregateExecutor, the first row of each group is copied to rows_ to
+ * evaluate the columns that are not aggregated. The generated code updates
+ * the states of the aggregate functions itself. Each aggregate function has
+ * an AggregateIntermediateData, whose size_ is the number of rows aggregated.
+ *
+ * Find() returns the states of the group of some keys. After all rows are
+ * aggregated, Next() returns the states of the groups one by one, and then
+ * nullptr, and Row() returns the row of the current group.
+ */
+class JitAggregate {
+ public:
+  JitAggregate(const OutputSchema& input_schema, std::vector<RetType> key_types,
+      size_t state_size)
+    : rows_(NonRaw(input_schema)), groups_(std::move(key_types), state_size) {}
+
+  uint8_t* Find(const StaticFieldRef* keys, const uint8_t* row) {
+    auto [group, inserted] = groups_.FindOrInsert(keys);
+    if (inserted) {
+      rows_.Append(row);
+      GroupTable::Row(group) = rows_.GetPointerVec().back();
+    }
+    return reinterpret_cast<uint8_t*>(GroupTable::States(group));
+  }
+  uint8_t* Next() {
+    if (next_ == groups_.Size())
+      return nullptr;
+    group_ = groups_.Groups()[next_++];
+    return reinterpret_cast<uint8_t*>(GroupTable::States(group_));
+  }
+  const uint8_t* Row() const { return GroupTable::Row(group_); }
+
+ private:
+  static OutputSchema NonRaw(OutputSchema schema) {
+    schema.SetRaw(false);
+    return schema;
+  }
+
+  TupleStore rows_;
+  GroupTable groups_;
+  size_t next_{0};
+  uint8_t* group_{nullptr};
+};
+
+// Find the aggregate functions in "expr".
+void JitFindAggregates(
+    const Expr* expr, std::vector<const AggregateFunctionExpr*>& result) {
+  if (expr == nullptr)
+    return;
+  if (expr->type_ == ExprType::AGGR) {
+    result.push_back(static_cast<const AggregateFunctionExpr*>(expr));
+    return;
+  }
+  JitFindAggregates(expr->ch0_.get(), result);
+  JitFindAggregates(expr->ch1_.get(), result);
+}
+
+/**
+ * All tuples of "ch" are aggregated before the aggregation outputs any tuple.
+ *
+ *  ch_success -> aggregate_update: update the states of the group -> ch_next
+ *  ch_failure -> aggregate_next: the next group, or aggregate_done if there
+ *                is none. Check the predicate, or go back to aggregate_next.
+ *
+ * Like HashAggregateExecutor, there is no group if there are no tuples.
+ */
+JitData JitGenerateAggregate(llvm::LLVMContext& C, llvm::Function* F,
+    llvm::Value* input, JitMemory& memory, const JitData& ch,
+    const OutputSchema& input_schema,
+    const std::vector<std::unique_ptr<Expr>>& output_exprs,
+    const std::vector<std::unique_ptr<Expr>>& group_by_exprs,
+    const Expr* predicate) {
+  using namespace llvm;
+  std::vector<const AggregateFunctionExpr*> aggregates;
+  for (auto& expr : output_exprs)
+    JitFindAggregates(expr.get(), aggregates);
+  JitFindAggregates(predicate, aggregates);
+  std::vector<RetType> key_types;
+  for (auto& expr : group_by_exprs)
+    key_types.push_back(expr->ret_type_);
+  auto aggregate = memory.AddObject(
+      [input_schema, key_types, size = aggregates.size()](
+          const uint8_t*, DB&, size_t) {
+        return std::make_shared<JitAggregate>(input_schema, key_types, size);
+      });
+  BasicBlock* update = BasicBlock::Create(C, "aggregate_update", F);
+  BasicBlock* next = BasicBlock::Create(C, "aggregate_next", F);
+  BasicBlock* if_not_null = BasicBlock::Create(C, "aggregate_if_not_null", F);
+  BasicBlock* done = BasicBlock::Create(C, "aggregate_done", F);
+  BasicBlock* success = BasicBlock::Create(C, "aggregate_success", F);
+  auto i64 = Type::getInt64Ty(C);
+  auto f64 = Type::getDoubleTy(C);
+  // The address of the data_ or size_ of the i-th state.
+  auto state_ptr = [&](Value* states, size_t i, bool size,
+                       IRBuilder<>& builder) {
+    auto offset = i * sizeof(AggregateIntermediateData) +
+                  (size ? offsetof(AggregateIntermediateData, size_) : 0);
+    return builder.CreateBitCast(
+        builder.CreateGEP(Type::getInt8Ty(C), states,
+            ConstantInt::get(C, APInt(64, offset))),
+        size ? Type::getInt64PtrTy(C) : Type::getDoublePtrTy(C));
+  };
+  std::vector<Value*> values;
+
+  {
+    IRBuilder<> builder(ch.success_);
+    builder.CreateBr(update);
+  }
+  {
+    IRBuilder<> builder(update);
+    std::vector<const Expr*> keys;
+    for (auto& expr : group_by_exprs)
+      keys.push_back(expr.get());
+    std::vector<Value*> key_values;
+    for (auto key : keys)
+      key_values.push_back(JitGenerateExpr(
+          key, input, memory, input_schema, ch.values_, builder));
+    auto key_ptr = JitGeneratePointer(
+        input, memory.Allocate(keys.size() * sizeof(StaticFieldRef)), builder);
+    JitStoreValues(key_ptr, key_values, builder);
+    auto row_ptr = JitGeneratePointer(input,
+        memory.Allocate(input_schema.Size() * sizeof(StaticFieldRef)), builder);
+    JitStoreValues(row_ptr, ch.values_, builder);
+    auto states = JitGenerateCall("_wing_jit_aggregate_find",
+        {JitGenerateObject(input, aggregate, builder), key_ptr, row_ptr},
+        builder);
+    for (size_t i = 0; i < aggregates.size(); i++) {
+      auto expr = aggregates[i];
+      auto size_ptr = state_ptr(states, i, true, builder);
+      auto size = builder.CreateLoad(i64, size_ptr);
+      builder.CreateStore(
+          builder.CreateAdd(size, ConstantInt::get(C, APInt(64, 1))), size_ptr);
+      if (expr->func_name_ == "count")
+        continue;
+      auto value = JitGenerateExpr(expr->ch0_.get(), input, memory,
+          input_schema, ch.values_, builder);
+      bool is_float = expr->ch0_->ret_type_ == RetType::FLOAT;
+      auto data_ptr = state_ptr(states, i, false, builder);
+      if (expr->func_name_ == "avg") {
+        // The sum is always a double.
+        if (!is_float)
+          value = builder.CreateSIToFP(value, f64);
+        builder.CreateStore(
+            builder.CreateFAdd(builder.CreateLoad(f64, data_ptr), value),
+            data_ptr);
+        continue;
+      }
+      if (!is_float)
+        data_ptr = builder.CreateBitCast(data_ptr, Type::getInt64PtrTy(C));
+      auto data = builder.CreateLoad(is_float ? f64 : i64, data_ptr);
+      Value* result;
+      if (expr->func_name_ == "sum") {
+        result = is_float ? builder.CreateFAdd(data, value)
+                          : builder.CreateAdd(data, value);
+      } else {
+        bool min = expr->func_name_ == "min";
+        auto better =
+            is_float ? (min ? builder.CreateFCmpOLT(value, data)
+                            : builder.CreateFCmpOGT(value, data))
+                     : (min ? builder.CreateICmpSLT(value, data)
+                            : builder.CreateICmpSGT(value, data));
+        // The first value is always taken.
+        auto first =
+            builder.CreateICmpEQ(size, ConstantInt::get(C, APInt(64, 0)));
+        result = builder.CreateSelect(
+            builder.CreateOr(first, better), value, data);
+      }
+      builder.CreateStore(result, data_ptr);
+    }
+    builder.CreateBr(ch.next_);
+  }
+  {
+    IRBuilder<> builder(ch.failure_);
+    builder.CreateBr(next);
+  }
+  {
+    IRBuilder<> builder(next);
+    auto aggregate_ptr = JitGenerateObject(input, aggregate, builder);
+    auto states =
+        JitGenerateCall("_wing_jit_aggregate_next", {aggregate_ptr}, builder);
+    builder.CreateCondBr(builder.CreateICmpEQ(states,
+                             ConstantPointerNull::get(Type::getInt8PtrTy(C))),
+        done, if_not_null);
+    builder.SetInsertPoint(if_not_null);
+    auto row =
+        JitGenerateCall("_wing_jit_aggregate_row", {aggregate_ptr}, builder);
+    auto row_values = JitGenerateValuesFromRefs(row, input_schema, builder);
+    JitAggregateValues aggregate_values;
+    for (size_t i = 0; i < aggregates.size(); i++) {
+      auto expr = aggregates[i];
+      Value* size = builder.CreateLoad(i64, state_ptr(states, i, true, builder));
+      auto data_ptr = state_ptr(states, i, false, builder);
+      Value* value;
+      if (expr->func_name_ == "count") {
+        value = size;
+      } else if (expr->func_name_ == "avg") {
+        value = builder.CreateFDiv(
+            builder.CreateLoad(f64, data_ptr), builder.CreateSIToFP(size, f64));
+      } else if (expr->ret_type_ == RetType::FLOAT) {
+        value = builder.CreateLoad(f64, data_ptr);
+      } else {
+        value = builder.CreateLoad(
+            i64, builder.CreateBitCast(data_ptr, Type::getInt64PtrTy(C)));
+      }
+      aggregate_values.emplace_back(expr, value);
+    }
+    if (predicate != nullptr) {
+      BasicBlock* pass = BasicBlock::Create(C, "aggregate_if_pass", F);
+      Value* flag = builder.CreateICmpEQ(
+          JitGenerateExpr(predicate, input, memory, input_schema, row_values,
+              builder, &aggregate_values),
+          ConstantInt::get(C, APInt(64, 0)), "flag");
+      builder.CreateCondBr(flag, next, pass);
+      builder.SetInsertPoint(pass);
+    }
+    for (auto& expr : output_exprs)
+      values.push_back(JitGenerateExpr(expr.get(), input, memory, input_schema,
+          row_values, builder, &aggregate_values));
+    builder.CreateBr(success);
+  }
+  return JitData{values, ch.entry_, next, success, done};
+}
+
+}  // namespace wing
+
+#endif
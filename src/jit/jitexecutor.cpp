@@ -1,6 +1,15 @@
 #include "jit/jitexecutor.hpp"
 
+#include <bit>
+#include <future>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "functions/functions.hpp"
+#include "jit/jitaggregate.hpp"
 #include "jit/jitexpr.hpp"
+#include "jit/jitjoin.hpp"
 #include "jit/jitmemory.hpp"
 #include "jit/jitscan.hpp"
 #include "jit/llvmheaders.hpp"
@@ -8,39 +17,280 @@
 
 namespace wing {
 
+// The compiled code of a plan, which is shared by its executions.
+struct JitCode {
+  using GenerateAllFuncType = uint8_t* (*)(uint8_t* memory);
+  std::unique_ptr<llvm::orc::LLJIT> lljit_;
+  GenerateAllFuncType generate_all_func_;
+  // The memory layout and the objects of an execution.
+  JitMemory memory_;
+};
+
 class JitExecutor : public Executor {
  public:
-  using GenerateAllFuncType = uint8_t* (*)(uint8_t* memory);
-  using InitFuncType = void (*)(uint8_t* memory);
-  JitExecutor(std::unique_ptr<llvm::orc::LLJIT>&& lljit,
-      GenerateAllFuncType generate_all_func,
-      std::unique_ptr<uint8_t[]>&& memory,
-      std::unique_ptr<TupleStore>&& tuple_store,
-      std::vector<std::unique_ptr<Iterator<const uint8_t*>>>&& iters)
-    : lljit_(std::move(lljit)),
-      generate_all_func_(generate_all_func),
-      memory_(std::move(memory)),
-      tuple_store_(std::move(tuple_store)),
-      iters_(std::move(iters)) {}
+  /* "literals" are the values of the literals of the plan. See
+   * JitFingerprint. */
+  JitExecutor(std::shared_ptr<const JitCode> code, std::vector<Field> literals,
+      DB& db, size_t txn_id)
+    : code_(std::move(code)),
+      literals_(std::move(literals)),
+      db_(db),
+      txn_id_(txn_id) {}
   void Init() override {
-    for (auto& a : iters_)
-      a->Init();
+    memory_ = code_->memory_.GetMemory();
+    // The objects may read the literals, e.g., the ranges of the scans.
+    objects_ = code_->memory_.StoreLiterals(memory_.get(), literals_);
+    auto objects = code_->memory_.CreateObjects(memory_.get(), db_, txn_id_);
+    objects_.insert(objects_.end(), objects.begin(), objects.end());
+  }
+  InputTuplePtr Next() override {
+    return code_->generate_all_func_(memory_.get());
   }
-  InputTuplePtr Next() override { return generate_all_func_(memory_.get()); }
 
  private:
-  std::unique_ptr<llvm::orc::LLJIT> lljit_;
-  GenerateAllFuncType generate_all_func_;
+  std::shared_ptr<const JitCode> code_;
+  std::vector<Field> literals_;
+  DB& db_;
+  size_t txn_id_;
   std::unique_ptr<uint8_t[]> memory_;
-  std::unique_ptr<TupleStore> tuple_store_;
-  std::vector<std::unique_ptr<Iterator<const uint8_t*>>> iters_;
+  std::vector<std::shared_ptr<void>> objects_;
+};
+
+// Call "f(expr, aggregate)" on each expression of "plan", but not on those of
+// its children. "aggregate" is whether "expr" may have aggregate functions.
+// Return false if the JIT does not support "plan".
+template <typename F>
+bool JitForEachExpr(const PlanNode* plan, F&& f) {
+  auto each = [&](const std::vector<std::unique_ptr<Expr>>& exprs,
+                  bool aggregate = false) {
+    for (auto& a : exprs)
+      f(a.get(), aggregate);
+  };
+  switch (plan->type_) {
+    case PlanType::Project:
+      each(static_cast<const ProjectPlanNode*>(plan)->output_exprs_);
+      return true;
+    case PlanType::Filter:
+      f(static_cast<const FilterPlanNode*>(plan)->predicate_.GenExpr().get(),
+          false);
+      return true;
+    case PlanType::SeqScan:
+      f(static_cast<const SeqScanPlanNode*>(plan)->predicate_.GenExpr().get(),
+          false);
+      return true;
+    case PlanType::RangeScan:
+      f(static_cast<const RangeScanPlanNode*>(plan)->predicate_.GenExpr().get(),
+          false);
+      return true;
+    case PlanType::Join:
+      f(static_cast<const JoinPlanNode*>(plan)->predicate_.GenExpr().get(),
+          false);
+      return true;
+    case PlanType::HashJoin: {
+      auto t_plan = static_cast<const HashJoinPlanNode*>(plan);
+      each(t_plan->left_hash_exprs_);
+      each(t_plan->right_hash_exprs_);
+      f(t_plan->predicate_.GenExpr().get(), false);
+      return true;
+    }
+    case PlanType::MergeSortJoin: {
+      auto t_plan = static_cast<const MergeSortJoinPlanNode*>(plan);
+      f(t_plan->left_merge_key_.get(), false);
+      f(t_plan->right_merge_key_.get(), false);
+      f(t_plan->predicate_.GenExpr().get(), false);
+      return true;
+    }
+    case PlanType::IndexNestloopJoin: {
+      // The scan is not executed, but its predicate is.
+      auto t_plan = static_cast<const IndexNestloopJoinPlanNode*>(plan);
+      f(t_plan->left_key_.get(), false);
+      f(t_plan->predicate_.GenExpr().get(), false);
+      return true;
+    }
+    case PlanType::Aggregate: {
+      auto t_plan = static_cast<const AggregatePlanNode*>(plan);
+      each(t_plan->output_exprs_, true);
+      each(t_plan->group_by_exprs_);
+      f(t_plan->group_predicate_.GenExpr().get(), true);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+// Whether the plan can be compiled. See JitExprSupported.
+bool JitSupported(const PlanNode* plan) {
+  if (plan == nullptr)
+    return true;
+  bool ret = true;
+  if (!JitForEachExpr(plan, [&](const Expr* expr, bool aggregate) {
+        ret = ret && JitExprSupported(expr, aggregate);
+      }))
+    return false;
+  return ret && JitSupported(plan->ch_.get()) && JitSupported(plan->ch2_.get());
+}
+
+// Append a literal to "literals", and the index of the first literal with the
+// same value to "out". The values are not in the fingerprint, so that the
+// plans which differ only in their literals share the code, which loads the
+// values from JitMemory. But literals with the same value share their memory,
+// so the plans must have the same literals with the same values.
+void JitFingerprintLiteral(
+    Field value, std::string& out, std::vector<Field>& literals) {
+  auto key = JitMemory::LiteralKey(value);
+  size_t index = 0;
+  while (index < literals.size() &&
+         JitMemory::LiteralKey(literals[index]) != key)
+    index += 1;
+  out += fmt::format(" ?{}", index);
+  literals.push_back(std::move(value));
+}
+
+// Append the fingerprint of "expr" to "out", and its literals to "literals".
+// Strings are prefixed with their sizes, so that different expressions have
+// different fingerprints.
+void JitFingerprint(
+    const Expr* expr, std::string& out, std::vector<Field>& literals) {
+  if (expr == nullptr) {
+    out += "_";
+    return;
+  }
+  out += fmt::format(
+      "({} {}", static_cast<int>(expr->type_), static_cast<int>(expr->ret_type_));
+  switch (expr->type_) {
+    case ExprType::LITERAL_STRING:
+    case ExprType::LITERAL_INTEGER:
+    case ExprType::LITERAL_FLOAT:
+      JitFingerprintLiteral(JitLiteralValue(expr), out, literals);
+      break;
+    case ExprType::BINOP:
+      out += fmt::format(
+          " {}", static_cast<int>(static_cast<const BinaryExpr*>(expr)->op_));
+      break;
+    case ExprType::BINCONDOP:
+      out += fmt::format(" {}",
+          static_cast<int>(static_cast<const BinaryConditionExpr*>(expr)->op_));
+      break;
+    case ExprType::UNARYOP:
+      out += fmt::format(
+          " {}", static_cast<int>(static_cast<const UnaryExpr*>(expr)->op_));
+      break;
+    case ExprType::UNARYCONDOP:
+      out += fmt::format(" {}",
+          static_cast<int>(static_cast<const UnaryConditionExpr*>(expr)->op_));
+      break;
+    case ExprType::COLUMN:
+      out += fmt::format(" {}",
+          static_cast<const ColumnExpr*>(expr)->id_in_column_name_table_);
+      break;
+    case ExprType::AGGR:
+      out += " " + static_cast<const AggregateFunctionExpr*>(expr)->func_name_;
+      break;
+    default:
+      break;
+  }
+  JitFingerprint(expr->ch0_.get(), out, literals);
+  JitFingerprint(expr->ch1_.get(), out, literals);
+  out += ")";
+}
+
+void JitFingerprint(const OutputSchema& schema, std::string& out) {
+  out += fmt::format("[{}", schema.IsRaw());
+  for (auto& col : schema.GetCols())
+    out += fmt::format(
+        " {}:{}:{}", col.id_, static_cast<int>(col.type_), col.size_);
+  out += "]";
+}
+
+// The value of a bound of a range is a literal.
+void JitFingerprint(const std::pair<Field, bool>& bound, std::string& out,
+    std::vector<Field>& literals) {
+  auto& field = bound.first;
+  out += fmt::format("<{} {}", bound.second, static_cast<int>(field.type_));
+  // The size and the data of an unbounded range are not initialized.
+  if (field.type_ != FieldType::EMPTY)
+    JitFingerprintLiteral(field, out, literals);
+  out += ">";
+}
+
+// The fingerprint of a plan, which has everything that its code depends on,
+// i.e., the plan nodes, their expressions and schemas, and the tables of the
+// scans. The plans with the same fingerprint share the code, and are executed
+// with the values of their own literals, including the ranges of the scans.
+void JitFingerprint(
+    const PlanNode* plan, std::string& out, std::vector<Field>& literals) {
+  if (plan == nullptr) {
+    out += "_";
+    return;
+  }
+  out += fmt::format("{{{}", static_cast<int>(plan->type_));
+  JitForEachExpr(plan, [&](const Expr* expr, bool) {
+    JitFingerprint(expr, out, literals);
+  });
+  JitFingerprint(plan->output_schema_, out);
+  auto table = [&](const std::string& name, const OutputSchema& schema) {
+    out += fmt::format("{}:{}", name.size(), name);
+    JitFingerprint(schema, out);
+  };
+  if (plan->type_ == PlanType::SeqScan) {
+    auto t_plan = static_cast<const SeqScanPlanNode*>(plan);
+    table(t_plan->table_name_, t_plan->table_schema_);
+  } else if (plan->type_ == PlanType::RangeScan) {
+    auto t_plan = static_cast<const RangeScanPlanNode*>(plan);
+    table(t_plan->table_name_, t_plan->table_schema_);
+    JitFingerprint(t_plan->range_l_, out, literals);
+    JitFingerprint(t_plan->range_r_, out, literals);
+  }
+  JitFingerprint(plan->ch_.get(), out, literals);
+  JitFingerprint(plan->ch2_.get(), out, literals);
+  out += "}";
+}
+
+// A bound of a range scan, whose value is read from the literals of the
+// execution.
+class JitBound {
+ public:
+  JitBound(const std::pair<Field, bool>& bound, const JitMemory& memory)
+    : type_(bound.first.type_),
+      size_(bound.first.size_),
+      inclusive_(bound.second),
+      offset_(type_ == FieldType::EMPTY ? 0
+                                        : memory.LiteralOffset(bound.first)) {}
+
+  std::pair<Field, bool> Read(const uint8_t* memory) const {
+    if (type_ == FieldType::EMPTY)
+      return {Field(), inclusive_};
+    int64_t data;
+    std::memcpy(&data, memory + offset_, sizeof(data));
+    if (type_ == FieldType::CHAR || type_ == FieldType::VARCHAR)
+      return {Field::CreateString(type_,
+                  reinterpret_cast<const StaticStringField*>(data)
+                      ->ReadStringView()),
+          inclusive_};
+    if (type_ == FieldType::FLOAT64)
+      return {Field::CreateFloat(type_, size_, std::bit_cast<double>(data)),
+          inclusive_};
+    return {Field::CreateInt(type_, size_, data), inclusive_};
+  }
+
+ private:
+  FieldType type_;
+  uint32_t size_;
+  bool inclusive_;
+  size_t offset_;
 };
 
+// The raw rows read by a scan, which may output a part of them.
+const OutputSchema& ScanTableSchema(
+    const PlanNode* plan, const OutputSchema& table_schema) {
+  return table_schema.Size() > 0 ? table_schema : plan->output_schema_;
+}
+
 // Generate blocks for each plan node
 // And connect them.
 JitData JitCodeGenerate(llvm::LLVMContext& C, llvm::Function* F,
-    llvm::Value* input, JitMemory& memory, const PlanNode* plan, DB& db,
-    size_t txn_id) {
+    llvm::Value* input, JitMemory& memory, const PlanNode* plan) {
   using namespace llvm;
   if (plan == nullptr) {
     throw DBException("Invalid PlanNode.");
@@ -48,9 +298,8 @@ JitData JitCodeGenerate(llvm::LLVMContext& C, llvm::Function* F,
 
   if (plan->type_ == PlanType::Project) {
     auto project_plan = static_cast<const ProjectPlanNode*>(plan);
-    auto ch = JitCodeGenerate(
-        C, F, input, memory, project_plan->ch_.get(), db, txn_id);
-    auto ret = JitGenerateProject(C, F, ch.values_,
+    auto ch = JitCodeGenerate(C, F, input, memory, project_plan->ch_.get());
+    auto ret = JitGenerateProject(C, F, input, memory, ch.values_,
         project_plan->ch_->output_schema_, project_plan->output_exprs_);
     {
       IRBuilder<> builder(ch.success_);
@@ -61,9 +310,8 @@ JitData JitCodeGenerate(llvm::LLVMContext& C, llvm::Function* F,
 
   else if (plan->type_ == PlanType::Filter) {
     auto filter_plan = static_cast<const FilterPlanNode*>(plan);
-    auto ch = JitCodeGenerate(
-        C, F, input, memory, filter_plan->ch_.get(), db, txn_id);
-    auto filter = JitGenerateFilter(C, F, ch.values_,
+    auto ch = JitCodeGenerate(C, F, input, memory, filter_plan->ch_.get());
+    auto filter = JitGenerateFilter(C, F, input, memory, ch.values_,
         filter_plan->ch_->output_schema_, filter_plan->predicate_.GenExpr());
     {
       IRBuilder<> builder(ch.success_);
@@ -78,21 +326,114 @@ JitData JitCodeGenerate(llvm::LLVMContext& C, llvm::Function* F,
 
   else if (plan->type_ == PlanType::SeqScan) {
     auto seqscan_plan = static_cast<const SeqScanPlanNode*>(plan);
-    auto table_schema_index = db.GetDBSchema().Find(seqscan_plan->table_name_);
-    if (!table_schema_index) {
-      throw DBException("Cannot find table \'{}\'", seqscan_plan->table_name_);
-    }
-    return JitGenerateSeqScan(C, F, input, memory, seqscan_plan->output_schema_,
-        db.GetIterator(txn_id, seqscan_plan->table_name_),
+    return JitGenerateSeqScan(C, F, input, memory,
+        ScanTableSchema(plan, seqscan_plan->table_schema_),
+        seqscan_plan->output_schema_,
+        [table_name = seqscan_plan->table_name_](
+            const uint8_t*, DB& db, size_t txn_id) {
+          if (!db.GetDBSchema().Find(table_name)) {
+            throw DBException("Cannot find table \'{}\'", table_name);
+          }
+          auto iter = db.GetIterator(txn_id, table_name);
+          iter->Init();
+          return std::shared_ptr<void>(std::move(iter));
+        },
         seqscan_plan->predicate_.GenExpr());
   }
 
+  else if (plan->type_ == PlanType::RangeScan) {
+    auto rangescan_plan = static_cast<const RangeScanPlanNode*>(plan);
+    return JitGenerateSeqScan(C, F, input, memory,
+        ScanTableSchema(plan, rangescan_plan->table_schema_),
+        rangescan_plan->output_schema_,
+        [table_name = rangescan_plan->table_name_,
+            range_l = JitBound(rangescan_plan->range_l_, memory),
+            range_r = JitBound(rangescan_plan->range_r_, memory)](
+            const uint8_t* memory, DB& db, size_t txn_id) {
+          auto l = range_l.Read(memory), r = range_r.Read(memory);
+          auto iter = db.GetRangeIterator(txn_id, table_name,
+              convert_bound_from_pair_to_tuple(l),
+              convert_bound_from_pair_to_tuple(r));
+          iter->Init();
+          return std::shared_ptr<void>(std::move(iter));
+        },
+        rangescan_plan->predicate_.GenExpr());
+  }
+
+  // The first child is the build side, like HashJoinExecutor. Nested loop
+  // joins and merge sort joins are compiled as hash joins too: a nested loop
+  // join has no keys, so all build rows are in one bucket, and a merge sort
+  // join is keyed by its merge keys. They output the same rows, but in the
+  // order of the probe side, e.g., a merge sort join no longer outputs the
+  // rows sorted by its keys. No plan compiled by the JIT depends on the order
+  // of its children, because sorts and limits are not supported.
+  else if (plan->type_ == PlanType::Join ||
+           plan->type_ == PlanType::HashJoin ||
+           plan->type_ == PlanType::MergeSortJoin) {
+    std::vector<const Expr*> build_keys, probe_keys;
+    const PredicateVec* predicate;
+    if (plan->type_ == PlanType::Join) {
+      predicate = &static_cast<const JoinPlanNode*>(plan)->predicate_;
+    } else if (plan->type_ == PlanType::HashJoin) {
+      auto join_plan = static_cast<const HashJoinPlanNode*>(plan);
+      for (auto& a : join_plan->left_hash_exprs_)
+        build_keys.push_back(a.get());
+      for (auto& a : join_plan->right_hash_exprs_)
+        probe_keys.push_back(a.get());
+      predicate = &join_plan->predicate_;
+    } else {
+      auto join_plan = static_cast<const MergeSortJoinPlanNode*>(plan);
+      build_keys.push_back(join_plan->left_merge_key_.get());
+      probe_keys.push_back(join_plan->right_merge_key_.get());
+      predicate = &join_plan->predicate_;
+    }
+    auto build = JitCodeGenerate(C, F, input, memory, plan->ch_.get());
+    auto probe =
+        JitCodeGenerate(C, F, input, memory, plan->ch2_.get());
+    return JitGenerateHashJoin(C, F, input, memory, build, probe,
+        plan->ch_->output_schema_, plan->ch2_->output_schema_,
+        plan->output_schema_, build_keys, probe_keys,
+        predicate->GenExpr().get());
+  }
+
+  else if (plan->type_ == PlanType::IndexNestloopJoin) {
+    auto join_plan = static_cast<const IndexNestloopJoinPlanNode*>(plan);
+    auto scan = join_plan->ch2_.get();
+    std::string table_name;
+    std::unique_ptr<Expr> scan_predicate;
+    if (scan->type_ == PlanType::SeqScan) {
+      auto t_scan = static_cast<const SeqScanPlanNode*>(scan);
+      table_name = t_scan->table_name_;
+      scan_predicate = t_scan->predicate_.GenExpr();
+    } else {
+      auto t_scan = static_cast<const RangeScanPlanNode*>(scan);
+      table_name = t_scan->table_name_;
+      scan_predicate = t_scan->predicate_.GenExpr();
+    }
+    auto outer =
+        JitCodeGenerate(C, F, input, memory, join_plan->ch_.get());
+    return JitGenerateIndexJoin(C, F, input, memory, outer,
+        join_plan->ch_->output_schema_, scan->output_schema_,
+        join_plan->output_schema_, table_name,
+        join_plan->left_key_.get(), scan_predicate.get(),
+        join_plan->predicate_.GenExpr().get());
+  }
+
+  else if (plan->type_ == PlanType::Aggregate) {
+    auto aggregate_plan = static_cast<const AggregatePlanNode*>(plan);
+    auto ch = JitCodeGenerate(C, F, input, memory, aggregate_plan->ch_.get());
+    return JitGenerateAggregate(C, F, input, memory, ch,
+        aggregate_plan->ch_->output_schema_, aggregate_plan->output_exprs_,
+        aggregate_plan->group_by_exprs_,
+        aggregate_plan->group_predicate_.GenExpr().get());
+  }
+
   throw DBException("Unsupported plan node.");
 }
 
 // Create a module and output the results.
 llvm::orc::ThreadSafeModule CreateMyModule(
-    JitMemory& memory, const PlanNode* plan, DB& db, size_t txn_id) {
+    JitMemory& memory, const PlanNode* plan) {
   using namespace llvm;
   auto pC = std::make_unique<LLVMContext>();
   auto& C = *pC;
@@ -104,13 +445,17 @@ llvm::orc::ThreadSafeModule CreateMyModule(
   BasicBlock* entry = BasicBlock::Create(C, "entry_block", next_func);
   BasicBlock* ret = BasicBlock::Create(C, "return_block", next_func);
   BasicBlock* print = BasicBlock::Create(C, "print_block", next_func);
-  auto tuple_store = std::make_unique<TupleStore>(plan->output_schema_);
-  auto tuple_store_addr = reinterpret_cast<size_t>(tuple_store.get());
-  memory.AddTupleStore(std::move(tuple_store));
+  // The outputs are arrays of StaticFieldRef, even if the plan outputs raw
+  // rows.
+  auto output_schema = plan->output_schema_;
+  output_schema.SetRaw(false);
+  auto tuple_store_offset =
+      memory.AddObject([output_schema](const uint8_t*, DB&, size_t) {
+        return std::make_shared<TupleStore>(output_schema);
+      });
   Value* tuple_store_ptr;
   Value* input = &*next_func->arg_begin();
-  auto jit_data =
-      JitCodeGenerate(C, next_func, input, memory, plan, db, txn_id);
+  auto jit_data = JitCodeGenerate(C, next_func, input, memory, plan);
 
   // Allocate a temporary memory region for output data.
   // We can also allocate on stack.
@@ -120,9 +465,8 @@ llvm::orc::ThreadSafeModule CreateMyModule(
   {
     IRBuilder<> builder(entry);
     // Get TupleStore pointer.
-    tuple_store_ptr = builder.CreateBitOrPointerCast(
-        ConstantInt::get(C, APInt(64, tuple_store_addr)), Type::getInt8PtrTy(C),
-        "tuple_store");
+    tuple_store_ptr = JitGenerateObject(input, tuple_store_offset, builder);
+    tuple_store_ptr->setName("tuple_store");
     builder.CreateBr(jit_data.entry_);
   }
   {
@@ -140,24 +484,13 @@ llvm::orc::ThreadSafeModule CreateMyModule(
     auto insert_func = M->getOrInsertFunction(
         "_wing_insert_into_tuple_store", insert_func_type);
     // Store the outputs to temporary memory region.
-    for (uint32_t i = 0; auto& v : jit_data.values_) {
-      Value* ptr = builder.CreateGEP(Type::getInt8Ty(C), input,
-          ConstantInt::get(C, APInt(64, result_addr + i * 8)));
-      // Integer values or pointer values are all int64_t.
-      if (plan->output_schema_[i].type_ != FieldType::FLOAT64) {
-        ptr = builder.CreateBitOrPointerCast(ptr, Type::getInt64PtrTy(C));
-        builder.CreateStore(
-            builder.CreateBitOrPointerCast(v, Type::getInt64Ty(C)), ptr);
-      } else {
-        ptr = builder.CreateBitCast(ptr, Type::getDoublePtrTy(C));
-        builder.CreateStore(v, ptr);
-      }
-      i += 1;
-    }
     Value* ptr = builder.CreateGEP(
         Type::getInt8Ty(C), input, ConstantInt::get(C, APInt(64, result_addr)));
+    JitStoreValues(ptr, jit_data.values_, builder);
     builder.CreateCall(insert_func, {tuple_store_ptr, ptr});
-    builder.CreateBr(jit_data.entry_);
+    // Joins and aggregations continue from where they stop, not from the
+    // beginning.
+    builder.CreateBr(jit_data.next_);
   }
   {
     IRBuilder<> builder(ret);
@@ -196,7 +529,6 @@ llvm::orc::ThreadSafeModule CreateMyModule(
 // Functions used by LLVM
 // Since C++ function names are compiler specified, we use C function names.
 // In LLVM there's no void* type, so we all use uint8_t*(i.e. i8*).
-// TODO: add hash table functions.
 extern "C" {
 static void _wing_insert_into_tuple_store(uint8_t* a, uint8_t* data) {
   reinterpret_cast<TupleStore*>(a)->Append(data);
@@ -205,23 +537,65 @@ static uint8_t* _wing_iter_next(uint8_t* iter) {
   return const_cast<uint8_t*>(
       reinterpret_cast<Iterator<const uint8_t*>*>(iter)->Next());
 }
+static uint8_t* _wing_jit_hash_join_append(uint8_t* join, uint8_t* row) {
+  return const_cast<uint8_t*>(
+      reinterpret_cast<JitHashJoin*>(join)->Append(row));
+}
+static void _wing_jit_hash_join_insert(
+    uint8_t* join, uint8_t* keys, uint8_t* row) {
+  reinterpret_cast<JitHashJoin*>(join)->Insert(
+      reinterpret_cast<const StaticFieldRef*>(keys), row);
+}
+static void _wing_jit_hash_join_build(uint8_t* join) {
+  reinterpret_cast<JitHashJoin*>(join)->Build();
+}
+static void _wing_jit_hash_join_probe(uint8_t* join, uint8_t* keys) {
+  reinterpret_cast<JitHashJoin*>(join)->Probe(
+      reinterpret_cast<const StaticFieldRef*>(keys));
+}
+static uint8_t* _wing_jit_hash_join_next(uint8_t* join) {
+  return const_cast<uint8_t*>(reinterpret_cast<JitHashJoin*>(join)->Next());
+}
+static uint8_t* _wing_jit_index_join_search(uint8_t* join, uint8_t* key) {
+  return const_cast<uint8_t*>(reinterpret_cast<JitIndexJoin*>(join)->Search(
+      reinterpret_cast<const StaticFieldRef*>(key)));
+}
+static uint8_t* _wing_jit_aggregate_find(
+    uint8_t* aggregate, uint8_t* keys, uint8_t* row) {
+  return reinterpret_cast<JitAggregate*>(aggregate)->Find(
+      reinterpret_cast<const StaticFieldRef*>(keys), row);
+}
+static uint8_t* _wing_jit_aggregate_next(uint8_t* aggregate) {
+  return reinterpret_cast<JitAggregate*>(aggregate)->Next();
+}
+static uint8_t* _wing_jit_aggregate_row(uint8_t* aggregate) {
+  return const_cast<uint8_t*>(
+      reinterpret_cast<JitAggregate*>(aggregate)->Row());
+}
 }
 
-std::unique_ptr<Executor> JitExecutorGenerator::Generate(
-    const PlanNode* plan, DB& db, size_t txn_id) {
+// Compile a plan, whose literals are "literals". It does not depend on the
+// database, so it can be compiled in any thread.
+std::shared_ptr<const JitCode> JitCompile(
+    const PlanNode* plan, const std::vector<Field>& literals) {
   using namespace llvm;
   using namespace llvm::orc;
   // Initialize
-  InitializeNativeTarget();
-  InitializeNativeTargetAsmPrinter();
+  static std::once_flag initialized;
+  std::call_once(initialized, [] {
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+  });
   auto J = LLJITBuilder().create();
   if (!J)
     throw DBException("LLJit create failed.");
   auto lljit = std::move(J.get());
   // Store global variables in memory.
   JitMemory memory;
+  for (auto& value : literals)
+    memory.AddLiteral(value);
   // Create module
-  auto M = CreateMyModule(memory, plan, db, txn_id);
+  auto M = CreateMyModule(memory, plan);
   auto err = lljit->addIRModule(std::move(M));
   if (err) {
     llvm::errs() << err;
@@ -245,17 +619,132 @@ std::unique_ptr<Executor> JitExecutorGenerator::Generate(
     // You can add your functions here
     def_func("_wing_insert_into_tuple_store", &_wing_insert_into_tuple_store);
     def_func("_wing_iter_next", &_wing_iter_next);
+    def_func("_wing_jit_hash_join_append", &_wing_jit_hash_join_append);
+    def_func("_wing_jit_hash_join_insert", &_wing_jit_hash_join_insert);
+    def_func("_wing_jit_hash_join_build", &_wing_jit_hash_join_build);
+    def_func("_wing_jit_hash_join_probe", &_wing_jit_hash_join_probe);
+    def_func("_wing_jit_hash_join_next", &_wing_jit_hash_join_next);
+    def_func("_wing_jit_index_join_search", &_wing_jit_index_join_search);
+    def_func("_wing_jit_aggregate_find", &_wing_jit_aggregate_find);
+    def_func("_wing_jit_aggregate_next", &_wing_jit_aggregate_next);
+    def_func("_wing_jit_aggregate_row", &_wing_jit_aggregate_row);
     def_func("memcmp", &memcmp);
   }
   // Find JIT function "next" for JitExecutor::Next.
   auto handle = lljit->lookup("next");
   if (!handle)
     throw DBException("Cannot find JIT function.");
-  auto next_func = reinterpret_cast<JitExecutor::GenerateAllFuncType>(
+  auto next_func = reinterpret_cast<JitCode::GenerateAllFuncType>(
       handle.get().getAddress());
 
-  return std::make_unique<JitExecutor>(std::move(lljit), next_func,
-      memory.GetMemory(), std::move(memory.GetTupleStore()),
-      std::move(memory.GetIterators()));
+  return std::make_shared<const JitCode>(
+      JitCode{std::move(lljit), next_func, std::move(memory)});
+}
+
+/**
+ * The compiled code of recently executed plans, keyed by JitFingerprint. A
+ * plan is compiled once, and its executions share the code. Compiling takes
+ * tens of milliseconds, which is longer than executing a small query.
+ *
+ * A plan is compiled by the thread that needs it, or in the background. When
+ * the cache is full, the least recently used code is dropped. The executors
+ * hold shared_ptrs to the code they run, so the code stays alive until they
+ * finish.
+ */
+class JitCodeCache {
+ public:
+  using CodeFuture = std::shared_future<std::shared_ptr<const JitCode>>;
+
+  /* Return the code of "plan", whose fingerprint is "key". If it is not
+   * compiled yet and "wait" is false, compile it in the background and return
+   * nullptr. */
+  std::shared_ptr<const JitCode> Get(const PlanNode* plan, std::string key,
+      const std::vector<Field>& literals, bool wait) {
+    std::promise<std::shared_ptr<const JitCode>> promise;
+    CodeFuture future;
+    bool compile = false;
+    std::vector<Entry> evicted;
+    {
+      std::unique_lock lck(mu_);
+      auto it = index_.find(key);
+      if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        future = it->second->second;
+      } else {
+        if (wait) {
+          future = promise.get_future().share();
+          compile = true;
+        } else {
+          // The future of std::async waits for the compilation when it is
+          // destroyed.
+          future = std::async(std::launch::async,
+              [plan = plan->clone(), literals] {
+                return JitCompile(plan.get(), literals);
+              }).share();
+        }
+        lru_.emplace_front(key, future);
+        index_.emplace(std::move(key), lru_.begin());
+        while (lru_.size() > CAPACITY) {
+          index_.erase(lru_.back().first);
+          evicted.push_back(std::move(lru_.back()));
+          lru_.pop_back();
+        }
+      }
+    }
+    if (compile) {
+      try {
+        promise.set_value(JitCompile(plan, literals));
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+      }
+    }
+    if (!wait && future.wait_for(std::chrono::seconds(0)) !=
+                     std::future_status::ready)
+      return nullptr;
+    return future.get();
+  }
+
+  size_t Size() {
+    std::unique_lock lck(mu_);
+    return lru_.size();
+  }
+
+  void Clear() {
+    std::list<Entry> lru;
+    {
+      std::unique_lock lck(mu_);
+      index_.clear();
+      lru.swap(lru_);
+    }
+  }
+
+ private:
+  static constexpr size_t CAPACITY = 256;
+  using Entry = std::pair<std::string, CodeFuture>;
+
+  std::mutex mu_;
+  /* The most recently used code is at the front. */
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+static JitCodeCache jit_code_cache;
+
+std::unique_ptr<Executor> JitExecutorGenerator::Generate(
+    const PlanNode* plan, DB& db, size_t txn_id, bool wait) {
+  if (!JitSupported(plan))
+    return nullptr;
+  std::string key;
+  std::vector<Field> literals;
+  JitFingerprint(plan, key, literals);
+  auto code = jit_code_cache.Get(plan, std::move(key), literals, wait);
+  if (code == nullptr)
+    return nullptr;
+  return std::make_unique<JitExecutor>(
+      std::move(code), std::move(literals), db, txn_id);
 }
+
+size_t JitExecutorGenerator::CacheSize() { return jit_code_cache.Size(); }
+
+void JitExecutorGenerator::ClearCache() { jit_code_cache.Clear(); }
 }  // namespace wing
\ No newline at end of file
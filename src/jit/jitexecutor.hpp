@@ -12,17 +12,27 @@ namespace wing {
 #ifdef BUILD_JIT
 class JitExecutorGenerator {
  public:
+  /* Return nullptr if "plan" is not supported. The compiled code is cached,
+   * and shared by the plans of the same fingerprint. If the code is not
+   * compiled yet and "wait" is false, it is compiled in the background, and
+   * nullptr is returned. */
   static std::unique_ptr<Executor> Generate(
-      const PlanNode* plan, DB& db, size_t txn_id);
+      const PlanNode* plan, DB& db, size_t txn_id, bool wait = true);
+  /* The number of plans in the code cache. */
+  static size_t CacheSize();
+  static void ClearCache();
 
  private:
 };
 #else
 class JitExecutorGenerator {
  public:
-  static std::unique_ptr<Executor> Generate(const PlanNode*, DB&, size_t) {
+  static std::unique_ptr<Executor> Generate(
+      const PlanNode*, DB&, size_t, bool = true) {
     return nullptr;
   }
+  static size_t CacheSize() { return 0; }
+  static void ClearCache() {}
 
  private:
 };
@@ -1,6 +1,7 @@
 #ifndef SAKURA_JITEXPR_H__
 #define SAKURA_JITEXPR_H__
 
+#include "jit/jitmemory.hpp"
 #include "jit/llvmheaders.hpp"
 #include "parser/expr.hpp"
 
@@ -57,31 +58,61 @@ llvm::Value* JitGetStringCompareResult(
       c0, builder.CreateSelect(lt, n1, builder.CreateSelect(gt, p1, zero)), c);
 }
 
+// The address of a region allocated in JitMemory, where "input" is the
+// memory of the executor.
+llvm::Value* JitGeneratePointer(
+    llvm::Value* input, size_t offset, llvm::IRBuilder<>& builder) {
+  using namespace llvm;
+  auto& C = builder.getContext();
+  return builder.CreateGEP(
+      Type::getInt8Ty(C), input, ConstantInt::get(C, APInt(64, offset)));
+}
+
+// The value of a literal expression.
+Field JitLiteralValue(const Expr* expr) {
+  if (expr->type_ == ExprType::LITERAL_INTEGER)
+    return Field::CreateInt(FieldType::INT64, 8,
+        static_cast<const LiteralIntegerExpr*>(expr)->literal_value_);
+  if (expr->type_ == ExprType::LITERAL_FLOAT)
+    return Field::CreateFloat(FieldType::FLOAT64, 8,
+        static_cast<const LiteralFloatExpr*>(expr)->literal_value_);
+  return Field::CreateString(FieldType::VARCHAR,
+      static_cast<const LiteralStringExpr*>(expr)->literal_value_);
+}
+
+// The values of the aggregate functions in an expression.
+using JitAggregateValues = std::vector<std::pair<const Expr*, llvm::Value*>>;
+
 // Generate output llvm::Value from input llvm::Value.
-// We don't support aggregate functions now.
-llvm::Value* JitGenerateExpr(const Expr* expr, const OutputSchema& input_schema,
-    const std::vector<llvm::Value*> input_value, llvm::IRBuilder<>& builder) {
+// Aggregate functions are replaced by their values in "aggregates". The
+// literals are loaded from "memory", where they must have been added, and
+// "input" is the memory of the executor.
+llvm::Value* JitGenerateExpr(const Expr* expr, llvm::Value* input,
+    const JitMemory& memory, const OutputSchema& input_schema,
+    const std::vector<llvm::Value*>& input_value, llvm::IRBuilder<>& builder,
+    const JitAggregateValues* aggregates = nullptr) {
   using namespace llvm;
   auto& C = builder.getContext();
-  if (expr->type_ == ExprType::LITERAL_INTEGER) {
-    auto this_expr = static_cast<const LiteralIntegerExpr*>(expr);
-    return ConstantInt::get(C, APInt(64, this_expr->literal_value_));
-  } else if (expr->type_ == ExprType::LITERAL_FLOAT) {
-    auto this_expr = static_cast<const LiteralFloatExpr*>(expr);
-    return ConstantFP::get(C, APFloat(this_expr->literal_value_));
-  } else if (expr->type_ == ExprType::LITERAL_STRING) {
-    auto this_expr = static_cast<const LiteralStringExpr*>(expr);
-    auto x = std::unique_ptr<StaticStringField, void (*)(StaticStringField*)>(
-        StaticStringField::Generate(this_expr->literal_value_),
-        StaticStringField::FreeFromGenerate);
-    return builder.CreateGlobalStringPtr(
-        std::string_view(reinterpret_cast<const char*>(x.get()), x->size_));
+  auto generate = [&](const Expr* ch) {
+    return JitGenerateExpr(
+        ch, input, memory, input_schema, input_value, builder, aggregates);
+  };
+  if (expr->type_ == ExprType::LITERAL_INTEGER ||
+      expr->type_ == ExprType::LITERAL_FLOAT ||
+      expr->type_ == ExprType::LITERAL_STRING) {
+    // Strings are loaded as the addresses of StaticStringFields.
+    Type* type = expr->type_ == ExprType::LITERAL_INTEGER ? Type::getInt64Ty(C)
+                 : expr->type_ == ExprType::LITERAL_FLOAT
+                     ? Type::getDoubleTy(C)
+                     : Type::getInt8PtrTy(C);
+    auto ptr = JitGeneratePointer(
+        input, memory.LiteralOffset(JitLiteralValue(expr)), builder);
+    return builder.CreateLoad(
+        type, builder.CreateBitCast(ptr, type->getPointerTo()));
   } else if (expr->type_ == ExprType::BINOP) {
     auto this_expr = static_cast<const BinaryExpr*>(expr);
-    auto lhs = JitGenerateExpr(
-        this_expr->ch0_.get(), input_schema, input_value, builder);
-    auto rhs = JitGenerateExpr(
-        this_expr->ch1_.get(), input_schema, input_value, builder);
+    auto lhs = generate(this_expr->ch0_.get());
+    auto rhs = generate(this_expr->ch1_.get());
 #define GEN_FUNC(optype, builder_func)           \
   if (this_expr->op_ == OpType::optype) {        \
     Value* ret = builder.builder_func(lhs, rhs); \
@@ -109,10 +140,8 @@ llvm::Value* JitGenerateExpr(const Expr* expr, const OutputSchema& input_schema,
 #undef GEN_FUNC
   } else if (expr->type_ == ExprType::BINCONDOP) {
     auto this_expr = static_cast<const BinaryExpr*>(expr);
-    auto lhs = JitGenerateExpr(
-        this_expr->ch0_.get(), input_schema, input_value, builder);
-    auto rhs = JitGenerateExpr(
-        this_expr->ch1_.get(), input_schema, input_value, builder);
+    auto lhs = generate(this_expr->ch0_.get());
+    auto rhs = generate(this_expr->ch1_.get());
 #define GEN_FUNC2(optype, builder_func)                        \
   if (this_expr->op_ == OpType::optype) {                      \
     Value* ret = builder.builder_func(lhs, rhs);               \
@@ -168,14 +197,12 @@ llvm::Value* JitGenerateExpr(const Expr* expr, const OutputSchema& input_schema,
     auto this_expr = static_cast<const CastExpr*>(expr);
     if (expr->ret_type_ == RetType::FLOAT &&
         this_expr->ch0_->ret_type_ == RetType::INT) {
-      auto lhs = JitGenerateExpr(
-          this_expr->ch0_.get(), input_schema, input_value, builder);
+      auto lhs = generate(this_expr->ch0_.get());
       Value* ret = builder.CreateSIToFP(lhs, Type::getDoubleTy(C));
       return ret;
     } else if (expr->ret_type_ == RetType::INT &&
                this_expr->ch0_->ret_type_ == RetType::FLOAT) {
-      auto lhs = JitGenerateExpr(
-          this_expr->ch0_.get(), input_schema, input_value, builder);
+      auto lhs = generate(this_expr->ch0_.get());
       // Integer is always signed.
       Value* ret = builder.CreateFPToSI(lhs, Type::getInt64Ty(C));
       return ret;
@@ -184,8 +211,7 @@ llvm::Value* JitGenerateExpr(const Expr* expr, const OutputSchema& input_schema,
     }
   } else if (expr->type_ == ExprType::UNARYOP) {
     auto this_expr = static_cast<const UnaryExpr*>(expr);
-    auto lhs = JitGenerateExpr(
-        this_expr->ch0_.get(), input_schema, input_value, builder);
+    auto lhs = generate(this_expr->ch0_.get());
     if (expr->ret_type_ == RetType::FLOAT) {
       Value* ret = builder.CreateFNeg(lhs);
       return ret;
@@ -195,10 +221,10 @@ llvm::Value* JitGenerateExpr(const Expr* expr, const OutputSchema& input_schema,
     }
   } else if (expr->type_ == ExprType::UNARYCONDOP) {
     auto this_expr = static_cast<const UnaryConditionExpr*>(expr);
-    auto lhs = JitGenerateExpr(
-        this_expr->ch0_.get(), input_schema, input_value, builder);
-    Value* ret = builder.CreateNot(lhs);
-    return ret;
+    auto lhs = generate(this_expr->ch0_.get());
+    // NOT is logical, e.g. NOT 2 is 0.
+    Value* ret = builder.CreateICmpEQ(lhs, ConstantInt::get(C, APInt(64, 0)));
+    return builder.CreateZExtOrTrunc(ret, Type::getInt64Ty(C));
   } else if (expr->type_ == ExprType::COLUMN) {
     auto this_expr = static_cast<const ColumnExpr*>(expr);
     uint32_t id = ~0u;
@@ -213,11 +239,52 @@ llvm::Value* JitGenerateExpr(const Expr* expr, const OutputSchema& input_schema,
       DB_ERR("Internal Error: Expression contains invalid parameters.");
     }
     return input_value[id];
+  } else if (expr->type_ == ExprType::AGGR && aggregates != nullptr) {
+    for (auto& [aggregate, value] : *aggregates) {
+      if (aggregate == expr)
+        return value;
+    }
   }
 
   DB_ERR("Internal Error: Invalid Expr.");
 }  // namespace wing
 
+/* Whether JitGenerateExpr can generate "expr". Aggregate functions are allowed
+ * if "aggregate", but not nested. The aggregate functions of strings are not
+ * supported. */
+bool JitExprSupported(const Expr* expr, bool aggregate = false) {
+  if (expr == nullptr)
+    return true;
+  if (expr->type_ == ExprType::AGGR) {
+    auto this_expr = static_cast<const AggregateFunctionExpr*>(expr);
+    if (!aggregate || (this_expr->func_name_ != "count" &&
+                          this_expr->ch0_->ret_type_ == RetType::STRING))
+      return false;
+    return JitExprSupported(expr->ch0_.get());
+  }
+  if (expr->type_ == ExprType::BINOP) {
+    auto this_expr = static_cast<const BinaryExpr*>(expr);
+    auto type = this_expr->ch0_->ret_type_;
+    // Operands of different types must be cast first.
+    if (type != this_expr->ch1_->ret_type_ ||
+        (type != RetType::INT &&
+            (type != RetType::FLOAT || this_expr->op_ > OpType::DIV)))
+      return false;
+  } else if (expr->type_ == ExprType::BINCONDOP) {
+    auto this_expr = static_cast<const BinaryConditionExpr*>(expr);
+    auto type = this_expr->ch0_->ret_type_;
+    bool logical =
+        this_expr->op_ == OpType::AND || this_expr->op_ == OpType::OR;
+    if (type != this_expr->ch1_->ret_type_ ||
+        (logical && type != RetType::INT) ||
+        (!logical &&
+            (this_expr->op_ < OpType::LT || this_expr->op_ > OpType::NEQ)))
+      return false;
+  }
+  return JitExprSupported(expr->ch0_.get(), aggregate) &&
+         JitExprSupported(expr->ch1_.get(), aggregate);
+}
+
 }  // namespace wing
 
 #endif
\ No newline at end of file
@@ -0,0 +1,269 @@
+#ifndef SAKURA_JIT_JOIN_H__
+#define SAKURA_JIT_JOIN_H__
+
+#include "catalog/db.hpp"
+#include "execution/join_hash_table.hpp"
+#include "jit/jitscan.hpp"
+
+namespace wing {
+
+/**
+ * The hash table of a join in the generated code. The build rows are copied
+ * to rows_, and their keys are evaluated on the copies, so that the string
+ * keys in table_ stay valid. A nested loop join is a hash join without keys,
+ * whose rows are all in one bucket.
+ *
+ * Rows are appended with Append() and Insert(), and then Build() builds the
+ * table. Probe() starts to find the rows of some keys, and Next() returns them
+ * one by one, and then nullptr.
+ */
+class JitHashJoin {
+ public:
+  JitHashJoin(const OutputSchema& build_schema, std::vector<RetType> key_types)
+    : rows_(NonRaw(build_schema)), table_(std::move(key_types)) {}
+
+  /* Copy the row, which is an array of StaticFieldRef. Return the copy. */
+  const uint8_t* Append(const uint8_t* row) {
+    rows_.Append(row);
+    return rows_.GetPointerVec().back();
+  }
+  void Insert(const StaticFieldRef* keys, const uint8_t* row) {
+    table_.Append(keys, row);
+  }
+  void Build() { table_.Build(); }
+  /* "keys" must be valid until the last Next(). */
+  void Probe(const StaticFieldRef* keys) {
+    keys_ = keys;
+    hash_ = table_.Hash(keys);
+    auto bucket = table_.Bucket(hash_);
+    entry_ = table_.Begin(bucket);
+    end_ = table_.End(bucket);
+  }
+  const uint8_t* Next() {
+    while (entry_ < end_) {
+      auto entry = entry_++;
+      if (table_.Match(entry, hash_, keys_))
+        return table_.Row(entry);
+    }
+    return nullptr;
+  }
+
+ private:
+  static OutputSchema NonRaw(OutputSchema schema) {
+    schema.SetRaw(false);
+    return schema;
+  }
+
+  TupleStore rows_;
+  JoinHashTable table_;
+  const StaticFieldRef* keys_{nullptr};
+  uint64_t hash_{0};
+  size_t entry_{0}, end_{0};
+};
+
+/**
+ * An index nested-loop join in the generated code. Like
+ * IndexNestloopJoinExecutor, the row of the key is found in the B+tree of the
+ * primary key instead of executing the scan.
+ */
+class JitIndexJoin {
+ public:
+  JitIndexJoin(std::unique_ptr<SearchHandle> handle, RetType type)
+    : handle_(std::move(handle)), type_(type) {}
+
+  /* The row is valid until the next search. */
+  const uint8_t* Search(const StaticFieldRef* key) {
+    auto view = type_ == RetType::STRING
+                    ? key->ReadStringView()
+                    : std::string_view(reinterpret_cast<const char*>(key),
+                          sizeof(StaticFieldRef));
+    const uint8_t* ret;
+    // SearchSorted does not lock the row, because the table is locked.
+    handle_->SearchSorted(&view, 1, &ret);
+    return ret;
+  }
+
+ private:
+  std::unique_ptr<SearchHandle> handle_;
+  RetType type_;
+};
+
+// Evaluate "keys" and store them to a region of "size" StaticFieldRef
+// allocated in "memory". Return the address of the region.
+llvm::Value* JitGenerateKeys(llvm::Value* input, JitMemory& memory,
+    const std::vector<const Expr*>& keys, const OutputSchema& input_schema,
+    const std::vector<llvm::Value*>& values, llvm::IRBuilder<>& builder) {
+  std::vector<llvm::Value*> key_values;
+  for (auto key : keys)
+    key_values.push_back(
+        JitGenerateExpr(key, input, memory, input_schema, values, builder));
+  auto ret = JitGeneratePointer(
+      input, memory.Allocate(keys.size() * sizeof(StaticFieldRef)), builder);
+  JitStoreValues(ret, key_values, builder);
+  return ret;
+}
+
+// Branch to "failure" if the predicate is false. Otherwise continue in a new
+// block.
+void JitGenerateCheck(llvm::Function* F, llvm::Value* input,
+    const JitMemory& memory, const Expr* predicate,
+    const OutputSchema& input_schema, const std::vector<llvm::Value*>& values,
+    llvm::BasicBlock* failure, llvm::IRBuilder<>& builder) {
+  using namespace llvm;
+  if (predicate == nullptr)
+    return;
+  auto& C = builder.getContext();
+  BasicBlock* success = BasicBlock::Create(C, "check_success", F);
+  Value* flag = builder.CreateICmpEQ(
+      JitGenerateExpr(predicate, input, memory, input_schema, values, builder),
+      ConstantInt::get(C, APInt(64, 0)), "flag");
+  builder.CreateCondBr(flag, failure, success);
+  builder.SetInsertPoint(success);
+}
+
+/**
+ * The build side "build" is read into the hash table before the probe side
+ * "probe" is read. Then each probe tuple loops over the build rows of the same
+ * keys, and the loop continues when the tuple above needs the next tuple. So
+ * the probe side is a pipeline with the operators above the join.
+ *
+ *  build_entry ... build_success -> join_build -> build_next
+ *  build_failure -> join_build_done -> probe_entry ...
+ *  probe_success -> join_probe -> join_next
+ *  join_next: the next build row of the keys, or probe_next if there is none.
+ *             Check the predicate, or go back to join_next.
+ */
+JitData JitGenerateHashJoin(llvm::LLVMContext& C, llvm::Function* F,
+    llvm::Value* input, JitMemory& memory, const JitData& build,
+    const JitData& probe, const OutputSchema& build_schema,
+    const OutputSchema& probe_schema, const OutputSchema& output_schema,
+    const std::vector<const Expr*>& build_keys,
+    const std::vector<const Expr*>& probe_keys, const Expr* predicate) {
+  using namespace llvm;
+  std::vector<RetType> key_types;
+  for (auto key : build_keys)
+    key_types.push_back(key->ret_type_);
+  auto join = memory.AddObject(
+      [build_schema, key_types](const uint8_t*, DB&, size_t) {
+        return std::make_shared<JitHashJoin>(build_schema, key_types);
+      });
+  BasicBlock* insert = BasicBlock::Create(C, "join_build", F);
+  BasicBlock* build_done = BasicBlock::Create(C, "join_build_done", F);
+  BasicBlock* probe_entry = BasicBlock::Create(C, "join_probe", F);
+  BasicBlock* next = BasicBlock::Create(C, "join_next", F);
+  BasicBlock* if_not_null = BasicBlock::Create(C, "join_if_not_null", F);
+  std::vector<Value*> values;
+  BasicBlock* success;
+
+  {
+    IRBuilder<> builder(build.success_);
+    builder.CreateBr(insert);
+  }
+  {
+    IRBuilder<> builder(insert);
+    auto join_ptr = JitGenerateObject(input, join, builder);
+    auto row_ptr = JitGeneratePointer(input,
+        memory.Allocate(build_schema.Size() * sizeof(StaticFieldRef)), builder);
+    JitStoreValues(row_ptr, build.values_, builder);
+    auto row = JitGenerateCall(
+        "_wing_jit_hash_join_append", {join_ptr, row_ptr}, builder);
+    auto keys = JitGenerateKeys(input, memory, build_keys, build_schema,
+        JitGenerateValuesFromRefs(row, build_schema, builder), builder);
+    JitGenerateCall(
+        "_wing_jit_hash_join_insert", {join_ptr, keys, row}, builder, true);
+    builder.CreateBr(build.next_);
+  }
+  {
+    IRBuilder<> builder(build.failure_);
+    builder.CreateBr(build_done);
+  }
+  {
+    IRBuilder<> builder(build_done);
+    JitGenerateCall("_wing_jit_hash_join_build",
+        {JitGenerateObject(input, join, builder)}, builder, true);
+    builder.CreateBr(probe.entry_);
+  }
+  {
+    IRBuilder<> builder(probe.success_);
+    builder.CreateBr(probe_entry);
+  }
+  {
+    IRBuilder<> builder(probe_entry);
+    auto keys = JitGenerateKeys(
+        input, memory, probe_keys, probe_schema, probe.values_, builder);
+    JitGenerateCall("_wing_jit_hash_join_probe",
+        {JitGenerateObject(input, join, builder), keys}, builder, true);
+    builder.CreateBr(next);
+  }
+  {
+    IRBuilder<> builder(next);
+    auto row = JitGenerateCall("_wing_jit_hash_join_next",
+        {JitGenerateObject(input, join, builder)}, builder);
+    builder.CreateCondBr(builder.CreateICmpEQ(row,
+                             ConstantPointerNull::get(Type::getInt8PtrTy(C))),
+        probe.next_, if_not_null);
+    builder.SetInsertPoint(if_not_null);
+    values = JitGenerateValuesFromRefs(row, build_schema, builder);
+    values.insert(values.end(), probe.values_.begin(), probe.values_.end());
+    values = JitSelectValues(values,
+        OutputSchema::Concat(build_schema, probe_schema), output_schema);
+    JitGenerateCheck(F, input, memory, predicate, output_schema, values, next,
+        builder);
+    success = builder.GetInsertBlock();
+  }
+  return JitData{values, build.entry_, next, success, probe.failure_};
+}
+
+/**
+ * For each tuple of "outer", the row whose primary key is "key" is searched,
+ * and checked with the predicate of the scan and that of the join.
+ */
+JitData JitGenerateIndexJoin(llvm::LLVMContext& C, llvm::Function* F,
+    llvm::Value* input, JitMemory& memory, const JitData& outer,
+    const OutputSchema& outer_schema, const OutputSchema& scan_schema,
+    const OutputSchema& output_schema, const std::string& table_name,
+    const Expr* key, const Expr* scan_predicate, const Expr* predicate) {
+  using namespace llvm;
+  auto join = memory.AddObject(
+      [table_name, type = key->ret_type_](
+          const uint8_t*, DB& db, size_t txn_id) {
+        auto handle = db.GetReadSearchHandle(txn_id, table_name);
+        handle->Init();
+        return std::make_shared<JitIndexJoin>(std::move(handle), type);
+      });
+  BasicBlock* search = BasicBlock::Create(C, "index_join_search", F);
+  BasicBlock* if_not_null = BasicBlock::Create(C, "index_join_if_not_null", F);
+  std::vector<Value*> values;
+  BasicBlock* success;
+
+  {
+    IRBuilder<> builder(outer.success_);
+    builder.CreateBr(search);
+  }
+  {
+    IRBuilder<> builder(search);
+    auto key_ptr = JitGenerateKeys(
+        input, memory, {key}, outer_schema, outer.values_, builder);
+    auto row = JitGenerateCall("_wing_jit_index_join_search",
+        {JitGenerateObject(input, join, builder), key_ptr}, builder);
+    builder.CreateCondBr(builder.CreateICmpEQ(row,
+                             ConstantPointerNull::get(Type::getInt8PtrTy(C))),
+        outer.next_, if_not_null);
+    builder.SetInsertPoint(if_not_null);
+    auto row_values = JitGenerateValuesFromTuple(row, scan_schema, builder);
+    JitGenerateCheck(F, input, memory, scan_predicate, scan_schema,
+        row_values, outer.next_, builder);
+    values = outer.values_;
+    values.insert(values.end(), row_values.begin(), row_values.end());
+    values = JitSelectValues(values,
+        OutputSchema::Concat(outer_schema, scan_schema), output_schema);
+    JitGenerateCheck(F, input, memory, predicate, output_schema, values,
+        outer.next_, builder);
+    success = builder.GetInsertBlock();
+  }
+  return JitData{values, outer.entry_, outer.next_, success, outer.failure_};
+}
+
+}  // namespace wing
+
+#endif
@@ -1,18 +1,34 @@
 #ifndef SAKURA_JITMEMORY_H__
 #define SAKURA_JITMEMORY_H__
 
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "storage/storage.hpp"
+#include "type/field.hpp"
 #include "type/tuple.hpp"
 
 namespace wing {
 
+class DB;
+
 // Global memory managing global variables,
-// and unique_ptrs such as Iterator, TupleStore.
+// and the objects used by the generated code, such as Iterator, TupleStore.
+// The objects are created for each execution, and their addresses are stored
+// in the memory, so the generated code does not depend on them, and it can be
+// executed again. So are the values of the literals of the plan, so the code
+// is shared by the plans which differ only in their literals.
 class JitMemory {
  public:
+  /* Create an object for an execution. "memory" has the values of the
+   * literals of the execution. */
+  using Factory = std::function<std::shared_ptr<void>(
+      const uint8_t* memory, DB& db, size_t txn_id)>;
+
   JitMemory() = default;
 
   /* Allocate memory and return the offset. */
@@ -25,35 +41,93 @@ class JitMemory {
   /* Init the value at t with data. */
   void Init(size_t t, uint8_t data) { init_values_.push_back({t, data}); }
 
-  /* Add an iterator used in JITExecutor.*/
-  void AddIterator(std::unique_ptr<Iterator<const uint8_t*>>&& iter) {
-    iters_.push_back(std::move(iter));
+  /* Add an object used by the generated code, e.g., an iterator or the hash
+   * table of a join. Return the offset of its address. */
+  size_t AddObject(Factory factory) {
+    auto ret = Allocate(sizeof(void*));
+    factories_.push_back({ret, std::move(factory)});
+    return ret;
+  }
+
+  /* Add a literal of the plan, and return the offset of its value. The
+   * literals of an execution are stored in the order they are added, and
+   * those with the same value share the offset. */
+  size_t AddLiteral(const Field& value) {
+    auto [it, inserted] = literal_offsets_.emplace(LiteralKey(value), 0);
+    if (inserted)
+      it->second = Allocate(sizeof(int64_t));
+    literals_.push_back(it->second);
+    return it->second;
+  }
+
+  /* The offset of the value of a literal added by AddLiteral. */
+  size_t LiteralOffset(const Field& value) const {
+    auto it = literal_offsets_.find(LiteralKey(value));
+    if (it == literal_offsets_.end())
+      throw DBException("Literal {} is not added.", value.ToString());
+    return it->second;
   }
 
-  /* ADd a tuple store used in JITExecutor. */
-  void AddTupleStore(std::unique_ptr<TupleStore>&& store) {
-    tuple_store_ = std::move(store);
+  /* Literals with the same key have the same value. */
+  static std::string LiteralKey(const Field& value) {
+    if (value.type_ == FieldType::CHAR || value.type_ == FieldType::VARCHAR)
+      return fmt::format("s{}:{}", value.size_, value.ReadStringView());
+    return fmt::format(
+        "{}{}", value.type_ == FieldType::FLOAT64 ? 'f' : 'i',
+        value.data_.int_data);
   }
 
   /* Allocate an memory region. */
-  std::unique_ptr<uint8_t[]> GetMemory() {
+  std::unique_ptr<uint8_t[]> GetMemory() const {
     auto ret = std::unique_ptr<uint8_t[]>(new uint8_t[memory_size_]);
     for (auto& [x, y] : init_values_)
       ret.get()[x] = y;
     return ret;
   }
 
-  auto& GetIterators() { return iters_; }
+  /* Store the values of the literals of an execution, which are in the order
+   * they are added, in "memory". Integers and floats are stored as 8 bytes,
+   * and strings as StaticStringFields, which are owned by the returned
+   * objects. */
+  std::vector<std::shared_ptr<void>> StoreLiterals(
+      uint8_t* memory, const std::vector<Field>& values) const {
+    std::vector<std::shared_ptr<void>> ret;
+    for (size_t i = 0; i < literals_.size(); i++) {
+      auto& value = values[i];
+      auto data = value.data_.int_data;
+      if (value.type_ == FieldType::CHAR || value.type_ == FieldType::VARCHAR) {
+        auto field = std::shared_ptr<StaticStringField>(
+            StaticStringField::Generate(value.ReadStringView()),
+            StaticStringField::FreeFromGenerate);
+        data = reinterpret_cast<int64_t>(field.get());
+        ret.push_back(std::move(field));
+      }
+      std::memcpy(memory + literals_[i], &data, sizeof(data));
+    }
+    return ret;
+  }
 
-  auto& GetTupleStore() { return tuple_store_; }
+  /* Create the objects in the order they are added, and store their
+   * addresses in "memory". */
+  std::vector<std::shared_ptr<void>> CreateObjects(
+      uint8_t* memory, DB& db, size_t txn_id) const {
+    std::vector<std::shared_ptr<void>> ret;
+    for (auto& [offset, factory] : factories_) {
+      ret.push_back(factory(memory, db, txn_id));
+      auto address = ret.back().get();
+      std::memcpy(memory + offset, &address, sizeof(void*));
+    }
+    return ret;
+  }
 
  private:
   size_t memory_size_{0};
   std::vector<std::pair<size_t, uint8_t>> init_values_;
-  std::vector<std::unique_ptr<Iterator<const uint8_t*>>> iters_;
-
-  std::unique_ptr<TupleStore> tuple_store_;
+  std::vector<std::pair<size_t, Factory>> factories_;
+  /* The offsets of the literals in the order they are added. */
+  std::vector<size_t> literals_;
+  std::unordered_map<std::string, size_t> literal_offsets_;
 };
 
 }  // namespace wing
-#endif
\ No newline at end of file
+#endif
@@ -48,6 +48,90 @@ std::vector<llvm::Value*> JitGenerateValuesFromTuple(llvm::Value* input,
   return ret;
 }
 
+// Generate llvm::Values from a pointer pointing to an array of
+// StaticFieldRef, e.g., a tuple in TupleStore.
+std::vector<llvm::Value*> JitGenerateValuesFromRefs(llvm::Value* input,
+    const OutputSchema& input_schema, llvm::IRBuilder<>& builder) {
+  using namespace llvm;
+  auto& C = builder.getContext();
+  std::vector<llvm::Value*> ret;
+  for (uint32_t i = 0; auto& a : input_schema.GetCols()) {
+    auto pos = builder.CreateInBoundsGEP(Type::getInt8Ty(C), input,
+        ConstantInt::get(C, APInt(32, i++ * sizeof(StaticFieldRef))));
+    if (a.type_ == FieldType::FLOAT64) {
+      ret.push_back(builder.CreateLoad(Type::getDoubleTy(C),
+          builder.CreateBitCast(pos, Type::getDoublePtrTy(C))));
+      continue;
+    }
+    Value* v = builder.CreateLoad(Type::getInt64Ty(C),
+        builder.CreateBitCast(pos, Type::getInt64PtrTy(C)));
+    if (a.type_ == FieldType::CHAR || a.type_ == FieldType::VARCHAR)
+      v = builder.CreateIntToPtr(v, Type::getInt8PtrTy(C));
+    ret.push_back(v);
+  }
+  return ret;
+}
+
+// Store the values to an array of StaticFieldRef at "output". Integers and
+// pointers are all int64_t.
+void JitStoreValues(llvm::Value* output, const std::vector<llvm::Value*>& values,
+    llvm::IRBuilder<>& builder) {
+  using namespace llvm;
+  auto& C = builder.getContext();
+  for (uint32_t i = 0; auto v : values) {
+    Value* ptr = builder.CreateInBoundsGEP(Type::getInt8Ty(C), output,
+        ConstantInt::get(C, APInt(32, i++ * sizeof(StaticFieldRef))));
+    if (v->getType()->isDoubleTy()) {
+      builder.CreateStore(
+          v, builder.CreateBitCast(ptr, Type::getDoublePtrTy(C)));
+    } else {
+      builder.CreateStore(builder.CreateBitOrPointerCast(v, Type::getInt64Ty(C)),
+          builder.CreateBitCast(ptr, Type::getInt64PtrTy(C)));
+    }
+  }
+}
+
+// Select the values of the columns of "output_schema" from "values", which
+// are the values of the columns of "input_schema".
+std::vector<llvm::Value*> JitSelectValues(
+    const std::vector<llvm::Value*>& values, const OutputSchema& input_schema,
+    const OutputSchema& output_schema) {
+  std::vector<llvm::Value*> ret;
+  for (auto& a : output_schema.GetCols()) {
+    auto index = input_schema.FindById(a.id_);
+    if (!index) {
+      DB_ERR("Internal Error: Column {} is not in the input.", a.column_name_);
+    }
+    ret.push_back(values[index.value()]);
+  }
+  return ret;
+}
+
+// The address of an object added to JitMemory, which is stored at "offset".
+llvm::Value* JitGenerateObject(
+    llvm::Value* input, size_t offset, llvm::IRBuilder<>& builder) {
+  using namespace llvm;
+  auto& C = builder.getContext();
+  return builder.CreateLoad(Type::getInt8PtrTy(C),
+      builder.CreateBitCast(JitGeneratePointer(input, offset, builder),
+          Type::getInt8PtrTy(C)->getPointerTo()));
+}
+
+// Call a function used by LLVM. All of its arguments are i8*, and it returns
+// i8* or void.
+llvm::Value* JitGenerateCall(std::string_view name,
+    const std::vector<llvm::Value*>& args, llvm::IRBuilder<>& builder,
+    bool returns_void = false) {
+  using namespace llvm;
+  auto& C = builder.getContext();
+  auto func_type = FunctionType::get(
+      returns_void ? Type::getVoidTy(C) : Type::getInt8PtrTy(C),
+      std::vector<Type*>(args.size(), Type::getInt8PtrTy(C)), false);
+  auto func = builder.GetInsertBlock()->getModule()->getOrInsertFunction(
+      StringRef(name.data(), name.size()), func_type);
+  return builder.CreateCall(func, args);
+}
+
 /**
  *
  * I think the following 4 interfaces can cover all needs.
@@ -113,13 +197,15 @@ class JitData {
   llvm::BasicBlock* failure_;
 };
 
+// The scan reads the raw rows of "input_schema", and outputs the columns of
+// "output_schema", which may be a part of them. See PruneColumnsRule.
+// "scan_iter" creates the iterator for each execution.
 JitData JitGenerateSeqScan(llvm::LLVMContext& C, llvm::Function* F,
     llvm::Value* input, JitMemory& memory, const OutputSchema& input_schema,
-    std::unique_ptr<Iterator<const uint8_t*>> scan_iter,
+    const OutputSchema& output_schema, JitMemory::Factory scan_iter,
     const std::unique_ptr<Expr>& predicate) {
   using namespace llvm;
-  auto scan_iter_addr = reinterpret_cast<size_t>(scan_iter.get());
-  memory.AddIterator(std::move(scan_iter));
+  auto scan_iter_offset = memory.AddObject(std::move(scan_iter));
   auto iter_next_func_type =
       FunctionType::get(Type::getInt8PtrTy(C), {Type::getInt8PtrTy(C)}, false);
   auto iter_next_func = F->getParent()->getOrInsertFunction(
@@ -138,9 +224,8 @@ JitData JitGenerateSeqScan(llvm::LLVMContext& C, llvm::Function* F,
 
   {
     IRBuilder<> builder(entry);
-    Value* ptr = builder.CreateBitOrPointerCast(
-        ConstantInt::get(C, APInt(64, scan_iter_addr)), Type::getInt8PtrTy(C),
-        "iter");
+    Value* ptr = JitGenerateObject(input, scan_iter_offset, builder);
+    ptr->setName("iter");
     tuple = builder.CreateCall(iter_next_func, {ptr}, "tuple");
     builder.CreateCondBr(builder.CreateICmpEQ(tuple,
                              ConstantPointerNull::get(Type::getInt8PtrTy(C))),
@@ -153,7 +238,8 @@ JitData JitGenerateSeqScan(llvm::LLVMContext& C, llvm::Function* F,
     if (predicate) {
       // Get predicate value
       Value* expr_value =
-          JitGenerateExpr(predicate.get(), input_schema, values, builder);
+          JitGenerateExpr(predicate.get(), input, memory, input_schema, values,
+              builder);
       expr_value->setName("predicate_value");
       Value* flag = builder.CreateICmpEQ(
           expr_value, ConstantInt::get(C, APInt(64, 0)), "flag");
@@ -163,10 +249,12 @@ JitData JitGenerateSeqScan(llvm::LLVMContext& C, llvm::Function* F,
     }
   }
   { IRBuilder<> builder(if_null); }
-  return JitData{values, entry, entry, if_pass_predicate, if_null};
+  return JitData{JitSelectValues(values, input_schema, output_schema), entry,
+      entry, if_pass_predicate, if_null};
 }
 
 JitData JitGenerateFilter(llvm::LLVMContext& C, llvm::Function* F,
+    llvm::Value* input, const JitMemory& memory,
     const std::vector<llvm::Value*>& values, const OutputSchema& input_schema,
     const std::unique_ptr<Expr>& expr) {
   using namespace llvm;
@@ -175,8 +263,8 @@ JitData JitGenerateFilter(llvm::LLVMContext& C, llvm::Function* F,
   BasicBlock* if_false = BasicBlock::Create(C, "filter_if_false", F);
   {
     IRBuilder<> builder(entry);
-    Value* expr_value =
-        JitGenerateExpr(expr.get(), input_schema, values, builder);
+    Value* expr_value = JitGenerateExpr(
+        expr.get(), input, memory, input_schema, values, builder);
     expr_value->setName("expr_value");
     Value* flag = builder.CreateICmpEQ(
         expr_value, ConstantInt::get(C, APInt(64, 0)), "flag");
@@ -186,6 +274,7 @@ JitData JitGenerateFilter(llvm::LLVMContext& C, llvm::Function* F,
 }
 
 JitData JitGenerateProject(llvm::LLVMContext& C, llvm::Function* F,
+    llvm::Value* input, const JitMemory& memory,
     const std::vector<llvm::Value*>& values, const OutputSchema& input_schema,
     const std::vector<std::unique_ptr<Expr>>& exprs) {
   using namespace llvm;
@@ -194,8 +283,8 @@ JitData JitGenerateProject(llvm::LLVMContext& C, llvm::Function* F,
   {
     IRBuilder<> builder(entry);
     for (uint32_t i = 0; auto& a : exprs) {
-      Value* expr_value =
-          JitGenerateExpr(a.get(), input_schema, values, builder);
+      Value* expr_value = JitGenerateExpr(
+          a.get(), input, memory, input_schema, values, builder);
       new_values.push_back(expr_value);
       expr_value->setName(fmt::format("output_{}", i++));
     }
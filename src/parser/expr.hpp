@@ -97,6 +97,10 @@ struct Expr {
   ExprType type_;
   RetType ret_type_;
   std::unique_ptr<Expr> ch0_, ch1_;
+  /* If a literal is the value of a parameter "?", the index of the parameter,
+   * otherwise -1. A cached plan is executed with other parameters by
+   * replacing the values of these literals. */
+  int param_index_{-1};
   Expr(ExprType type) : type_(type) {}
   Expr(ExprType type, std::unique_ptr<Expr>&& ch0)
     : type_(type), ch0_(std::move(ch0)) {}
@@ -66,6 +66,7 @@ enum class TokenType {
   _SEMICOLON,
   _LEFTQ,
   _RIGHTQ,
+  _PARAMETER,
   _AND,
   _NOT,
   _OR,
@@ -89,8 +90,8 @@ static const char* all_tokens[] = {"select", "from", "where", "insert", "into",
     "int64", "real", "float64", "char", "varchar", "index", "view", "limit",
     "offset", "asc", "desc", "group", "order", "join", "inner", "on", "by",
     "distinct", "having", "as", "max", "min", "sum", "avg", "count", "*", ".",
-    ",", ";", "(", ")", "and", "not", "or", "+", "-", "/", "%", ">", "<", "^",
-    "&", "|", "=", ">=", "<=", "<>", "<<", ">>"};
+    ",", ";", "(", ")", "?", "and", "not", "or", "+", "-", "/", "%", ">", "<",
+    "^", "&", "|", "=", ">=", "<=", "<>", "<<", ">>"};
 
 template <const uint32_t SZ, const uint32_t A>
 class Trie {
@@ -443,11 +444,17 @@ class Parser::Impl {
 
  public:
   std::pair<std::unique_ptr<Statement>, std::string> Parse(
-      std::string_view statement) {
+      std::string_view statement, const std::vector<Field>& params) {
     std::lock_guard l(latch_);
     reader_.Init(statement);
+    params_ = &params;
+    num_params_ = 0;
     try {
       auto statement = parse();
+      if (num_params_ != params.size())
+        throw ParserException(fmt::format(
+            "Expect {} parameters, but {} are bound.", num_params_,
+            params.size()));
       return {std::move(statement), ""};
     } catch (const ParserException& e) {
       auto data = reader_.CurrentPosition();
@@ -461,9 +468,44 @@ class Parser::Impl {
     }
   }
 
+  std::string Normalize(std::string_view statement, size_t& num_params) {
+    std::lock_guard l(latch_);
+    reader_.Init(statement);
+    std::string ret;
+    num_params = 0;
+    for (; reader_.ReadType() != TokenType::_END; reader_.Next()) {
+      auto [type, str] = reader_.Read();
+      if (!ret.empty())
+        ret += ' ';
+      if (type < TokenType::_OPERATOR) {
+        ret += all_tokens[static_cast<uint32_t>(type)];
+        num_params += type == TokenType::_PARAMETER;
+      } else if (type == TokenType::_OPERATOR) {
+        // "and", "not" and "or" are operators.
+        for (auto c : str)
+          ret += std::tolower(c);
+      } else if (type == TokenType::_LITERIAL_STRING) {
+        ret += fmt::format("\'{}\'", str);
+      } else if (type == TokenType::_TABLENAME) {
+        ret += fmt::format("\"{}\"", str);
+      } else if (type == TokenType::_LITERIAL_INTEGER ||
+                 type == TokenType::_LITERIAL_FLOAT) {
+        ret += str;
+      } else {
+        // Let the parser report the error.
+        return std::string(statement);
+      }
+    }
+    return ret;
+  }
+
  private:
   SimpleTokenizer reader_;
   std::mutex latch_;
+  // The parameters bound to the placeholders "?", and the number of
+  // placeholders parsed.
+  const std::vector<Field>* params_{nullptr};
+  size_t num_params_{0};
 
   std::unique_ptr<Statement> parse() {
     auto [type, str] = reader_.Read();
@@ -545,10 +587,16 @@ class Parser::Impl {
       return ret;
     else if (reader_.ReadType() == TokenType::LIMIT) {
       reader_.Next();
+      // The plan has the numbers instead of the literals, so they cannot be
+      // parameters.
       ret->limit_count_ = expr_clause();
+      if (ret->limit_count_->param_index_ >= 0)
+        throw ParserException("Parameters are not supported in LIMIT.");
       if (reader_.ReadType() == TokenType::OFFSET) {
         reader_.Next();
         ret->limit_offset_ = expr_clause();
+        if (ret->limit_offset_->param_index_ >= 0)
+          throw ParserException("Parameters are not supported in OFFSET.");
       }
     }
     return ret;
@@ -1042,10 +1090,33 @@ class Parser::Impl {
     throw ParserException("Expect column.");
   }
 
+  // The literals of parameters are not folded, so that they can be replaced.
   bool is_literal(std::unique_ptr<Expr>& expr) {
-    return expr->type_ == ExprType::LITERAL_FLOAT ||
-           expr->type_ == ExprType::LITERAL_INTEGER ||
-           expr->type_ == ExprType::LITERAL_STRING;
+    return expr->param_index_ < 0 &&
+           (expr->type_ == ExprType::LITERAL_FLOAT ||
+               expr->type_ == ExprType::LITERAL_INTEGER ||
+               expr->type_ == ExprType::LITERAL_STRING);
+  }
+
+  // The literal of the next parameter.
+  std::unique_ptr<Expr> param_clause() {
+    if (num_params_ >= params_->size())
+      throw ParserException("Too few parameters are bound.");
+    auto& param = (*params_)[num_params_];
+    std::unique_ptr<Expr> ret;
+    if (param.type_ == FieldType::INT32 || param.type_ == FieldType::INT64) {
+      ret = std::make_unique<LiteralIntegerExpr>(param.ReadInt());
+    } else if (param.type_ == FieldType::FLOAT64) {
+      ret = std::make_unique<LiteralFloatExpr>(param.ReadFloat());
+    } else if (param.type_ == FieldType::CHAR ||
+               param.type_ == FieldType::VARCHAR) {
+      ret = std::make_unique<LiteralStringExpr>(param.ReadStringView());
+    } else {
+      throw ParserException(
+          fmt::format("Invalid type of parameter {}.", num_params_));
+    }
+    ret->param_index_ = num_params_++;
+    return ret;
   }
 
   // If all operands are literal exprs then the expr can also be converted to
@@ -1163,7 +1234,8 @@ class Parser::Impl {
         throw ParserException("Invalid operator on STRING.");
       } else if (expr->ch0_->type_ == ExprType::LITERAL_FLOAT) {
         throw ParserException("Invalid operator on FLOAT.");
-      } else if (expr->ch0_->type_ == ExprType::LITERAL_INTEGER) {
+      } else if (is_literal(expr->ch0_) &&
+                 expr->ch0_->type_ == ExprType::LITERAL_INTEGER) {
         auto v0 =
             static_cast<LiteralIntegerExpr*>(expr->ch0_.get())->literal_value_;
         expr = std::make_unique<LiteralIntegerExpr>(!v0);
@@ -1171,6 +1243,8 @@ class Parser::Impl {
     } else if (expr->type_ == ExprType::UNARYOP) {
       if (expr->ch0_->type_ == ExprType::LITERAL_STRING) {
         throw ParserException("Invalid operator on STRING.");
+      } else if (!is_literal(expr->ch0_)) {
+        return;
       } else if (expr->ch0_->type_ == ExprType::LITERAL_FLOAT) {
         auto v0 =
             static_cast<LiteralFloatExpr*>(expr->ch0_.get())->literal_value_;
@@ -1241,6 +1315,11 @@ class Parser::Impl {
         auto ret = std::make_unique<LiteralStringExpr>(str);
         reader_.Next();
         return {std::move(ret), 0};
+      } else if (type == TokenType::_PARAMETER) {
+        // F0 := ?
+        auto ret = param_clause();
+        reader_.Next();
+        return {std::move(ret), 0};
       } else if (type == TokenType::_LEFTQ) {
         // F0 := (Expr)
         reader_.Next();
@@ -1503,8 +1582,9 @@ Parser::~Parser() {}
 
 Parser::Parser() { ptr_ = std::make_unique<Parser::Impl>(); }
 
-ParserResult Parser::Parse(std::string_view str, const DBSchema& schema) {
-  auto [statement, errmsg] = ptr_->Parse(str);
+ParserResult Parser::Parse(std::string_view str, const DBSchema& schema,
+    const std::vector<Field>& params) {
+  auto [statement, errmsg] = ptr_->Parse(str, params);
   if (errmsg != "")
     return {std::move(errmsg)};
 
@@ -1523,6 +1603,10 @@ ParserResult Parser::Parse(std::string_view str, const DBSchema& schema) {
   return {std::move(statement), std::move(plan), ""};
 }
 
+std::string Parser::Normalize(std::string_view str, size_t& num_params) {
+  return ptr_->Normalize(str, num_params);
+}
+
 namespace impl {
 
 template <typename T>
@@ -1830,18 +1914,21 @@ std::unique_ptr<Expr> ColumnExpr::clone() const {
 std::unique_ptr<Expr> LiteralStringExpr::clone() const {
   auto ret = std::make_unique<LiteralStringExpr>(literal_value_);
   ret->ret_type_ = ret_type_;
+  ret->param_index_ = param_index_;
   return ret;
 }
 
 std::unique_ptr<Expr> LiteralIntegerExpr::clone() const {
   auto ret = std::make_unique<LiteralIntegerExpr>(literal_value_);
   ret->ret_type_ = ret_type_;
+  ret->param_index_ = param_index_;
   return ret;
 }
 
 std::unique_ptr<Expr> LiteralFloatExpr::clone() const {
   auto ret = std::make_unique<LiteralFloatExpr>(literal_value_);
   ret->ret_type_ = ret_type_;
+  ret->param_index_ = param_index_;
   return ret;
 }
 
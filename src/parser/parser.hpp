@@ -4,10 +4,12 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "catalog/schema.hpp"
 #include "parser/ast.hpp"
 #include "plan/plan.hpp"
+#include "type/field.hpp"
 
 namespace wing {
 
@@ -47,7 +49,16 @@ class Parser {
 
   ~Parser();
 
-  ParserResult Parse(std::string_view statement, const DBSchema& db_schema);
+  /* "params" are bound to the placeholders "?" in order. A parameter is a
+   * literal of its type, e.g. a CHAR parameter is a string. */
+  ParserResult Parse(std::string_view statement, const DBSchema& db_schema,
+      const std::vector<Field>& params = {});
+
+  /* Return the tokens of "statement" separated by single spaces, so that the
+   * statements that differ only in spaces and the case of keywords are the
+   * same. The result is parsed the same as "statement". "num_params" is set
+   * to the number of placeholders. */
+  std::string Normalize(std::string_view statement, size_t& num_params);
 
  private:
   class Impl;
@@ -2,6 +2,9 @@
 
 #include "plan/optimizer.hpp"
 #include "rules/convert_to_hash_join.hpp"
+#include "rules/convert_to_merge_sort_join.hpp"
+#include "rules/convert_to_index_nestloop_join.hpp"
+#include "rules/prune_columns.hpp"
 #include "plan/card_est.hpp"
 #include "plan/cost_model.hpp"
 
@@ -93,13 +96,18 @@ bool CheckCondition(const PlanNode* plan, const DB& db) {
 std::unique_ptr<PlanNode> CostBasedOptimizer::Optimize(
     std::unique_ptr<PlanNode> plan, DB& db) {
   if (CheckCondition(plan.get(), db)) {
-    return CostBasedOptimizer_(std::move(plan),db).solve();
+    plan = CostBasedOptimizer_(std::move(plan),db).solve();
   } else {
     std::vector<std::unique_ptr<OptRule>> R;
+    R.push_back(std::make_unique<ConvertToMergeSortJoinRule>(db));
     R.push_back(std::make_unique<ConvertToHashJoinRule>());
     plan = Apply(std::move(plan), R, db);
-    return plan;
   }
+  // The columns are pruned after the joins are converted, because the scan of
+  // an index nested-loop join must not be pruned.
+  std::vector<std::unique_ptr<OptRule>> R;
+  R.push_back(std::make_unique<PruneColumnsRule>());
+  return Apply(std::move(plan), R, db);
 }
 
 void CostBasedOptimizer_::find_scan_node(PlanNode* p)
@@ -136,14 +144,22 @@ void CostBasedOptimizer_::dp()
   for(int i=0;i<(1<<n);i++) if(i&(i-1)) bitvec[i]=bitvec[i&(i-1)]|bitvec[i-(i&(i-1))];
   for(int i=0;i<(1<<n);i++) if(i&(i-1))
   {
-    int J=0; double C=-1;
+    int J=0; double C=-1; bool index=false;
     int I=(1<<n)-1-i; PredicateVec _pred; for(auto &t:pred.GetVec()) if(!t.CheckLeft(bitvec[I])&&!t.CheckRight(bitvec[I])) _pred.Append({PredicateVec::_trans(t.expr_->clone()), t.left_bits_, t.right_bits_});
     for(int j=i&(i-1);j;j=i&(j-1))
     {
-      double _C=cost[j]+cost[i-j]+(ConvertToHashJoinRule().Check(plan_[j].get(),plan_[i-j].get(),pred)?CostCalculator::HashJoinCost:CostCalculator::NestloopJoinCost)(summary[j].size_,summary[i-j].size_);
-      if(C>_C||C<0){ C=_C; J=j; }
+      auto join_cost=ConvertToMergeSortJoinRule(db).Check(plan_[j].get(),plan_[i-j].get(),pred)?CostCalculator::MergeSortJoinCost:
+                     ConvertToHashJoinRule().Check(plan_[j].get(),plan_[i-j].get(),pred)?CostCalculator::HashJoinCost:CostCalculator::NestloopJoinCost;
+      double _C=cost[j]+cost[i-j]+join_cost(summary[j].size_,summary[i-j].size_); bool _index=false;
+      // an index nestloop join reads no row of the right side except the ones it finds, so the cost of the scan is not added
+      if(ConvertToIndexNestloopJoinRule(db,{}).Check(plan_[j].get(),plan_[i-j].get(),pred))
+      {
+        double c=cost[j]+CostCalculator::IndexNestloopJoinCost(summary[j].size_,summary[i-j].size_);
+        if(c<_C){ _C=c; _index=true; }
+      }
+      if(C>_C||C<0){ C=_C; J=j; index=_index; }
     }
-    split_point[i]=J; cost[i]=C; summary[i]=CardEstimator::EstimateJoinEq(_pred,summary[J],summary[i-J]);
+    split_point[i]=J; cost[i]=C; index_join[i]=index; summary[i]=CardEstimator::EstimateJoinEq(_pred,summary[J],summary[i-J]);
     JoinPlanNode *p=new JoinPlanNode;
     p->ch_=plan_[J]->clone(); p->ch2_=plan_[i-J]->clone(); p->table_bitset_=bitvec[i];
     p->output_schema_.Append(p->ch_->output_schema_); p->output_schema_.Append(p->ch2_->output_schema_);
@@ -188,7 +204,7 @@ std::unique_ptr<PlanNode> CostBasedOptimizer_::solve()
     label1:;
   }
   // std::cout<<pred.ToString()<<std::endl;
-  bitvec.resize(1<<n); plan_.resize(1<<n); cost.resize(1<<n); summary.resize(1<<n); split_point.resize(1<<n);
+  bitvec.resize(1<<n); plan_.resize(1<<n); cost.resize(1<<n); summary.resize(1<<n); split_point.resize(1<<n); index_join.resize(1<<n);
   dp();
   plan->ch_=std::move(plan_[(1<<n)-1]->clone());
   (plan->ch_->type_==PlanType::Join     ?((JoinPlanNode*)     (plan->ch_).get())->predicate_:
@@ -196,7 +212,10 @@ std::unique_ptr<PlanNode> CostBasedOptimizer_::solve()
                                          ((RangeScanPlanNode*)(plan->ch_).get())->predicate_)=pred.clone();
   // logical_optimize
   plan=LogicalOptimizer::Optimize(std::move(plan),db);
+  std::vector<BitVector> index_joins; for(int i=0;i<(1<<n);i++) if(index_join[i]) index_joins.push_back(bitvec[i]);
   std::vector<std::unique_ptr<OptRule>> R;
+  R.push_back(std::make_unique<ConvertToIndexNestloopJoinRule>(db,std::move(index_joins)));
+  R.push_back(std::make_unique<ConvertToMergeSortJoinRule>(db));
   R.push_back(std::make_unique<ConvertToHashJoinRule>());
   plan = Apply(std::move(plan), R, db);
   // print((1<<n)-1,0);
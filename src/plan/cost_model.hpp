@@ -1,6 +1,8 @@
 #ifndef SAKURA_COST_MODEL_H__
 #define SAKURA_COST_MODEL_H__
 
+#include <cmath>
+
 namespace wing {
 
 class CostCalculator{
@@ -9,6 +11,18 @@ class CostCalculator{
     return build_size*2+probe_size;
   }
 
+  /* Calculate the cost of merge sort join, whose inputs are already sorted,
+   * so each of them is read once. */
+  static double MergeSortJoinCost(double left_size, double right_size) {
+    return left_size+right_size;
+  }
+
+  /* Calculate the cost of index nestloop join, which searches the B+tree of
+   * the inner table for each outer row instead of reading the inner table. */
+  static double IndexNestloopJoinCost(double outer_size, double inner_size) {
+    return outer_size*std::log2(inner_size+2);
+  }
+
   /* Calculate the cost of nestloop join. */
   static double NestloopJoinCost(double build_size, double probe_size) {
     return build_size*probe_size;
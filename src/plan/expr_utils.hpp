@@ -45,6 +45,20 @@ class ExprUtils {
     }
   }
 
+  // Get all ids of columns in the expression.
+  static void GetExprColumnIds(
+      const Expr* expr, std::vector<uint32_t>& result) {
+    if (expr->type_ == ExprType::COLUMN) {
+      result.push_back(
+          static_cast<const ColumnExpr*>(expr)->id_in_column_name_table_);
+    } else {
+      if (expr->ch0_ != nullptr)
+        GetExprColumnIds(expr->ch0_.get(), result);
+      if (expr->ch1_ != nullptr)
+        GetExprColumnIds(expr->ch1_.get(), result);
+    }
+  }
+
   // First get all table ids.
   // Then pack them into a BitVector.
   static BitVector GetExprBitVector(const Expr* expr) {
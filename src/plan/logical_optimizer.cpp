@@ -2,6 +2,8 @@
 #include "plan/optimizer.hpp"
 #include "plan/rules/push_down_filter.hpp"
 #include "plan/rules/convert_to_range_scan.hpp"
+#include "plan/rules/convert_to_top_n.hpp"
+#include "plan/rules/convert_to_hash_distinct.hpp"
 #include <iostream>
 
 namespace wing {
@@ -37,6 +39,8 @@ std::unique_ptr<PlanNode> LogicalOptimizer::Optimize(
   R.push_back(std::make_unique<PushdownJoinPredicateRule>());
   R.push_back(std::make_unique<PushDownFilterRule>());
   R.push_back(std::make_unique<ConvertToRangeScanRule>(db));
+  R.push_back(std::make_unique<ConvertToTopNRule>());
+  R.push_back(std::make_unique<ConvertToHashDistinctRule>());
   // std::cout<<plan->ToString()<<std::endl;
   // timer_.start();
   plan = Apply(std::move(plan), R);
@@ -46,6 +46,7 @@ class CostBasedOptimizer_ {
   std::vector<double> cost; // the estimate cost of the plan of S
   std::vector<CardEstimator::Summary> summary; // the estimate info
   std::vector<int> split_point; // the estimate info
+  std::vector<char> index_join; // whether the right side of the split is probed by its primary key
 };
 
 }  // namespace wing
@@ -907,6 +907,16 @@ std::string VecToString(const std::vector<T>& v, F&& func) {
   return ret;
 }
 
+// The columns of a scan if it does not output all columns of its table.
+std::string ScanColumnsToString(
+    const OutputSchema& table_schema, const OutputSchema& output_schema) {
+  if (table_schema.Size() == 0)
+    return "";
+  return fmt::format(" [Columns: {}]",
+      VecToString(output_schema.GetCols(),
+          [](const OutputColumnData& x) { return x.column_name_; }));
+}
+
 std::string ProjectPlanNode::ToString() const {
   int i = 0;
   return fmt::format("Project [Output: {}] \n  -> {}",
@@ -925,8 +935,9 @@ std::string FilterPlanNode::ToString() const {
 }
 
 std::string SeqScanPlanNode::ToString() const {
-  return fmt::format("Seq Scan [Table: {}] [Predicate: {}]", table_name_,
-      predicate_.ToString());
+  return fmt::format("Seq Scan [Table: {}] [Predicate: {}]{}", table_name_,
+      predicate_.ToString(),
+      ScanColumnsToString(table_schema_, output_schema_));
 }
 
 std::string JoinPlanNode::ToString() const {
@@ -949,6 +960,23 @@ std::string HashJoinPlanNode::ToString() const {
       AddSpacesAfterNewLine(ch2_->ToString(), 4));
 }
 
+std::string MergeSortJoinPlanNode::ToString() const {
+  return fmt::format(
+      "Merge Sort Join [Predicate: {}] \n  [Merge Key: {}]\n  -> {}\n  "
+      "[Merge Key: {}]\n  -> {}",
+      predicate_.ToString(), left_merge_key_->ToString(),
+      AddSpacesAfterNewLine(ch_->ToString(), 4), right_merge_key_->ToString(),
+      AddSpacesAfterNewLine(ch2_->ToString(), 4));
+}
+
+std::string IndexNestloopJoinPlanNode::ToString() const {
+  return fmt::format(
+      "Index Nestloop Join [Predicate: {}] \n  [Key: {}]\n  -> {}\n  -> {}",
+      predicate_.ToString(), left_key_->ToString(),
+      AddSpacesAfterNewLine(ch_->ToString(), 4),
+      AddSpacesAfterNewLine(ch2_->ToString(), 4));
+}
+
 std::string AggregatePlanNode::ToString() const {
   int i = 0;
   return fmt::format(
@@ -1017,12 +1045,36 @@ std::string DistinctPlanNode::ToString() const {
       "Distinct \n  -> {}", AddSpacesAfterNewLine(ch_->ToString(), 4));
 }
 
+std::string HashDistinctPlanNode::ToString() const {
+  return fmt::format(
+      "Hash Distinct \n  -> {}", AddSpacesAfterNewLine(ch_->ToString(), 4));
+}
+
 std::string RangeScanPlanNode::ToString() const {
   return fmt::format(
-      "Range Scan [Table: {}] [Range: {}{}, {}{} ] [Predicate: {}] , bit table: {}",
+      "Range Scan [Table: {}] [Range: {}{}, {}{} ] [Predicate: {}]{} , bit table: {}",
       table_name_, range_l_.second ? "[" : "(", range_l_.first.ToString(),
       range_r_.first.ToString(), range_r_.second ? "]" : ")",
-      predicate_.ToString(),table_bitset_.ToString());
+      predicate_.ToString(),
+      ScanColumnsToString(table_schema_, output_schema_),
+      table_bitset_.ToString());
+}
+
+std::string TopNPlanNode::ToString() const {
+  int i = 0;
+  return fmt::format("TopN [On: {}] [Limit {}, Offset {}] \n  -> {}",
+      VecToString(order_by_exprs_,
+          [&](const std::pair<RetType, bool>& x) {
+            auto expr =
+                std::make_unique<ColumnExpr>(ch_->output_schema_[i].table_name_,
+                    ch_->output_schema_[i].column_name_);
+            expr->id_in_column_name_table_ = ch_->output_schema_[i].id_;
+            expr->ret_type_ = x.first;
+            i++;
+            return fmt::format(
+                "{} {}", expr->ToString(), x.second ? "asc" : "desc");
+          }),
+      limit_size_, offset_, AddSpacesAfterNewLine(ch_->ToString(), 4));
 }
 
 std::unique_ptr<PlanNode> ProjectPlanNode::clone() const {
@@ -1052,6 +1104,7 @@ std::unique_ptr<PlanNode> SeqScanPlanNode::clone() const {
   ret->table_name_ = table_name_;
   ret->table_bitset_ = table_bitset_;
   ret->predicate_ = predicate_.clone();
+  ret->table_schema_ = table_schema_;
   return ret;
 }
 
@@ -1101,6 +1154,19 @@ std::unique_ptr<PlanNode> LimitPlanNode::clone() const {
   return ret;
 }
 
+std::unique_ptr<PlanNode> TopNPlanNode::clone() const {
+  auto ret = std::make_unique<TopNPlanNode>();
+  ret->output_schema_ = output_schema_;
+  ret->order_by_exprs_ = order_by_exprs_;
+  ret->order_by_offset_ = order_by_offset_;
+  ret->limit_size_ = limit_size_;
+  ret->offset_ = offset_;
+  ret->ch2_ = ch2_ ? ch2_->clone() : nullptr;
+  ret->ch_ = ch_ ? ch_->clone() : nullptr;
+  ret->table_bitset_ = table_bitset_;
+  return ret;
+}
+
 std::unique_ptr<PlanNode> InsertPlanNode::clone() const {
   auto ret = std::make_unique<InsertPlanNode>();
   ret->output_schema_ = output_schema_;
@@ -1151,6 +1217,15 @@ std::unique_ptr<PlanNode> DistinctPlanNode::clone() const {
   return ret;
 }
 
+std::unique_ptr<PlanNode> HashDistinctPlanNode::clone() const {
+  auto ret = std::make_unique<HashDistinctPlanNode>();
+  ret->output_schema_ = output_schema_;
+  ret->ch2_ = ch2_ ? ch2_->clone() : nullptr;
+  ret->ch_ = ch_ ? ch_->clone() : nullptr;
+  ret->table_bitset_ = table_bitset_;
+  return ret;
+}
+
 std::unique_ptr<PlanNode> HashJoinPlanNode::clone() const {
   auto ret = std::make_unique<HashJoinPlanNode>();
   ret->output_schema_ = output_schema_;
@@ -1165,6 +1240,29 @@ std::unique_ptr<PlanNode> HashJoinPlanNode::clone() const {
   return ret;
 }
 
+std::unique_ptr<PlanNode> MergeSortJoinPlanNode::clone() const {
+  auto ret = std::make_unique<MergeSortJoinPlanNode>();
+  ret->output_schema_ = output_schema_;
+  ret->predicate_ = predicate_.clone();
+  ret->ch2_ = ch2_ ? ch2_->clone() : nullptr;
+  ret->ch_ = ch_ ? ch_->clone() : nullptr;
+  ret->left_merge_key_ = left_merge_key_->clone();
+  ret->right_merge_key_ = right_merge_key_->clone();
+  ret->table_bitset_ = table_bitset_;
+  return ret;
+}
+
+std::unique_ptr<PlanNode> IndexNestloopJoinPlanNode::clone() const {
+  auto ret = std::make_unique<IndexNestloopJoinPlanNode>();
+  ret->output_schema_ = output_schema_;
+  ret->predicate_ = predicate_.clone();
+  ret->ch2_ = ch2_ ? ch2_->clone() : nullptr;
+  ret->ch_ = ch_ ? ch_->clone() : nullptr;
+  ret->left_key_ = left_key_->clone();
+  ret->table_bitset_ = table_bitset_;
+  return ret;
+}
+
 std::unique_ptr<PlanNode> RangeScanPlanNode::clone() const {
   auto ret = std::make_unique<RangeScanPlanNode>();
   ret->output_schema_ = output_schema_;
@@ -1173,6 +1271,7 @@ std::unique_ptr<PlanNode> RangeScanPlanNode::clone() const {
   ret->predicate_ = predicate_.clone();
   ret->range_l_ = range_l_;
   ret->range_r_ = range_r_;
+  ret->table_schema_ = table_schema_;
   return ret;
 }
 
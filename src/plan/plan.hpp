@@ -31,6 +31,9 @@ enum class PlanType {
   HashJoin,
   MergeSortJoin,
   RangeScan,
+  TopN,
+  HashDistinct,
+  IndexNestloopJoin,
 };
 
 /**
@@ -71,6 +74,14 @@ enum class PlanType {
  *              +-- PrintPlanNode: It directly print rows.
  *              |
  *              +-- DistinctPlanNode: It eliminate duplicate rows.
+ *
+ * TopNPlanNode is the implementation of a LimitPlanNode over an
+ * OrderByPlanNode, which keeps only the first rows.
+ * HashDistinctPlanNode is the implementation of a DistinctPlanNode whose input
+ * is not sorted, which eliminates duplicate rows by hashing.
+ * IndexNestloopJoinPlanNode is the implementation of a JoinPlanNode whose
+ * right child is a scan joined on its primary key, which searches the B+tree
+ * of the table instead of scanning it.
  */
 class PlanNode {
  public:
@@ -100,6 +111,10 @@ class SeqScanPlanNode : public PlanNode {
   std::unique_ptr<PlanNode> clone() const override;
   std::string table_name_;
   PredicateVec predicate_;
+  // If it is not empty, the predicate is evaluated on the raw rows of this
+  // schema, and only the columns of output_schema_ are deserialized from the
+  // rows that pass it. See PruneColumnsRule.
+  OutputSchema table_schema_;
 };
 
 class FilterPlanNode : public PlanNode {
@@ -215,7 +230,10 @@ class MergeSortJoinPlanNode : public PlanNode {
   MergeSortJoinPlanNode() : PlanNode(PlanType::MergeSortJoin) {}
   std::string ToString() const override;
   std::unique_ptr<PlanNode> clone() const override;
-  std::vector<std::unique_ptr<Expr>> merge_keys_;
+  // Both children are sorted in ascending order by their merge keys, which
+  // must be equal in the output rows.
+  std::unique_ptr<Expr> left_merge_key_;
+  std::unique_ptr<Expr> right_merge_key_;
   PredicateVec predicate_;
 };
 
@@ -230,6 +248,39 @@ class RangeScanPlanNode : public PlanNode {
   std::pair<Field, bool> range_l_;
   std::pair<Field, bool> range_r_;
   PredicateVec predicate_;
+  // The same as that of SeqScanPlanNode.
+  OutputSchema table_schema_;
+};
+
+class TopNPlanNode : public PlanNode {
+ public:
+  TopNPlanNode() : PlanNode(PlanType::TopN) {}
+  std::string ToString() const override;
+  std::unique_ptr<PlanNode> clone() const override;
+  // The same as those of OrderByPlanNode.
+  std::vector<std::pair<RetType, bool>> order_by_exprs_;
+  size_t order_by_offset_;
+  // The same as those of LimitPlanNode.
+  size_t limit_size_{0}, offset_{0};
+};
+
+class IndexNestloopJoinPlanNode : public PlanNode {
+ public:
+  IndexNestloopJoinPlanNode() : PlanNode(PlanType::IndexNestloopJoin) {}
+  std::string ToString() const override;
+  std::unique_ptr<PlanNode> clone() const override;
+  // The key of the left child which is searched in the table of the right
+  // child, which is a SeqScanPlanNode or a RangeScanPlanNode. The right child
+  // is not executed, but its predicate is checked on the rows found.
+  std::unique_ptr<Expr> left_key_;
+  PredicateVec predicate_;
+};
+
+class HashDistinctPlanNode : public PlanNode {
+ public:
+  HashDistinctPlanNode() : PlanNode(PlanType::HashDistinct) {}
+  std::string ToString() const override;
+  std::unique_ptr<PlanNode> clone() const override;
 };
 
 // This is used to generate a base plan after generating AST.
@@ -0,0 +1,208 @@
+#ifndef SAKURA_PLAN_CACHE_H__
+#define SAKURA_PLAN_CACHE_H__
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "catalog/db.hpp"
+#include "plan/plan.hpp"
+#include "plan/rules/convert_to_range_scan.hpp"
+
+namespace wing {
+
+/**
+ * The optimized plans of recently executed statements. Parsing, planning and
+ * optimizing a point query costs more than executing it. The key of a plan is
+ * the normalized text of its statement (see Parser::Normalize) and the types
+ * of its parameters.
+ *
+ * A cached plan is executed with other parameters by BindParameters(), so it
+ * is optimized for the parameters of its first execution. All plans are
+ * dropped when the catalog version of the database changes, i.e., a table is
+ * created or dropped, or the statistics are updated. When the cache is full,
+ * the least recently used plan is dropped.
+ */
+class PlanCache {
+ public:
+  struct Entry {
+    std::unique_ptr<PlanNode> plan_;
+    // The output schema before optimization, whose columns have the names in
+    // the statement.
+    OutputSchema output_schema_;
+    bool select_{false};
+
+    Entry clone() const { return {plan_->clone(), output_schema_, select_}; }
+  };
+
+  PlanCache(size_t capacity) : capacity_(capacity) {}
+
+  /* Return a copy of the plan of "key", or std::nullopt if it is not cached.
+   * "version" is the current catalog version. */
+  std::optional<Entry> Get(const std::string& key, size_t version) {
+    std::unique_lock lck(mu_);
+    if (version != version_) {
+      Clear(version);
+      return std::nullopt;
+    }
+    auto it = index_.find(key);
+    if (it == index_.end())
+      return std::nullopt;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second.clone();
+  }
+
+  /* "version" is the catalog version before the statement is parsed. The
+   * plan is dropped if the catalog has changed since. */
+  void Put(const std::string& key, size_t version, Entry entry) {
+    std::unique_lock lck(mu_);
+    if (version < version_ || capacity_ == 0)
+      return;
+    if (version > version_)
+      Clear(version);
+    if (auto it = index_.find(key); it != index_.end()) {
+      lru_.erase(it->second);
+      index_.erase(it);
+    }
+    lru_.emplace_front(key, std::move(entry));
+    index_.emplace(key, lru_.begin());
+    Evict();
+  }
+
+  size_t Size() {
+    std::unique_lock lck(mu_);
+    return lru_.size();
+  }
+
+  size_t Capacity() {
+    std::unique_lock lck(mu_);
+    return capacity_;
+  }
+
+  void SetCapacity(size_t capacity) {
+    std::unique_lock lck(mu_);
+    capacity_ = capacity;
+    Evict();
+  }
+
+  /* Replace the literals of the parameters in "plan" by "params", and
+   * compute the ranges of the range scans again, which may depend on them. */
+  static void BindParameters(
+      PlanNode* plan, const std::vector<Field>& params, const DB& db) {
+    if (plan == nullptr)
+      return;
+    auto bind = [&](const auto& exprs) {
+      for (auto& a : exprs)
+        BindParameters(a.get(), params);
+    };
+    auto bind_predicate = [&](PredicateVec& predicate) {
+      for (auto& a : predicate.GetVec())
+        BindParameters(a.expr_.get(), params);
+    };
+    switch (plan->type_) {
+      case PlanType::Project:
+        bind(static_cast<ProjectPlanNode*>(plan)->output_exprs_);
+        break;
+      case PlanType::SeqScan:
+        bind_predicate(static_cast<SeqScanPlanNode*>(plan)->predicate_);
+        break;
+      case PlanType::RangeScan: {
+        auto t_plan = static_cast<RangeScanPlanNode*>(plan);
+        bind_predicate(t_plan->predicate_);
+        auto pk = get_pk_from_table_name(db, t_plan->table_name_);
+        auto [range_l, range_r] =
+            ConvertToRangeScanRule::get_bound(t_plan->predicate_, pk);
+        t_plan->range_l_ = std::move(range_l);
+        t_plan->range_r_ = std::move(range_r);
+        break;
+      }
+      case PlanType::Filter:
+        bind_predicate(static_cast<FilterPlanNode*>(plan)->predicate_);
+        break;
+      case PlanType::Join:
+        bind_predicate(static_cast<JoinPlanNode*>(plan)->predicate_);
+        break;
+      case PlanType::HashJoin: {
+        auto t_plan = static_cast<HashJoinPlanNode*>(plan);
+        bind(t_plan->left_hash_exprs_);
+        bind(t_plan->right_hash_exprs_);
+        bind_predicate(t_plan->predicate_);
+        break;
+      }
+      case PlanType::MergeSortJoin: {
+        auto t_plan = static_cast<MergeSortJoinPlanNode*>(plan);
+        BindParameters(t_plan->left_merge_key_.get(), params);
+        BindParameters(t_plan->right_merge_key_.get(), params);
+        bind_predicate(t_plan->predicate_);
+        break;
+      }
+      case PlanType::IndexNestloopJoin: {
+        auto t_plan = static_cast<IndexNestloopJoinPlanNode*>(plan);
+        BindParameters(t_plan->left_key_.get(), params);
+        bind_predicate(t_plan->predicate_);
+        break;
+      }
+      case PlanType::Aggregate: {
+        auto t_plan = static_cast<AggregatePlanNode*>(plan);
+        bind(t_plan->output_exprs_);
+        bind(t_plan->group_by_exprs_);
+        bind_predicate(t_plan->group_predicate_);
+        break;
+      }
+      case PlanType::Update:
+        for (auto& [_, expr] : static_cast<UpdatePlanNode*>(plan)->updates_)
+          BindParameters(expr.get(), params);
+        break;
+      default:
+        break;
+    }
+    BindParameters(plan->ch_.get(), params, db);
+    BindParameters(plan->ch2_.get(), params, db);
+  }
+
+ private:
+  static void BindParameters(Expr* expr, const std::vector<Field>& params) {
+    if (expr == nullptr)
+      return;
+    if (expr->param_index_ >= 0) {
+      auto& param = params[expr->param_index_];
+      if (expr->type_ == ExprType::LITERAL_INTEGER) {
+        static_cast<LiteralIntegerExpr*>(expr)->literal_value_ =
+            param.ReadInt();
+      } else if (expr->type_ == ExprType::LITERAL_FLOAT) {
+        static_cast<LiteralFloatExpr*>(expr)->literal_value_ =
+            param.ReadFloat();
+      } else if (expr->type_ == ExprType::LITERAL_STRING) {
+        static_cast<LiteralStringExpr*>(expr)->literal_value_ =
+            param.ReadString();
+      }
+    }
+    BindParameters(expr->ch0_.get(), params);
+    BindParameters(expr->ch1_.get(), params);
+  }
+
+  void Clear(size_t version) {
+    index_.clear();
+    lru_.clear();
+    version_ = version;
+  }
+
+  void Evict() {
+    while (lru_.size() > capacity_) {
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+  }
+
+  std::mutex mu_;
+  size_t capacity_;
+  size_t version_{0};
+  /* The most recently used plan is at the front. */
+  std::list<std::pair<std::string, Entry>> lru_;
+  std::unordered_map<std::string, decltype(lru_)::iterator> index_;
+};
+
+}  // namespace wing
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef SAKURA_CONVERT_TO_HASH_DISTINCT_H__
+#define SAKURA_CONVERT_TO_HASH_DISTINCT_H__
+
+#include <set>
+
+#include "plan/rules/rule.hpp"
+
+namespace wing {
+
+/**
+ * A Distinct only compares each row with the previous one, so duplicate rows
+ * must be adjacent, i.e., the output columns must be a prefix of the sort
+ * keys. For example,
+ * select distinct A.a from A order by A.a asc;
+ * select distinct A.a, A.b from A order by A.b asc, A.a desc, A.c asc;
+ *
+ * Otherwise it is converted to a HashDistinct, which remembers the rows it
+ * has returned in a hash table. For example,
+ * select distinct A.a, A.b from A order by A.a asc;
+ * select distinct A.a from A order by A.b asc, A.a asc;
+ * select distinct A.a from A;
+ */
+class ConvertToHashDistinctRule : public OptRule {
+ public:
+  bool Match(const PlanNode* node) override {
+    return node->type_ == PlanType::Distinct &&
+           !SortedByAllColumns(node->ch_.get());
+  }
+  std::unique_ptr<PlanNode> Transform(std::unique_ptr<PlanNode> node) override {
+    auto ret = std::make_unique<HashDistinctPlanNode>();
+    ret->ch_ = std::move(node->ch_);
+    ret->output_schema_ = std::move(node->output_schema_);
+    ret->table_bitset_ = std::move(node->table_bitset_);
+    return ret;
+  }
+
+ private:
+  /* The sort keys of an OrderBy are the first output expressions of its
+   * child, and are followed by the output columns. The rows are sorted by
+   * the output columns if the sort keys before the last of them are output
+   * columns too. */
+  static bool SortedByAllColumns(const PlanNode* node) {
+    if (node->type_ != PlanType::Order)
+      return false;
+    auto order = static_cast<const OrderByPlanNode*>(node);
+    auto ch = order->ch_.get();
+    const std::vector<std::unique_ptr<Expr>>* exprs = nullptr;
+    if (ch->type_ == PlanType::Project)
+      exprs = &static_cast<const ProjectPlanNode*>(ch)->output_exprs_;
+    else if (ch->type_ == PlanType::Aggregate)
+      exprs = &static_cast<const AggregatePlanNode*>(ch)->output_exprs_;
+    else
+      return false;
+    size_t offset = order->order_by_offset_;
+    std::set<std::string> columns;
+    for (size_t i = offset; i < exprs->size(); i++)
+      columns.insert((*exprs)[i]->ToString());
+    for (size_t j = 0; j < offset && !columns.empty(); j++) {
+      auto key = (*exprs)[j]->ToString();
+      bool is_column = false;
+      for (size_t i = offset; i < exprs->size() && !is_column; i++)
+        is_column = (*exprs)[i]->ToString() == key;
+      if (!is_column)
+        return false;
+      columns.erase(key);
+    }
+    return columns.empty();
+  }
+};
+
+}  // namespace wing
+
+#endif
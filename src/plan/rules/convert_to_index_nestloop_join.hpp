@@ -0,0 +1,88 @@
+#ifndef SAKURA_CONVERT_TO_INDEX_NESTLOOP_JOIN_H__
+#define SAKURA_CONVERT_TO_INDEX_NESTLOOP_JOIN_H__
+
+#include "plan/rules/convert_to_merge_sort_join.hpp"
+
+namespace wing {
+
+/**
+ * If the right child of a join is a scan, and the join has an equality of its
+ * primary key and an expression of the left child, the rows of the right
+ * child can be found by searching the B+tree of the table for each left row.
+ * For example,
+ * select * from A, B where A.b_id = B.id;
+ *
+ * The predicate of the scan is checked on the rows found. A range scan keeps
+ * the predicates of its range, so they are checked too.
+ *
+ * It is only better than a hash join if the left child is much smaller than
+ * the table, so the cost based optimizer decides which joins are converted,
+ * and passes their table bitsets.
+ */
+class ConvertToIndexNestloopJoinRule : public OptRule {
+ public:
+  ConvertToIndexNestloopJoinRule(const DB& db, std::vector<BitVector> joins)
+    : db_(db), joins_(std::move(joins)) {}
+  bool Match(const PlanNode* node) override {
+    if (node->type_ != PlanType::Join)
+      return false;
+    auto t_node = static_cast<const JoinPlanNode*>(node);
+    for (auto& a : joins_)
+      if (!(a ^ node->table_bitset_))
+        return Check(t_node->ch_.get(), t_node->ch2_.get(), t_node->predicate_);
+    return false;
+  }
+  bool Check(const PlanNode* c1, const PlanNode* c2, const PredicateVec& pred) {
+    return FindKey(c1, c2, pred) != nullptr;
+  }
+  std::unique_ptr<PlanNode> Transform(std::unique_ptr<PlanNode> node) override {
+    auto t_node = static_cast<JoinPlanNode*>(node.get());
+    auto ret = std::make_unique<IndexNestloopJoinPlanNode>();
+    ret->left_key_ =
+        FindKey(t_node->ch_.get(), t_node->ch2_.get(), t_node->predicate_)
+            ->clone();
+    ret->predicate_ = std::move(t_node->predicate_);
+    ret->ch_ = std::move(t_node->ch_);
+    ret->ch2_ = std::move(t_node->ch2_);
+    ret->output_schema_ = std::move(node->output_schema_);
+    ret->table_bitset_ = std::move(node->table_bitset_);
+    return ret;
+  }
+
+ private:
+  /* The expression of c1 in an equality of "pred" with the primary key of c2,
+   * or nullptr if there is none. */
+  const Expr* FindKey(
+      const PlanNode* c1, const PlanNode* c2, const PredicateVec& pred) const {
+    auto pk = ScanPrimaryKey(db_, c2);
+    if (!pk)
+      return nullptr;
+    auto is_pk = [&](const Expr* e) {
+      return e->type_ == ExprType::COLUMN &&
+             static_cast<const ColumnExpr*>(e)->id_in_column_name_table_ == pk;
+    };
+    // The tables of the expression must be in c1.
+    auto in_c1 = [&](const BitVector& bits) {
+      return bits && !((bits | c1->table_bitset_) ^ c1->table_bitset_);
+    };
+    for (auto& a : pred.GetVec()) {
+      if (a.expr_->op_ != OpType::EQ)
+        continue;
+      const Expr *l = a.expr_->ch0_.get(), *r = a.expr_->ch1_.get();
+      if (l->ret_type_ != r->ret_type_)
+        continue;
+      if (is_pk(r) && in_c1(a.left_bits_))
+        return l;
+      if (is_pk(l) && in_c1(a.right_bits_))
+        return r;
+    }
+    return nullptr;
+  }
+
+  const DB& db_;
+  std::vector<BitVector> joins_;
+};
+
+}  // namespace wing
+
+#endif
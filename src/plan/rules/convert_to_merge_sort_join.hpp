@@ -0,0 +1,101 @@
+#ifndef SAKURA_CONVERT_TO_MERGE_SORT_JOIN_H__
+#define SAKURA_CONVERT_TO_MERGE_SORT_JOIN_H__
+
+#include <optional>
+
+#include "catalog/db.hpp"
+#include "functions/functions.hpp"
+#include "plan/rules/rule.hpp"
+
+namespace wing {
+
+/* The id of the primary key column in the output of "node" if it is a scan.
+ * The scan returns the rows in ascending order of it. */
+inline std::optional<uint32_t> ScanPrimaryKey(
+    const DB& db, const PlanNode* node) {
+  const std::string* table_name;
+  if (node->type_ == PlanType::SeqScan)
+    table_name = &static_cast<const SeqScanPlanNode*>(node)->table_name_;
+  else if (node->type_ == PlanType::RangeScan)
+    table_name = &static_cast<const RangeScanPlanNode*>(node)->table_name_;
+  else
+    return std::nullopt;
+  // A hidden primary key is not in the output.
+  auto pk = get_pk_from_table_name(db, *table_name);
+  for (auto& col : node->output_schema_.GetCols())
+    if (col.column_name_ == pk)
+      return col.id_;
+  return std::nullopt;
+}
+
+/**
+ * Tables are stored in B+trees by their primary keys, so scans return tuples
+ * in ascending order of the primary keys. If a join has an equality of the
+ * primary keys of two scans, it is converted to a merge sort join, which
+ * merges the two sorted inputs without building a hash table. For example,
+ * select * from A, B where A.id = B.id;
+ *
+ * The primary keys must have the same type, so that the order of the values
+ * is the same. Other predicates are checked on the joined rows.
+ */
+class ConvertToMergeSortJoinRule : public OptRule {
+ public:
+  ConvertToMergeSortJoinRule(const DB& db) : db_(db) {}
+  bool Match(const PlanNode* node) override {
+    if (node->type_ == PlanType::Join) {
+      auto t_node = static_cast<const JoinPlanNode*>(node);
+      return Check(t_node->ch_.get(), t_node->ch2_.get(), t_node->predicate_);
+    }
+    return false;
+  }
+  bool Check(const PlanNode* c1, const PlanNode* c2, const PredicateVec& pred) {
+    return FindKeys(c1, c2, pred).first != nullptr;
+  }
+  std::unique_ptr<PlanNode> Transform(std::unique_ptr<PlanNode> node) override {
+    auto t_node = static_cast<JoinPlanNode*>(node.get());
+    auto ret = std::make_unique<MergeSortJoinPlanNode>();
+    auto [left, right] =
+        FindKeys(t_node->ch_.get(), t_node->ch2_.get(), t_node->predicate_);
+    ret->left_merge_key_ = left->clone();
+    ret->right_merge_key_ = right->clone();
+    ret->predicate_ = std::move(t_node->predicate_);
+    ret->ch_ = std::move(t_node->ch_);
+    ret->ch2_ = std::move(t_node->ch2_);
+    ret->output_schema_ = std::move(node->output_schema_);
+    ret->table_bitset_ = std::move(node->table_bitset_);
+    return ret;
+  }
+
+ private:
+  /* The keys of c1 and c2 in an equality of "pred" by which they are sorted,
+   * or nullptr if there is none. */
+  std::pair<const Expr*, const Expr*> FindKeys(
+      const PlanNode* c1, const PlanNode* c2, const PredicateVec& pred) const {
+    auto k1 = ScanPrimaryKey(db_, c1), k2 = ScanPrimaryKey(db_, c2);
+    if (!k1 || !k2)
+      return {nullptr, nullptr};
+    auto id = [](const Expr* e) -> std::optional<uint32_t> {
+      if (e->type_ != ExprType::COLUMN)
+        return std::nullopt;
+      return static_cast<const ColumnExpr*>(e)->id_in_column_name_table_;
+    };
+    for (auto& a : pred.GetVec()) {
+      if (a.expr_->op_ != OpType::EQ)
+        continue;
+      const Expr *l = a.expr_->ch0_.get(), *r = a.expr_->ch1_.get();
+      if (l->ret_type_ != r->ret_type_)
+        continue;
+      if (id(l) == k1 && id(r) == k2)
+        return {l, r};
+      if (id(l) == k2 && id(r) == k1)
+        return {r, l};
+    }
+    return {nullptr, nullptr};
+  }
+
+  const DB& db_;
+};
+
+}  // namespace wing
+
+#endif
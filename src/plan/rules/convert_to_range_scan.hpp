@@ -36,9 +36,8 @@ public:
 		Rs->range_l_=r.first; Rs->range_r_=r.second;
 		return rs;
 	}
-private:
-	DB& db;
 	typedef std::pair<Field,bool> bound;
+	// The range of the key "column_name" in "predicate". It is also used to bind the parameters of a cached plan.
 	static std::pair<bound,bound> get_bound(const PredicateVec &predicate,const std::string &column_name)
 	{
 		std::pair<bound,bound> r;
@@ -58,6 +57,8 @@ private:
 		}
 		return r;
 	}
+private:
+	DB& db;
 };
 }
 #endif
\ No newline at end of file
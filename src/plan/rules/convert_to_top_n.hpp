@@ -0,0 +1,48 @@
+#ifndef SAKURA_CONVERT_TO_TOP_N_H__
+#define SAKURA_CONVERT_TO_TOP_N_H__
+
+#include "plan/rules/rule.hpp"
+
+namespace wing {
+
+/**
+ * A Limit over an OrderBy only needs the first offset + limit rows of the
+ * sorted input. So it is converted to a TopN, which keeps them in a bounded
+ * heap instead of sorting all the input. For example,
+ * select * from A order by A.a asc limit 10;
+ *
+ * If offset + limit is large, the heap does not fit in the cache, and the
+ * OrderBy is kept, which may spill to disk.
+ */
+class ConvertToTopNRule : public OptRule {
+ public:
+  bool Match(const PlanNode* node) override {
+    if (node->type_ == PlanType::Limit &&
+        node->ch_->type_ == PlanType::Order) {
+      auto t_node = static_cast<const LimitPlanNode*>(node);
+      return t_node->limit_size_ <= MAX_ROWS &&
+             t_node->offset_ <= MAX_ROWS - t_node->limit_size_;
+    }
+    return false;
+  }
+  std::unique_ptr<PlanNode> Transform(std::unique_ptr<PlanNode> node) override {
+    auto t_node = static_cast<LimitPlanNode*>(node.get());
+    auto order = static_cast<OrderByPlanNode*>(t_node->ch_.get());
+    auto ret = std::make_unique<TopNPlanNode>();
+    ret->order_by_exprs_ = std::move(order->order_by_exprs_);
+    ret->order_by_offset_ = order->order_by_offset_;
+    ret->limit_size_ = t_node->limit_size_;
+    ret->offset_ = t_node->offset_;
+    ret->ch_ = std::move(order->ch_);
+    ret->output_schema_ = std::move(node->output_schema_);
+    ret->table_bitset_ = std::move(node->table_bitset_);
+    return ret;
+  }
+
+ private:
+  static constexpr size_t MAX_ROWS = 1 << 16;
+};
+
+}  // namespace wing
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef SAKURA_PRUNE_COLUMNS_H__
+#define SAKURA_PRUNE_COLUMNS_H__
+
+#include <unordered_set>
+
+#include "plan/expr_utils.hpp"
+#include "plan/rules/rule.hpp"
+
+namespace wing {
+
+/**
+ * A scan outputs raw rows, which have all columns of the table. Joins
+ * deserialize all of them, and hash joins copy them with all their strings,
+ * even if the query only uses a few columns. For example,
+ * select A.b from A, B where A.id = B.a_id;
+ *
+ * This rule finds the columns that each node needs from its children, from
+ * the root down. A scan under a join only outputs the columns needed above
+ * it. Its predicate is still evaluated on the raw rows, and the other columns
+ * are deserialized only from the rows that pass it, so a wide string that is
+ * not needed is never read.
+ *
+ * Scans that are not under a join are not pruned, because the operators above
+ * them read the columns of the raw rows in place. The scan of an index
+ * nested-loop join is not executed, so it is not pruned either.
+ *
+ * It matches projections and aggregations. It is applied after the joins are
+ * converted to physical joins, and it can be applied again.
+ */
+class PruneColumnsRule : public OptRule {
+ public:
+  bool Match(const PlanNode* node) override {
+    return node->type_ == PlanType::Project ||
+           node->type_ == PlanType::Aggregate;
+  }
+  std::unique_ptr<PlanNode> Transform(std::unique_ptr<PlanNode> node) override {
+    Prune(node.get(), {}, false);
+    return node;
+  }
+
+ private:
+  using ColumnSet = std::unordered_set<uint32_t>;
+
+  static void Add(ColumnSet& columns, const Expr* expr) {
+    if (expr == nullptr)
+      return;
+    std::vector<uint32_t> ids;
+    ExprUtils::GetExprColumnIds(expr, ids);
+    columns.insert(ids.begin(), ids.end());
+  }
+  static void Add(ColumnSet& columns, const PredicateVec& pred) {
+    for (auto& a : pred.GetVec())
+      Add(columns, a.expr_.get());
+  }
+  static void Add(
+      ColumnSet& columns, const std::vector<std::unique_ptr<Expr>>& exprs) {
+    for (auto& a : exprs)
+      Add(columns, a.get());
+  }
+  static ColumnSet AllColumns(const OutputSchema& schema) {
+    ColumnSet ret;
+    for (auto& col : schema.GetCols())
+      ret.insert(col.id_);
+    return ret;
+  }
+
+  /* Prune the columns of "node" that are not in "required". "under_join" is
+   * whether the output of the node goes to a join. The output schema of the
+   * node is updated if its children are pruned. */
+  static void Prune(PlanNode* node, ColumnSet required, bool under_join) {
+    switch (node->type_) {
+      case PlanType::Project: {
+        ColumnSet columns;
+        Add(columns, static_cast<ProjectPlanNode*>(node)->output_exprs_);
+        Prune(node->ch_.get(), std::move(columns), false);
+        return;
+      }
+      case PlanType::Aggregate: {
+        auto t_node = static_cast<AggregatePlanNode*>(node);
+        ColumnSet columns;
+        Add(columns, t_node->output_exprs_);
+        Add(columns, t_node->group_by_exprs_);
+        Add(columns, t_node->group_predicate_);
+        Prune(node->ch_.get(), std::move(columns), false);
+        return;
+      }
+      case PlanType::Filter:
+        Add(required, static_cast<FilterPlanNode*>(node)->predicate_);
+        Prune(node->ch_.get(), std::move(required), under_join);
+        node->output_schema_ = node->ch_->output_schema_;
+        return;
+      case PlanType::Join:
+        Add(required, static_cast<JoinPlanNode*>(node)->predicate_);
+        PruneJoin(node, std::move(required));
+        return;
+      case PlanType::HashJoin: {
+        auto t_node = static_cast<HashJoinPlanNode*>(node);
+        Add(required, t_node->predicate_);
+        Add(required, t_node->left_hash_exprs_);
+        Add(required, t_node->right_hash_exprs_);
+        PruneJoin(node, std::move(required));
+        return;
+      }
+      case PlanType::MergeSortJoin: {
+        auto t_node = static_cast<MergeSortJoinPlanNode*>(node);
+        Add(required, t_node->predicate_);
+        Add(required, t_node->left_merge_key_.get());
+        Add(required, t_node->right_merge_key_.get());
+        PruneJoin(node, std::move(required));
+        return;
+      }
+      case PlanType::IndexNestloopJoin: {
+        auto t_node = static_cast<IndexNestloopJoinPlanNode*>(node);
+        Add(required, t_node->predicate_);
+        Add(required, t_node->left_key_.get());
+        Prune(node->ch_.get(), std::move(required), true);
+        node->output_schema_ = OutputSchema::Concat(
+            node->ch_->output_schema_, node->ch2_->output_schema_);
+        return;
+      }
+      case PlanType::SeqScan:
+        if (under_join)
+          PruneScan(node, static_cast<SeqScanPlanNode*>(node)->table_schema_,
+              required);
+        return;
+      case PlanType::RangeScan:
+        if (under_join)
+          PruneScan(node,
+              static_cast<RangeScanPlanNode*>(node)->table_schema_, required);
+        return;
+      case PlanType::Order:
+      case PlanType::TopN:
+      case PlanType::Limit:
+      case PlanType::Distinct:
+      case PlanType::HashDistinct:
+        // The output is the output of the child.
+        Prune(node->ch_.get(), AllColumns(node->ch_->output_schema_), false);
+        return;
+      default:
+        // Insert, delete and update need the raw rows.
+        return;
+    }
+  }
+
+  static void PruneJoin(PlanNode* node, ColumnSet required) {
+    Prune(node->ch_.get(), required, true);
+    Prune(node->ch2_.get(), std::move(required), true);
+    node->output_schema_ = OutputSchema::Concat(
+        node->ch_->output_schema_, node->ch2_->output_schema_);
+  }
+
+  static void PruneScan(
+      PlanNode* node, OutputSchema& table_schema, const ColumnSet& required) {
+    OutputSchema output;
+    for (auto& col : node->output_schema_.GetCols())
+      if (required.count(col.id_))
+        output.Append(col);
+    // A row has at least one column.
+    if (output.Size() == 0)
+      output.Append(node->output_schema_[0]);
+    if (output.Size() == node->output_schema_.Size())
+      return;
+    if (table_schema.Size() == 0)
+      table_schema = std::move(node->output_schema_);
+    node->output_schema_ = std::move(output);
+  }
+};
+
+}  // namespace wing
+
+#endif
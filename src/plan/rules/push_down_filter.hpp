@@ -42,6 +42,7 @@ static bool is_query_plan(const PlanNode* node)
 	       node->type_ == PlanType::Aggregate ||
 	       node->type_ == PlanType::Order ||
 	       node->type_ == PlanType::Distinct ||
+	       node->type_ == PlanType::HashDistinct ||
 	       node->type_ == PlanType::Filter ||
 	       node->type_ == PlanType::Join ||
 	       node->type_ == PlanType::SeqScan || 
@@ -62,6 +63,7 @@ class PushDownFilterRule : public OptRule {
 	std::unique_ptr<PlanNode> Transform(std::unique_ptr<PlanNode> node) override {
 		auto t_node = static_cast<FilterPlanNode*>(node.get());
 		if (t_node->ch_->type_ == PlanType::Distinct ||
+				t_node->ch_->type_ == PlanType::HashDistinct ||
 				t_node->ch_->type_ == PlanType::Order) {
 			auto ch = std::move(t_node->ch_);
 			t_node->ch_ = std::move(ch->ch_);
@@ -4,6 +4,8 @@
 #include <compare>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
+#include <unordered_set>
 
 #include "blob.hpp"
 #include "bplus-tree.hpp"
@@ -12,6 +14,7 @@
 #include "storage.hpp"
 #include "transaction/lock_manager.hpp"
 #include "transaction/lock_mode.hpp"
+#include "transaction/log_manager.hpp"
 #include "transaction/txn_manager.hpp"
 
 namespace wing {
@@ -82,6 +85,9 @@ class BPlusTreeTable : public AbstractBPlusTreeTable {
       std::string_view tuple = ret.value().second;
       return reinterpret_cast<const uint8_t*>(tuple.data());
     }
+    size_t NextBatch(const uint8_t** out, size_t max) override {
+      return ReadBatch(*this, iter_, out, max);
+    }
 
    private:
     bool first_flag_;
@@ -116,6 +122,9 @@ class BPlusTreeTable : public AbstractBPlusTreeTable {
       }
       return reinterpret_cast<const uint8_t*>(tuple.data());
     }
+    size_t NextBatch(const uint8_t** out, size_t max) override {
+      return ReadBatch(*this, iter_, out, max);
+    }
 
    private:
     bool first_flag_;
@@ -132,6 +141,8 @@ class BPlusTreeTable : public AbstractBPlusTreeTable {
       ctx_->lock_manager_->AcquireTupleLock(table_name,key,LockMode::X,p);
       p->modify_records_.push(ModifyRecord(ModifyType::DELETE,table_name,key,table_.Get(key)));
       // P4 DONE
+      std::shared_lock cl(table_.log_->CheckpointLatch());
+      table_.log_->AppendModify(p->txn_id_,ModifyType::DELETE,table_name,key,{});
       return table_.Delete(key);
     }
     bool Insert(std::string_view key, std::string_view value) override {
@@ -139,6 +150,8 @@ class BPlusTreeTable : public AbstractBPlusTreeTable {
       ctx_->lock_manager_->AcquireTupleLock(table_name,key,LockMode::X,p);
       p->modify_records_.push(ModifyRecord(ModifyType::INSERT,table_name,key,std::nullopt));
       // P4 DONE
+      std::shared_lock cl(table_.log_->CheckpointLatch());
+      table_.log_->AppendModify(p->txn_id_,ModifyType::INSERT,table_name,key,value);
       return table_.Insert(key, value);
     }
     bool Update(std::string_view key, std::string_view value) override {
@@ -146,6 +159,8 @@ class BPlusTreeTable : public AbstractBPlusTreeTable {
       ctx_->lock_manager_->AcquireTupleLock(table_name,key,LockMode::X,p);
       p->modify_records_.push(ModifyRecord(ModifyType::UPDATE,table_name,key,table_.Get(key)));
       // P4 DONE
+      std::shared_lock cl(table_.log_->CheckpointLatch());
+      table_.log_->AppendModify(p->txn_id_,ModifyType::UPDATE,table_name,key,value);
       return table_.Update(key, value);
     }
 
@@ -169,34 +184,102 @@ class BPlusTreeTable : public AbstractBPlusTreeTable {
       last_ = std::move(ret.value());
       return reinterpret_cast<const uint8_t*>(last_.data());
     }
+    void SearchSorted(
+        const std::string_view* keys, size_t n, const uint8_t** out) override {
+      std::string_view table_name = std::string_view(ctx_->table_name_);
+      Txn* p = TxnManager::GetTxn(ctx_->txn_id_).value();
+      std::unique_lock lock(p->rw_latch_);
+      // A table lock which covers reading the whole table makes tuple locks
+      // unnecessary.
+      bool covered = false;
+      for (auto mode : {LockMode::S, LockMode::X, LockMode::SIX})
+        covered |= p->table_lock_set_[mode].count(std::string(table_name)) > 0;
+      if (!covered) {
+        for (size_t i = 0; i < n; i++)
+          ctx_->lock_manager_->AcquireTupleLock(
+              table_name, keys[i], LockMode::S, p);
+      }
+      if (batch_.size() < n)
+        batch_.resize(n);
+      std::fill(out, out + n, nullptr);
+      // The leaves are unpinned after the search, so the rows are copied.
+      tree_.GetSorted(keys, n, [&](size_t i, std::string_view value) {
+        batch_[i].assign(value);
+        out[i] = reinterpret_cast<const uint8_t*>(batch_[i].data());
+      });
+    }
 
    private:
     tree_t& tree_;
     std::unique_ptr<TxnExecCtx> ctx_;
     std::string last_;
+    std::vector<std::string> batch_;
     friend class BPlusTreeTable<KeyCompare>;
   };
 
+  /* Morsel i is [keys[i - 1], keys[i]). The first morsel starts at L, and the
+   * last morsel ends at R.
+   */
+  class MorselSource : public wing::MorselSource {
+   public:
+    MorselSource(BPlusTreeTable& table,
+        std::tuple<std::string_view, bool, bool> L,
+        std::tuple<std::string_view, bool, bool> R,
+        std::vector<std::string>&& keys, size_t readahead)
+      : table_(table),
+        L_(std::get<0>(L), std::get<1>(L), std::get<2>(L)),
+        R_(std::get<0>(R), std::get<1>(R), std::get<2>(R)),
+        keys_(std::move(keys)),
+        readahead_(readahead) {}
+    std::unique_ptr<wing::Iterator<const uint8_t*>> Next() override {
+      size_t i = next_.fetch_add(1, std::memory_order_relaxed);
+      if (i > keys_.size())
+        return nullptr;
+      using Bound = std::tuple<std::string_view, bool, bool>;
+      auto view = [](const auto& b) {
+        return Bound(std::get<0>(b), std::get<1>(b), std::get<2>(b));
+      };
+      Bound L = i == 0 ? view(L_) : Bound(keys_[i - 1], false, true);
+      Bound R = i == keys_.size() ? view(R_) : Bound(keys_[i], false, false);
+      return table_.GetRangeIterator(L, R, readahead_);
+    }
+
+   private:
+    BPlusTreeTable& table_;
+    std::tuple<std::string, bool, bool> L_, R_;
+    std::vector<std::string> keys_;
+    size_t readahead_;
+    std::atomic<size_t> next_{0};
+  };
+
   BPlusTreeTable(const BPlusTreeTable&) = delete;
   BPlusTreeTable& operator=(const BPlusTreeTable&) = delete;
   BPlusTreeTable(BPlusTreeTable&& table)
-    : schema_(std::move(table.schema_)), tree_(std::move(table.tree_)) {}
+    : schema_(std::move(table.schema_)),
+      tree_(std::move(table.tree_)),
+      log_(table.log_) {}
   BPlusTreeTable& operator=(BPlusTreeTable&& rhs) {
     schema_ = std::move(rhs.schema_);
     tree_ = std::move(rhs.tree_);
+    log_ = rhs.log_;
     return *this;
   }
   void Drop() { tree_.Destroy(); }
   Iterator Begin() { return Iterator(tree_.Begin()); }
-  std::unique_ptr<wing::Iterator<const uint8_t*>> GetIterator() {
-    return std::make_unique<Iterator>(tree_.Begin());
+  // readahead: the number of leaves to read ahead. 0 disables read-ahead.
+  std::unique_ptr<wing::Iterator<const uint8_t*>> GetIterator(
+      size_t readahead = 0) {
+    auto iter = tree_.Begin();
+    iter.SetReadAhead(readahead);
+    return std::make_unique<Iterator>(std::move(iter));
   }
   auto GetRangeIterator(std::tuple<std::string_view, bool, bool> L,
-      std::tuple<std::string_view, bool, bool> R)
+      std::tuple<std::string_view, bool, bool> R, size_t readahead = 0)
       -> std::unique_ptr<wing::Iterator<const uint8_t*>> {
     auto iter = std::get<1>(L)   ? tree_.Begin()
                 : std::get<2>(L) ? tree_.LowerBound(std::get<0>(L))
                                  : tree_.UpperBound(std::get<0>(L));
+    iter.SetReadAhead(readahead);
     if (std::get<1>(R)) {
       // right is empty. i.e. not limited.
       return std::make_unique<RangeIterator<false, true>>(
@@ -211,6 +294,22 @@ class BPlusTreeTable : public AbstractBPlusTreeTable {
           std::move(iter), std::string(std::get<0>(R)));
     }
   }
+  /* Split the range into at most "n" morsels of about the same number of
+   * leaves. The bounds are the same as GetRangeIterator.
+   */
+  auto GetMorsels(std::tuple<std::string_view, bool, bool> L,
+      std::tuple<std::string_view, bool, bool> R, size_t n,
+      size_t readahead = 0) -> std::unique_ptr<wing::MorselSource> {
+    std::vector<std::string> keys;
+    tree_.split_keys(n, keys);
+    // Keep the keys strictly inside the range.
+    std::erase_if(keys, [&](const std::string& key) {
+      return (!std::get<1>(L) && KeyCompare()(key, std::get<0>(L)) <= 0) ||
+             (!std::get<1>(R) && KeyCompare()(key, std::get<0>(R)) >= 0);
+    });
+    return std::make_unique<MorselSource>(
+        *this, L, R, std::move(keys), readahead);
+  }
 
   bool Delete(std::string_view key) { return tree_.Delete(key); }
   std::optional<std::string> Get(std::string_view key) {
@@ -238,12 +337,30 @@ class BPlusTreeTable : public AbstractBPlusTreeTable {
   std::optional<std::string_view> GetMaxKey() { return tree_.MaxKey(); }
   size_t GetTicks() { return ticks_; }
   const TableSchema& GetTableSchema() { return schema_; }
-  BPlusTreeTable(TableSchema&& schema, tree_t&& tree)
-    : schema_(std::move(schema)), tree_(std::move(tree)) {}
+  BPlusTreeTable(TableSchema&& schema, tree_t&& tree, LogManager* log)
+    : schema_(std::move(schema)), tree_(std::move(tree)), log_(log) {}
 
  private:
+  /* Read a batch of tuples with "it", which reads the tree with "iter". The
+   * leaves of the batch are kept pinned until the next batch is read, because
+   * the tuples point into them.
+   */
+  template <typename It>
+  static size_t ReadBatch(
+      It& it, typename tree_t::Iter& iter, const uint8_t** out, size_t max) {
+    iter.ReleaseKeptPages();
+    iter.KeepPages(true);
+    size_t num = 0;
+    while (num < max && (out[num] = it.It::Next()))
+      num += 1;
+    iter.KeepPages(false);
+    return num;
+  }
+
   TableSchema schema_;
   tree_t tree_;
+  // Modifications through ModifyHandle are logged here.
+  LogManager* log_;
   std::atomic<size_t> ticks_;
   friend class BPlusTreeStorage;
 };
@@ -261,13 +378,37 @@ struct TableMetaPages {
 
 class BPlusTreeStorage {
  public:
+  /* The write-ahead log is kept in "<path>.wal". If the database was not
+   * closed cleanly, it is recovered with the log: the file is restored to the
+   * last checkpoint with the page images in the log, and then the DDL and the
+   * modifications of committed txns after the checkpoint are redone. See
+   * LogManager for details.
+   */
   static auto Open(std::filesystem::path&& path, bool create_if_missing,
       size_t max_buf_pages) -> Result<BPlusTreeStorage, io::Error> {
     if (!std::filesystem::exists(path)) {
       if (create_if_missing)
         return Create(std::move(path), max_buf_pages);
     }
+    std::vector<LogRecord> records;
+    auto log = EXTRACT_RESULT(LogManager::Open(LogPath(path), records));
+    // Nothing to recover if the log only has the checkpoint, i.e., the
+    // database was closed cleanly. A log without a checkpoint is empty.
+    bool recover =
+        records.size() > 1 && records[0].type_ == LogRecordType::CHECKPOINT;
+    if (recover) {
+      std::vector<std::pair<pgid_t, std::string_view>> images;
+      for (const auto& record : records) {
+        if (record.type_ == LogRecordType::PAGE_IMAGE)
+          images.emplace_back(record.pgid_, record.value_);
+      }
+      auto ret = PageManager::Restore(path, images, records[0].pgid_);
+      if (ret.has_value())
+        return std::move(ret.value());
+    }
     auto pgm = EXTRACT_RESULT(PageManager::Open(path, max_buf_pages));
+    pgm->SetJournal(log.get());
+    pgm->ResetJournal();
     pgid_t meta;
     pgm->GetPlainPage(pgm->SuperPageID()).Read(&meta, 0, sizeof(meta));
     // Table B+Tree use StringKeyCompare by default.
@@ -288,14 +429,44 @@ class BPlusTreeStorage {
       db_schema.AddTable(schema);
       it.Next();
     }
-    return BPlusTreeStorage(
-        std::move(pgm), std::move(map), std::move(db_schema));
+    auto storage = BPlusTreeStorage(std::move(log), std::move(pgm),
+        std::move(map), std::move(db_schema));
+    if (recover)
+      storage.Redo(records);
+    // Start a new log.
+    storage.Checkpoint();
+    return std::move(storage);
+  }
+  BPlusTreeStorage(BPlusTreeStorage&&) = default;
+  ~BPlusTreeStorage() {
+    if (pgm_ == nullptr)
+      return;
+    // Nothing has to be recovered if the checkpoint succeeds.
+    if (Checkpoint())
+      pgm_->SetJournal(nullptr);
+  }
+  /* Flush all pages and start a new log. Return false without doing anything
+   * if there is an unfinished txn that has modified something.
+   */
+  bool Checkpoint() {
+    std::unique_lock l(log_->CheckpointLatch());
+    return CheckpointLocked();
   }
+  // Take a checkpoint if the log is large and nothing is being modified.
+  void MaybeCheckpoint() {
+    if (log_->Size() < CHECKPOINT_LOG_SIZE)
+      return;
+    std::unique_lock l(log_->CheckpointLatch(), std::try_to_lock);
+    if (l.owns_lock())
+      CheckpointLocked();
+  }
+  LogManager::Stats GetLogStats() { return log_->GetStats(); }
+
   auto GetIterator(std::string_view table_name)
       -> std::unique_ptr<Iterator<const uint8_t*>> {
     return ApplyFuncOnTable<std::unique_ptr<Iterator<const uint8_t*>>>(
         GetPKType(table_name), GetTable(table_name),
-        [](auto a) { return a->GetIterator(); });
+        [this](auto a) { return a->GetIterator(readahead_); });
   }
 
   auto GetRangeIterator(std::string_view table_name,
@@ -304,8 +475,25 @@ class BPlusTreeStorage {
       -> std::unique_ptr<Iterator<const uint8_t*>> {
     return ApplyFuncOnTable<std::unique_ptr<Iterator<const uint8_t*>>>(
         GetPKType(table_name), GetTable(table_name),
-        [&L, &R](auto a) { return a->GetRangeIterator(L, R); });
+        [&L, &R, this](auto a) {
+          return a->GetRangeIterator(L, R, readahead_);
+        });
   }
+  auto GetMorsels(std::string_view table_name,
+      std::tuple<std::string_view, bool, bool> L,
+      std::tuple<std::string_view, bool, bool> R, size_t n)
+      -> std::unique_ptr<MorselSource> {
+    return ApplyFuncOnTable<std::unique_ptr<MorselSource>>(
+        GetPKType(table_name), GetTable(table_name),
+        [&L, &R, n, this](auto a) {
+          return a->GetMorsels(L, R, n, readahead_);
+        });
+  }
+  /* Set the number of leaves to read ahead for table iterators created
+   * afterwards. 0 (the default) disables read-ahead.
+   */
+  void SetReadAhead(size_t readahead) { readahead_ = readahead; }
+  PageManager::Stats GetBufferStats() { return pgm_->GetStats(); }
 
   std::unique_ptr<wing::ModifyHandle> GetModifyHandle(
       std::unique_ptr<TxnExecCtx> ctx) {
@@ -320,6 +508,124 @@ class BPlusTreeStorage {
         [&ctx](auto a) { return a->GetSearchHandle(std::move(ctx)); });
   }
   std::optional<io::Error> Create(const TableSchema& schema) {
+    std::shared_lock l(log_->CheckpointLatch());
+    log_->Flush(log_->Append(LogRecord{
+        .type_ = LogRecordType::CREATE_TABLE,
+        .table_name_ = std::string(schema.GetName()),
+        .value_ = serde::bin_stream::to_string(schema),
+    }));
+    return DoCreate(schema);
+  }
+  std::optional<io::Error> Drop(std::string_view table_name) {
+    std::shared_lock l(log_->CheckpointLatch());
+    log_->Flush(log_->Append(LogRecord{
+        .type_ = LogRecordType::DROP_TABLE,
+        .table_name_ = std::string(table_name),
+    }));
+    return DoDrop(table_name);
+  }
+  size_t TupleNum(std::string_view table_name) {
+    return ApplyFuncOnTable<size_t>(GetPKType(table_name), GetTable(table_name),
+        [](auto a) { return a->TupleNum(); });
+  }
+  std::optional<std::string_view> GetMaxKey(std::string_view table_name) {
+    return ApplyFuncOnTable<std::optional<std::string_view>>(
+        GetPKType(table_name), GetTable(table_name),
+        [](auto a) { return a->GetMaxKey(); });
+  }
+  size_t GetTicks(std::string_view table_name) {
+    return ApplyFuncOnTable<size_t>(GetPKType(table_name), GetTable(table_name),
+        [](auto a) { return a->GetTicks(); });
+  }
+  const DBSchema& GetDBSchema() const { return schema_; }
+
+ private:
+  // Take a checkpoint if the log is larger than this.
+  static constexpr size_t CHECKPOINT_LOG_SIZE = 64 << 20;
+
+  BPlusTreeStorage(std::unique_ptr<LogManager> log,
+      std::unique_ptr<PageManager> pgm, BPlusTree<StringKeyCompare>&& map,
+      DBSchema&& db_schema)
+    : log_(std::move(log)),
+      pgm_(std::move(pgm)),
+      map_table_name_to_meta_pages_(std::move(map)),
+      schema_(std::move(db_schema)) {}
+  static auto Create(std::filesystem::path path, size_t max_buf_pages)
+      -> Result<BPlusTreeStorage, io::Error> {
+    // Create the log first, so that an old log never applies to the new file.
+    auto log = EXTRACT_RESULT(LogManager::Create(LogPath(path)));
+    auto pgm = PageManager::Create(path, max_buf_pages);
+    pgm->SetJournal(log.get());
+    auto map = BPlusTree<StringKeyCompare>::Create(*pgm);
+    pgid_t meta = map.MetaPageID();
+    pgm->GetPlainPage(pgm->SuperPageID())
+        .Write(0, std::string_view(
+                      reinterpret_cast<const char*>(&meta), sizeof(meta)));
+    auto storage = BPlusTreeStorage(
+        std::move(log), std::move(pgm), std::move(map), DBSchema{});
+    storage.Checkpoint();
+    return std::move(storage);
+  }
+  static std::filesystem::path LogPath(const std::filesystem::path& path) {
+    return path.string() + ".wal";
+  }
+  // Requires the checkpoint latch exclusively.
+  bool CheckpointLocked() {
+    if (log_->HasActiveTxns())
+      return false;
+    pgm_->Checkpoint();
+    log_->Reset(pgm_->PageNum());
+    pgm_->ResetJournal();
+    return true;
+  }
+  // Redo the DDL and the modifications of committed txns in the log.
+  void Redo(const std::vector<LogRecord>& records) {
+    std::unordered_set<txn_id_t> committed;
+    for (const auto& record : records) {
+      if (record.type_ == LogRecordType::COMMIT)
+        committed.insert(record.txn_id_);
+    }
+    size_t redone = 0;
+    for (const auto& record : records) {
+      switch (record.type_) {
+        case LogRecordType::CREATE_TABLE: {
+          auto schema = serde::bin_stream::from_string<TableSchema>(
+              std::string(record.value_));
+          if (schema.index() == 1)
+            DB_ERR("Corrupted schema of table {} in log", record.table_name_);
+          DoCreate(std::get<0>(schema));
+          break;
+        }
+        case LogRecordType::DROP_TABLE:
+          DoDrop(record.table_name_);
+          break;
+        case LogRecordType::INSERT:
+        case LogRecordType::DELETE:
+        case LogRecordType::UPDATE: {
+          if (committed.find(record.txn_id_) == committed.end() ||
+              !schema_.Find(record.table_name_).has_value())
+            break;
+          ApplyFuncOnTable<void>(GetPKType(record.table_name_),
+              GetTable(record.table_name_), [&record](auto a) {
+                if (record.type_ == LogRecordType::INSERT)
+                  a->Insert(record.key_, record.value_);
+                else if (record.type_ == LogRecordType::DELETE)
+                  a->Delete(record.key_);
+                else
+                  a->Update(record.key_, record.value_);
+              });
+          redone += 1;
+          break;
+        }
+        default:
+          break;
+      }
+    }
+    DB_INFO("Recovered from the log: {} committed txns, {} modifications "
+            "redone",
+        committed.size(), redone);
+  }
+  std::optional<io::Error> DoCreate(const TableSchema& schema) {
     auto table_name = schema.GetName();
     auto blob = Blob::Create(*pgm_);
     schema_.AddTable(schema);
@@ -358,7 +664,7 @@ class BPlusTreeStorage {
       DB_ERR("Invalid primary key type.");
     }
   }
-  std::optional<io::Error> Drop(std::string_view table_name) {
+  std::optional<io::Error> DoDrop(std::string_view table_name) {
     auto ret = map_table_name_to_meta_pages_.Take(table_name);
     if (!ret.has_value())
       return io::Error::from(io::ErrorKind::NotFound);
@@ -379,37 +685,6 @@ class BPlusTreeStorage {
     schema_.RemoveTable(table_name);
     return std::nullopt;
   }
-  size_t TupleNum(std::string_view table_name) {
-    return ApplyFuncOnTable<size_t>(GetPKType(table_name), GetTable(table_name),
-        [](auto a) { return a->TupleNum(); });
-  }
-  std::optional<std::string_view> GetMaxKey(std::string_view table_name) {
-    return ApplyFuncOnTable<std::optional<std::string_view>>(
-        GetPKType(table_name), GetTable(table_name),
-        [](auto a) { return a->GetMaxKey(); });
-  }
-  size_t GetTicks(std::string_view table_name) {
-    return ApplyFuncOnTable<size_t>(GetPKType(table_name), GetTable(table_name),
-        [](auto a) { return a->GetTicks(); });
-  }
-  const DBSchema& GetDBSchema() const { return schema_; }
-
- private:
-  BPlusTreeStorage(std::unique_ptr<PageManager> pgm,
-      BPlusTree<StringKeyCompare>&& map, DBSchema&& db_schema)
-    : pgm_(std::move(pgm)),
-      map_table_name_to_meta_pages_(std::move(map)),
-      schema_(std::move(db_schema)) {}
-  static auto Create(std::filesystem::path path, size_t max_buf_pages)
-      -> BPlusTreeStorage {
-    auto pgm = PageManager::Create(path, max_buf_pages);
-    auto map = BPlusTree<StringKeyCompare>::Create(*pgm);
-    pgid_t meta = map.MetaPageID();
-    pgm->GetPlainPage(pgm->SuperPageID())
-        .Write(0, std::string_view(
-                      reinterpret_cast<const char*>(&meta), sizeof(meta)));
-    return BPlusTreeStorage(std::move(pgm), std::move(map), DBSchema{});
-  }
   AbstractBPlusTreeTable* GetTable(std::string_view table_name) {
     auto it_find = cached_tables_.find(std::string(table_name));
     if (it_find != cached_tables_.end())
@@ -431,21 +706,22 @@ class BPlusTreeStorage {
     if (pk_type == FieldType::INT32 || pk_type == FieldType::INT64) {
       auto [it, succeed] = cached_tables_.emplace(std::string(table_name),
           std::make_unique<BPlusTreeTable<IntegerKeyCompare>>(std::move(schema),
-              BPlusTree<IntegerKeyCompare>::Open(*pgm_, meta.data)));
+              BPlusTree<IntegerKeyCompare>::Open(*pgm_, meta.data),
+              log_.get()));
       if (!succeed)
         DB_ERR("Concurrency issue?");
       return it->second.get();
     } else if (pk_type == FieldType::CHAR || pk_type == FieldType::VARCHAR) {
       auto [it, succeed] = cached_tables_.emplace(std::string(table_name),
           std::make_unique<BPlusTreeTable<StringKeyCompare>>(std::move(schema),
-              BPlusTree<StringKeyCompare>::Open(*pgm_, meta.data)));
+              BPlusTree<StringKeyCompare>::Open(*pgm_, meta.data), log_.get()));
       if (!succeed)
         DB_ERR("Concurrency issue?");
       return it->second.get();
     } else if (pk_type == FieldType::FLOAT64) {
       auto [it, succeed] = cached_tables_.emplace(std::string(table_name),
           std::make_unique<BPlusTreeTable<FloatKeyCompare>>(std::move(schema),
-              BPlusTree<FloatKeyCompare>::Open(*pgm_, meta.data)));
+              BPlusTree<FloatKeyCompare>::Open(*pgm_, meta.data), log_.get()));
       if (!succeed)
         DB_ERR("Concurrency issue?");
       return it->second.get();
@@ -487,15 +763,19 @@ class BPlusTreeStorage {
   std::unique_ptr<AbstractBPlusTreeTable> CreateBPlusTreeTable(
       TableSchema&& schema, BPlusTree<T>&& tree) const {
     return std::make_unique<BPlusTreeTable<T>>(
-        std::move(schema), std::move(tree));
+        std::move(schema), std::move(tree), log_.get());
   }
 
+  // Destructed after pgm_, which may journal pages when destructed.
+  std::unique_ptr<LogManager> log_;
   std::unique_ptr<PageManager> pgm_;
   // Table name -> TableMetaPages
   BPlusTree<StringKeyCompare> map_table_name_to_meta_pages_;
   std::unordered_map<std::string, std::unique_ptr<AbstractBPlusTreeTable>>
       cached_tables_;
   DBSchema schema_;
+  // The number of leaves to read ahead in table iterators.
+  size_t readahead_{0};
   friend class TxnManager;
 };
 
@@ -4,6 +4,7 @@
 #include "common/logging.hpp"
 
 #include <cassert>
+#include <deque>
 #include <filesystem>
 #include <optional>
 #include <stack>
@@ -100,10 +101,14 @@ class BPlusTree {
 		Iter& operator=(const Iter&) = delete;
 		Iter(Iter&& iter) {
 			page=std::move(iter.page); slotid=iter.slotid; tree=iter.tree;
+			readahead=iter.readahead; ahead=std::move(iter.ahead);
+			keep=iter.keep; kept=std::move(iter.kept);
 			//DEBUG
 		}
 		Iter& operator=(Iter&& iter) {
 			page=std::move(iter.page); slotid=iter.slotid; tree=iter.tree;
+			readahead=iter.readahead; ahead=std::move(iter.ahead);
+			keep=iter.keep; kept=std::move(iter.kept);
 			return *this;
 			//DEBUG
 		}
@@ -117,11 +122,36 @@ class BPlusTree {
 			//DEBUG
 		}
 		void Next(){ slotid++; }
+		/* Keep at most "window" leaves after the current leaf being read ahead
+		 * with PageManager::Prefetch. 0 disables read-ahead.
+		 * The window is refilled when half of it has been consumed.
+		 */
+		void SetReadAhead(size_t window){ readahead=window; ahead.clear(); read_ahead(); }
+		/* While "k" is true, the leaves that the iterator leaves stay pinned
+		 * until ReleaseKeptPages(), so that the tuples read from them remain
+		 * valid. Used to read tuples in batches.
+		 */
+		void KeepPages(bool k){ keep=k; }
+		void ReleaseKeptPages(){ kept.clear(); }
 		Iter(pgid_t p,slotid_t s,BPlusTree *t):slotid(s),tree(t){ set_page(p); }
 		Iter(LeafPage p,slotid_t s,BPlusTree *t):page(std::move(p)),slotid(s),tree(t){ }
 	 private:
-	 	void set_page(pgid_t id){ if(!id) page.reset(); else page=std::move(tree->GetLeafPage(id)); }
+	 	void set_page(pgid_t id){ if(keep&&page.has_value()) kept.push_back(std::move(page.value())); if(!id) page.reset(); else page=std::move(tree->GetLeafPage(id)); read_ahead(); }
+		void read_ahead()
+		{
+			if(!readahead||!page.has_value()) return;
+			if(!ahead.empty()&&ahead.front()==page.value().ID()) ahead.pop_front(); else ahead.clear();
+			if(ahead.size()>readahead/2||page.value().IsEmpty()) return;
+			std::vector<pgid_t> leaves; leaves.reserve(readahead);
+			tree->leaves_after(LeafSlotParse(page.value().Slot(0)).key,readahead,leaves);
+			for(size_t i=ahead.size();i<leaves.size();i++) tree->pgm_.get().Prefetch(leaves[i]);
+			ahead.assign(leaves.begin(),leaves.end());
+		}
 		std::optional<LeafPage> page; slotid_t slotid; BPlusTree *tree;
+		// Read-ahead window, and the leaves after the current one that have been
+		// prefetched.
+		size_t readahead=0; std::deque<pgid_t> ahead;
+		bool keep=false; std::vector<LeafPage> kept;
 		// DEBUG
 	};
 	BPlusTree(const Self&) = delete;
@@ -192,6 +222,45 @@ class BPlusTree {
 		return road;
 		// DEBUG
 	}
+	// Append the IDs of at most "k" leaves following the leaf that "key" belongs
+	// to, in the order of the leaf chain. Only inner pages are accessed.
+	void leaves_after(std::string_view key,size_t k,std::vector<pgid_t>& out)
+	{
+		if(LevelNum()) leaves_after(Root(),LevelNum(),&key,k,out);
+	}
+	// "key" is nullptr if all leaves in this subtree follow the leaf.
+	void leaves_after(pgid_t id,uint8_t l,const std::string_view *key,size_t k,std::vector<pgid_t>& out)
+	{
+		InnerPage x=GetInnerPage(id); slotid_t s=key?x.UpperBound(*key):0;
+		for(slotid_t i=s;i<=x.SlotNum()&&out.size()<k;i++)
+		{
+			pgid_t c=i==x.SlotNum()?GetInnerSpecial(x):InnerSlotParse(x.Slot(i)).next;
+			if(l>1) leaves_after(c,l-1,i==s?key:nullptr,k,out);
+			else if(!key||i!=s) out.push_back(c);
+		}
+	}
+	// Append at most "n"-1 keys that split the tree into ranges of about the same number of subtrees, in ascending order.
+	// A range starts at a key (inclusive). Only inner pages are accessed.
+	void split_keys(size_t n,std::vector<std::string>& out)
+	{
+		if(!LevelNum()||n<2) return;
+		// nodes of one level, and keys[i] separates nodes[i] and nodes[i+1]
+		std::vector<pgid_t> nodes={Root()}; std::vector<std::string> keys;
+		for(uint8_t l=LevelNum();l>=1&&nodes.size()<n;l--)
+		{
+			std::vector<pgid_t> nn; std::vector<std::string> nk;
+			for(size_t j=0;j<nodes.size();j++)
+			{
+				if(j) nk.push_back(std::move(keys[j-1]));
+				InnerPage x=GetInnerPage(nodes[j]);
+				for(slotid_t i=0;i<x.SlotNum();i++){ InnerSlot s=InnerSlotParse(x.Slot(i)); nn.push_back(s.next); nk.emplace_back(s.strict_upper_bound); }
+				nn.push_back(GetInnerSpecial(x));
+			}
+			nodes.swap(nn); keys.swap(nk);
+		}
+		size_t m=std::min(n,nodes.size());
+		for(size_t j=1;j<m;j++) out.push_back(keys[j*nodes.size()/m-1]);
+	}
 	LeafPage access_leaf(std::string_view key)
 	{
 		int n=LevelNum(); pgid_t id=Root();
@@ -306,6 +375,20 @@ class BPlusTree {
 		return std::string(LeafSlotParse(x.Slot(s)).value);
 		// DEBUG
 	}
+	// Look up the ascending "keys", and call f(i, value) for each keys[i] that
+	// exists. A key that is not after the last key of the leaf of the previous
+	// key is in that leaf, so it is found without going down from the root.
+	template <typename F>
+	void GetSorted(const std::string_view* keys, size_t n, F&& f) {
+		std::lock_guard l(latch_);
+		std::optional<LeafPage> x;
+		for(size_t i=0;i<n;i++)
+		{
+			if(!x.has_value()||!x->SlotNum()||comp_(keys[i],LeafSlotParse(x->Slot(x->SlotNum()-1)).key)>0) x=access_leaf(keys[i]);
+			slotid_t s=x->Find(keys[i]);
+			if(s!=x->SlotNum()) f(i,LeafSlotParse(x->Slot(s)).value);
+		}
+	}
 	// Return succeed or not.
 	bool __Delete(std::string_view key) {
 		//   printf("- %s\n",key.data());
@@ -73,6 +73,11 @@ class MemoryTable {
     const uint8_t* Search(std::string_view key) override {
       return table_.Search(key);
     }
+    void SearchSorted(
+        const std::string_view* keys, size_t n, const uint8_t** out) override {
+      for (size_t i = 0; i < n; i++)
+        out[i] = table_.Search(keys[i]);
+    }
 
    private:
     MemoryTable& table_;
@@ -3,81 +3,133 @@
 #include <memory>
 #include <mutex>
 
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 namespace wing {
 
 PageManager::~PageManager() {
-  // Flush free list standby buffer
-  if (free_list_buf_standby_full_) {
-    if (free_list_buf_used_ != 0) {
-      free_list_buf_used_ -= 1;
-      pgid_t pgid = free_list_buf_[free_list_buf_used_];
-      FlushFreeListStandby(pgid);
-    } else {
-      std::swap(free_list_buf_, free_list_buf_standby_);
-      free_list_buf_used_ = PGID_PER_PAGE;
-      free_list_buf_standby_full_ = false;
+  if (flusher_thread_.joinable()) {
+    {
+      std::lock_guard l(flusher_latch_);
+      stop_flusher_ = true;
     }
+    flusher_cv_.notify_all();
+    flusher_thread_.join();
   }
-  // Flush free list buffer
-  if (free_list_buf_used_ != 0) {
-    free_list_buf_used_ -= 1;
-    pgid_t pgid = free_list_buf_[free_list_buf_used_];
-    file_.seekp(pgid * Page::SIZE);
-    file_.write(reinterpret_cast<const char *>(free_list_buf_),
-      free_list_buf_used_ * sizeof(pgid_t));
-    pgid_t head = FreeListHead();
-    file_.seekp((pgid + 1) * Page::SIZE - sizeof(pgid_t));
-    file_.write(reinterpret_cast<const char *>(&head), sizeof(head));
-    FreeListHead() = pgid;
-    FreePagesInHead() = free_list_buf_used_;
-    free_list_buf_used_ = 0;
+  // Stop prefetching. In-progress loads finish before the threads exit.
+  {
+    std::lock_guard l(prefetch_latch_);
+    stop_prefetch_ = true;
   }
-  // Flush dirty pages
-  std::vector<pgid_t> pages;
-  pages.reserve(buf_.size());
-  for (const auto& buf : buf_)
-    pages.push_back(buf.first);
-  std::sort(pages.begin(), pages.end());
-  assert(pages[0] == 0);
-  assert(buf_[0].refcount == 1);
-  buf_[0].refcount = 0;
-  for (pgid_t i : pages) {
-    auto it = buf_.find(i);
-    assert(it != buf_.end());
-    assert(it->second.refcount == 0);
-    if (it->second.dirty) {
-      file_.seekp(i * Page::SIZE);
-      file_.write(it->second.addr(), Page::SIZE);
-    }
+  prefetch_cv_.notify_all();
+  for (auto& thread : prefetch_threads_)
+    thread.join();
+#ifndef NDEBUG
+  for (size_t i = 0; i < num_partitions_; ++i) {
+    for (const auto& buf : partitions_[i].buf)
+      assert(buf.second.refcount == 0);
+  }
+#endif
+  FlushDirtyPages(true);
+  {
+    std::lock_guard l(latch_);
+    FlushMeta();
+  }
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+PageManager::PageManager(std::filesystem::path path, size_t max_buf_pages,
+    const PageManagerOptions& options)
+  : path_(path),
+    io_mode_(options.io_mode),
+    max_buf_pages_(max_buf_pages),
+    num_partitions_(options.num_partitions),
+    partitions_(new Partition[options.num_partitions]),
+    free_list_buf_(free_list_bufs_[0]),
+    free_list_buf_used_(0),
+    free_list_buf_standby_(free_list_bufs_[1]),
+    free_list_buf_standby_full_(false),
+    clean_frames_(options.clean_frames) {
+  assert(num_partitions_ >= 1);
+  // One buffer page is for pinned meta page, and each partition needs at
+  // least one buffer page.
+  assert(max_buf_pages_ >= num_partitions_ + 1);
+  size_t pages = max_buf_pages_ - 1;
+  for (size_t i = 0; i < num_partitions_; ++i) {
+    auto& part = partitions_[i];
+    part.max_buf_pages =
+      pages / num_partitions_ + (i < pages % num_partitions_);
+    part.eviction_policy =
+      CreateEvictionPolicy(options.eviction_policy, part.max_buf_pages);
+    // The memory is not touched until the frames are used.
+    part.arena.reset(static_cast<char *>(
+      std::aligned_alloc(Page::SIZE, part.max_buf_pages * Page::SIZE)));
+    if (part.arena == nullptr)
+      DB_ERR("Fail to allocate the buffer pool");
+    part.free_frames.reserve(part.max_buf_pages);
+    for (size_t j = part.max_buf_pages; j > 0; --j)
+      part.free_frames.push_back(part.arena.get() + (j - 1) * Page::SIZE);
   }
+  if (options.background_flush)
+    flusher_thread_ = std::thread([this]() { FlusherWorker(); });
 }
 
 auto PageManager::Create(
-  std::filesystem::path path, size_t max_buf_pages
+  std::filesystem::path path, size_t max_buf_pages,
+  const PageManagerOptions& options
 ) -> std::unique_ptr<PageManager> {
-  std::ofstream f(path); // Used to create the file
   auto pgm = std::unique_ptr<PageManager>(
-    new PageManager(path, std::fstream(path), max_buf_pages));
+    new PageManager(path, max_buf_pages, options));
+  auto ret = pgm->OpenFile(true);
+  if (ret.has_value())
+    DB_ERR("{}", ret.value().to_string());
   pgm->Init();
   return pgm;
 }
 
 auto PageManager::Open(
-  std::filesystem::path path, size_t max_buf_pages
+  std::filesystem::path path, size_t max_buf_pages,
+  const PageManagerOptions& options
 ) -> Result<std::unique_ptr<PageManager>, io::Error> {
-  std::fstream file(path);
-  // TODO: Detect more detailed reason
-  if (!file.good())
-    return io::Error::New(io::ErrorKind::Other,
-      "Fail to open file " + path.string());
   auto pgm = std::unique_ptr<PageManager>(
-    new PageManager(path, std::move(file), max_buf_pages));
-  auto ret = pgm->Load();
+    new PageManager(path, max_buf_pages, options));
+  auto ret = pgm->OpenFile(false);
+  if (ret.has_value())
+    return std::move(ret.value());
+  ret = pgm->Load();
   if (ret.has_value())
     return std::move(ret.value());
   return pgm;
 }
 
+std::optional<io::Error> PageManager::OpenFile(bool create) {
+  if (io_mode_ == PageIOMode::Stream) {
+    if (create)
+      std::ofstream f(path_); // Used to create the file
+    file_ = std::fstream(path_);
+    // TODO: Detect more detailed reason
+    if (!file_.good())
+      return io::Error::New(io::ErrorKind::Other,
+        "Fail to open file " + path_.string());
+    return std::nullopt;
+  }
+  int flags = O_RDWR;
+  if (create)
+    flags |= O_CREAT | O_TRUNC;
+  if (io_mode_ == PageIOMode::Direct)
+    flags |= O_DIRECT;
+  fd_ = open(path_.c_str(), flags, 0644);
+  if (fd_ < 0) {
+    return io::Error::New(errno == ENOENT ? io::ErrorKind::NotFound
+                                          : io::ErrorKind::Other,
+      "Fail to open file " + path_.string() + ": " + strerror(errno));
+  }
+  return std::nullopt;
+}
+
 pgid_t PageManager::__Allocate() {
   if (free_list_buf_used_ == 0) {
     if (free_list_buf_standby_full_) {
@@ -88,12 +140,12 @@ pgid_t PageManager::__Allocate() {
     }
     pgid_t pgid = FreeListHead();
     if (pgid != 0) {
-      file_.seekg(pgid * Page::SIZE);
       free_list_buf_used_ = PGID_PER_PAGE;
-      file_.read(reinterpret_cast<char *>(free_list_buf_),
+      ReadAt(pgid * Page::SIZE, reinterpret_cast<char *>(free_list_buf_),
         free_list_buf_used_ * sizeof(pgid_t));
       pgid_t head;
-      file_.read(reinterpret_cast<char *>(&head), sizeof(pgid_t));
+      ReadAt(pgid * Page::SIZE + PGID_PER_PAGE * sizeof(pgid_t),
+        reinterpret_cast<char *>(&head), sizeof(pgid_t));
       FreeListHead() = head;
       return free_list_buf_[--free_list_buf_used_];
     }
@@ -123,11 +175,21 @@ void PageManager::Free(pgid_t pgid) {
   if (is_free_[pgid])
     DB_ERR("Internal error: Double free of page {}\n", pgid);
   is_free_[pgid] = true;
-  eviction_policy_.Remove(pgid);
-  auto it = buf_.find(pgid);
-  if (it != buf_.end()) {
-    assert(it->second.refcount == 0);
-    buf_.erase(it);
+  {
+    auto& part = PartitionOf(pgid);
+    std::unique_lock pl(part.latch);
+    auto it = part.buf.find(pgid);
+    while (it != part.buf.end() &&
+        (it->second.loading || it->second.flushing)) {
+      part.loaded.wait(pl);
+      it = part.buf.find(pgid);
+    }
+    part.eviction_policy->Remove(pgid);
+    if (it != part.buf.end()) {
+      assert(it->second.refcount == 0);
+      part.free_frames.push_back(it->second.buf);
+      part.buf.erase(it);
+    }
   }
   if (free_list_buf_used_ == PGID_PER_PAGE) {
     if (free_list_buf_standby_full_) {
@@ -156,10 +218,10 @@ void PageManager::ShrinkToFit() {
   pgid_t pgid = FreeListHead();
   while (pgid != 0) {
     free_pages.push_back(pgid);
-    file_.seekg(pgid * Page::SIZE);
-    file_.read(reinterpret_cast<char *>(free_list_buf_),
+    ReadAt(pgid * Page::SIZE, reinterpret_cast<char *>(free_list_buf_),
       PGID_PER_PAGE * sizeof(pgid_t));
-    file_.read(reinterpret_cast<char *>(&pgid), sizeof(pgid));
+    ReadAt(pgid * Page::SIZE + PGID_PER_PAGE * sizeof(pgid_t),
+      reinterpret_cast<char *>(&pgid), sizeof(pgid));
     for (size_t i = 0; i < PGID_PER_PAGE; ++i)
       free_pages.push_back(free_list_buf_[i]);
   }
@@ -179,12 +241,14 @@ void PageManager::ShrinkToFit() {
   size_t i = 0;
   while (free_pages.size() - i > PGID_PER_PAGE) {
     pgid = free_pages[i++];
-    file_.seekp(pgid * Page::SIZE);
-    file_.write(reinterpret_cast<const char *>(free_pages.data() + i),
-      PGID_PER_PAGE * Page::SIZE);
+    JournalPages(&pgid, 1);
+    WriteAt(pgid * Page::SIZE,
+      reinterpret_cast<const char *>(free_pages.data() + i),
+      PGID_PER_PAGE * sizeof(pgid_t));
     i += PGID_PER_PAGE;
     pgid_t head = FreeListHead();
-    file_.write(reinterpret_cast<const char *>(&head), sizeof(head));
+    WriteAt(pgid * Page::SIZE + PGID_PER_PAGE * sizeof(pgid_t),
+      reinterpret_cast<const char *>(&head), sizeof(head));
     FreeListHead() = pgid;
   }
   free_list_buf_used_ = free_pages.size() - i;
@@ -197,17 +261,11 @@ void PageManager::ShrinkToFit() {
 }
 
 void PageManager::AllocMeta() {
-  auto buf = std::unique_ptr<char[]>(new char[Page::SIZE]);
-  // Mark dirty to force the meta page to be flushed when closing,
-  // so that we don't need to mark it dirty anymore when running.
-  auto ret = buf_.emplace(0, PageBufInfo{std::move(buf), 1, true});
-  (void)ret;
-  assert(ret.second);
-  assert(buf_.size() < max_buf_pages_);
+  meta_ = std::unique_ptr<char[]>(new char[Page::SIZE]);
 }
 void PageManager::Init() {
   AllocMeta();
-  memset(buf_[0].addr_mut(), 0, Page::SIZE);
+  memset(meta_.get(), 0, Page::SIZE);
   FreeListHead() = 0;
   FreePagesInHead() = 0;
   PageNum() = 2;
@@ -217,104 +275,518 @@ void PageManager::Init() {
 
 std::optional<io::Error> PageManager::Load() {
   AllocMeta();
-  file_.read(buf_[0].addr_mut(), Page::SIZE);
-  if (!file_.good())
+  bool good = ReadAt(0, meta_.get(), Page::SIZE);
+  if (!good)
     return io::Error::New(io::ErrorKind::Other,
       "Error occurred when reading file " + path_.string());
   is_free_.resize(PageNum(), false);
   pgid_t head = FreeListHead();
   if (head == 0)
     return std::nullopt;
-  file_.seekg(head * Page::SIZE);
   free_list_buf_used_ = FreePagesInHead();
-  file_.read(reinterpret_cast<char *>(free_list_buf_),
+  good &= ReadAt(head * Page::SIZE, reinterpret_cast<char *>(free_list_buf_),
      free_list_buf_used_ * sizeof(pgid_t));
   pgid_t pgid;
-  file_.seekg((head + 1) * Page::SIZE - sizeof(pgid_t));
-  file_.read(reinterpret_cast<char *>(&pgid), sizeof(pgid));
+  good &= ReadAt((head + 1) * Page::SIZE - sizeof(pgid_t),
+    reinterpret_cast<char *>(&pgid), sizeof(pgid));
   FreeListHead() = pgid;
 
   for (size_t i = 0; i < free_list_buf_used_; ++i)
     is_free_[free_list_buf_[i]] = true;
-  while (pgid) {
-    file_.seekg(pgid * Page::SIZE);
+  while (good && pgid) {
     assert(!free_list_buf_standby_full_);
     // Borrow free_list_buf_standby_ here
-    file_.read(reinterpret_cast<char *>(free_list_buf_standby_),
+    good &= ReadAt(pgid * Page::SIZE,
+      reinterpret_cast<char *>(free_list_buf_standby_),
       PGID_PER_PAGE * sizeof(pgid_t));
     for (size_t i = 0; i < PGID_PER_PAGE; ++i)
       is_free_[free_list_buf_standby_[i]] = true;
-    file_.read(reinterpret_cast<char *>(&pgid), sizeof(pgid));
+    good &= ReadAt((pgid + 1) * Page::SIZE - sizeof(pgid_t),
+      reinterpret_cast<char *>(&pgid), sizeof(pgid));
   }
 
   // Postpone the free here to make sure that free_list_buf_standby_ is empty.
   Free(head);
 
-  if (!file_.good())
+  if (!good)
     return io::Error::New(io::ErrorKind::Other,
       "Error occurred when reading file " + path_.string());
   return std::nullopt;
 }
 
-Page PageManager::GetPage(pgid_t pgid) {
+void PageManager::CheckAccessible(pgid_t pgid) {
+  // is_free_ is protected by latch_, which would serialize all partitions
+  // again. So with multiple partitions, only check it in debug mode.
+#ifdef NDEBUG
+  if (num_partitions_ > 1)
+    return;
+#endif
+  std::lock_guard l(latch_);
   if (pgid >= PageNum()) {
     DB_ERR("Internal Error: " + std::to_string(pgid) + " >= " +
         std::to_string(PageNum()));
   }
   if (is_free_[pgid])
     DB_ERR("Internal error: Accessing free page {}", pgid);
-  char *addr;
-  auto it = buf_.find(pgid);
-  if (it != buf_.end()) {
-    addr = it->second.addr_mut();
-    if (it->second.refcount == 0)
-      eviction_policy_.Pin(pgid);
-    it->second.refcount += 1;
-  } else {
-    assert(buf_.size() <= max_buf_pages_);
-    std::unique_ptr<char[]> buf;
-    if (buf_.size() == max_buf_pages_) {
-      pgid_t pgid_to_evict = eviction_policy_.Evict();
-      auto it = buf_.find(pgid_to_evict);
-      assert(it->second.refcount == 0);
-      if (it->second.dirty) {
-        file_.seekp(pgid_to_evict * Page::SIZE);
-        file_.write(it->second.addr(), Page::SIZE);
+}
+char *PageManager::AllocFrame(
+    Partition& part, std::unique_lock<std::mutex>& lock) {
+  if (!part.free_frames.empty()) {
+    char *frame = part.free_frames.back();
+    part.free_frames.pop_back();
+    return frame;
+  }
+  auto pgid_to_evict = part.eviction_policy->Evict();
+  if (!pgid_to_evict.has_value())
+    return nullptr;
+  pgid_t victim = pgid_to_evict.value();
+  auto it = part.buf.find(victim);
+  assert(it->second.refcount == 0 && !it->second.loading);
+  if (it->second.flushing) {
+    // Being written by the flusher. Wait for the write so that the frame is
+    // not reused during it. Accesses to the victim wait until it is evicted.
+    it->second.loading = true;
+    part.loaded.wait(lock, [&]() {
+      return !part.buf.find(victim)->second.flushing;
+    });
+    it = part.buf.find(victim);
+    assert(!it->second.dirty);
+    part.loaded.notify_all();
+  } else if (it->second.dirty) {
+    // Write back without holding the latch. Accesses to the victim wait until
+    // it is written and evicted, and then read it from disk.
+    it->second.loading = true;
+    part.stats.foreground_writes += 1;
+    if (flusher_thread_.joinable())
+      flusher_cv_.notify_one();
+    char *frame = it->second.buf;
+    lock.unlock();
+    JournalPages(&victim, 1);
+    WriteAt(victim * Page::SIZE, frame, Page::SIZE);
+    lock.lock();
+    it = part.buf.find(victim);
+    assert(it != part.buf.end() && it->second.loading);
+    part.loaded.notify_all();
+  }
+  char *frame = it->second.buf;
+  part.buf.erase(it);
+  return frame;
+}
+Page PageManager::GetPage(pgid_t pgid) {
+  CheckAccessible(pgid);
+  auto& part = PartitionOf(pgid);
+  std::unique_lock l(part.latch);
+  for (;;) {
+    auto it = part.buf.find(pgid);
+    if (it != part.buf.end() &&
+        (it->second.loading || it->second.flushing)) {
+      if (it->second.prefetched)
+        part.stats.prefetch_stalls += 1;
+      part.loaded.wait(l);
+      continue;
+    }
+    if (it != part.buf.end()) {
+      part.stats.hits += 1;
+      if (it->second.prefetched) {
+        part.stats.prefetch_hits += 1;
+        it->second.prefetched = false;
       }
-      buf = std::move(it->second.buf);
-      buf_.erase(it);
-    } else {
-      buf = std::unique_ptr<char[]>(new char[Page::SIZE]);
+      if (it->second.refcount == 0)
+        part.eviction_policy->Pin(pgid);
+      it->second.refcount += 1;
+      return Page(pgid, it->second.addr_mut(), *this, false);
     }
-    PageBufInfo buf_info{std::move(buf), 1, false};
-    addr = buf_info.addr_mut();
-    file_.seekg(pgid * Page::SIZE);
-    file_.read(addr, Page::SIZE);
-    auto ret = buf_.emplace(pgid, std::move(buf_info));
-    (void)ret;
-    assert(ret.second);
+    char *frame = AllocFrame(part, l);
+    if (frame == nullptr)
+      DB_ERR("Buffer size for PageManager is too small!");
+    if (part.buf.find(pgid) != part.buf.end()) {
+      // Loaded by others when the latch was released.
+      part.free_frames.push_back(frame);
+      continue;
+    }
+    part.stats.misses += 1;
+    // Pinned by us, so it will not be evicted when the latch is released.
+    part.buf.emplace(pgid, PageBufInfo{frame, 1, false, true, false});
+    l.unlock();
+    ReadAt(pgid * Page::SIZE, frame, Page::SIZE);
+    l.lock();
+    part.buf.find(pgid)->second.loading = false;
+    part.loaded.notify_all();
+    return Page(pgid, frame, *this, false);
   }
-  return Page(pgid, addr, *this, false);
 }
 void PageManager::DropPage(pgid_t pgid, bool dirty) {
-  std::lock_guard l(latch_);
   assert(pgid != 0);
-  auto it = buf_.find(pgid);
-  assert(it != buf_.end());
+  auto& part = PartitionOf(pgid);
+  std::lock_guard l(part.latch);
+  auto it = part.buf.find(pgid);
+  assert(it != part.buf.end());
   it->second.dirty |= dirty;
   assert(it->second.refcount > 0);
   it->second.refcount -= 1;
   if (it->second.refcount == 0)
-    eviction_policy_.Unpin(pgid);
+    part.eviction_policy->Unpin(pgid);
+}
+auto PageManager::GetStats() -> Stats {
+  Stats ret;
+  for (size_t i = 0; i < num_partitions_; ++i) {
+    std::lock_guard l(partitions_[i].latch);
+    ret.hits += partitions_[i].stats.hits;
+    ret.misses += partitions_[i].stats.misses;
+    ret.prefetches += partitions_[i].stats.prefetches;
+    ret.prefetch_hits += partitions_[i].stats.prefetch_hits;
+    ret.prefetch_stalls += partitions_[i].stats.prefetch_stalls;
+    ret.foreground_writes += partitions_[i].stats.foreground_writes;
+  }
+  ret.background_writes = background_writes_;
+  ret.background_write_ios = background_write_ios_;
+  return ret;
+}
+void PageManager::ResetStats() {
+  for (size_t i = 0; i < num_partitions_; ++i) {
+    std::lock_guard l(partitions_[i].latch);
+    partitions_[i].stats = Stats();
+  }
+  background_writes_ = 0;
+  background_write_ios_ = 0;
+}
+
+void PageManager::Prefetch(pgid_t pgid) {
+  {
+    std::lock_guard l(prefetch_latch_);
+    if (prefetch_queue_.size() >= MAX_PENDING_PREFETCHES)
+      return;
+    if (prefetch_threads_.empty()) {
+      for (size_t i = 0; i < PREFETCH_THREADS; ++i)
+        prefetch_threads_.emplace_back([this]() { PrefetchWorker(); });
+    }
+    prefetch_queue_.push_back(pgid);
+  }
+  prefetch_cv_.notify_one();
+}
+void PageManager::PrefetchWorker() {
+  for (;;) {
+    pgid_t pgid;
+    {
+      std::unique_lock l(prefetch_latch_);
+      prefetch_cv_.wait(l,
+        [this]() { return stop_prefetch_ || !prefetch_queue_.empty(); });
+      if (stop_prefetch_)
+        return;
+      pgid = prefetch_queue_.front();
+      prefetch_queue_.pop_front();
+    }
+    LoadPrefetch(pgid);
+  }
 }
+void PageManager::LoadPrefetch(pgid_t pgid) {
+  {
+    std::lock_guard l(latch_);
+    if (pgid >= PageNum() || is_free_[pgid])
+      return;
+  }
+  // The page may be freed from now on, which is harmless: the buffer will
+  // hold what is on disk, and it is never dirty.
+  auto& part = PartitionOf(pgid);
+  std::unique_lock l(part.latch);
+  if (part.buf.find(pgid) != part.buf.end())
+    return;
+  char *frame = AllocFrame(part, l);
+  if (frame == nullptr)
+    return;
+  if (part.buf.find(pgid) != part.buf.end()) {
+    part.free_frames.push_back(frame);
+    return;
+  }
+  part.buf.emplace(pgid, PageBufInfo{frame, 0, false, true, true});
+  l.unlock();
+  ReadAt(pgid * Page::SIZE, frame, Page::SIZE);
+  l.lock();
+  auto it = part.buf.find(pgid);
+  assert(it != part.buf.end() && it->second.loading);
+  it->second.loading = false;
+  part.stats.prefetches += 1;
+  part.eviction_policy->Unpin(pgid);
+  part.loaded.notify_all();
+}
+
+void PageManager::Checkpoint() {
+  FlushDirtyPages(true);
+  std::lock_guard l(latch_);
+  FlushMeta();
+  if (io_mode_ == PageIOMode::Stream) {
+    std::lock_guard io_l(io_latch_);
+    file_.flush();
+  } else if (fdatasync(fd_) < 0) {
+    DB_ERR("Fail to sync file {}: {}", path_.string(), strerror(errno));
+  }
+}
+void PageManager::FlusherWorker() {
+  std::unique_lock l(flusher_latch_);
+  while (!stop_flusher_) {
+    flusher_cv_.wait_for(l, FLUSH_INTERVAL);
+    if (stop_flusher_)
+      break;
+    l.unlock();
+    FlushDirtyPages(false);
+    l.lock();
+  }
+}
+size_t PageManager::FlushDirtyPages(bool all) {
+  std::lock_guard fl(flush_latch_);
+  std::vector<std::pair<pgid_t, const char *>> pages;
+  std::vector<pgid_t> candidates;
+  for (size_t i = 0; i < num_partitions_; ++i) {
+    auto& part = partitions_[i];
+    std::lock_guard l(part.latch);
+    auto pick = [&](pgid_t pgid, PageBufInfo& info) {
+      if ((!all && info.refcount != 0) || !info.dirty || info.loading ||
+          info.flushing)
+        return;
+      info.flushing = true;
+      pages.emplace_back(pgid, info.addr());
+    };
+    if (all) {
+      for (auto& [pgid, info] : part.buf)
+        pick(pgid, info);
+    } else if (part.free_frames.size() < clean_frames_) {
+      candidates.clear();
+      part.eviction_policy->Peek(
+        clean_frames_ - part.free_frames.size(), candidates);
+      for (pgid_t pgid : candidates)
+        pick(pgid, part.buf.find(pgid)->second);
+    }
+  }
+  if (pages.empty())
+    return 0;
+  std::sort(pages.begin(), pages.end());
+  WritePages(pages);
+  background_writes_ += pages.size();
+  for (auto [pgid, buf] : pages) {
+    auto& part = PartitionOf(pgid);
+    std::lock_guard l(part.latch);
+    auto& info = part.buf.find(pgid)->second;
+    assert(info.flushing);
+    info.flushing = false;
+    info.dirty = false;
+    part.loaded.notify_all();
+  }
+  return pages.size();
+}
+void PageManager::WritePages(
+    const std::vector<std::pair<pgid_t, const char *>>& pages) {
+  if (journal_ != nullptr) {
+    std::vector<pgid_t> pgids;
+    for (auto [pgid, buf] : pages)
+      pgids.push_back(pgid);
+    JournalPages(pgids.data(), pgids.size());
+  }
+  if (io_mode_ == PageIOMode::Stream) {
+    for (auto [pgid, buf] : pages)
+      WriteAt(pgid * Page::SIZE, buf, Page::SIZE);
+    background_write_ios_ += pages.size();
+    return;
+  }
+  struct iovec iov[MAX_COALESCED_PAGES];
+  size_t i = 0;
+  while (i < pages.size()) {
+    size_t n = 0;
+    pgid_t first = pages[i].first;
+    while (i + n < pages.size() && n < MAX_COALESCED_PAGES &&
+        pages[i + n].first == first + n) {
+      iov[n].iov_base = const_cast<char *>(pages[i + n].second);
+      iov[n].iov_len = Page::SIZE;
+      n += 1;
+    }
+    ssize_t ret;
+    do {
+      ret = pwritev(fd_, iov, n, first * Page::SIZE);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+      DB_ERR("Fail to write file {}: {}", path_.string(), strerror(errno));
+    background_write_ios_ += 1;
+    // Finish a short write page by page.
+    for (size_t j = 0; j < n; ++j) {
+      size_t written = std::clamp<ssize_t>(ret - j * Page::SIZE, 0, Page::SIZE);
+      if (written < Page::SIZE) {
+        WriteAt((first + j) * Page::SIZE + written,
+          pages[i + j].second + written, Page::SIZE - written);
+      }
+    }
+    i += n;
+  }
+}
+void PageManager::FlushMeta() {
+  // Flush free list standby buffer
+  if (free_list_buf_standby_full_) {
+    if (free_list_buf_used_ != 0) {
+      free_list_buf_used_ -= 1;
+      pgid_t pgid = free_list_buf_[free_list_buf_used_];
+      FlushFreeListStandby(pgid);
+    } else {
+      std::swap(free_list_buf_, free_list_buf_standby_);
+      free_list_buf_used_ = PGID_PER_PAGE;
+      free_list_buf_standby_full_ = false;
+    }
+  }
+  /* The pages in the free list buffer are written to one of them, which
+   * becomes the head of the free list on disk. Only the meta page on disk
+   * references it, so the free list in memory is kept as it is.
+   */
+  auto meta = std::unique_ptr<char[]>(new char[Page::SIZE]);
+  memcpy(meta.get(), meta_.get(), Page::SIZE);
+  if (free_list_buf_used_ != 0) {
+    pgid_t num = free_list_buf_used_ - 1;
+    pgid_t pgid = free_list_buf_[num];
+    JournalPages(&pgid, 1);
+    WriteAt(pgid * Page::SIZE, reinterpret_cast<const char *>(free_list_buf_),
+      num * sizeof(pgid_t));
+    pgid_t head = FreeListHead();
+    WriteAt((pgid + 1) * Page::SIZE - sizeof(pgid_t),
+      reinterpret_cast<const char *>(&head), sizeof(head));
+    *(pgid_t *)(meta.get() + FREE_LIST_HEAD_OFF) = pgid;
+    *(pgid_t *)(meta.get() + FREE_PAGES_IN_HEAD) = num;
+  }
+  pgid_t meta_pgid = 0;
+  JournalPages(&meta_pgid, 1);
+  WriteAt(0, meta.get(), Page::SIZE);
+}
+void PageManager::JournalPages(const pgid_t *pgids, size_t num) {
+  if (journal_ == nullptr)
+    return;
+  std::lock_guard l(journal_latch_);
+  std::optional<uint64_t> seq;
+  auto image = std::unique_ptr<char, decltype(&std::free)>(
+    static_cast<char *>(std::aligned_alloc(Page::SIZE, Page::SIZE)),
+    &std::free);
+  for (size_t i = 0; i < num; ++i) {
+    pgid_t pgid = pgids[i];
+    if (pgid >= journal_base_ || journaled_[pgid])
+      continue;
+    ReadAt(pgid * Page::SIZE, image.get(), Page::SIZE);
+    seq = journal_->SavePageImage(pgid, image.get());
+    journaled_[pgid] = true;
+  }
+  // The pages are overwritten after we return, so the images must be durable.
+  if (seq.has_value())
+    journal_->SyncPageImages(seq.value());
+}
+void PageManager::ResetJournal() {
+  std::lock_guard l(latch_);
+  std::lock_guard jl(journal_latch_);
+  journal_base_ = PageNum();
+  journaled_.assign(journal_base_, false);
+}
+std::optional<io::Error> PageManager::Restore(
+    const std::filesystem::path& path,
+    const std::vector<std::pair<pgid_t, std::string_view>>& images,
+    pgid_t page_num) {
+  int fd = open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    return io::Error::New(errno == ENOENT ? io::ErrorKind::NotFound
+                                          : io::ErrorKind::Other,
+      "Fail to open file " + path.string() + ": " + strerror(errno));
+  }
+  std::vector<bool> restored(page_num, false);
+  bool good = true;
+  for (auto [pgid, image] : images) {
+    assert(image.size() == Page::SIZE);
+    if (pgid >= page_num || restored[pgid])
+      continue;
+    restored[pgid] = true;
+    good &= pwrite(fd, image.data(), Page::SIZE, (off_t)pgid * Page::SIZE) ==
+      (ssize_t)Page::SIZE;
+  }
+  good &= ftruncate(fd, (off_t)page_num * Page::SIZE) == 0;
+  good &= fdatasync(fd) == 0;
+  close(fd);
+  if (!good)
+    return io::Error::New(io::ErrorKind::Other,
+      "Fail to restore file " + path.string() + ": " + strerror(errno));
+  return std::nullopt;
+}
+
 void PageManager::FlushFreeListStandby(pgid_t pgid) {
-  file_.seekp(pgid * Page::SIZE);
-  file_.write(reinterpret_cast<const char *>(free_list_buf_standby_),
+  JournalPages(&pgid, 1);
+  WriteAt(pgid * Page::SIZE,
+    reinterpret_cast<const char *>(free_list_buf_standby_),
     PGID_PER_PAGE * sizeof(pgid_t));
   pgid_t head = FreeListHead();
-  file_.write(reinterpret_cast<const char *>(&head), sizeof(head));
+  WriteAt(pgid * Page::SIZE + PGID_PER_PAGE * sizeof(pgid_t),
+    reinterpret_cast<const char *>(&head), sizeof(head));
   FreeListHead() = pgid;
   free_list_buf_standby_full_ = false;
 }
 
+bool PageManager::ReadAt(size_t offset, char *buf, size_t len) {
+  if (io_mode_ == PageIOMode::Stream) {
+    std::lock_guard l(io_latch_);
+    file_.seekg(offset);
+    file_.read(buf, len);
+    size_t got = file_.gcount();
+    if (got < len) {
+      memset(buf + got, 0, len - got);
+      file_.clear();
+      return false;
+    }
+    return true;
+  }
+  if (io_mode_ == PageIOMode::Direct &&
+      (offset % Page::SIZE != 0 || len % Page::SIZE != 0 ||
+       reinterpret_cast<uintptr_t>(buf) % Page::SIZE != 0)) {
+    size_t start = offset / Page::SIZE * Page::SIZE;
+    size_t end = (offset + len + Page::SIZE - 1) / Page::SIZE * Page::SIZE;
+    auto bounce = std::unique_ptr<char, decltype(&std::free)>(
+      static_cast<char *>(std::aligned_alloc(Page::SIZE, end - start)),
+      &std::free);
+    bool ret = ReadAt(start, bounce.get(), end - start);
+    memcpy(buf, bounce.get() + (offset - start), len);
+    return ret;
+  }
+  size_t done = 0;
+  while (done < len) {
+    ssize_t ret = pread(fd_, buf + done, len - done, offset + done);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0) {
+      memset(buf + done, 0, len - done);
+      return false;
+    }
+    done += ret;
+  }
+  return true;
+}
+void PageManager::WriteAt(size_t offset, const char *buf, size_t len) {
+  if (io_mode_ == PageIOMode::Stream) {
+    std::lock_guard l(io_latch_);
+    file_.seekp(offset);
+    file_.write(buf, len);
+    return;
+  }
+  if (io_mode_ == PageIOMode::Direct &&
+      (offset % Page::SIZE != 0 || len % Page::SIZE != 0 ||
+       reinterpret_cast<uintptr_t>(buf) % Page::SIZE != 0)) {
+    // Read-modify-write. Only metadata is written this way, which is
+    // protected by latch_ or only accessed when opening or closing.
+    size_t start = offset / Page::SIZE * Page::SIZE;
+    size_t end = (offset + len + Page::SIZE - 1) / Page::SIZE * Page::SIZE;
+    auto bounce = std::unique_ptr<char, decltype(&std::free)>(
+      static_cast<char *>(std::aligned_alloc(Page::SIZE, end - start)),
+      &std::free);
+    ReadAt(start, bounce.get(), end - start);
+    memcpy(bounce.get() + (offset - start), buf, len);
+    WriteAt(start, bounce.get(), end - start);
+    return;
+  }
+  size_t done = 0;
+  while (done < len) {
+    ssize_t ret = pwrite(fd_, buf + done, len - done, offset + done);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret < 0)
+      DB_ERR("Fail to write file {}: {}", path_.string(), strerror(errno));
+    done += ret;
+  }
+}
+
 }
@@ -5,15 +5,21 @@
 #include "common/logging.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <list>
 #include <mutex>
 #include <optional>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <variant>
 #include <vector>
@@ -474,12 +480,40 @@ private:
   friend class PageManager;
 };
 
-// Evict the page that has been unpinned for the longest time.
+/* Decides which unpinned page buffer to evict when the buffer pool is full.
+ * A page becomes evictable when it is unpinned, and becomes unevictable again
+ * when it is pinned. Pages that are loaded and pinned but never unpinned are
+ * unknown to the policy.
+ */
 class EvictionPolicy {
 public:
-  pgid_t Evict() {
+  virtual ~EvictionPolicy() = default;
+  // Choose an evictable page and forget it. Return std::nullopt if there is no
+  // evictable page.
+  virtual std::optional<pgid_t> Evict() = 0;
+  // An evictable page is referenced again.
+  virtual void Pin(pgid_t pgid) = 0;
+  // The page becomes evictable.
+  virtual void Unpin(pgid_t pgid) = 0;
+  // Forget the page if it is known. Called when the page is freed.
+  virtual void Remove(pgid_t pgid) = 0;
+  // Append at most "n" evictable pages to "out" in the order they are likely
+  // to be evicted, without changing the state.
+  virtual void Peek(size_t n, std::vector<pgid_t>& out) const = 0;
+};
+
+enum class EvictionPolicyType {
+  FIFO,
+  Clock,
+  TwoQueue,
+};
+
+// Evict the page that has been unpinned for the longest time.
+class FIFOEvictionPolicy : public EvictionPolicy {
+public:
+  std::optional<pgid_t> Evict() override {
     if (evictable_.empty())
-      DB_ERR("Buffer size for PageManager is too small!");
+      return std::nullopt;
     pgid_t ret = evictable_.front();
     evictable_.pop_front();
     size_t erased = its_.erase(ret);
@@ -487,13 +521,13 @@ public:
     assert(erased == 1);
     return ret;
   }
-  void Pin(pgid_t pgid) {
+  void Pin(pgid_t pgid) override {
     auto it = its_.find(pgid);
     assert(it != its_.end());
     evictable_.erase(it->second);
     its_.erase(it);
   }
-  void Unpin(pgid_t pgid) {
+  void Unpin(pgid_t pgid) override {
     evictable_.push_back(pgid);
     auto it = evictable_.end();
     --it;
@@ -501,18 +535,272 @@ public:
     (void)ret;
     assert(ret.second);
   }
-  void Remove(pgid_t pgid) {
+  void Remove(pgid_t pgid) override {
     auto it = its_.find(pgid);
     if (it == its_.end())
       return;
     evictable_.erase(it->second);
     its_.erase(it);
   }
+  void Peek(size_t n, std::vector<pgid_t>& out) const override {
+    for (auto it = evictable_.begin(); n > 0 && it != evictable_.end(); ++it) {
+      out.push_back(*it);
+      n -= 1;
+    }
+  }
 private:
   std::unordered_map<pgid_t, std::list<pgid_t>::iterator> its_;
   std::list<pgid_t> evictable_;
 };
 
+/* CLOCK-sweep. Every known page occupies a slot of a fixed-size array with a
+ * reference bit. The clock hand sweeps the slots, clears the reference bits
+ * and evicts the first evictable page whose reference bit is already cleared.
+ * Pin and Unpin only flip flags of the slot, so there is no allocation when
+ * pages are re-referenced.
+ */
+class ClockEvictionPolicy : public EvictionPolicy {
+public:
+  ClockEvictionPolicy(size_t capacity)
+    : slots_(capacity), hand_(0), evictable_num_(0) {
+    free_slots_.reserve(capacity);
+    for (size_t i = capacity; i > 0; --i)
+      free_slots_.push_back(i - 1);
+    slot_of_.reserve(capacity);
+  }
+  std::optional<pgid_t> Evict() override {
+    if (evictable_num_ == 0)
+      return std::nullopt;
+    for (;;) {
+      Slot& slot = slots_[hand_];
+      size_t cur = hand_;
+      hand_ = hand_ + 1 == slots_.size() ? 0 : hand_ + 1;
+      if (!slot.evictable)
+        continue;
+      if (slot.referenced) {
+        slot.referenced = false;
+        continue;
+      }
+      pgid_t ret = slot.pgid;
+      ReleaseSlot(cur);
+      return ret;
+    }
+  }
+  void Pin(pgid_t pgid) override {
+    auto it = slot_of_.find(pgid);
+    assert(it != slot_of_.end());
+    Slot& slot = slots_[it->second];
+    assert(slot.evictable);
+    slot.evictable = false;
+    slot.referenced = true;
+    evictable_num_ -= 1;
+  }
+  void Unpin(pgid_t pgid) override {
+    auto it = slot_of_.find(pgid);
+    if (it == slot_of_.end()) {
+      assert(!free_slots_.empty());
+      size_t id = free_slots_.back();
+      free_slots_.pop_back();
+      it = slot_of_.emplace(pgid, id).first;
+      slots_[id].pgid = pgid;
+      slots_[id].used = true;
+    }
+    Slot& slot = slots_[it->second];
+    assert(!slot.evictable);
+    slot.evictable = true;
+    slot.referenced = true;
+    evictable_num_ += 1;
+  }
+  void Remove(pgid_t pgid) override {
+    auto it = slot_of_.find(pgid);
+    if (it == slot_of_.end())
+      return;
+    ReleaseSlot(it->second);
+  }
+  // Pages whose reference bits are cleared come first, then the others, both
+  // in the order of the sweep.
+  void Peek(size_t n, std::vector<pgid_t>& out) const override {
+    n = std::min(n, evictable_num_);
+    size_t end = out.size() + n;
+    for (bool referenced : {false, true}) {
+      for (size_t i = 0; i < slots_.size() && out.size() < end; ++i) {
+        const Slot& slot = slots_[(hand_ + i) % slots_.size()];
+        if (slot.evictable && slot.referenced == referenced)
+          out.push_back(slot.pgid);
+      }
+    }
+  }
+private:
+  struct Slot {
+    pgid_t pgid{0};
+    bool used{false};
+    bool evictable{false};
+    bool referenced{false};
+  };
+  void ReleaseSlot(size_t id) {
+    Slot& slot = slots_[id];
+    assert(slot.used);
+    if (slot.evictable)
+      evictable_num_ -= 1;
+    slot_of_.erase(slot.pgid);
+    slot = Slot();
+    free_slots_.push_back(id);
+  }
+  std::vector<Slot> slots_;
+  std::vector<size_t> free_slots_;
+  std::unordered_map<pgid_t, size_t> slot_of_;
+  size_t hand_;
+  size_t evictable_num_;
+};
+
+/* The 2Q policy. A page unpinned for the first time since loaded enters the
+ * FIFO queue "A1in". If it is referenced again while resident, or it is
+ * loaded again shortly after being evicted from A1in (its ID is still in the
+ * ghost queue "A1out"), it is regarded as hot and enters the LRU queue "Am"
+ * after being unpinned. Pages in A1in are evicted first as long as A1in is
+ * larger than its share of the buffer, so a large scan only cycles through
+ * A1in and does not flush hot pages such as B+tree inner pages out of Am.
+ */
+class TwoQueueEvictionPolicy : public EvictionPolicy {
+public:
+  TwoQueueEvictionPolicy(size_t capacity)
+    : a1in_max_(std::max<size_t>(capacity / 4, 1)),
+      a1out_max_(std::max<size_t>(capacity / 2, 1)) {}
+  std::optional<pgid_t> Evict() override {
+    std::list<pgid_t> *queue;
+    if (!a1in_.empty() && (a1in_.size() > a1in_max_ || am_.empty()))
+      queue = &a1in_;
+    else if (!am_.empty())
+      queue = &am_;
+    else if (!a1in_.empty())
+      queue = &a1in_;
+    else
+      return std::nullopt;
+    pgid_t ret = queue->front();
+    queue->pop_front();
+    entries_.erase(ret);
+    if (queue == &a1in_) {
+      a1out_.push_back(ret);
+      a1out_its_.emplace(ret, std::prev(a1out_.end()));
+      if (a1out_.size() > a1out_max_) {
+        a1out_its_.erase(a1out_.front());
+        a1out_.pop_front();
+      }
+    }
+    return ret;
+  }
+  void Pin(pgid_t pgid) override {
+    auto it = entries_.find(pgid);
+    assert(it != entries_.end() && it->second.queue != nullptr);
+    it->second.queue->erase(it->second.it);
+    it->second.queue = nullptr;
+    it->second.hot = true;
+  }
+  void Unpin(pgid_t pgid) override {
+    auto it = entries_.find(pgid);
+    if (it == entries_.end()) {
+      bool hot = RemoveGhost(pgid);
+      it = entries_.emplace(pgid, Entry{hot, nullptr, {}}).first;
+    }
+    Entry& entry = it->second;
+    assert(entry.queue == nullptr);
+    entry.queue = entry.hot ? &am_ : &a1in_;
+    entry.queue->push_back(pgid);
+    entry.it = std::prev(entry.queue->end());
+  }
+  void Remove(pgid_t pgid) override {
+    auto it = entries_.find(pgid);
+    if (it != entries_.end()) {
+      if (it->second.queue != nullptr)
+        it->second.queue->erase(it->second.it);
+      entries_.erase(it);
+    }
+    RemoveGhost(pgid);
+  }
+  void Peek(size_t n, std::vector<pgid_t>& out) const override {
+    auto a1in = a1in_.begin();
+    auto am = am_.begin();
+    size_t a1in_size = a1in_.size();
+    for (; n > 0; --n) {
+      if (a1in != a1in_.end() && (a1in_size > a1in_max_ || am == am_.end())) {
+        out.push_back(*a1in++);
+        a1in_size -= 1;
+      } else if (am != am_.end()) {
+        out.push_back(*am++);
+      } else {
+        break;
+      }
+    }
+  }
+private:
+  struct Entry {
+    bool hot;
+    // The queue this page is in. nullptr if the page is pinned.
+    std::list<pgid_t> *queue;
+    std::list<pgid_t>::iterator it;
+  };
+  // Return whether the page was in A1out.
+  bool RemoveGhost(pgid_t pgid) {
+    auto it = a1out_its_.find(pgid);
+    if (it == a1out_its_.end())
+      return false;
+    a1out_.erase(it->second);
+    a1out_its_.erase(it);
+    return true;
+  }
+  size_t a1in_max_;
+  size_t a1out_max_;
+  std::list<pgid_t> a1in_;
+  std::list<pgid_t> am_;
+  std::list<pgid_t> a1out_;
+  std::unordered_map<pgid_t, std::list<pgid_t>::iterator> a1out_its_;
+  std::unordered_map<pgid_t, Entry> entries_;
+};
+
+inline auto CreateEvictionPolicy(EvictionPolicyType type, size_t capacity)
+    -> std::unique_ptr<EvictionPolicy> {
+  switch (type) {
+    case EvictionPolicyType::FIFO:
+      return std::make_unique<FIFOEvictionPolicy>();
+    case EvictionPolicyType::Clock:
+      return std::make_unique<ClockEvictionPolicy>(capacity);
+    case EvictionPolicyType::TwoQueue:
+      return std::make_unique<TwoQueueEvictionPolicy>(capacity);
+  }
+  DB_ERR("Internal Error: Unknown eviction policy type");
+}
+
+/* Receives the images of pages on disk before they are overwritten. See
+ * PageManager::SetJournal.
+ */
+class PageJournal {
+public:
+  virtual ~PageJournal() = default;
+  // Save the image of the page. Return the sequence number of the record.
+  virtual uint64_t SavePageImage(pgid_t pgid, const char *image) = 0;
+  // Return after the records up to "seq" are durable.
+  virtual void SyncPageImages(uint64_t seq) = 0;
+};
+
+// How PageManager accesses the database file.
+enum class PageIOMode {
+  // std::fstream. Accesses are serialized by a latch.
+  Stream,
+  // pread/pwrite on a file descriptor. Accesses proceed in parallel.
+  Positional,
+  // Positional with O_DIRECT, which bypasses the kernel page cache.
+  Direct,
+};
+
+struct PageManagerOptions {
+  // See the comments of PageManager.
+  size_t num_partitions = 1;
+  EvictionPolicyType eviction_policy = EvictionPolicyType::FIFO;
+  PageIOMode io_mode = PageIOMode::Positional;
+  bool background_flush = false;
+  size_t clean_frames = 32;
+};
+
 /* Page 0: The meta page of PageManager.
  * Page 1: The pre-allocated super page for user. BPlusTreeStorage stores
  *  metadata (e.g., the meta page of B+tree) here.
@@ -534,6 +822,44 @@ private:
  * evicted depends on the eviction policy. When a page is evicted from the
  * buffer pool, if it is marked dirty with Page::MarkDirty(), it will be flushed
  * to disk.
+ *
+ * PageManagerOptions in Create/Open configures the page manager.
+ *
+ * The buffer pool can be split into several partitions with "num_partitions".
+ * A page is assigned to partition (pgid % num_partitions), and each partition
+ * has its own page buffers, eviction policy and latch, so that threads
+ * accessing pages in different partitions do not contend with each other. The
+ * "max_buf_pages - 1" buffer pages (one is for the pinned meta page) are
+ * divided evenly among the partitions, so every partition must be large enough
+ * to hold the pages pinned in it at the same time.
+ *
+ * The eviction policy of every partition is chosen by "eviction_policy".
+ *
+ * Frames are allocated from a page-aligned arena of each partition. A page
+ * miss, or writing back a dirty page before evicting it, does not hold the
+ * latch of the partition during the I/O, so with "io_mode" Positional or
+ * Direct, misses on the same partition are also served in parallel.
+ *
+ * Pages can be read ahead asynchronously with Prefetch(). The page is loaded
+ * into the buffer pool by background I/O threads and is unpinned after loaded.
+ * If GetPage finds a page that is still being loaded, it waits for the load to
+ * finish instead of reading the page again, which is counted as a stall.
+ *
+ * With "background_flush", a flusher thread periodically writes the dirty
+ * pages among the next "clean_frames" pages to be evicted in every partition
+ * (free frames count as well), so that a page miss seldom has to write back
+ * the victim before reading. Pages are written in the order of page ID, and
+ * adjacent pages are written with a single vectored write. A page being
+ * written by the flusher cannot be pinned until the write finishes.
+ *
+ * Checkpoint() writes all dirty pages, the free list and the meta page and
+ * syncs the file.
+ *
+ * With a PageJournal set by SetJournal(), the image of a page on disk is saved
+ * to the journal and made durable before the page is overwritten for the first
+ * time since the last ResetJournal(), so the file can be restored to its state
+ * at ResetJournal() with Restore(). Pages allocated after ResetJournal() are
+ * not journaled, because Restore() truncates the file.
  */
 class PageManager {
 public:
@@ -543,10 +869,12 @@ public:
   PageManager& operator=(PageManager&&) = delete;
   ~PageManager();
   static auto Create(
-    std::filesystem::path path, size_t max_buf_pages
+    std::filesystem::path path, size_t max_buf_pages,
+    const PageManagerOptions& options = {}
   ) -> std::unique_ptr<PageManager>;
   static auto Open(
-    std::filesystem::path path, size_t max_buf_pages
+    std::filesystem::path path, size_t max_buf_pages,
+    const PageManagerOptions& options = {}
   ) -> Result<std::unique_ptr<PageManager>, io::Error>;
   /* Allocate a page ID. You may use GetSortedPage or GetPlainPage later on
    * this page ID to get a handle for this page. Note that SortedPage should be
@@ -562,7 +890,6 @@ public:
   // Regard the page as PlainPage and return a handle that references its
   // buffer.
   PlainPage GetPlainPage(pgid_t pgid) {
-    std::lock_guard l(latch_);
     return PlainPage(GetPage(pgid));
   }
   // Regard the page as SortedPage and return a handle that references its
@@ -571,7 +898,6 @@ public:
   auto GetSortedPage(pgid_t pgid, const SlotKeyCompare& slot_key_comp,
     const SlotCompare& slot_comp
   ) -> SortedPage<SlotKeyCompare, SlotCompare> {
-    std::lock_guard l(latch_);
     return SortedPage<SlotKeyCompare, SlotCompare>(
       GetPage(pgid), slot_key_comp, slot_comp);
   }
@@ -592,70 +918,204 @@ public:
     return page;
   }
 
+  /* Asynchronously load the page into the buffer pool if it is not there.
+   * This is only a hint: the request may be dropped, e.g. if all buffer pages
+   * of the partition are pinned or too many requests are pending.
+   */
+  void Prefetch(pgid_t pgid);
+  /* Write all dirty pages, the free list and the meta page to disk, and sync
+   * the file. The caller should make sure that no page is being modified
+   * during the checkpoint.
+   */
+  void Checkpoint();
+  // Set the journal of page images. nullptr disables journaling.
+  void SetJournal(PageJournal *journal) { journal_ = journal; }
+  // Journal pages again before overwriting them.
+  void ResetJournal();
+  /* Write the page images to the file, which is not opened, and truncate it
+   * to "page_num" pages. If a page has multiple images, the first one is used.
+   */
+  static std::optional<io::Error> Restore(const std::filesystem::path& path,
+    const std::vector<std::pair<pgid_t, std::string_view>>& images,
+    pgid_t page_num);
+
   // Made public for test
   inline pgid_t& PageNum() {
-    return *(pgid_t *)(buf_[0].addr_mut() + PAGE_NUM_OFF);
+    return *(pgid_t *)(meta_.get() + PAGE_NUM_OFF);
   }
+  size_t NumPartitions() const { return num_partitions_; }
+
+  struct Stats {
+    // Number of GetPage calls that find the page in the buffer pool.
+    size_t hits{0};
+    // Number of GetPage calls that read the page from disk.
+    size_t misses{0};
+    // Number of pages loaded by Prefetch.
+    size_t prefetches{0};
+    // Number of GetPage calls that find a prefetched page which has not been
+    // accessed since loaded. They are also counted in "hits".
+    size_t prefetch_hits{0};
+    // Number of GetPage calls that wait for an in-progress prefetch.
+    size_t prefetch_stalls{0};
+    // Number of dirty pages written back when being evicted.
+    size_t foreground_writes{0};
+    // Number of dirty pages written by the flusher or Checkpoint, and the
+    // number of write calls for them.
+    size_t background_writes{0};
+    size_t background_write_ios{0};
+  };
+  // Sum of the statistics of all partitions.
+  Stats GetStats();
+  void ResetStats();
   // For test
   void ShrinkToFit();
 private:
   struct PageBufInfo {
-    const char *addr() const {
-      return reinterpret_cast<const char *>(buf.get());
-    }
-    char *addr_mut() { return reinterpret_cast<char *>(buf.get()); }
-    std::unique_ptr<char[]> buf;
+    const char *addr() const { return buf; }
+    char *addr_mut() { return buf; }
+    // A frame of the partition's arena.
+    char *buf;
     size_t refcount;
     bool dirty;
+    /* The page is in I/O without holding the partition latch, i.e., being
+     * loaded into the buffer, or being written back before eviction.
+     * The buffer must not be accessed until the I/O finishes.
+     */
+    bool loading{false};
+    // Loaded by a prefetch and not accessed yet.
+    bool prefetched{false};
+    // Being written by the flusher. The buffer can be read but not pinned.
+    bool flushing{false};
   };
-  PageManager(std::filesystem::path path, std::fstream&& file,
-      size_t max_buf_pages)
-    : path_(path),
-      file_(std::move(file)),
-      max_buf_pages_(max_buf_pages),
-      free_list_buf_(free_list_bufs_[0]),
-      free_list_buf_used_(0),
-      free_list_buf_standby_(free_list_bufs_[1]),
-      free_list_buf_standby_full_(false) {
-    // One buffer page is for pinned meta page.
-    assert(max_buf_pages_ >= 2);
-  }
+  // A partition of the buffer pool. All fields except "max_buf_pages" and
+  // "arena" are protected by "latch". Aligned to avoid false sharing between
+  // the latches.
+  struct alignas(64) Partition {
+    std::unordered_map<pgid_t, PageBufInfo> buf;
+    std::unique_ptr<EvictionPolicy> eviction_policy;
+    size_t max_buf_pages;
+    // Page::SIZE aligned memory for "max_buf_pages" frames, which meets the
+    // requirement of O_DIRECT.
+    std::unique_ptr<char, decltype(&std::free)> arena{nullptr, &std::free};
+    // Frames in the arena that are not used by any page.
+    std::vector<char *> free_frames;
+    Stats stats;
+    std::mutex latch;
+    // Notified when a page of this partition finishes I/O.
+    std::condition_variable loaded;
+  };
+  PageManager(std::filesystem::path path, size_t max_buf_pages,
+      const PageManagerOptions& options);
   static constexpr pgoff_t PGID_PER_PAGE = Page::SIZE / sizeof(pgid_t) - 1;
   static constexpr pgoff_t FREE_LIST_HEAD_OFF = 0;
   static constexpr pgoff_t FREE_PAGES_IN_HEAD = FREE_LIST_HEAD_OFF + sizeof(pgid_t);
   static constexpr pgoff_t PAGE_NUM_OFF = FREE_PAGES_IN_HEAD + sizeof(pgid_t);
   inline pgid_t& FreeListHead() {
-    return *(pgid_t *)(buf_[0].addr_mut() + FREE_LIST_HEAD_OFF);
+    return *(pgid_t *)(meta_.get() + FREE_LIST_HEAD_OFF);
   }
   inline pgid_t& FreePagesInHead() {
-    return *(pgid_t *)(buf_[0].addr_mut() + FREE_PAGES_IN_HEAD);
+    return *(pgid_t *)(meta_.get() + FREE_PAGES_IN_HEAD);
+  }
+  inline Partition& PartitionOf(pgid_t pgid) {
+    return partitions_[pgid % num_partitions_];
   }
 
   pgid_t __Allocate();
 
+  std::optional<io::Error> OpenFile(bool create);
   void AllocMeta();
   void Init();
   std::optional<io::Error> Load();
+  void CheckAccessible(pgid_t pgid);
+  /* Return a free frame of the partition, evicting a page if the partition is
+   * full. Return nullptr if all frames are pinned. If the evicted page is
+   * dirty, the latch is released while writing it back, so the caller should
+   * check the state of the partition again.
+   */
+  char *AllocFrame(Partition& part, std::unique_lock<std::mutex>& lock);
   Page GetPage(pgid_t pgid);
   void DropPage(pgid_t pgid, bool dirty);
   void FlushFreeListStandby(pgid_t pgid);
+  void PrefetchWorker();
+  void LoadPrefetch(pgid_t pgid);
+  void FlusherWorker();
+  /* Write dirty pages in the order of page ID. If "all" is false, only the
+   * dirty pages among the next "clean_frames_" victims of every partition are
+   * written. Otherwise pinned pages are written as well. Return the number of
+   * written pages.
+   */
+  size_t FlushDirtyPages(bool all);
+  // Write the pages, which are sorted by page ID and not accessible by
+  // others, and coalesce adjacent pages into one write.
+  void WritePages(const std::vector<std::pair<pgid_t, const char *>>& pages);
+  // Write the free list and the meta page. Requires latch_.
+  void FlushMeta();
+  // Called before overwriting the pages on disk.
+  void JournalPages(const pgid_t *pgids, size_t num);
+  /* All accesses to the file go through these two functions.
+   * In Stream mode they are serialized by io_latch_. In Direct mode, accesses
+   * that are not aligned to pages go through an aligned bounce buffer.
+   * Reading beyond the end of file gets zeros, and ReadAt returns false.
+   */
+  bool ReadAt(size_t offset, char *buf, size_t len);
+  void WriteAt(size_t offset, const char *buf, size_t len);
 
   std::filesystem::path path_;
+  PageIOMode io_mode_;
+  // Used in Stream mode.
   std::fstream file_;
+  // Used in Positional and Direct mode.
+  int fd_{-1};
   size_t max_buf_pages_;
+  size_t num_partitions_;
+  std::unique_ptr<Partition[]> partitions_;
+  // The buffer of the meta page, which is always in memory.
+  std::unique_ptr<char[]> meta_;
   pgid_t *free_list_buf_;
   size_t free_list_buf_used_;
   // The standby buffer is either full or empty.
   pgid_t *free_list_buf_standby_;
   bool free_list_buf_standby_full_;
-  std::unordered_map<pgid_t, PageBufInfo> buf_;
-  EvictionPolicy eviction_policy_;
   pgid_t free_list_bufs_[2][PGID_PER_PAGE];
 
   // For debugging
   std::vector<bool> is_free_;
-  
+
+  // Protects the meta page, the free list and is_free_.
+  // Lock order: latch_ -> Partition::latch -> io_latch_.
   std::mutex latch_;
+  std::mutex io_latch_;
+
+  static constexpr size_t PREFETCH_THREADS = 4;
+  static constexpr size_t MAX_PENDING_PREFETCHES = 1024;
+  // Protects prefetch_queue_, prefetch_threads_ and stop_prefetch_.
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
+  std::deque<pgid_t> prefetch_queue_;
+  // Started on the first Prefetch call.
+  std::vector<std::thread> prefetch_threads_;
+  bool stop_prefetch_{false};
+
+  static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(10);
+  // Pages written by one vectored write at most.
+  static constexpr size_t MAX_COALESCED_PAGES = 64;
+  size_t clean_frames_;
+  // Serializes FlushDirtyPages.
+  std::mutex flush_latch_;
+  // Protects stop_flusher_.
+  std::mutex flusher_latch_;
+  std::condition_variable flusher_cv_;
+  std::thread flusher_thread_;
+  bool stop_flusher_{false};
+  std::atomic<size_t> background_writes_{0};
+  std::atomic<size_t> background_write_ios_{0};
+
+  PageJournal *journal_{nullptr};
+  // Protects journal_base_ and journaled_, and serializes journaling.
+  std::mutex journal_latch_;
+  // Pages with ID >= journal_base_ are not journaled.
+  pgid_t journal_base_{0};
+  std::vector<bool> journaled_;
 
   friend class Page;
 };
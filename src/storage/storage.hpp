@@ -1,6 +1,7 @@
 #ifndef SAKURA_STORAGE_H__
 #define SAKURA_STORAGE_H__
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -18,6 +19,16 @@ class Iterator {
   virtual ~Iterator() = default;
   virtual void Init() = 0;
   virtual TupleType Next() = 0;
+  /* Read at most "max" tuples into "out" and return the number of tuples read.
+   * Return 0 if there are no more tuples. The tuples are valid until the next
+   * NextBatch() is called. Do not mix it with Next().
+   */
+  virtual size_t NextBatch(TupleType* out, size_t max) {
+    size_t num = 0;
+    while (num < max && (out[num] = Next()))
+      num += 1;
+    return num;
+  }
 };
 
 /**
@@ -51,6 +62,23 @@ class SearchHandle {
   virtual ~SearchHandle() = default;
   virtual void Init() = 0;
   virtual const uint8_t* Search(std::string_view key) = 0;
+  /* Search "n" keys in ascending order, and set out[i] to the row of keys[i],
+   * or nullptr if there is none. The rows are valid until the next search. */
+  virtual void SearchSorted(
+      const std::string_view* keys, size_t n, const uint8_t** out) = 0;
+};
+
+/**
+ * MorselSource. A scan split into ranges (morsels), so that several threads can
+ * read it in parallel.
+ * Next() returns an iterator over the next morsel that has not been handed
+ * out, or nullptr if there are no more morsels. It is thread-safe, but each
+ * iterator is used by one thread.
+ */
+class MorselSource {
+ public:
+  virtual ~MorselSource() = default;
+  virtual std::unique_ptr<Iterator<const uint8_t*>> Next() = 0;
 };
 
 }  // namespace wing
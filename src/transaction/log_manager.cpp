@@ -0,0 +1,298 @@
+#include "log_manager.hpp"
+
+#include <cstring>
+
+#include "common/logging.hpp"
+#include "common/murmurhash.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace wing {
+
+/* A record is laid out as:
+ * | size (4B) | checksum (4B) | type (1B) | txn_id (8B) | pgid (4B) |
+ * | len (4B) | table_name | len (4B) | key | len (4B) | value |
+ * "size" is the size of the whole record, and "checksum" covers everything
+ * after it, so that a torn write at the tail of the log can be detected.
+ */
+static constexpr size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+static constexpr size_t MIN_RECORD_SIZE = HEADER_SIZE + sizeof(uint8_t) +
+                                          sizeof(txn_id_t) + sizeof(pgid_t) +
+                                          3 * sizeof(uint32_t);
+static constexpr size_t CHECKSUM_SEED = 0x5a4b3c2d;
+
+static uint32_t Checksum(std::string_view body) {
+  return utils::Hash(body.data(), body.size(), CHECKSUM_SEED);
+}
+
+template <typename T>
+static void Put(std::string& out, T x) {
+  out.append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+static void PutString(std::string& out, std::string_view s) {
+  Put<uint32_t>(out, s.size());
+  out.append(s);
+}
+template <typename T>
+static bool Get(std::string_view& in, T& x) {
+  if (in.size() < sizeof(x))
+    return false;
+  memcpy(&x, in.data(), sizeof(x));
+  in.remove_prefix(sizeof(x));
+  return true;
+}
+static bool GetString(std::string_view& in, std::string& s) {
+  uint32_t len;
+  if (!Get(in, len) || in.size() < len)
+    return false;
+  s = in.substr(0, len);
+  in.remove_prefix(len);
+  return true;
+}
+
+std::string LogManager::Serialize(const LogRecord& record) {
+  std::string ret(HEADER_SIZE, '\0');
+  Put<uint8_t>(ret, static_cast<uint8_t>(record.type_));
+  Put<txn_id_t>(ret, record.txn_id_);
+  Put<pgid_t>(ret, record.pgid_);
+  PutString(ret, record.table_name_);
+  PutString(ret, record.key_);
+  PutString(ret, record.value_);
+  uint32_t size = ret.size();
+  uint32_t checksum = Checksum(std::string_view(ret).substr(HEADER_SIZE));
+  memcpy(ret.data(), &size, sizeof(size));
+  memcpy(ret.data() + sizeof(size), &checksum, sizeof(checksum));
+  return ret;
+}
+
+size_t LogManager::Deserialize(std::string_view data, LogRecord& record) {
+  uint32_t size, checksum;
+  if (!Get(data, size) || !Get(data, checksum))
+    return 0;
+  if (size < MIN_RECORD_SIZE || size - HEADER_SIZE > data.size())
+    return 0;
+  std::string_view body = data.substr(0, size - HEADER_SIZE);
+  if (Checksum(body) != checksum)
+    return 0;
+  uint8_t type;
+  bool good = Get(body, type) && Get(body, record.txn_id_) &&
+              Get(body, record.pgid_) && GetString(body, record.table_name_) &&
+              GetString(body, record.key_) && GetString(body, record.value_);
+  if (!good || !body.empty() ||
+      type > static_cast<uint8_t>(LogRecordType::CHECKPOINT))
+    return 0;
+  record.type_ = static_cast<LogRecordType>(type);
+  return size;
+}
+
+LogManager::~LogManager() {
+  Flush(end_lsn_);
+  close(fd_);
+}
+
+auto LogManager::Create(std::filesystem::path path)
+    -> Result<std::unique_ptr<LogManager>, io::Error> {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return io::Error::New(io::ErrorKind::Other,
+        "Fail to create log " + path.string() + ": " + strerror(errno));
+  return std::unique_ptr<LogManager>(new LogManager(std::move(path), fd, 0));
+}
+
+auto LogManager::Open(std::filesystem::path path,
+    std::vector<LogRecord>& records)
+    -> Result<std::unique_ptr<LogManager>, io::Error> {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return io::Error::New(io::ErrorKind::Other,
+        "Fail to open log " + path.string() + ": " + strerror(errno));
+  std::string data;
+  char buf[1 << 16];
+  for (;;) {
+    ssize_t ret = read(fd, buf, sizeof(buf));
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret < 0) {
+      close(fd);
+      return io::Error::New(io::ErrorKind::Other,
+          "Fail to read log " + path.string() + ": " + strerror(errno));
+    }
+    if (ret == 0)
+      break;
+    data.append(buf, ret);
+  }
+  size_t end = 0;
+  for (;;) {
+    LogRecord record;
+    size_t size = Deserialize(std::string_view(data).substr(end), record);
+    if (size == 0)
+      break;
+    records.push_back(std::move(record));
+    end += size;
+  }
+  if (end < data.size()) {
+    DB_INFO("Truncate the torn tail of log {}: {} bytes", path.string(),
+        data.size() - end);
+    if (ftruncate(fd, end) != 0) {
+      close(fd);
+      return io::Error::New(io::ErrorKind::Other,
+          "Fail to truncate log " + path.string() + ": " + strerror(errno));
+    }
+  }
+  return std::unique_ptr<LogManager>(new LogManager(std::move(path), fd, end));
+}
+
+lsn_t LogManager::AppendLocked(const LogRecord& record) {
+  std::string data = Serialize(record);
+  buf_.append(data);
+  end_lsn_ += data.size();
+  return end_lsn_;
+}
+
+lsn_t LogManager::Append(const LogRecord& record) {
+  std::lock_guard l(latch_);
+  return AppendLocked(record);
+}
+
+lsn_t LogManager::AppendModify(txn_id_t txn_id, ModifyType type,
+    std::string_view table_name, std::string_view key,
+    std::string_view value) {
+  LogRecord record{
+      .txn_id_ = txn_id,
+      .table_name_ = std::string(table_name),
+      .key_ = std::string(key),
+  };
+  switch (type) {
+    case ModifyType::INSERT:
+      record.type_ = LogRecordType::INSERT;
+      record.value_ = value;
+      break;
+    case ModifyType::DELETE:
+      record.type_ = LogRecordType::DELETE;
+      break;
+    case ModifyType::UPDATE:
+      record.type_ = LogRecordType::UPDATE;
+      record.value_ = value;
+      break;
+  }
+  std::lock_guard l(latch_);
+  active_txns_.insert(txn_id);
+  return AppendLocked(record);
+}
+
+void LogManager::Flush(lsn_t lsn) {
+  std::unique_lock l(latch_);
+  while (flushed_lsn_ < lsn) {
+    if (flushing_) {
+      // Someone else is flushing. The records appended after that flush
+      // started will be flushed by the next one, possibly us.
+      flushed_.wait(l);
+      continue;
+    }
+    flushing_ = true;
+    std::string data;
+    data.swap(buf_);
+    lsn_t start = flushed_lsn_;
+    lsn_t end = end_lsn_;
+    l.unlock();
+    WriteAll(fd_, data, start);
+    if (fdatasync(fd_) != 0)
+      DB_ERR("Fail to sync log {}: {}", path_.string(), strerror(errno));
+    l.lock();
+    flushed_lsn_ = end;
+    flushing_ = false;
+    stats_.syncs += 1;
+    flushed_.notify_all();
+  }
+}
+
+void LogManager::Commit(txn_id_t txn_id) {
+  lsn_t lsn;
+  {
+    std::lock_guard l(latch_);
+    // Nothing to make durable for read-only txns.
+    if (active_txns_.find(txn_id) == active_txns_.end())
+      return;
+    lsn = AppendLocked(
+        LogRecord{.type_ = LogRecordType::COMMIT, .txn_id_ = txn_id});
+  }
+  Flush(lsn);
+  std::lock_guard l(latch_);
+  active_txns_.erase(txn_id);
+  stats_.commits += 1;
+}
+
+void LogManager::Abort(txn_id_t txn_id) {
+  std::lock_guard l(latch_);
+  if (active_txns_.erase(txn_id) == 0)
+    return;
+  // Not necessary for recovery, which regards txns without COMMIT as aborted.
+  AppendLocked(LogRecord{.type_ = LogRecordType::ABORT, .txn_id_ = txn_id});
+}
+
+bool LogManager::HasActiveTxns() {
+  std::lock_guard l(latch_);
+  return !active_txns_.empty();
+}
+
+void LogManager::Reset(pgid_t page_num) {
+  std::unique_lock l(latch_);
+  flushed_.wait(l, [&]() { return !flushing_; });
+  std::string data = Serialize(
+      LogRecord{.type_ = LogRecordType::CHECKPOINT, .pgid_ = page_num});
+  // Write the new log aside and rename it, so that a crash leaves either the
+  // old log or the new one.
+  std::filesystem::path tmp = path_.string() + ".tmp";
+  int fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    DB_ERR("Fail to create log {}: {}", tmp.string(), strerror(errno));
+  WriteAll(fd, data, 0);
+  if (fdatasync(fd) != 0)
+    DB_ERR("Fail to sync log {}: {}", tmp.string(), strerror(errno));
+  std::filesystem::rename(tmp, path_);
+  auto dir = path_.parent_path();
+  int dir_fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+  if (dir_fd >= 0) {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+  close(fd_);
+  fd_ = fd;
+  buf_.clear();
+  end_lsn_ = flushed_lsn_ = data.size();
+  stats_.syncs += 1;
+}
+
+size_t LogManager::Size() {
+  std::lock_guard l(latch_);
+  return end_lsn_;
+}
+
+auto LogManager::GetStats() -> Stats {
+  std::lock_guard l(latch_);
+  return stats_;
+}
+
+uint64_t LogManager::SavePageImage(pgid_t pgid, const char* image) {
+  return Append(LogRecord{
+      .type_ = LogRecordType::PAGE_IMAGE,
+      .value_ = std::string(image, Page::SIZE),
+      .pgid_ = pgid,
+  });
+}
+
+void LogManager::WriteAll(int fd, std::string_view data, lsn_t offset) {
+  size_t done = 0;
+  while (done < data.size()) {
+    ssize_t ret =
+        pwrite(fd, data.data() + done, data.size() - done, offset + done);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret < 0)
+      DB_ERR("Fail to write log {}: {}", path_.string(), strerror(errno));
+    done += ret;
+  }
+}
+
+}  // namespace wing
@@ -0,0 +1,143 @@
+#ifndef SAKURA_LOG_MANAGER_H__
+#define SAKURA_LOG_MANAGER_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "common/error.hpp"
+#include "storage/page-manager.hpp"
+#include "txn.hpp"
+
+namespace wing {
+
+// Log sequence number. It is the offset of the end of the record in the log.
+typedef uint64_t lsn_t;
+
+enum class LogRecordType : uint8_t {
+  // Row modifications. They are redone if the txn commits.
+  INSERT,
+  DELETE,
+  UPDATE,
+  COMMIT,
+  ABORT,
+  // DDL. They are always redone.
+  CREATE_TABLE,
+  DROP_TABLE,
+  // The image of a page before it is overwritten.
+  PAGE_IMAGE,
+  // The first record of the log.
+  CHECKPOINT,
+};
+
+struct LogRecord {
+  LogRecordType type_;
+  txn_id_t txn_id_{INVALID_TXN_ID};
+  // The table of row modifications and DDL.
+  std::string table_name_;
+  std::string key_;
+  // The new value of INSERT and UPDATE, the serialized schema of CREATE_TABLE,
+  // or the page image of PAGE_IMAGE.
+  std::string value_;
+  // The page of PAGE_IMAGE, or the number of pages of CHECKPOINT.
+  pgid_t pgid_{0};
+};
+
+/**
+ * The write-ahead log of BPlusTreeStorage.
+ *
+ * The log starts with a CHECKPOINT record written when the database file is
+ * consistent. After that, PageManager saves the image of a page to the log
+ * before it overwrites the page for the first time, and the row modifications
+ * and DDL are logged before they are applied. So recovery restores the file to
+ * the checkpoint with the page images, and then redoes the DDL and the row
+ * modifications of committed txns in order. A checkpoint can be taken only if
+ * there is no active txn that has modified anything, and replaces the log with
+ * a new one.
+ *
+ * Commit() returns after the COMMIT record is durable. Records are buffered in
+ * memory, and the first committer that finds no flush in progress writes the
+ * buffer and syncs the log for all of them, while the others wait for it, so
+ * concurrent commits share one fsync.
+ */
+class LogManager : public PageJournal {
+ public:
+  struct Stats {
+    // Number of txns that committed with modifications.
+    size_t commits{0};
+    // Number of fsyncs.
+    size_t syncs{0};
+  };
+
+  LogManager(const LogManager&) = delete;
+  LogManager& operator=(const LogManager&) = delete;
+  ~LogManager();
+  // Create an empty log. The existing one is truncated.
+  static auto Create(std::filesystem::path path)
+      -> Result<std::unique_ptr<LogManager>, io::Error>;
+  // Read the valid records of the log into "records" and open it for
+  // appending. A torn tail is truncated. A missing log is regarded as empty.
+  static auto Open(std::filesystem::path path, std::vector<LogRecord>& records)
+      -> Result<std::unique_ptr<LogManager>, io::Error>;
+
+  lsn_t Append(const LogRecord& record);
+  // Log a row modification of the txn. "value" is ignored for DELETE.
+  lsn_t AppendModify(txn_id_t txn_id, ModifyType type,
+      std::string_view table_name, std::string_view key,
+      std::string_view value);
+  // Return after the records up to "lsn" are durable.
+  void Flush(lsn_t lsn);
+  // Log the commit of the txn and wait for it to be durable.
+  void Commit(txn_id_t txn_id);
+  void Abort(txn_id_t txn_id);
+  // Whether there is a txn that has modified something and is not finished.
+  bool HasActiveTxns();
+  // Replace the log with a new one that only contains a CHECKPOINT record.
+  void Reset(pgid_t page_num);
+  // The size of the log in bytes.
+  size_t Size();
+  // Held shared when logging and applying a modification, and exclusively
+  // when taking a checkpoint.
+  std::shared_mutex& CheckpointLatch() { return checkpoint_latch_; }
+  Stats GetStats();
+
+  uint64_t SavePageImage(pgid_t pgid, const char* image) override;
+  void SyncPageImages(uint64_t seq) override { Flush(seq); }
+
+ private:
+  LogManager(std::filesystem::path path, int fd, lsn_t end)
+    : path_(std::move(path)), fd_(fd), end_lsn_(end), flushed_lsn_(end) {}
+  static std::string Serialize(const LogRecord& record);
+  // Return the size of the record, or 0 if "data" does not start with a valid
+  // record.
+  static size_t Deserialize(std::string_view data, LogRecord& record);
+  // Requires latch_.
+  lsn_t AppendLocked(const LogRecord& record);
+  void WriteAll(int fd, std::string_view data, lsn_t offset);
+
+  std::filesystem::path path_;
+  int fd_;
+  // Protects all fields below.
+  std::mutex latch_;
+  // Records that are not written yet.
+  std::string buf_;
+  lsn_t end_lsn_;
+  lsn_t flushed_lsn_;
+  bool flushing_{false};
+  std::condition_variable flushed_;
+  std::unordered_set<txn_id_t> active_txns_;
+  Stats stats_;
+
+  std::shared_mutex checkpoint_latch_;
+};
+
+}  // namespace wing
+
+#endif
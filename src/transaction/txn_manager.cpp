@@ -20,14 +20,19 @@ Txn* TxnManager::Begin() {
 }
 
 void TxnManager::Commit(Txn* txn) {
+  // The modifications must be durable before they are visible to others.
+  storage_.log_->Commit(txn->txn_id_);
   txn->state_ = TxnState::COMMITTED;
   // Release all the locks
   ReleaseAllLocks(txn);
+  storage_.MaybeCheckpoint();
 }
 
 void TxnManager::Abort(Txn* txn) {
   // P4 TODO: rollback
   txn->state_ = TxnState::ABORTED;
+  // The rollback is not logged, so no checkpoint may happen in the middle.
+  std::shared_lock checkpoint_latch(storage_.log_->CheckpointLatch());
   while(!txn->modify_records_.empty())
   {
     auto t=txn->modify_records_.top(); txn->modify_records_.pop();
@@ -64,6 +69,8 @@ void TxnManager::Abort(Txn* txn) {
       assert(0);
     }
   }
+  checkpoint_latch.unlock();
+  storage_.log_->Abort(txn->txn_id_);
   // Release all the locks.
   ReleaseAllLocks(txn);
 }
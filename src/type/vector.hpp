@@ -145,6 +145,9 @@ class TupleVector {
 
   void Clear() { allocator_.Clear(); }
 
+  /* The memory used by the tuples. */
+  size_t MemoryUsage() const { return allocator_.Allocated(); }
+
  private:
   /* Check if it is raw data. i.e. the serialized tuple stored in B+tree. */
   bool is_raw_data_flag_{false};
@@ -179,6 +182,18 @@ class TupleStore {
   /* Get all tuples. */
   const std::vector<uint8_t*>& GetPointerVec() const { return pointer_vec_; }
 
+  /* Remove all tuples. */
+  void Clear() {
+    tuple_vec_.Clear();
+    pointer_vec_.clear();
+  }
+
+  /* The memory used by the tuples and the pointers. */
+  size_t MemoryUsage() const {
+    return tuple_vec_.MemoryUsage() +
+           pointer_vec_.capacity() * sizeof(uint8_t*);
+  }
+
  private:
   /* The TupleVector. */
   TupleVector tuple_vec_;
@@ -0,0 +1,429 @@
+#include "storage/page-manager.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "common/stopwatch.hpp"
+#include "storage/bplus-tree.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static inline std::string test_name() {
+  auto info = ::testing::UnitTest::GetInstance()->current_test_info();
+  return std::string(info->test_suite_name()) + '.' + info->name();
+}
+
+// Fill each page with its page ID, so that the content can be checked later.
+static std::vector<wing::pgid_t> PreparePages(
+    wing::PageManager& pgm, size_t num) {
+  std::vector<wing::pgid_t> pages;
+  for (size_t i = 0; i < num; ++i) {
+    auto page = pgm.AllocPlainPage();
+    wing::pgid_t id = page.ID();
+    for (size_t off = 0; off < wing::Page::SIZE; off += sizeof(id))
+      page.Write(off, std::string_view((const char *)&id, sizeof(id)));
+    pages.push_back(id);
+  }
+  return pages;
+}
+
+// Each thread repeatedly gets a random page, checks it and drops it.
+// Return the number of operations per second.
+static double RunGetDrop(wing::PageManager& pgm,
+    const std::vector<wing::pgid_t>& pages, size_t num_threads,
+    size_t ops_per_thread) {
+  std::atomic<bool> ok = true;
+  std::vector<std::thread> threads;
+  wing::StopWatch sw;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::minstd_rand e(t + 1);
+      std::uniform_int_distribution<size_t> dist(0, pages.size() - 1);
+      for (size_t i = 0; i < ops_per_thread; ++i) {
+        wing::pgid_t id = pages[dist(e)];
+        auto page = pgm.GetPlainPage(id);
+        wing::pgid_t got;
+        page.Read(&got, wing::Page::SIZE - sizeof(got), sizeof(got));
+        if (got != id)
+          ok = false;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  double time = sw.GetTimeInSeconds();
+  EXPECT_TRUE(ok);
+  return num_threads * ops_per_thread / time;
+}
+
+TEST(PageManagerTest, Partitioned) {
+  std::string path = test_name();
+  constexpr size_t NUM_PAGES = 2000;
+  for (size_t parts : {1, 4, 16}) {
+    {
+      // The buffer is smaller than the data, so pages will be evicted.
+      auto pgm = wing::PageManager::Create(path, 513, {.num_partitions = parts});
+      ASSERT_EQ(pgm->NumPartitions(), parts);
+      auto pages = PreparePages(*pgm, NUM_PAGES);
+      RunGetDrop(*pgm, pages, 8, 20000);
+      for (size_t i = 0; i < pages.size(); i += 2)
+        pgm->Free(pages[i]);
+    }
+    {
+      auto ret = wing::PageManager::Open(path, 513, {.num_partitions = parts});
+      ASSERT_EQ(ret.index(), 0);
+      auto pgm = std::move(std::get<0>(ret));
+      std::vector<wing::pgid_t> pages;
+      for (size_t i = 0; i < NUM_PAGES / 2; ++i) {
+        wing::pgid_t id = pgm->Allocate();
+        pgm->Free(id);
+      }
+      for (wing::pgid_t id = 3; id < pgm->PageNum(); id += 2)
+        pages.push_back(id);
+      RunGetDrop(*pgm, pages, 8, 20000);
+    }
+  }
+  fs::remove(path);
+}
+
+// O_DIRECT is not supported by some file systems, e.g., tmpfs.
+static bool DirectIOSupported(const std::string& path) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+  if (fd < 0)
+    return false;
+  close(fd);
+  fs::remove(path);
+  return true;
+}
+
+static std::vector<std::pair<wing::PageIOMode, const char *>> IOModes(
+    const std::string& path) {
+  std::vector<std::pair<wing::PageIOMode, const char *>> modes = {
+      {wing::PageIOMode::Stream, "fstream"},
+      {wing::PageIOMode::Positional, "pread/pwrite"},
+  };
+  if (DirectIOSupported(path))
+    modes.emplace_back(wing::PageIOMode::Direct, "O_DIRECT");
+  else
+    DB_INFO("O_DIRECT is not supported here, skipped");
+  return modes;
+}
+
+TEST(PageManagerTest, IOModes) {
+  std::string path = test_name();
+  constexpr size_t NUM_PAGES = 3000;
+  for (auto [mode, name] : IOModes(path)) {
+    {
+      auto pgm = wing::PageManager::Create(
+          path, 257, {.num_partitions = 4, .io_mode = mode});
+      auto pages = PreparePages(*pgm, NUM_PAGES);
+      RunGetDrop(*pgm, pages, 4, 20000);
+      // Free enough pages to flush some free list pages to disk.
+      for (size_t i = 0; i < pages.size(); i += 2)
+        pgm->Free(pages[i]);
+    }
+    {
+      auto ret = wing::PageManager::Open(path, 257, {.io_mode = mode});
+      ASSERT_EQ(ret.index(), 0);
+      auto pgm = std::move(std::get<0>(ret));
+      std::vector<wing::pgid_t> pages;
+      for (wing::pgid_t id = 3; id < pgm->PageNum(); id += 2)
+        pages.push_back(id);
+      ASSERT_EQ(pages.size(), NUM_PAGES / 2);
+      RunGetDrop(*pgm, pages, 4, 20000);
+      // Freed pages are reused.
+      for (size_t i = 0; i < NUM_PAGES / 2; ++i)
+        ASSERT_EQ(pgm->Allocate() % 2, 0);
+    }
+  }
+  fs::remove(path);
+}
+
+TEST(PageManagerTest, EvictionPolicies) {
+  std::string path = test_name();
+  for (auto policy : {wing::EvictionPolicyType::FIFO,
+           wing::EvictionPolicyType::Clock,
+           wing::EvictionPolicyType::TwoQueue}) {
+    auto pgm = wing::PageManager::Create(
+        path, 129, {.num_partitions = 2, .eviction_policy = policy});
+    auto pages = PreparePages(*pgm, 1000);
+    RunGetDrop(*pgm, pages, 4, 20000);
+    // Hold some pages pinned so that eviction has to skip them.
+    std::vector<wing::PlainPage> pinned;
+    for (size_t i = 0; i < 32; ++i)
+      pinned.push_back(pgm->GetPlainPage(pages[i * 7]));
+    RunGetDrop(*pgm, pages, 4, 20000);
+    pinned.clear();
+    for (size_t i = 0; i < pages.size(); i += 3)
+      pgm->Free(pages[i]);
+    auto stats = pgm->GetStats();
+    ASSERT_GT(stats.misses, 0);
+    ASSERT_GT(stats.hits, 0);
+  }
+  fs::remove(path);
+}
+
+// Pages are modified concurrently with the flusher. A copy of the file taken
+// right after Checkpoint() should be a consistent database.
+TEST(PageManagerTest, BackgroundFlush) {
+  std::string path = test_name();
+  std::string copy = path + ".ckpt";
+  constexpr size_t NUM_PAGES = 1000;
+  constexpr size_t NUM_THREADS = 4;
+  for (auto policy : {wing::EvictionPolicyType::FIFO,
+           wing::EvictionPolicyType::Clock,
+           wing::EvictionPolicyType::TwoQueue}) {
+    auto pgm = wing::PageManager::Create(path, 129,
+        {.num_partitions = 4, .eviction_policy = policy,
+         .background_flush = true, .clean_frames = 16});
+    auto pages = PreparePages(*pgm, NUM_PAGES);
+    // The first 4 bytes of a page is its version. Thread t only modifies
+    // pages[i] with i % NUM_THREADS == t.
+    std::vector<uint32_t> version(NUM_PAGES, 0);
+    std::vector<bool> live(NUM_PAGES, true);
+    auto modify = [&](size_t ops) {
+      std::atomic<bool> ok = true;
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+          std::minstd_rand e(t + ops);
+          std::uniform_int_distribution<size_t> dist(
+            0, NUM_PAGES / NUM_THREADS - 1);
+          for (size_t i = 0; i < ops; ++i) {
+            size_t idx = dist(e) * NUM_THREADS + t;
+            if (!live[idx])
+              continue;
+            auto page = pgm->GetPlainPage(pages[idx]);
+            uint32_t got;
+            page.Read(&got, 0, sizeof(got));
+            if (got != (version[idx] == 0 ? pages[idx] : version[idx]))
+              ok = false;
+            if (i % 2 == 0) {
+              version[idx] += 1;
+              page.Write(0, std::string_view(
+                (const char *)&version[idx], sizeof(uint32_t)));
+            }
+          }
+        });
+      }
+      for (auto& thread : threads)
+        thread.join();
+      ASSERT_TRUE(ok);
+    };
+    modify(20000);
+    std::set<wing::pgid_t> freed;
+    for (size_t i = 0; i < NUM_PAGES; i += 5) {
+      pgm->Free(pages[i]);
+      freed.insert(pages[i]);
+      live[i] = false;
+    }
+    auto snapshot = version;
+    pgm->Checkpoint();
+    fs::copy_file(path, copy, fs::copy_options::overwrite_existing);
+    modify(20000);
+    auto stats = pgm->GetStats();
+    ASSERT_GT(stats.background_writes, 0);
+    ASSERT_LE(stats.background_write_ios, stats.background_writes);
+
+    auto ret = wing::PageManager::Open(copy, 129);
+    ASSERT_EQ(ret.index(), 0);
+    auto ckpt = std::move(std::get<0>(ret));
+    for (size_t i = 0; i < NUM_PAGES; ++i) {
+      if (!live[i])
+        continue;
+      auto page = ckpt->GetPlainPage(pages[i]);
+      uint32_t got;
+      page.Read(&got, 0, sizeof(got));
+      ASSERT_EQ(got, snapshot[i] == 0 ? pages[i] : snapshot[i]);
+    }
+    for (size_t i = 0; i < freed.size(); ++i)
+      ASSERT_TRUE(freed.count(ckpt->Allocate()));
+  }
+  fs::remove(path);
+  fs::remove(copy);
+}
+
+TEST(PageManagerBenchmark, ConcurrentGetPage) {
+  std::string path = test_name();
+  constexpr size_t NUM_PAGES = 4096;
+  constexpr size_t OPS = 400000;
+  for (size_t parts : {1, 64}) {
+    auto pgm = wing::PageManager::Create(
+        path, 2 * NUM_PAGES, {.num_partitions = parts});
+    auto pages = PreparePages(*pgm, NUM_PAGES);
+    for (size_t threads = 1; threads <= 32; threads *= 2) {
+      double ops = RunGetDrop(*pgm, pages, threads, OPS / threads);
+      DB_INFO("partitions: {}, threads: {}, {:.0f} ops/s", parts, threads, ops);
+    }
+  }
+  fs::remove(path);
+}
+
+// Point lookups on a hot key range, interleaved with full scans of a table
+// much larger than the buffer pool.
+TEST(PageManagerBenchmark, EvictionPolicyScanMix) {
+  std::string path = test_name();
+  constexpr size_t NUM_KEYS = 100000;
+  constexpr size_t HOT_KEYS = NUM_KEYS / 10;
+  constexpr size_t ROUNDS = 5;
+  constexpr size_t LOOKUPS_PER_ROUND = 5000;
+  auto key_of = [](size_t i) { return fmt::format("{:08}", i); };
+  std::string value(100, 'v');
+  for (auto [policy, name] : {
+           std::make_pair(wing::EvictionPolicyType::FIFO, "FIFO"),
+           std::make_pair(wing::EvictionPolicyType::Clock, "CLOCK"),
+           std::make_pair(wing::EvictionPolicyType::TwoQueue, "2Q")}) {
+    auto pgm = wing::PageManager::Create(
+        path, 1024, {.eviction_policy = policy});
+    auto tree = wing::BPlusTree<std::compare_three_way>::Create(*pgm);
+    for (size_t i = 0; i < NUM_KEYS; ++i)
+      tree.Insert(key_of(i), value);
+    std::minstd_rand e(233);
+    std::uniform_int_distribution<size_t> dist(0, HOT_KEYS - 1);
+    double lookup_time = 0;
+    wing::PageManager::Stats lookup_stats;
+    for (size_t round = 0; round < ROUNDS; ++round) {
+      pgm->ResetStats();
+      wing::StopWatch sw;
+      for (size_t i = 0; i < LOOKUPS_PER_ROUND; ++i)
+        ASSERT_TRUE(tree.Get(key_of(dist(e))).has_value());
+      lookup_time += sw.GetTimeInSeconds();
+      auto stats = pgm->GetStats();
+      lookup_stats.hits += stats.hits;
+      lookup_stats.misses += stats.misses;
+      size_t cnt = 0;
+      for (auto it = tree.Begin(); it.Cur().has_value(); it.Next())
+        cnt += 1;
+      ASSERT_EQ(cnt, NUM_KEYS);
+    }
+    DB_INFO("{}: lookup hit ratio {:.4f}, {:.3f} us per lookup", name,
+        (double)lookup_stats.hits / (lookup_stats.hits + lookup_stats.misses),
+        lookup_time * 1e6 / (ROUNDS * LOOKUPS_PER_ROUND));
+  }
+  fs::remove(path);
+}
+
+// Cold full scans of a B+tree with different read-ahead windows.
+TEST(PageManagerBenchmark, ScanReadAhead) {
+  std::string path = test_name();
+  constexpr size_t NUM_KEYS = 100000;
+  auto key_of = [](size_t i) { return fmt::format("{:08}", i); };
+  wing::pgid_t meta;
+  {
+    auto pgm = wing::PageManager::Create(path, 1024);
+    auto tree = wing::BPlusTree<std::compare_three_way>::Create(*pgm);
+    std::string value(100, 'v');
+    for (size_t i = 0; i < NUM_KEYS; ++i)
+      tree.Insert(key_of(i), value);
+    meta = tree.MetaPageID();
+  }
+  for (size_t window : {0, 1, 8, 32, 128}) {
+    // Reopen so that the buffer pool is empty.
+    auto ret = wing::PageManager::Open(path, 1024);
+    ASSERT_EQ(ret.index(), 0);
+    auto pgm = std::move(std::get<0>(ret));
+    auto tree = wing::BPlusTree<std::compare_three_way>::Open(*pgm, meta);
+    wing::StopWatch sw;
+    size_t cnt = 0;
+    auto it = tree.Begin();
+    it.SetReadAhead(window);
+    for (; it.Cur().has_value(); it.Next()) {
+      ASSERT_EQ(it.Cur().value().first, key_of(cnt));
+      cnt += 1;
+    }
+    double time = sw.GetTimeInSeconds();
+    ASSERT_EQ(cnt, NUM_KEYS);
+    auto stats = pgm->GetStats();
+    if (window > 0) {
+      ASSERT_GT(stats.prefetches, 0);
+    }
+    DB_INFO("window {}: {:.3f} s, misses {}, prefetches {}, prefetch hits {}, "
+            "stalls {}",
+        window, time, stats.misses, stats.prefetches, stats.prefetch_hits,
+        stats.prefetch_stalls);
+  }
+  fs::remove(path);
+}
+
+// Random page accesses on data much larger than the buffer pool, so that
+// most accesses miss. Half of the accesses dirty the page.
+TEST(PageManagerBenchmark, IOModes) {
+  std::string path = test_name();
+  constexpr size_t NUM_PAGES = 16384;
+  constexpr size_t OPS = 100000;
+  for (auto [mode, name] : IOModes(path)) {
+    auto pgm = wing::PageManager::Create(
+        path, 1025, {.num_partitions = 16, .io_mode = mode});
+    auto pages = PreparePages(*pgm, NUM_PAGES);
+    for (size_t threads : {1, 4, 16}) {
+      std::vector<std::thread> workers;
+      wing::StopWatch sw;
+      for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+          std::minstd_rand e(t + 1);
+          std::uniform_int_distribution<size_t> dist(0, NUM_PAGES - 1);
+          for (size_t i = 0; i < OPS / threads; ++i) {
+            auto page = pgm->GetPlainPage(pages[dist(e)]);
+            if (i % 2 == 0)
+              page.MarkDirty();
+          }
+        });
+      }
+      for (auto& worker : workers)
+        worker.join();
+      DB_INFO("{}, threads: {}, {:.0f} ops/s", name, threads,
+          OPS / sw.GetTimeInSeconds());
+    }
+  }
+  fs::remove(path);
+}
+
+// Random page accesses that dirty half of the pages they access, with and
+// without the background flusher.
+TEST(PageManagerBenchmark, BackgroundFlush) {
+  std::string path = test_name();
+  constexpr size_t NUM_PAGES = 16384;
+  constexpr size_t OPS = 100000;
+  constexpr size_t NUM_THREADS = 4;
+  for (bool flush : {false, true}) {
+    auto pgm = wing::PageManager::Create(path, 1025,
+        {.num_partitions = 16, .background_flush = flush,
+         .clean_frames = 16});
+    auto pages = PreparePages(*pgm, NUM_PAGES);
+    pgm->ResetStats();
+    std::vector<std::thread> workers;
+    wing::StopWatch sw;
+    for (size_t t = 0; t < NUM_THREADS; ++t) {
+      workers.emplace_back([&, t]() {
+        std::minstd_rand e(t + 1);
+        std::uniform_int_distribution<size_t> dist(0, NUM_PAGES - 1);
+        for (size_t i = 0; i < OPS / NUM_THREADS; ++i) {
+          auto page = pgm->GetPlainPage(pages[dist(e)]);
+          if (i % 2 == 0)
+            page.MarkDirty();
+        }
+      });
+    }
+    for (auto& worker : workers)
+      worker.join();
+    double time = sw.GetTimeInSeconds();
+    auto stats = pgm->GetStats();
+    sw.Reset();
+    pgm->Checkpoint();
+    DB_INFO("background flush {}: {:.0f} ops/s, foreground writes {}, "
+            "background writes {} in {} I/Os, checkpoint {:.3f} s",
+        flush ? "on" : "off", OPS / time, stats.foreground_writes,
+        stats.background_writes, stats.background_write_ios,
+        sw.GetTimeInSeconds());
+  }
+  fs::remove(path);
+}
@@ -3,6 +3,8 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <filesystem>
 #include <functional>
 #include <future>
 #include <random>
@@ -16,6 +18,93 @@
 #define SAKURA_USE_JIT_FLAG 0
 
 namespace wing::wing_testing {
+// Remove a database and its write-ahead log.
+void RemoveDB(const std::string& path) {
+  std::filesystem::remove(path);
+  std::filesystem::remove(path + ".wal");
+}
+// Format the rows of "result" in the order they are returned. "types" has a
+// character per column: 'i' for integers, 'f' for floats and 's' for strings.
+std::vector<std::string> CollectRows(ResultSet result, std::string_view types) {
+  EXPECT_TRUE(result.Valid());
+  std::vector<std::string> rows;
+  while (auto tuple = result.Next()) {
+    std::string row;
+    for (size_t i = 0; i < types.size(); i++) {
+      if (types[i] == 'i')
+        row += fmt::format("{}|", tuple.ReadInt(i));
+      else if (types[i] == 'f')
+        row += fmt::format("{:.6f}|", tuple.ReadFloat(i));
+      else
+        row += fmt::format("{}|", tuple.ReadString(i));
+    }
+    rows.push_back(std::move(row));
+  }
+  // A streaming result becomes invalid if the query fails after some rows.
+  EXPECT_TRUE(result.Valid());
+  return rows;
+}
+// The formatted rows of "result" in sorted order, for results without order.
+std::vector<std::string> SortedRows(ResultSet result, std::string_view types) {
+  auto rows = CollectRows(std::move(result), types);
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+// How TestDB executes a query. The defaults are those of Instance.
+struct QueryOptions {
+  bool vectorized{true};
+  size_t threads{1};
+  size_t memory_budget{size_t(2) << 30};
+  bool jit{SAKURA_USE_JIT_FLAG};
+};
+// A database that is removed before it is opened and after the test. Its
+// queries are executed with QueryOptions, and their rows are formatted like
+// CollectRows(). Other methods of Instance are called through "->".
+class TestDB {
+ public:
+  explicit TestDB(std::string path) : path_(std::move(path)) {
+    RemoveDB(path_);
+    db_ = std::make_unique<Instance>(path_, SAKURA_USE_JIT_FLAG);
+  }
+  ~TestDB() {
+    db_ = nullptr;
+    RemoveDB(path_);
+  }
+  Instance* operator->() { return db_.get(); }
+  // Execute each statement, which is expected to succeed.
+  void Run(std::initializer_list<std::string_view> stmts) {
+    for (auto stmt : stmts)
+      EXPECT_TRUE(db_->Execute(stmt).Valid()) << stmt;
+  }
+  // Insert the rows row(0), ..., row(num - 1) into "table", e.g., "(1, 'a')".
+  void Insert(std::string_view table, int num,
+      const std::function<std::string(int)>& row) {
+    for (int begin = 0; begin < num; begin += 20000) {
+      std::string stmt = fmt::format("insert into {} values ", table);
+      for (int i = begin; i < std::min(num, begin + 20000); i++)
+        stmt += (i > begin ? ", " : "") + row(i);
+      Run({stmt + ";"});
+    }
+  }
+  std::vector<std::string> Collect(std::string_view sql,
+      std::string_view types, const QueryOptions& options = {}) {
+    db_->SetVectorized(options.vectorized);
+    db_->SetThreads(options.threads);
+    db_->SetMemoryBudget(options.memory_budget);
+    db_->SetJit(options.jit);
+    return CollectRows(db_->Execute(sql), types);
+  }
+  std::vector<std::string> Sorted(std::string_view sql, std::string_view types,
+      const QueryOptions& options = {}) {
+    auto rows = Collect(sql, types, options);
+    std::sort(rows.begin(), rows.end());
+    return rows;
+  }
+
+ private:
+  std::string path_;
+  std::unique_ptr<Instance> db_;
+};
 bool test_timeout(std::function<void()> function, size_t timeout_in_ms) {
   std::promise<bool> promisedFinished;
   auto futureResult = promisedFinished.get_future();
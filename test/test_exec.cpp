@@ -1,9 +1,18 @@
 #include <gtest/gtest.h>
 
 #include <filesystem>
+#include <functional>
+#include <random>
+#include <set>
 
 #include "common/stopwatch.hpp"
+#include "execution/group_table.hpp"
+#include "execution/runtime_filter.hpp"
+#include "execution/tuple_sorter.hpp"
+#include "execution/vec_expr.hpp"
 #include "instance/instance.hpp"
+#include "jit/jitexecutor.hpp"
+#include "parser/parser.hpp"
 #include "test.hpp"
 
 #define print_log printf("Running on line %d at file \"%s\"\n",__LINE__,__FILE__),fflush(stdout)
@@ -11,7 +20,7 @@
 TEST(ExecutorJoinTest, JoinTestNum10Table2) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0100");
+  RemoveDB("__tmp0100");
   auto db = std::make_unique<wing::Instance>("__tmp0100", SAKURA_USE_JIT_FLAG);
 
   // Do joins on values.
@@ -278,13 +287,13 @@ TEST(ExecutorJoinTest, JoinTestNum10Table2) {
   }
   
   db = nullptr;
-  std::filesystem::remove("__tmp0100");
+  RemoveDB("__tmp0100");
 }
 
 TEST(ExecutorJoinTest, JoinTestNum3e3Table2) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0101");
+  RemoveDB("__tmp0101");
   auto db = std::make_unique<wing::Instance>("__tmp0101", SAKURA_USE_JIT_FLAG);
   auto NUM = 3e3;
   // Two countries have 3e3 ports. Ports have three attributes: name, position,
@@ -353,13 +362,13 @@ TEST(ExecutorJoinTest, JoinTestNum3e3Table2) {
       fmt::format("{}_{}", tuple.ReadString(0), tuple.ReadString(1)), 3);
 
   db = nullptr;
-  std::filesystem::remove("__tmp0101");
+  RemoveDB("__tmp0101");
 }
 
 TEST(ExecutorJoinTest, JoinTestTable3) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0102");
+  RemoveDB("__tmp0102");
   auto db = std::make_unique<wing::Instance>("__tmp0102", SAKURA_USE_JIT_FLAG);
   // Two databases have some users and their id, now give the relations between
   // the two user groups, print the corresponding username.
@@ -481,13 +490,13 @@ TEST(ExecutorJoinTest, JoinTestTable3) {
   }
 
   db = nullptr;
-  std::filesystem::remove("__tmp0102");
+  RemoveDB("__tmp0102");
 }
 
 TEST(ExecutorJoinTest, JoinTestTableN) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0106");
+  RemoveDB("__tmp0106");
   auto db = std::make_unique<wing::Instance>("__tmp0106", SAKURA_USE_JIT_FLAG);
   {
     auto result = db->Execute(
@@ -639,13 +648,13 @@ TEST(ExecutorJoinTest, JoinTestTableN) {
     EXPECT_EQ(sz, ssz);
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0106");
+  RemoveDB("__tmp0106");
 }
 
 TEST(ExecutorAggregateTest, SmallAggregateTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0103");
+  RemoveDB("__tmp0103");
   auto db = std::make_unique<wing::Instance>("__tmp0103", SAKURA_USE_JIT_FLAG);
   {
     auto result = db->Execute(
@@ -839,13 +848,13 @@ TEST(ExecutorAggregateTest, SmallAggregateTest) {
     }
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0103");
+  RemoveDB("__tmp0103");
 }
 
 TEST(ExecutorAggregateTest, PolyAggregateTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0104");
+  RemoveDB("__tmp0104");
   auto db = std::make_unique<wing::Instance>("__tmp0104", SAKURA_USE_JIT_FLAG);
   // Now we can use our executors to calculate polynomial multiplication!
   // We want to calculate A * B * B, where A is of degree 3000, B is of degree
@@ -928,13 +937,13 @@ TEST(ExecutorAggregateTest, PolyAggregateTest) {
     delete[] D;
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0104");
+  RemoveDB("__tmp0104");
 }
 
 TEST(ExecutorAggregateTest, StringAggregateTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0105");
+  RemoveDB("__tmp0105");
   auto db = std::make_unique<wing::Instance>("__tmp0105", SAKURA_USE_JIT_FLAG);
   {
     EXPECT_TRUE(
@@ -991,13 +1000,13 @@ TEST(ExecutorAggregateTest, StringAggregateTest) {
     CHECK_ALL_ANS(answer, result, std::string(tuple.ReadString(0)), 3);
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0105");
+  RemoveDB("__tmp0105");
 }
 
 TEST(ExecutorOrderByTest, SmallTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0107");
+  RemoveDB("__tmp0107");
   auto db = std::make_unique<wing::Instance>("__tmp0107", SAKURA_USE_JIT_FLAG);
   {
     // clang-format off
@@ -1031,13 +1040,13 @@ TEST(ExecutorOrderByTest, SmallTest) {
     EXPECT_FALSE(result.Next());
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0107");
+  RemoveDB("__tmp0107");
 }
 
 TEST(ExecutorOrderByTest, BigTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0113");
+  RemoveDB("__tmp0113");
   auto db = std::make_unique<wing::Instance>("__tmp0113", SAKURA_USE_JIT_FLAG);
   // A student called Alice wants to do her C++ homework, quicksort.
   // She needs a magical mirror that reflects the correct answer.
@@ -1158,13 +1167,48 @@ TEST(ExecutorOrderByTest, BigTest) {
     }
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0113");
+  RemoveDB("__tmp0113");
+}
+
+TEST(ExecutorOrderByTest, ExternalSort) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0121");
+  db.Run({"create table A(id int64 primary key, k int64, f float64, s "
+          "varchar(40));"});
+  db.Insert("A", 60000, [](int i) {
+    return fmt::format("({}, {}, {:.1f}, '{}-{}')", i, (i * 7919) % 1000,
+        (i * 31 % 577) * 0.5, (i * 13) % 4999, std::string(i % 20, 'x'));
+  });
+  // The data is several MB, and the budgets are 128KB and 1MB.
+  for (auto sql : {"select k, id, s from A order by k asc, id asc;",
+           "select k, id, s from A order by s desc, id asc;",
+           "select k, id, s from A order by f asc, k desc, id asc;",
+           "select k, id, s from A where id % 3 = 0 order by s asc, k "
+           "asc, id asc;"}) {
+    auto expected = db.Collect(sql, "iis");
+    EXPECT_FALSE(expected.empty()) << sql;
+    EXPECT_EQ(db.Collect(sql, "iis", {.memory_budget = 1 << 17}), expected)
+        << sql;
+    EXPECT_EQ(db.Collect(sql, "iis",
+                  {.vectorized = false, .memory_budget = 1 << 17}),
+        expected)
+        << sql;
+    EXPECT_EQ(
+        db.Collect(sql, "iis", {.threads = 4, .memory_budget = 1 << 20}),
+        expected)
+        << sql;
+  }
+  // A limit stops reading the merged runs early.
+  EXPECT_EQ(db.Collect("select id from A order by k desc, id asc limit 5;",
+                "i", {.memory_budget = 1 << 17}),
+      (std::vector<std::string>{"321|", "1321|", "2321|", "3321|", "4321|"}));
 }
 
 TEST(ExecutorLimitTest, SmallTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0108");
+  RemoveDB("__tmp0108");
   auto db = std::make_unique<wing::Instance>("__tmp0108", SAKURA_USE_JIT_FLAG);
   // empty query
   {
@@ -1194,13 +1238,13 @@ TEST(ExecutorLimitTest, SmallTest) {
     CHECK_ALL_SORTED_ANS(answer, result, 1);
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0108");
+  RemoveDB("__tmp0108");
 }
 
 TEST(ExecutorLimitTest, BigTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0114");
+  RemoveDB("__tmp0114");
   auto db = std::make_unique<wing::Instance>("__tmp0114", SAKURA_USE_JIT_FLAG);
   // Solve the equation -x^3 + 17x + 1 = 0.
   {
@@ -1228,13 +1272,49 @@ TEST(ExecutorLimitTest, BigTest) {
     EXPECT_FALSE(result.Next());
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0114");
+  RemoveDB("__tmp0114");
+}
+
+TEST(ExecutorLimitTest, TopN) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0122");
+  db.Run({"create table A(id int64 primary key, k int64, f float64, s "
+          "varchar(20));"});
+  db.Insert("A", 30000, [](int i) {
+    return fmt::format("({}, {}, {:.1f}, 's{}')", i, (i * 7919) % 3000,
+        (i * 31 % 577) * 0.5, (i * 13) % 4999);
+  });
+  for (auto order : {"order by k asc, id asc", "order by s desc, id desc",
+           "order by f asc, k desc, id asc"}) {
+    auto sorted =
+        db.Collect(fmt::format("select k, id, s from A {};", order), "iis");
+    EXPECT_EQ(sorted.size(), 30000u);
+    for (auto [limit, offset] : std::vector<std::pair<size_t, size_t>>{
+             {0, 0}, {1, 0}, {10, 0}, {10, 100}, {2000, 5}, {100, 29950},
+             {5, 40000}, {40000, 3}}) {
+      auto sql = fmt::format("select k, id, s from A {} limit {} offset {};",
+          order, limit, offset);
+      std::vector<std::string> expected(
+          sorted.begin() + std::min(offset, sorted.size()),
+          sorted.begin() + std::min(offset + limit, sorted.size()));
+      EXPECT_EQ(db.Collect(sql, "iis"), expected) << sql;
+      EXPECT_EQ(db.Collect(sql, "iis", {.vectorized = false}), expected)
+          << sql;
+    }
+  }
+  EXPECT_EQ(db->GetPlan("select k from A order by k asc limit 10;")->type_,
+      PlanType::TopN);
+  // Too many rows for the heap.
+  EXPECT_EQ(
+      db->GetPlan("select k from A order by k asc limit 1000000;")->type_,
+      PlanType::Limit);
 }
 
 TEST(ExecutorDistinctTest, SmallTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0109");
+  RemoveDB("__tmp0109");
   auto db = std::make_unique<wing::Instance>("__tmp0109", SAKURA_USE_JIT_FLAG);
   // empty return set
   {
@@ -1278,13 +1358,13 @@ TEST(ExecutorDistinctTest, SmallTest) {
     CHECK_ALL_SORTED_ANS(answer, result, 1);
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0109");
+  RemoveDB("__tmp0109");
 }
 
 TEST(ExecutorDistinctTest, BigTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0115");
+  RemoveDB("__tmp0115");
   auto db = std::make_unique<wing::Instance>("__tmp0115", SAKURA_USE_JIT_FLAG);
   // Get distinct code lines from a big code base.
   // Clearly there are many duplicate codes.
@@ -1356,14 +1436,1278 @@ TEST(ExecutorDistinctTest, BigTest) {
     }
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0115");
+  RemoveDB("__tmp0115");
+}
+
+TEST(ExecutorDistinctTest, Hash) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0124");
+  db.Run({"create table A(id int64 primary key, k int64, f float64, s "
+          "varchar(20));"});
+  db.Insert("A", 50000, [](int i) {
+    return fmt::format("({}, {}, {:.1f}, 's{}')", i, (i * 7919) % 3001,
+        (i * 31 % 577) * 0.5, (i * 13) % 4999);
+  });
+  for (auto cols : {"k, f, s", "k % 10, f, s", "k % 3, 0.5, 's'"}) {
+    // The first occurrences in the order of the input.
+    std::vector<std::string> expected;
+    std::set<std::string> seen;
+    for (auto& row :
+        db.Collect(fmt::format("select {} from A;", cols), "ifs")) {
+      if (seen.insert(row).second)
+        expected.push_back(row);
+    }
+    auto sql = fmt::format("select distinct {} from A;", cols);
+    EXPECT_EQ(db->GetPlan(sql)->type_, PlanType::HashDistinct);
+    for (bool vectorized : {true, false}) {
+      EXPECT_EQ(db.Collect(sql, "ifs", {.vectorized = vectorized}), expected)
+          << sql;
+      // Spilled partitions are returned after the tuples that fit.
+      for (size_t budget : {size_t(1) << 17, size_t(1) << 19}) {
+        EXPECT_EQ(db.Sorted(sql, "ifs",
+                      {.vectorized = vectorized, .memory_budget = budget}),
+            std::vector<std::string>(seen.begin(), seen.end()))
+            << sql << " " << budget;
+      }
+    }
+  }
+  // Duplicates are not adjacent if the input is not sorted by all columns.
+  {
+    auto sql = "select distinct k % 10, f, s from A order by f desc;";
+    EXPECT_EQ(db->GetPlan(sql)->type_, PlanType::HashDistinct);
+    auto rows = db.Collect(sql, "ifs");
+    EXPECT_EQ(std::set<std::string>(rows.begin(), rows.end()).size(),
+        rows.size());
+    auto all = db.Collect("select k % 10, f, s from A;", "ifs");
+    EXPECT_EQ(std::set<std::string>(all.begin(), all.end()).size(),
+        rows.size());
+  }
+  // The sort key b precedes a, so equal values of a are not adjacent.
+  {
+    db.Run({"create table T(a int64, b int64);",
+        "insert into T values (1, 1), (2, 2), (1, 3);"});
+    auto sql = "select distinct a from T order by b asc, a asc;";
+    EXPECT_EQ(db->GetPlan(sql)->type_, PlanType::HashDistinct);
+    for (bool vectorized : {true, false}) {
+      EXPECT_EQ(db.Collect(sql, "i", {.vectorized = vectorized}),
+          (std::vector<std::string>{"1|", "2|"}));
+    }
+  }
+  EXPECT_EQ(
+      db->GetPlan("select distinct k from A order by k asc;")->type_,
+      PlanType::Distinct);
+  EXPECT_EQ(
+      db->GetPlan("select distinct k, f from A order by f desc, k asc, s asc;")
+          ->type_,
+      PlanType::Distinct);
+}
+
+TEST(ExecutorBatchTest, SameAsTupleAtATime) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0116");
+  db.Run({"create table A(id int64 primary key, g int64, s varchar(20), f "
+          "float64);",
+      "create table B(id int64 primary key, a_id int64, v varchar(20));"});
+  db.Insert("A", 5000, [](int i) {
+    return fmt::format(
+        "({}, {}, 's{}', {}.5)", i, i % 10, (i * 7919) % 5000, i % 97);
+  });
+  db.Insert("B", 8000,
+      [](int i) { return fmt::format("({}, {}, 'v{}')", i, i % 2000, i); });
+  // Each query is expected to return more than one batch of tuples, except
+  // the aggregations.
+  std::vector<std::tuple<std::string, std::string, bool>> queries = {
+      {"select * from A where g < 7;", "iisf", false},
+      {"select id, f * 2 + g, s from A where id >= 1000 and id < 4000;", "ifs",
+          false},
+      {"select A.id, A.s, B.v from A, B where A.id = B.a_id;", "iss", false},
+      {"select A.g, B.v from A, B where A.id = B.a_id and A.g + 1 < B.id / "
+       "1000;",
+          "is", false},
+      {"select g, count(*), sum(f), max(f) from A group by g having count(*) "
+       "> 10;",
+          "iiff", false},
+      {"select id, s from A order by s desc, id asc;", "is", true},
+      {"select id, s from A order by s desc, id asc limit 1200 offset 1500;",
+          "is", true},
+      {"select * from A limit 10 offset 4995;", "iisf", false},
+      {"select distinct g from A;", "i", false},
+      {"select id % 7, id * 3 - g, -f, f / 4, id & 5, id | 2, id ^ 3, id << "
+       "2, id >> 1 from A where not (g = 3) and (f > 20.0 or s < 's2');",
+          "iiffiiiii", false},
+      {"select s, g from A where s >= 's1' and s <> 's1234' and id / 3 * 3 = "
+       "id;",
+          "si", false},
+      {"select id + 0.5, f - id, s from A where f * 2 < id or g >= 8;", "ffs",
+          false},
+  };
+  for (auto& [sql, types, ordered] : queries) {
+    auto expected = db.Collect(sql, types, {.vectorized = false});
+    auto rows = db.Collect(sql, types);
+    EXPECT_FALSE(rows.empty()) << sql;
+    if (!ordered) {
+      std::sort(expected.begin(), expected.end());
+      std::sort(rows.begin(), rows.end());
+    }
+    EXPECT_EQ(rows, expected) << sql;
+  }
+}
+
+TEST(ExecutorJoinTest, HashJoinFloatKeys) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  RemoveDB("__tmp0136");
+  auto db = std::make_unique<wing::Instance>("__tmp0136", SAKURA_USE_JIT_FLAG);
+  EXPECT_TRUE(
+      db->Execute("create table A(id int64 primary key, f float64);").Valid());
+  EXPECT_TRUE(
+      db->Execute("create table B(id int64 primary key, f float64);").Valid());
+  // The keys of B are the negated keys of A, so only 0.0 = -0.0 joins.
+  {
+    std::string a = "insert into A values ", b = "insert into B values ";
+    for (int i = 0; i < 1000; i++) {
+      a += fmt::format("{}({}, {}.0)", i ? ", " : "", i, i % 100);
+      b += fmt::format("{}({}, -{}.0)", i ? ", " : "", i, i % 100);
+    }
+    EXPECT_TRUE(db->Execute(a + ";").Valid());
+    EXPECT_TRUE(db->Execute(b + ";").Valid());
+  }
+  for (bool vectorized : {true, false}) {
+    db->SetVectorized(vectorized);
+    for (auto sql : {"select A.id, B.id from A, B where A.f = B.f;",
+             "select A.id, B.id from B, A where B.f = A.f;"}) {
+      auto result = db->Execute(sql);
+      ASSERT_TRUE(result.Valid());
+      size_t count = 0;
+      while (auto tuple = result.Next()) {
+        EXPECT_EQ(tuple.ReadInt(0) % 100, 0);
+        EXPECT_EQ(tuple.ReadInt(1) % 100, 0);
+        count += 1;
+      }
+      EXPECT_EQ(count, 100u) << sql;
+    }
+  }
+  db = nullptr;
+  RemoveDB("__tmp0136");
+}
+
+TEST(ExecutorJoinTest, HashJoinSpill) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0117");
+  db.Run({"create table A(id int64 primary key, k int64, s varchar(30), f "
+          "float64);",
+      "create table B(id int64 primary key, k int64, s varchar(30), f "
+      "float64);"});
+  // Key -1 has many rows on both sides, so its partition cannot be split. The
+  // float keys equal the integer keys, and the low bits of their hashes are
+  // zero.
+  db.Insert("A", 20000, [](int i) {
+    int k = i % 50 == 0 ? -1 : (i * 7919) % 6000;
+    return fmt::format("({}, {}, 'a{}', {}.0)", i, k, i % 9000, k);
+  });
+  db.Insert("B", 30000, [](int i) {
+    int k = i % 300 == 0 ? -1 : i % 8000;
+    return fmt::format("({}, {}, 'a{}', {}.0)", i, k, i % 11000, k);
+  });
+  for (auto sql : {"select A.id, A.s, B.id, B.s from A, B where A.k = B.k;",
+           "select A.id, A.s, B.id, B.s from A, B where A.s = B.s and A.k "
+           "<> B.k;",
+           "select A.id, A.s, B.id, B.s from A, B where A.f = B.f;"}) {
+    auto expected = db.Sorted(sql, "isis");
+    EXPECT_GT(expected.size(), 10000u) << sql;
+    // The budget is much smaller than the build side.
+    EXPECT_EQ(db.Sorted(sql, "isis", {.memory_budget = 1 << 16}), expected)
+        << sql;
+    EXPECT_EQ(db.Sorted(sql, "isis", {.memory_budget = 1 << 20}), expected)
+        << sql;
+    EXPECT_EQ(db.Sorted(sql, "isis",
+                  {.vectorized = false, .memory_budget = 1 << 16}),
+        expected)
+        << sql;
+  }
+}
+
+TEST(ExecutorJoinTest, MergeSortJoin) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0125");
+  db.Run({"create table A(id int64 primary key, k int64);",
+      "create table B(id int64 primary key, s varchar(20));",
+      "create table C(s varchar(20) primary key, k int64);",
+      "create table D(s varchar(20) primary key, id int64);"});
+  db.Insert("A", 30000,
+      [](int i) { return fmt::format("({}, {})", i * 2, i % 97); });
+  db.Insert("B", 20000,
+      [](int i) { return fmt::format("({}, 's{}')", i * 3 - 5000, i); });
+  db.Insert("C", 20000,
+      [](int i) { return fmt::format("('s{}', {})", i * 5, i % 89); });
+  db.Insert("D", 20000,
+      [](int i) { return fmt::format("('s{}', {})", i * 3, i); });
+  auto merged = [&](const std::string& sql) {
+    return db->GetPlan(sql)->ToString().find("Merge Sort Join") !=
+           std::string::npos;
+  };
+  // The same joins on expressions of the keys, which are hash joins.
+  std::vector<std::pair<std::string, std::string>> queries = {
+      {"select A.id, B.s, A.k from A, B where A.id = B.id;",
+          "select A.id, B.s, A.k from A, B where A.id + 0 = B.id;"},
+      {"select A.id, B.s, A.k from B, A where B.id = A.id and A.k < 50 and "
+       "A.id < 20000;",
+          "select A.id, B.s, A.k from B, A where B.id = A.id + 0 and A.k < 50 "
+          "and A.id < 20000;"},
+      {"select A.id, B.s, A.k from A, B where A.id = B.id and A.k > B.id % "
+       "100;",
+          "select A.id, B.s, A.k from A, B where A.id = B.id + 0 and A.k > "
+          "B.id % 100;"},
+  };
+  // String keys: the keys of C are multiples of 5, and those of D are
+  // multiples of 3.
+  std::vector<std::string> expected_str;
+  for (int i = 0; i < 60000; i += 15) {
+    if (i / 5 % 89 % 2 == 0)
+      expected_str.push_back(fmt::format("{}|s{}|{}|", i / 3, i, i / 5 % 89));
+  }
+  std::sort(expected_str.begin(), expected_str.end());
+  auto str_sql = "select D.id, C.s, C.k from C, D where C.s = D.s and C.k % 2 "
+                 "= 0;";
+  for (int analyzed = 0; analyzed < 2; analyzed++) {
+    for (auto& [sql, hash_sql] : queries) {
+      EXPECT_FALSE(merged(hash_sql)) << hash_sql;
+      auto expected = db.Sorted(hash_sql, "isi");
+      EXPECT_FALSE(expected.empty()) << hash_sql;
+      EXPECT_TRUE(merged(sql)) << sql;
+      EXPECT_EQ(db.Sorted(sql, "isi"), expected) << sql;
+      EXPECT_EQ(db.Sorted(sql, "isi", {.vectorized = false}), expected)
+          << sql;
+    }
+    EXPECT_TRUE(merged(str_sql));
+    EXPECT_EQ(db.Sorted(str_sql, "isi"), expected_str);
+    EXPECT_EQ(db.Sorted(str_sql, "isi", {.vectorized = false}), expected_str);
+    // B.s is not the primary key of B.
+    EXPECT_FALSE(merged("select B.id, C.s, C.k from B, C where B.s = C.s;"));
+    db->Analyze("A");
+    db->Analyze("B");
+    db->Analyze("C");
+    db->Analyze("D");
+  }
+}
+
+TEST(ExecutorJoinTest, IndexNestloopJoin) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0126");
+  db.Run({"create table B(id int64 primary key, s varchar(20));",
+      "create table C(s varchar(20) primary key, k int64);",
+      "create table O(id int64 primary key, b_id int64, c_s varchar(20), k "
+      "int64);"});
+  db.Insert("B", 50000,
+      [](int i) { return fmt::format("({}, 's{}')", i * 2, i); });
+  db.Insert("C", 50000,
+      [](int i) { return fmt::format("('c{}', {})", i * 3, i % 89); });
+  // Some keys are missing from B and C, and some are repeated.
+  db.Insert("O", 400, [](int i) {
+    if (i < 300) {
+      return fmt::format("({}, {}, 'c{}', {})", i, (i * 7919) % 110000,
+          (i * 104729) % 160000 / 2, i % 100);
+    }
+    return fmt::format(
+        "({}, {}, 'c{}', {})", i, i % 10 * 2, i % 10 * 3, i % 100);
+  });
+  std::vector<std::string> queries = {
+      "select O.id, B.s, O.k from O, B where O.b_id = B.id;",
+      "select O.id, B.s, O.k from B, O where B.id = O.b_id and B.id % 3 = 0;",
+      "select O.id, B.s, O.k from O, B where O.b_id = B.id and O.k > B.id % "
+      "100;",
+      "select O.id, C.s, C.k from O, C where O.c_s = C.s;",
+      "select O.id, B.s, C.k from O, B, C where O.b_id = B.id and O.c_s = "
+      "C.s;",
+  };
+  // Without statistics, the joins are hash joins.
+  std::vector<std::vector<std::string>> expected;
+  for (auto& sql : queries) {
+    expected.push_back(db.Sorted(sql, "isi"));
+    EXPECT_FALSE(expected.back().empty()) << sql;
+  }
+  db->Analyze("B");
+  db->Analyze("C");
+  db->Analyze("O");
+  for (size_t i = 0; i < queries.size(); i++) {
+    auto& sql = queries[i];
+    EXPECT_TRUE(db->GetPlan(sql)->ToString().find("Index Nestloop Join") !=
+                std::string::npos)
+        << sql;
+    EXPECT_EQ(db.Sorted(sql, "isi"), expected[i]) << sql;
+    EXPECT_EQ(db.Sorted(sql, "isi", {.vectorized = false}), expected[i])
+        << sql;
+  }
+}
+
+TEST(ExecutorJoinTest, RuntimeFilter) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  {
+    RuntimeFilter filter({RetType::INT, RetType::STRING});
+    std::vector<StaticStringField*> strs(10000);
+    for (int i = 0; i < 10000; i++)
+      strs[i] = StaticStringField::Generate(fmt::format("s{}", i));
+    auto key = [&](int i, int j) {
+      return std::vector<StaticFieldRef>{StaticFieldRef::CreateInt(i),
+          StaticFieldRef::CreateStringRef(strs[j])};
+    };
+    for (int i = 0; i < 10000; i += 2)
+      filter.Insert(key(i, i).data());
+    filter.Publish();
+    // The keys of the build side always pass.
+    for (int i = 0; i < 10000; i += 2)
+      EXPECT_TRUE(filter.Check(key(i, i).data())) << i;
+    // Out of the range of the integers.
+    EXPECT_FALSE(filter.Check(key(-1, 0).data()));
+    EXPECT_FALSE(filter.Check(key(10000, 0).data()));
+    std::vector<StaticFieldRef> keys;
+    for (int i = 1; i < 10000; i += 2) {
+      auto k = key(i, i);
+      keys.insert(keys.end(), k.begin(), k.end());
+    }
+    std::vector<uint8_t> mask(keys.size() / 2);
+    filter.Check(keys.data(), mask.size(), mask.data());
+    size_t passed = std::count(mask.begin(), mask.end(), 1);
+    EXPECT_EQ(filter.Checked(), 5000u);
+    EXPECT_EQ(filter.Dropped(), 5000u - passed);
+    EXPECT_LT(passed, 250u);
+    for (auto str : strs)
+      StaticStringField::FreeFromGenerate(str);
+  }
+  TestDB db("__tmp0127");
+  db.Run({"create table A(id int64 primary key, k int64, s varchar(20));",
+      "create table B(id int64 primary key, a_id int64, s varchar(20));",
+      "create table C(id int64 primary key);"});
+  db.Insert("A", 2000,
+      [](int i) { return fmt::format("({}, {}, 's{}')", i, i % 100, i); });
+  db.Insert("B", 50000, [](int i) {
+    return fmt::format("({}, {}, 's{}')", i, i % 3000, i % 2500);
+  });
+  db.Insert("C", 1000, [](int i) { return fmt::format("({})", i); });
+  // The build sides are small, so most rows of B are dropped by the scan.
+  std::vector<std::pair<std::string, std::function<bool(int)>>> queries = {
+      {"select B.id, A.k from A, B where A.id = B.a_id and A.k = 7;",
+          [](int i) { return i % 3000 < 2000 && i % 3000 % 100 == 7; }},
+      {"select B.id, A.k from A, B where A.s = B.s and A.k = 7;",
+          [](int i) { return i % 2500 < 2000 && i % 2500 % 100 == 7; }},
+      // The filter of the upper join is checked by the scan of B.
+      {"select B.id, A.k from C, A, B where C.id = A.k and A.id = B.a_id and "
+       "C.id < 2;",
+          [](int i) { return i % 3000 < 2000 && i % 3000 % 100 < 2; }},
+  };
+  for (auto& [sql, pred] : queries) {
+    std::vector<std::string> expected;
+    for (int i = 0; i < 50000; i++) {
+      if (pred(i))
+        expected.push_back(
+            fmt::format("{}|{}|", i, sql.find("A.s") != std::string::npos
+                                        ? i % 2500 % 100
+                                        : i % 3000 % 100));
+    }
+    std::sort(expected.begin(), expected.end());
+    EXPECT_FALSE(expected.empty()) << sql;
+    EXPECT_EQ(db.Sorted(sql, "ii"), expected) << sql;
+    EXPECT_EQ(db.Sorted(sql, "ii", {.vectorized = false}), expected) << sql;
+  }
+}
+
+TEST(ExecutorJoinTest, PruneColumns) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0128");
+  db.Run({"create table A(id int64 primary key, a int64, pad varchar(200), s "
+          "varchar(20), f float64);",
+      "create table B(id int64 primary key, a_id int64, pad varchar(200), t "
+      "varchar(20));"});
+  std::string pad(150, 'p');
+  db.Insert("A", 2000, [&](int i) {
+    return fmt::format(
+        "({}, {}, '{}{}', 's{}', {:.1f})", i, i % 7, pad, i, i, i * 0.5);
+  });
+  db.Insert("B", 5000, [&](int i) {
+    return fmt::format("({}, {}, '{}{}', 't{}')", i, i * 3 % 2500, pad, i, i);
+  });
+  // B.id joins A.id = B.id * 3 % 2500 if it is in A.
+  std::vector<std::pair<std::string, std::function<bool(int)>>> queries = {
+      {"select A.s, B.t from A, B where A.id = B.a_id;",
+          [](int i) { return i * 3 % 2500 < 2000; }},
+      // A.a is only read by the scan of A.
+      {"select A.s, B.t from A, B where A.id = B.a_id and A.a = 3;",
+          [](int i) { return i * 3 % 2500 < 2000 && i * 3 % 2500 % 7 == 3; }},
+      // A.a is read by the join.
+      {"select A.s, B.t from A, B where A.id = B.a_id and A.a + B.id % 5 = "
+       "4;",
+          [](int i) {
+            return i * 3 % 2500 < 2000 && i * 3 % 2500 % 7 + i % 5 == 4;
+          }},
+  };
+  for (int analyzed = 0; analyzed < 2; analyzed++) {
+    for (auto& [sql, pred] : queries) {
+      std::vector<std::string> expected;
+      for (int i = 0; i < 5000; i++) {
+        if (pred(i))
+          expected.push_back(fmt::format("s{}|t{}|", i * 3 % 2500, i));
+      }
+      std::sort(expected.begin(), expected.end());
+      EXPECT_FALSE(expected.empty()) << sql;
+      // The wide strings are not output by the scans.
+      auto plan = db->GetPlan(sql)->ToString();
+      EXPECT_NE(plan.find("[Columns: "), std::string::npos) << plan;
+      EXPECT_EQ(plan.find("pad"), std::string::npos) << plan;
+      EXPECT_EQ(db.Sorted(sql, "ss"), expected) << sql;
+      EXPECT_EQ(db.Sorted(sql, "ss", {.vectorized = false}), expected) << sql;
+      EXPECT_EQ(db.Sorted(sql, "ss", {.threads = 2}), expected) << sql;
+    }
+    db->Analyze("A");
+    db->Analyze("B");
+  }
+  {
+    auto result = db->Execute("select count(*), sum(A.f) from A, B where "
+                              "A.id = B.a_id and B.id % 2 = 0;");
+    EXPECT_TRUE(result.Valid());
+    int64_t count = 0;
+    double sum = 0;
+    for (int i = 0; i < 5000; i += 2) {
+      if (i * 3 % 2500 < 2000) {
+        count++;
+        sum += i * 3 % 2500 * 0.5;
+      }
+    }
+    auto tuple = result.Next();
+    ASSERT_TRUE(tuple);
+    EXPECT_EQ(tuple.ReadInt(0), count);
+    EXPECT_DOUBLE_EQ(tuple.ReadFloat(1), sum);
+  }
+  // A scan that is not under a join outputs the raw rows.
+  EXPECT_EQ(db->GetPlan("select s from A where a = 1;")
+                ->ToString()
+                .find("[Columns: "),
+      std::string::npos);
+}
+
+TEST(ExecutorJoinTest, Parallel) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0118");
+  for (auto table : {"A", "B", "C"}) {
+    db.Run({fmt::format(
+        "create table {}(id int64 primary key, k int64, s varchar(30));",
+        table)});
+  }
+  db.Insert("A", 20000, [](int i) {
+    return fmt::format("({}, {}, 'a{}')", i, (i * 7919) % 6000, i % 9000);
+  });
+  db.Insert("B", 30000, [](int i) {
+    return fmt::format("({}, {}, 'a{}')", i, i % 8000, i % 11000);
+  });
+  db.Insert("C", 5000, [](int i) {
+    return fmt::format("({}, {}, 'a{}')", i, i % 700, i % 3000);
+  });
+  for (auto sql : {"select A.id, A.s, A.k, A.s from A;",
+           "select A.id, A.s, A.k, A.s from A where A.id >= 1000 and A.id < "
+           "15000 and A.k < 3000;",
+           "select A.id, A.s, B.id, B.s from A, B where A.k = B.k;",
+           "select A.id, A.s, B.id, B.s from A, B where A.s = B.s and A.k "
+           "<> B.k;",
+           "select A.id, B.s, C.id, C.s from A, B, C where A.k = B.k and B.k "
+           "= C.k and C.id < 2000;",
+           "select A.k, A.s, count(*), A.s from A, B where A.k = B.k group "
+           "by A.k, A.s;"}) {
+    auto expected = db.Sorted(sql, "isis");
+    EXPECT_GT(expected.size(), 1000u) << sql;
+    EXPECT_EQ(db.Sorted(sql, "isis", {.threads = 4}), expected) << sql;
+    EXPECT_EQ(db.Sorted(sql, "isis", {.vectorized = false, .threads = 3}),
+        expected)
+        << sql;
+    // Executed again serially, because the hash tables exceed the budget.
+    EXPECT_EQ(
+        db.Sorted(sql, "isis", {.threads = 4, .memory_budget = 1 << 16}),
+        expected)
+        << sql;
+  }
+}
+
+TEST(ExecutorAggregateTest, Parallel) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  TestDB db("__tmp0119");
+  db.Run({"create table A(id int64 primary key, k int64, f float64, s "
+          "varchar(30), g float64);"});
+  db.Insert("A", 50000, [](int i) {
+    return fmt::format("({}, {}, {:.2f}, 'a{}', {}.0)", i, (i * 7919) % 20000,
+        (i % 100) * 0.25, i % 5, (i * 31) % 25000);
+  });
+  // The first query has few groups, and the others have more groups than the
+  // table of a thread. The keys of the last but one are integer-valued
+  // floats, whose hashes have no low bits set before they are mixed.
+  for (auto sql :
+      {"select A.s, count(*), sum(A.k), avg(A.f), max(A.f) from A group by "
+       "A.s;",
+          "select A.s, A.k, min(A.id), sum(A.f), avg(A.k) from A group by "
+          "A.k, A.s;",
+          "select A.s, A.k, count(*), sum(A.f) + 1, min(A.f) from A group by "
+          "A.k, A.s having count(*) > 2 and max(A.id) - min(A.id) > 10000;",
+          "select A.s, A.k, max(A.id), avg(A.f), sum(A.f) from A where A.id "
+          "< 40000 and A.f > 3 group by A.k, A.s;",
+          "select 'x', count(*), sum(A.k), A.g, avg(A.f) from A group by "
+          "A.g;",
+          "select 'x', count(*), sum(A.k), avg(A.f), min(A.f) from A;"}) {
+    auto expected = db.Sorted(sql, "siiff");
+    EXPECT_FALSE(expected.empty()) << sql;
+    EXPECT_EQ(db.Sorted(sql, "siiff", {.threads = 4}), expected) << sql;
+    EXPECT_EQ(db.Sorted(sql, "siiff", {.threads = 3}), expected) << sql;
+  }
+}
+
+TEST(ExecutorJitTest, SameAsInterpreter) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+#ifndef BUILD_JIT
+  GTEST_SKIP() << "Wing is built without the JIT.";
+#endif
+  TestDB db("__tmp0129");
+  db.Run({"create table A(id int64 primary key, g int32, s varchar(20), f "
+          "float64);",
+      "create table B(id int64 primary key, a_id int64, v varchar(20));",
+      "create table C(s varchar(20) primary key, k int64);",
+      "create table D(id int64 primary key, b_id int64, c_s varchar(20));"});
+  db.Insert("A", 3000, [](int i) {
+    return fmt::format(
+        "({}, {}, 's{}', {}.5)", i, i % 10, (i * 7919) % 3000, i % 97);
+  });
+  db.Insert("B", 5000,
+      [](int i) { return fmt::format("({}, {}, 'v{}')", i, i % 4000, i); });
+  db.Insert("C", 2000,
+      [](int i) { return fmt::format("('s{}', {})", i * 2, i % 13); });
+  db.Insert("D", 50, [](int i) {
+    return fmt::format("({}, {}, 's{}')", i, (i * 7919) % 6000, i * 3);
+  });
+  std::vector<std::pair<std::string, std::string>> queries = {
+      {"select * from A where not (g = 3) and id < 2000;", "iisf"},
+      {"select id, s from A where id >= 1000 and id < 1100;", "is"},
+      {"select A.id, A.s, B.v from A, B where A.id = B.a_id;", "iss"},
+      {"select A.g, B.v from A, B where A.id = B.a_id and A.g + 1 < B.id / "
+       "1000;",
+          "is"},
+      {"select A.id, B.id from A, B where A.id < 30 and B.id < 40 and A.g > "
+       "B.id % 10;",
+          "ii"},
+      {"select A.id, B.v, C.k from A, B, C where A.id = B.a_id and A.s = C.s;",
+          "isi"},
+      {"select g, count(*), sum(f), max(f), min(id), avg(id) from A group by "
+       "g;",
+          "iiffif"},
+      {"select s, count(*), sum(g) from A group by s having count(*) > 0 and "
+       "max(id) - min(id) >= 0;",
+          "sii"},
+      {"select count(*), sum(A.g), avg(B.id), max(A.f) from A, B where A.id "
+       "= B.a_id;",
+          "iiff"},
+      {"select C.k, count(*), min(A.f) from A, C where A.s = C.s group by "
+       "C.k having count(*) > 5;",
+          "iif"},
+      {"select D.id, B.v from D, B where D.b_id = B.id and B.a_id % 3 <> 1;",
+          "is"},
+      {"select D.id, C.k, count(*) from D, C, A where D.c_s = C.s and C.k = "
+       "A.g group by D.id, C.k;",
+          "iii"},
+  };
+  auto check = [&]() {
+    for (auto& [sql, types] : queries) {
+      auto expected = db.Sorted(sql, types, {.jit = false});
+      EXPECT_FALSE(expected.empty()) << sql;
+      EXPECT_EQ(db.Sorted(sql, types, {.jit = true}), expected) << sql;
+    }
+  };
+  // Without statistics, the joins are hash joins. With them, some are index
+  // nested-loop joins.
+  check();
+  db->Analyze("A");
+  db->Analyze("B");
+  db->Analyze("C");
+  db->Analyze("D");
+  EXPECT_TRUE(db->GetPlan(queries[10].first)->ToString().find(
+                  "Index Nestloop Join") != std::string::npos);
+  check();
+  // There are no groups if there are no tuples.
+  auto sql = "select count(*), max(f) from A where id < 0;";
+  EXPECT_EQ(db.Sorted(sql, "if", {.jit = true}),
+      db.Sorted(sql, "if", {.jit = false}));
+}
+
+TEST(ExecutorJitTest, CodeCache) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+#ifndef BUILD_JIT
+  GTEST_SKIP() << "Wing is built without the JIT.";
+#endif
+  RemoveDB("__tmp0130");
+  auto db = std::make_unique<wing::Instance>("__tmp0130", SAKURA_USE_JIT_FLAG);
+  EXPECT_TRUE(
+      db->Execute("create table A(id int64 primary key, v int64);").Valid());
+  {
+    std::string stmt = "insert into A values ";
+    for (int i = 0; i < 1000; i++)
+      stmt += fmt::format("{}({}, {})", i ? ", " : "", i, i % 10);
+    EXPECT_TRUE(db->Execute(stmt + ";").Valid());
+  }
+  auto count = [&](const std::string& sql) {
+    auto result = db->Execute(sql);
+    EXPECT_TRUE(result.Valid()) << sql;
+    size_t ret = 0;
+    while (result.Next())
+      ret += 1;
+    return ret;
+  };
+  db->SetJit(true);
+  JitExecutorGenerator::ClearCache();
+  // The executions of a query share the code.
+  EXPECT_EQ(count("select * from A where v = 3;"), 100);
+  EXPECT_EQ(JitExecutorGenerator::CacheSize(), 1);
+  EXPECT_EQ(count("select * from A where v = 3;"), 100);
+  EXPECT_EQ(JitExecutorGenerator::CacheSize(), 1);
+  EXPECT_EQ(count("select * from A where v = 4 and id < 500;"), 50);
+  EXPECT_EQ(JitExecutorGenerator::CacheSize(), 2);
+  // The queries which differ only in their literals share the code.
+  EXPECT_EQ(count("select * from A where v = 7 and id < 300;"), 30);
+  EXPECT_EQ(count("select * from A where v = 1 and id < 1000;"), 100);
+  EXPECT_EQ(JitExecutorGenerator::CacheSize(), 2);
+  // Unless their literals are equal in one query but not in the other.
+  EXPECT_EQ(count("select * from A where v = 1 and id < 1;"), 0);
+  EXPECT_EQ(count("select * from A where v = 5 and id < 5;"), 0);
+  EXPECT_EQ(JitExecutorGenerator::CacheSize(), 3);
+  // The first executions are interpreted in the adaptive mode, but the
+  // results are the same.
+  db->SetJitAdaptive(true);
+  for (int i = 0; i < 5; i++)
+    EXPECT_EQ(count("select v, count(*) from A group by v;"), 10);
+  EXPECT_EQ(JitExecutorGenerator::CacheSize(), 4);
+  db->SetJitAdaptive(false);
+  // A table of the same name but a different schema does not use the code of
+  // the old table.
+  EXPECT_TRUE(db->Execute("drop table A;").Valid());
+  EXPECT_TRUE(
+      db->Execute("create table A(id int64 primary key, v varchar(20));")
+          .Valid());
+  EXPECT_TRUE(db->Execute("insert into A values (1, 'a'), (2, 'b');").Valid());
+  auto result = db->Execute("select * from A where id = 2;");
+  ASSERT_TRUE(result.Valid());
+  auto tuple = result.Next();
+  ASSERT_TRUE(tuple);
+  EXPECT_EQ(tuple.ReadString(1), "b");
+  EXPECT_FALSE(result.Next());
+  // The ranges of the scans and the strings are literals too.
+  auto size = JitExecutorGenerator::CacheSize();
+  result = db->Execute("select * from A where id = 1;");
+  ASSERT_TRUE(result.Valid());
+  tuple = result.Next();
+  ASSERT_TRUE(tuple);
+  EXPECT_EQ(tuple.ReadString(1), "a");
+  EXPECT_FALSE(result.Next());
+  EXPECT_EQ(count("select * from A where v = 'a';"), 1);
+  EXPECT_EQ(count("select * from A where v = 'b';"), 1);
+  EXPECT_EQ(count("select * from A where v = 'c';"), 0);
+  EXPECT_EQ(JitExecutorGenerator::CacheSize(), size + 1);
+  db = nullptr;
+  RemoveDB("__tmp0130");
+}
+
+TEST(ExecutorBenchmark, JitCodeCache) {
+  using namespace wing;
+#ifndef BUILD_JIT
+  GTEST_SKIP() << "Wing is built without the JIT.";
+#endif
+  wing_testing::RemoveDB("__tmp0131");
+  auto db = std::make_unique<wing::Instance>("__tmp0131", SAKURA_USE_JIT_FLAG);
+  EXPECT_TRUE(db->Execute("create table A(id int64 primary key, k int64, "
+                          "v float64);")
+                  .Valid());
+  {
+    std::string stmt = "insert into A values ";
+    for (int i = 0; i < 1000; i++)
+      stmt += fmt::format("{}({}, {}, {}.5)", i ? ", " : "", i, i % 16, i);
+    EXPECT_TRUE(db->Execute(stmt + ";").Valid());
+  }
+  auto run = [&](const std::string& sql) {
+    StopWatch sw;
+    auto result = db->Execute(sql);
+    EXPECT_TRUE(result.Valid());
+    while (result.Next()) {
+    }
+    return sw.GetTimeInSeconds();
+  };
+  auto sql =
+      "select k, count(*), sum(v) from A where id < 500 group by k having "
+      "count(*) > 1;";
+  const int rounds = 20;
+  db->SetJit(true);
+  JitExecutorGenerator::ClearCache();
+  double cold_time = run(sql);
+  double warm_time = 0;
+  for (int i = 0; i < rounds; i++)
+    warm_time += run(sql);
+  warm_time /= rounds;
+  DB_INFO("Compile and execute {:.3f}ms, cached {:.3f}ms, {:.1f}x",
+      cold_time * 1e3, warm_time * 1e3, cold_time / warm_time);
+  // In the adaptive mode, the first execution does not wait for the
+  // compilation.
+  JitExecutorGenerator::ClearCache();
+  db->SetJitAdaptive(true);
+  double adaptive_time = run(sql);
+  db->SetJit(false);
+  double interpreted_time = run(sql);
+  DB_INFO("First execution: adaptive {:.3f}ms, interpreted {:.3f}ms",
+      adaptive_time * 1e3, interpreted_time * 1e3);
+  // The code is shared by the queries with other literals, so they are not
+  // compiled or interpreted again.
+  db->SetJit(true);
+  db->SetJitAdaptive(false);
+  run(sql);
+  double other_time = 0;
+  for (int i = 0; i < rounds; i++)
+    other_time += run(fmt::format(
+        "select k, count(*), sum(v) from A where id < {} group by k having "
+        "count(*) > 1;",
+        400 + i));
+  other_time /= rounds;
+  EXPECT_EQ(JitExecutorGenerator::CacheSize(), 1);
+  DB_INFO("Other literals: {:.3f}ms", other_time * 1e3);
+  db = nullptr;
+  wing_testing::RemoveDB("__tmp0131");
+}
+
+TEST(ExecutorPreparedTest, PlanCache) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  RemoveDB("__tmp0132");
+  auto db = std::make_unique<wing::Instance>("__tmp0132", SAKURA_USE_JIT_FLAG);
+  EXPECT_TRUE(db->Execute("create table A(id int64 primary key, k int32, "
+                          "v float64, s varchar(20));")
+                  .Valid());
+  {
+    std::string stmt = "insert into A values ";
+    for (int i = 0; i < 1000; i++)
+      stmt += fmt::format(
+          "{}({}, {}, {}.5, 's{}')", i ? ", " : "", i, i % 10, i, i % 7);
+    EXPECT_TRUE(db->Execute(stmt + ";").Valid());
+  }
+  auto int64 = [](int64_t x) {
+    return Field::CreateInt(FieldType::INT64, 8, x);
+  };
+  auto float64 = [](double x) {
+    return Field::CreateFloat(FieldType::FLOAT64, 8, x);
+  };
+  auto varchar = [](std::string_view x) {
+    return Field::CreateString(FieldType::VARCHAR, x);
+  };
+  auto count = [](ResultSet result) {
+    EXPECT_TRUE(result.Valid());
+    size_t ret = 0;
+    while (result.Next())
+      ret += 1;
+    return ret;
+  };
+  // Point lookups with different keys share the plan.
+  auto point = db->Prepare("select id, k from A where id = ?;");
+  EXPECT_EQ(point.num_params_, 1);
+  for (int i = 0; i < 1000; i += 37) {
+    auto result = db->ExecuteBound(point, {int64(i)});
+    ASSERT_TRUE(result.Valid());
+    auto tuple = result.Next();
+    ASSERT_TRUE(tuple);
+    EXPECT_EQ(tuple.ReadInt(0), i);
+    EXPECT_EQ(tuple.ReadInt(1), i % 10);
+    EXPECT_FALSE(result.Next());
+  }
+  EXPECT_EQ(count(db->ExecuteBound(point, {int64(1000)})), 0);
+  // The bounds of the range scan are computed from the parameters.
+  auto range = db->Prepare("select * from A where id >= ? and id < ?;");
+  EXPECT_EQ(range.num_params_, 2);
+  EXPECT_EQ(count(db->ExecuteBound(range, {int64(10), int64(20)})), 10);
+  EXPECT_EQ(count(db->ExecuteBound(range, {int64(500), int64(1000)})), 500);
+  EXPECT_EQ(count(db->ExecuteBound(range, {int64(30), int64(20)})), 0);
+  // Strings and floats.
+  auto filter = db->Prepare("select * from A where s = ? and v < ?;");
+  EXPECT_EQ(count(db->ExecuteBound(filter, {varchar("s3"), float64(100)})), 14);
+  EXPECT_EQ(
+      count(db->ExecuteBound(filter, {varchar("s0"), float64(1e9)})), 143);
+  EXPECT_EQ(count(db->ExecuteBound(filter, {varchar("x"), float64(1e9)})), 0);
+  // Parameters in expressions are not folded into the plan.
+  auto expr = db->Prepare("select id from A where id = ? + 1;");
+  EXPECT_EQ(count(db->ExecuteBound(expr, {int64(5)})), 1);
+  EXPECT_EQ(count(db->ExecuteBound(expr, {int64(999)})), 0);
+  // Deletes.
+  auto del = db->Prepare("delete from A where id < ?;");
+  EXPECT_TRUE(db->ExecuteBound(del, {int64(10)}).Valid());
+  EXPECT_EQ(count(db->ExecuteBound(range, {int64(0), int64(20)})), 10);
+  // Inserts.
+  auto insert = db->Prepare("insert into A values (?, ?, ?, ?);");
+  EXPECT_EQ(insert.num_params_, 4);
+  EXPECT_TRUE(db->ExecuteBound(insert,
+                    {int64(5), int64(1), float64(2.5), varchar("new")})
+                  .Valid());
+  EXPECT_EQ(count(db->ExecuteBound(filter, {varchar("new"), float64(3)})), 1);
+  // Wrong parameters.
+  EXPECT_FALSE(db->ExecuteBound(point, {}).Valid());
+  EXPECT_FALSE(db->ExecuteBound(point, {int64(1), int64(2)}).Valid());
+  EXPECT_FALSE(db->ExecuteBound(point, {Field()}).Valid());
+  EXPECT_FALSE(db->ExecuteBound(db->Prepare("select * from A limit ?;"),
+                     {int64(1)})
+                   .Valid());
+  // The cached plans are dropped when the statistics are updated, or the
+  // table is dropped.
+  db->Analyze("A");
+  EXPECT_EQ(count(db->ExecuteBound(range, {int64(0), int64(1000)})), 991);
+  EXPECT_TRUE(db->Execute("drop table A;").Valid());
+  EXPECT_TRUE(
+      db->Execute("create table A(id int64 primary key, s varchar(20));")
+          .Valid());
+  EXPECT_TRUE(db->Execute("insert into A values (1, 'a'), (2, 'b');").Valid());
+  {
+    auto result = db->ExecuteBound(
+        db->Prepare("select * from A where id = ?;"), {int64(2)});
+    ASSERT_TRUE(result.Valid());
+    auto tuple = result.Next();
+    ASSERT_TRUE(tuple);
+    EXPECT_EQ(tuple.ReadString(1), "b");
+    EXPECT_FALSE(result.Next());
+  }
+  EXPECT_FALSE(db->ExecuteBound(point, {int64(1)}).Valid());
+  // Cached plans of statements without parameters.
+  for (int i = 0; i < 3; i++)
+    EXPECT_EQ(count(db->Execute("select * from A where id > 1;")), 1);
+  db->SetPlanCacheSize(0);
+  EXPECT_EQ(count(db->ExecuteBound(
+                db->Prepare("select * from A where id > ?;"), {int64(0)})),
+      2);
+  db = nullptr;
+  RemoveDB("__tmp0132");
+}
+
+TEST(ExecutorPreparedTest, Normalize) {
+  using namespace wing;
+  Parser parser;
+  size_t num_params;
+  auto a = parser.Normalize(
+      "SELECT  id, k from A\n where id = ? AND s = 'Its';", num_params);
+  EXPECT_EQ(num_params, 1);
+  auto b = parser.Normalize(
+      "select id,k FROM A WHERE id=? and s='Its' ;", num_params);
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, parser.Normalize(
+                   "select id, k from A where id = ? and s = 'its';",
+                   num_params));
+  parser.Normalize("insert into A values (?, ?, ?);", num_params);
+  EXPECT_EQ(num_params, 3);
+}
+
+TEST(ExecutorBenchmark, PlanCache) {
+  using namespace wing;
+  wing_testing::RemoveDB("__tmp0133");
+  auto db = std::make_unique<wing::Instance>("__tmp0133", SAKURA_USE_JIT_FLAG);
+  EXPECT_TRUE(db->Execute("create table A(id int64 primary key, k int64, "
+                          "v float64);")
+                  .Valid());
+  {
+    std::string stmt = "insert into A values ";
+    for (int i = 0; i < 10000; i++)
+      stmt += fmt::format("{}({}, {}, {}.5)", i ? ", " : "", i, i % 16, i);
+    EXPECT_TRUE(db->Execute(stmt + ";").Valid());
+  }
+  const int rounds = 2000;
+  auto prepared = db->Prepare("select k, v from A where id = ?;");
+  auto run = [&](bool bound) {
+    StopWatch sw;
+    for (int i = 0; i < rounds; i++) {
+      auto id = i * 7 % 10000;
+      auto result =
+          bound ? db->ExecuteBound(prepared,
+                      {Field::CreateInt(FieldType::INT64, 8, id)})
+                : db->Execute(
+                      fmt::format("select k, v from A where id = {};", id));
+      EXPECT_TRUE(result.Valid());
+      EXPECT_TRUE(result.Next());
+    }
+    return rounds / sw.GetTimeInSeconds();
+  };
+  db->SetPlanCacheSize(0);
+  double literal_qps = run(false);
+  double uncached_qps = run(true);
+  db->SetPlanCacheSize(128);
+  double cached_qps = run(true);
+  DB_INFO("Point lookups per second: literals {:.0f}, parameters {:.0f}, "
+          "cached plans {:.0f}, {:.1f}x",
+      literal_qps, uncached_qps, cached_qps, cached_qps / literal_qps);
+  db = nullptr;
+  wing_testing::RemoveDB("__tmp0133");
+}
+
+TEST(ExecutorStreamTest, SameAsMaterialized) {
+  using namespace wing;
+  using namespace wing::wing_testing;
+  RemoveDB("__tmp0134");
+  auto db = std::make_unique<wing::Instance>("__tmp0134", SAKURA_USE_JIT_FLAG);
+  EXPECT_TRUE(db->Execute("create table A(id int64 primary key, k int64, "
+                          "s varchar(20));")
+                  .Valid());
+  {
+    std::string stmt = "insert into A values ";
+    for (int i = 0; i < 5000; i++)
+      stmt += fmt::format(
+          "{}({}, {}, 's{}')", i ? ", " : "", i, i % 13, i * 7 % 1000);
+    EXPECT_TRUE(db->Execute(stmt + ";").Valid());
+  }
+  std::vector<std::pair<std::string, std::string>> queries = {
+      {"select * from A;", "iis"},
+      {"select s, id + k from A where k = 3;", "si"},
+      {"select k, count(*) from A group by k;", "ii"},
+      {"select * from A order by s desc limit 10;", "iis"},
+      {"select * from A where id < 0;", "iis"},
+  };
+  for (bool vectorized : {true, false}) {
+    db->SetVectorized(vectorized);
+    for (auto& [sql, types] : queries) {
+      auto expected = SortedRows(db->Execute(sql), types);
+      EXPECT_EQ(SortedRows(db->ExecuteStream(sql), types), expected) << sql;
+    }
+  }
+  db->SetVectorized(true);
+  // Errors and statements other than SELECT.
+  EXPECT_FALSE(db->ExecuteStream("select * from B;").Valid());
+  EXPECT_TRUE(db->ExecuteStream("delete from A where id >= 4000;").Valid());
+  // The table lock is held until the last row is read.
+  {
+    auto result = db->ExecuteStream("select * from A;");
+    ASSERT_TRUE(result.Next());
+    EXPECT_TRUE(result.Streaming());
+    auto txn = db->GetTxnManager().Begin();
+    EXPECT_THROW(
+        db->Execute("delete from A;", txn->txn_id_), TxnDLAbortException);
+    db->GetTxnManager().Abort(txn);
+    size_t count = 1;
+    while (result.Next())
+      count += 1;
+    EXPECT_EQ(count, 4000);
+    EXPECT_FALSE(result.Streaming());
+    EXPECT_TRUE(db->Execute("delete from A where id >= 3000;").Valid());
+  }
+  // The locks are also released if the ResultSet is destroyed before the
+  // last row.
+  {
+    auto result = db->ExecuteStream("select * from A;");
+    EXPECT_TRUE(result.Next());
+  }
+  EXPECT_EQ(
+      SortedRows(db->ExecuteStream("select id from A;"), "i").size(), 3000);
+  EXPECT_TRUE(db->Execute("drop table A;").Valid());
+  db = nullptr;
+  RemoveDB("__tmp0134");
+}
+
+TEST(ExecutorBenchmark, Streaming) {
+  using namespace wing;
+  wing_testing::RemoveDB("__tmp0135");
+  auto db = std::make_unique<wing::Instance>("__tmp0135", SAKURA_USE_JIT_FLAG);
+  EXPECT_TRUE(db->Execute("create table A(id int64 primary key, k int64, "
+                          "s varchar(40));")
+                  .Valid());
+  const int num_rows = 100000;
+  for (int j = 0; j < num_rows; j += 10000) {
+    std::string stmt = "insert into A values ";
+    for (int i = j; i < j + 10000; i++)
+      stmt += fmt::format("{}({}, {}, 'row number {}')", i > j ? ", " : "",
+          i, i % 16, i);
+    EXPECT_TRUE(db->Execute(stmt + ";").Valid());
+  }
+  auto run = [&](bool stream) {
+    StopWatch sw;
+    auto result = stream ? db->ExecuteStream("select * from A;")
+                         : db->Execute("select * from A;");
+    EXPECT_TRUE(result.Next());
+    double first = sw.GetTimeInSeconds();
+    int count = 1;
+    while (result.Next())
+      count += 1;
+    EXPECT_EQ(count, num_rows);
+    return std::make_pair(first, sw.GetTimeInSeconds());
+  };
+  auto [materialized_first, materialized_total] = run(false);
+  auto [stream_first, stream_total] = run(true);
+  DB_INFO("First row {:.3f}ms, streaming {:.3f}ms; all rows {:.3f}ms, "
+          "streaming {:.3f}ms",
+      materialized_first * 1e3, stream_first * 1e3, materialized_total * 1e3,
+      stream_total * 1e3);
+  db = nullptr;
+  wing_testing::RemoveDB("__tmp0135");
+}
+
+TEST(ExecutorBenchmark, ExprKernels) {
+  using namespace wing;
+  // Rows of (a int64, b int64, c float64), as the outputs of executors.
+  OutputSchema schema({{0, "T", "a", FieldType::INT64, 8},
+      {1, "T", "b", FieldType::INT64, 8}, {2, "T", "c", FieldType::FLOAT64, 8}});
+  auto column = [](uint32_t id, RetType type) {
+    auto ret = std::make_unique<ColumnExpr>("T", "");
+    ret->id_in_column_name_table_ = id;
+    ret->ret_type_ = type;
+    return ret;
+  };
+  auto integer = [](int64_t x) {
+    auto ret = std::make_unique<LiteralIntegerExpr>(x);
+    ret->ret_type_ = RetType::INT;
+    return ret;
+  };
+  auto binary = [](OpType op, std::unique_ptr<Expr> x,
+                    std::unique_ptr<Expr> y) -> std::unique_ptr<Expr> {
+    auto type = x->ret_type_;
+    auto ret = std::make_unique<BinaryExpr>(op, std::move(x), std::move(y));
+    ret->ret_type_ = type;
+    return ret;
+  };
+  auto cond = [](OpType op, std::unique_ptr<Expr> x,
+                  std::unique_ptr<Expr> y) -> std::unique_ptr<Expr> {
+    auto ret =
+        std::make_unique<BinaryConditionExpr>(op, std::move(x), std::move(y));
+    ret->ret_type_ = RetType::INT;
+    return ret;
+  };
+  auto to_float = [](std::unique_ptr<Expr> x) -> std::unique_ptr<Expr> {
+    auto ret = std::make_unique<CastExpr>(std::move(x));
+    ret->ret_type_ = RetType::FLOAT;
+    return ret;
+  };
+  // a + b * 3 < 1500 and c > a or b & 7 = 0
+  auto predicate = cond(OpType::OR,
+      cond(OpType::AND,
+          cond(OpType::LT,
+              binary(OpType::ADD, column(0, RetType::INT),
+                  binary(OpType::MUL, column(1, RetType::INT), integer(3))),
+              integer(1500)),
+          cond(OpType::GT, column(2, RetType::FLOAT),
+              to_float(column(0, RetType::INT)))),
+      cond(OpType::EQ,
+          binary(OpType::BITAND, column(1, RetType::INT), integer(7)),
+          integer(0)));
+  // c * c - a * 0.5
+  auto project = binary(OpType::SUB,
+      binary(OpType::MUL, column(2, RetType::FLOAT), column(2, RetType::FLOAT)),
+      binary(OpType::MUL, to_float(column(0, RetType::INT)), [] {
+        auto ret = std::make_unique<LiteralFloatExpr>(0.5);
+        ret->ret_type_ = RetType::FLOAT;
+        return ret;
+      }()));
+
+  const size_t num = 1 << 20;
+  std::mt19937_64 gen(0x1234);
+  std::vector<StaticFieldRef> data(num * 3);
+  std::vector<const uint8_t*> input(num);
+  for (size_t i = 0; i < num; i++) {
+    data[i * 3] = StaticFieldRef::CreateInt(gen() % 2000);
+    data[i * 3 + 1] = StaticFieldRef::CreateInt(gen() % 1000);
+    data[i * 3 + 2] = StaticFieldRef::CreateFloat((gen() % 4000) / 2.0);
+    input[i] = reinterpret_cast<const uint8_t*>(&data[i * 3]);
+  }
+  const size_t batch = 1024, rounds = 10;
+  for (auto expr : {predicate.get(), project.get()}) {
+    ExprFunction func(expr, schema);
+    VecExprFunction vec_func(expr, schema);
+    std::vector<StaticFieldRef> expected(num), result(num);
+    std::vector<uint8_t> mask(num);
+    StopWatch sw;
+    for (size_t r = 0; r < rounds; r++)
+      for (size_t i = 0; i < num; i++)
+        expected[i] = func.Evaluate(input[i]);
+    double closure_time = sw.GetTimeInSeconds();
+    sw.Reset();
+    for (size_t r = 0; r < rounds; r++)
+      for (size_t i = 0; i < num; i += batch)
+        vec_func.Evaluate(input.data() + i, batch, result.data() + i);
+    double vec_time = sw.GetTimeInSeconds();
+    vec_func.EvaluateMask(input.data(), num, mask.data());
+    for (size_t i = 0; i < num; i++) {
+      ASSERT_EQ(result[i].ReadInt(), expected[i].ReadInt()) << i;
+      ASSERT_EQ(mask[i], expected[i].ReadInt() != 0) << i;
+    }
+    DB_INFO("{}: closures {}s, kernels {}s, speedup {:.2f}x", expr->ToString(),
+        closure_time, vec_time, closure_time / vec_time);
+  }
+}
+
+TEST(ExecutorBenchmark, HashAggregate) {
+  using namespace wing;
+  wing_testing::RemoveDB("__tmp0120");
+  auto db = std::make_unique<wing::Instance>("__tmp0120", SAKURA_USE_JIT_FLAG);
+  EXPECT_TRUE(db->Execute("create table A(id int64 primary key, k int64, "
+                          "v float64, s varchar(20));")
+                  .Valid());
+  const int n = 200000;
+  for (int begin = 0; begin < n; begin += 50000) {
+    std::string stmt = "insert into A values ";
+    for (int i = begin; i < begin + 50000; i++)
+      stmt += fmt::format("{}({}, {}, {:.1f}, 's{}')", i > begin ? ", " : "",
+          i, (i * 7919) % n, (i % 1000) * 0.5, i % 16);
+    EXPECT_TRUE(db->Execute(stmt + ";").Valid());
+  }
+  // Return the number of output rows and the time.
+  auto run = [&](const std::string& sql) {
+    // The first execution with the JIT compiles the code, which is cached.
+    if (SAKURA_USE_JIT_FLAG)
+      db->Execute(sql);
+    StopWatch sw;
+    auto result = db->Execute(sql);
+    EXPECT_TRUE(result.Valid());
+    size_t rows = 0;
+    while (result.Next())
+      rows += 1;
+    return std::make_pair(rows, sw.GetTimeInSeconds());
+  };
+  auto [scan_rows, scan_time] = run("select k, v, s from A;");
+  DB_INFO("Scan {} rows: {:.2f}M rows/s", scan_rows, n / scan_time / 1e6);
+  for (auto sql : {"select s, count(*), sum(v), max(k) from A group by s;",
+           "select k % 1000, count(*), sum(v), min(id) from A group by k % "
+           "1000;",
+           "select k, count(*), sum(v), avg(v), max(id) from A group by k;",
+           "select k, s, count(*), sum(v) from A group by k, s;"}) {
+    auto [groups, time] = run(sql);
+    DB_INFO("{}: {} groups, {:.2f}M rows/s", sql, groups, n / time / 1e6);
+  }
+  db = nullptr;
+  wing_testing::RemoveDB("__tmp0120");
+
+  // The groups are allocated from the arena of GroupTable in large blocks,
+  // so the number of blocks is much smaller than the number of groups.
+  for (size_t num_groups : {16, 1000, 200000}) {
+    GroupTable table({RetType::INT, RetType::FLOAT}, 3);
+    StopWatch sw;
+    for (int i = 0; i < n; i++) {
+      int64_t k = (i * 7919LL) % num_groups;
+      StaticFieldRef keys[2] = {StaticFieldRef::CreateInt(k),
+          StaticFieldRef::CreateFloat(k * 0.5)};
+      auto [group, inserted] = table.FindOrInsert(keys);
+      GroupTable::States(group)[0].size_ += 1;
+    }
+    double time = sw.GetTimeInSeconds();
+    EXPECT_EQ(table.Size(), num_groups);
+    DB_INFO("GroupTable with {} groups: {:.2f}M rows/s, {} arena blocks, "
+            "{:.1f} bytes per group",
+        num_groups, n / time / 1e6, table.ArenaBlocks(),
+        (double)table.MemoryUsage() / num_groups);
+    EXPECT_LE(table.ArenaBlocks(), num_groups / 256 + 1);
+  }
+}
+
+TEST(ExecutorBenchmark, TopN) {
+  using namespace wing;
+  wing_testing::RemoveDB("__tmp0123");
+  auto db = std::make_unique<wing::Instance>("__tmp0123", SAKURA_USE_JIT_FLAG);
+  EXPECT_TRUE(db->Execute("create table A(id int64 primary key, k int64, "
+                          "f float64, s varchar(20));")
+                  .Valid());
+  const int n = 1000000;
+  for (int begin = 0; begin < n; begin += 50000) {
+    std::string stmt = "insert into A values ";
+    for (int i = begin; i < begin + 50000; i++)
+      stmt += fmt::format("{}({}, {}, {:.1f}, 's{}')", i > begin ? ", " : "",
+          i, (i * 7919LL) % n, (i * 31 % 577) * 0.5, (i * 13) % 4999);
+    EXPECT_TRUE(db->Execute(stmt + ";").Valid());
+  }
+  // Read the first 10 rows of the query.
+  auto run = [&](const std::string& sql) {
+    StopWatch sw;
+    auto result = db->Execute(sql);
+    EXPECT_TRUE(result.Valid());
+    std::vector<std::string> rows;
+    for (int i = 0; i < 10; i++) {
+      auto tuple = result.Next();
+      rows.push_back(fmt::format("{}|{}", tuple.ReadInt(0), tuple.ReadInt(1)));
+    }
+    return std::make_pair(rows, sw.GetTimeInSeconds());
+  };
+  for (auto order : {"order by k asc", "order by k desc",
+           "order by f asc, id desc", "order by s asc, id asc"}) {
+    auto [sorted, sort_time] =
+        run(fmt::format("select id, k from A {};", order));
+    auto [top, top_time] =
+        run(fmt::format("select id, k from A {} limit 10;", order));
+    EXPECT_EQ(top, sorted);
+    DB_INFO("{} over {} rows: sort {:.3f}s, top-n {:.3f}s, speedup {:.2f}x",
+        order, n, sort_time, top_time, sort_time / top_time);
+  }
+  db = nullptr;
+  wing_testing::RemoveDB("__tmp0123");
+}
+
+TEST(ExecutorBenchmark, SortKeys) {
+  using namespace wing;
+  const size_t n = 1000000;
+  std::mt19937_64 rng(0x5eed);
+  std::vector<std::shared_ptr<StaticStringField>> strings;
+  for (size_t i = 0; i < 50000; i++) {
+    // Some strings share their first 8 bytes.
+    strings.emplace_back(
+        StaticStringField::Generate(fmt::format("{}{}",
+            i % 3 ? "prefix__" : "", std::to_string(rng() % 1000000))),
+        StaticStringField::FreeFromGenerate);
+  }
+  auto run = [&](const std::string& name,
+                 std::vector<std::pair<RetType, bool>> order) {
+    // Each tuple is its keys.
+    std::vector<StaticFieldRef> fields(n * order.size());
+    std::vector<StaticFieldRef*> tuples(n);
+    for (size_t i = 0; i < n; i++) {
+      tuples[i] = fields.data() + i * order.size();
+      for (size_t j = 0; j < order.size(); j++) {
+        if (order[j].first == RetType::INT) {
+          tuples[i][j] = StaticFieldRef::CreateInt(
+              static_cast<int64_t>(rng() % 2000000) - 1000000);
+        } else if (order[j].first == RetType::FLOAT) {
+          tuples[i][j] = StaticFieldRef::CreateFloat(
+              (static_cast<int64_t>(rng() % 2000001) - 1000000) / 7.0);
+        } else {
+          tuples[i][j] = StaticFieldRef::CreateStringRef(
+              strings[rng() % strings.size()].get());
+        }
+      }
+    }
+    TupleSorter sorter(order);
+    auto expected = tuples;
+    StopWatch sw;
+    std::sort(expected.begin(), expected.end(),
+        [&](auto a, auto b) { return sorter.Less(a, b); });
+    double comparator_time = sw.GetTimeInSeconds();
+    sw.Reset();
+    sorter.Sort(tuples.data(), tuples.data() + n);
+    double sorter_time = sw.GetTimeInSeconds();
+    for (size_t i = 0; i < n; i++) {
+      ASSERT_FALSE(sorter.Less(tuples[i], expected[i]) ||
+                   sorter.Less(expected[i], tuples[i]))
+          << name << " " << i;
+    }
+    DB_INFO("{}: std::sort with comparator {:.3f}s, normalized keys {:.3f}s, "
+            "speedup {:.2f}x",
+        name, comparator_time, sorter_time, comparator_time / sorter_time);
+  };
+  run("INT asc", {{RetType::INT, true}});
+  run("INT desc", {{RetType::INT, false}});
+  run("FLOAT asc", {{RetType::FLOAT, true}});
+  run("VARCHAR asc", {{RetType::STRING, true}});
+  run("VARCHAR desc, INT asc",
+      {{RetType::STRING, false}, {RetType::INT, true}});
+  run("FLOAT desc, VARCHAR asc",
+      {{RetType::FLOAT, false}, {RetType::STRING, true}});
 }
 
 TEST(ExecutorAllTest, OJContestTest) {
   // In Lecture 2
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0110");
+  RemoveDB("__tmp0110");
   auto db = std::make_unique<wing::Instance>("__tmp0110", SAKURA_USE_JIT_FLAG);
   // clang-format off
   EXPECT_TRUE(db->Execute("create table Contestant(id int32 auto_increment primary key, name varchar(8));").Valid());
@@ -1497,5 +2841,5 @@ TEST(ExecutorAllTest, OJContestTest) {
   }
 
   db = nullptr;
-  std::filesystem::remove("__tmp0110");
+  RemoveDB("__tmp0110");
 }
\ No newline at end of file
@@ -2,10 +2,13 @@
 
 #include <filesystem>
 #include <fstream>
+#include <functional>
 
 #include "catalog/stat.hpp"
 #include "common/stopwatch.hpp"
+#include "execution/join_hash_table.hpp"
 #include "instance/instance.hpp"
+#include "jit/jitexecutor.hpp"
 #include "test.hpp"
 #include "zipf.hpp"
 
@@ -70,6 +73,54 @@ static std::pair<size_t, double> GetExecutionTime(wing::Instance& db, const std:
   return {tuple_counts, sw.GetTimeInSeconds()};
 }
 
+// Run the queries tuple-at-a-time and then vectorized, and report the
+// speedup. Return the result and the execution time of the vectorized run.
+static std::pair<size_t, double> CompareExecutionTime(wing::Instance& db, const std::string& file_name) {
+  db.SetVectorized(false);
+  auto [expected_counts, tuple_time] = GetExecutionTime(db, file_name);
+  db.SetVectorized(true);
+  auto [tuple_counts, time] = GetExecutionTime(db, file_name);
+  EXPECT_EQ(tuple_counts, expected_counts);
+  DB_INFO("Tuple-at-a-time {}s, vectorized {}s, speedup {:.2f}x", tuple_time, time, tuple_time / time);
+  return {tuple_counts, time};
+}
+
+// Run the queries with 1, 2, 4, 8 and 16 threads, and report the speedups
+// over 1 thread.
+static void CompareThreads(wing::Instance& db, const std::string& file_name) {
+  db.SetThreads(1);
+  auto [expected_counts, serial_time] = GetExecutionTime(db, file_name);
+  for (size_t threads : {2, 4, 8, 16}) {
+    db.SetThreads(threads);
+    auto [tuple_counts, time] = GetExecutionTime(db, file_name);
+    EXPECT_EQ(tuple_counts, expected_counts);
+    DB_INFO("{}: {} threads {}s, speedup {:.2f}x", file_name, threads, time, serial_time / time);
+  }
+  db.SetThreads(1);
+}
+
+// Run the queries interpreted and compiled by the JIT, and report the speedup
+// of the JIT.
+static void CompareJit(wing::Instance& db, const std::string& file_name) {
+  db.SetJit(false);
+  auto [expected_counts, interpreted_time] = GetExecutionTime(db, file_name);
+  wing::JitExecutorGenerator::ClearCache();
+  db.SetJit(true);
+  auto [tuple_counts, cold_time] = GetExecutionTime(db, file_name);
+  EXPECT_EQ(tuple_counts, expected_counts);
+  // The first run compiles the plans, the second one reuses the cached code.
+  auto [cached_counts, time] = GetExecutionTime(db, file_name);
+  db.SetJit(false);
+  EXPECT_EQ(cached_counts, expected_counts);
+  // The plans that the JIT does not support are interpreted, and not cached.
+  if (wing::JitExecutorGenerator::CacheSize() == 0) {
+    DB_INFO("{}: interpreted {}s, not supported by the JIT", file_name, interpreted_time);
+  } else {
+    DB_INFO("{}: interpreted {}s, JIT {}s (first run {}s), speedup {:.2f}x", file_name, interpreted_time, time,
+        cold_time, interpreted_time / time);
+  }
+}
+
 static bool CheckData(wing::Instance& db, int movieN, int movieRoleN, int movieCompanyN, int castN, int personN, int akaN) {
   auto check_table = [&](auto table_name, int counts) {
     auto rs = db.Execute(fmt::format("select count(*) from {};", table_name));
@@ -239,7 +290,7 @@ static bool CheckDefaultData(wing::Instance& db) {
 static void EnsureDB(std::unique_ptr<wing::Instance>& db) {
   db = std::make_unique<wing::Instance>("__imdb", SAKURA_USE_JIT_FLAG);
   if (!CheckDefaultData(*db)) {
-    std::filesystem::remove("__imdb");
+    wing::wing_testing::RemoveDB("__imdb");
     db = std::make_unique<wing::Instance>("__imdb", SAKURA_USE_JIT_FLAG);
     CreateTables(*db);
     DB_INFO("Generating data...");
@@ -250,17 +301,93 @@ static void EnsureDB(std::unique_ptr<wing::Instance>& db) {
   }
 }
 
+// Build a JoinHashTable on the integer keys returned by "build_sql", and
+// probe it with the keys returned by "probe_sql" a batch at a time. Report the
+// throughputs, and those of the buckets of std::vector that HashJoinExecutor
+// used before.
+static void BenchmarkJoinHashTable(wing::Instance& db, const std::string& build_sql, const std::string& probe_sql) {
+  using namespace wing;
+  auto read_keys = [&](const std::string& sql) {
+    std::vector<StaticFieldRef> ret;
+    auto result = db.Execute(sql);
+    EXPECT_TRUE(result.Valid());
+    while (auto tuple = result.Next())
+      ret.push_back(StaticFieldRef::CreateInt(tuple.ReadInt(0)));
+    return ret;
+  };
+  auto build = read_keys(build_sql);
+  auto probe = read_keys(probe_sql);
+
+  StopWatch sw;
+  JoinHashTable table({RetType::INT});
+  for (auto& key : build)
+    table.Append(&key, reinterpret_cast<const uint8_t*>(&key));
+  table.Build();
+  double build_time = sw.GetTimeInSeconds();
+  sw.Reset();
+  const size_t batch = 1024;
+  std::vector<uint64_t> hashes(batch);
+  std::vector<std::pair<size_t, size_t>> entries(batch);
+  size_t matches = 0;
+  for (size_t begin = 0; begin < probe.size(); begin += batch) {
+    size_t num = std::min(batch, probe.size() - begin);
+    for (size_t i = 0; i < num; i++) {
+      hashes[i] = table.Hash(&probe[begin + i]);
+      table.Prefetch(table.Bucket(hashes[i]));
+    }
+    for (size_t i = 0; i < num; i++) {
+      size_t bucket = table.Bucket(hashes[i]);
+      entries[i] = {table.Begin(bucket), table.End(bucket)};
+      table.PrefetchEntry(entries[i].first);
+    }
+    for (size_t i = 0; i < num; i++) {
+      for (size_t e = entries[i].first; e < entries[i].second; e++)
+        matches += table.Match(e, hashes[i], &probe[begin + i]);
+    }
+  }
+  double probe_time = sw.GetTimeInSeconds();
+
+  sw.Reset();
+  size_t mask = 1;
+  while (mask < build.size())
+    mask <<= 1;
+  std::vector<std::vector<std::pair<uint64_t, const StaticFieldRef*>>> buckets(mask);
+  mask -= 1;
+  for (auto& key : build)
+    buckets[key.ReadInt() & mask].emplace_back(key.ReadInt(), &key);
+  double vector_build_time = sw.GetTimeInSeconds();
+  sw.Reset();
+  size_t vector_matches = 0;
+  for (auto& key : probe)
+    for (auto& [hash, row] : buckets[key.ReadInt() & mask])
+      vector_matches += (uint64_t)key.ReadInt() == hash;
+  double vector_probe_time = sw.GetTimeInSeconds();
+
+  EXPECT_EQ(matches, vector_matches);
+  DB_INFO("Build {} rows: {:.1f}M rows/s, std::vector buckets {:.1f}M rows/s", build.size(), build.size() / build_time / 1e6, build.size() / vector_build_time / 1e6);
+  DB_INFO("Probe {} rows, {} matches: {:.1f}M rows/s, std::vector buckets {:.1f}M rows/s", probe.size(), matches, probe.size() / probe_time / 1e6, probe.size() / vector_probe_time / 1e6);
+}
+
+TEST(Benchmark, JoinHashTable) {
+  using namespace wing;
+  std::unique_ptr<wing::Instance> db;
+  EnsureDB(db);
+  BenchmarkJoinHashTable(*db, "select id from title;", "select movie_id from cast_info;");
+  BenchmarkJoinHashTable(*db, "select id from name;", "select person_id from cast_info;");
+  BenchmarkJoinHashTable(*db, "select movie_id from movie_companies;", "select id from title;");
+}
+
 TEST(Benchmark, JoinOrder10Q1) {
   using namespace wing;
   using namespace wing::wing_testing;
-  // std::filesystem::remove("__imdb");
+  // RemoveDB("__imdb");
   std::filesystem::remove("__job_benchmark_result1");
   std::unique_ptr<wing::Instance> db;
   EnsureDB(db);
 
   AnalyzeAllTable(*db);
   std::ofstream out("__job_benchmark_result1");
-  auto [tuple_counts, result] = GetExecutionTime(*db, test_sql1);
+  auto [tuple_counts, result] = CompareExecutionTime(*db, test_sql1);
   DB_INFO("Use {}s", result);
   out << tuple_counts << " " << result;
 }
@@ -268,14 +395,14 @@ TEST(Benchmark, JoinOrder10Q1) {
 TEST(Benchmark, JoinOrder10Q2) {
   using namespace wing;
   using namespace wing::wing_testing;
-  // std::filesystem::remove("__imdb");
+  // RemoveDB("__imdb");
   std::filesystem::remove("__job_benchmark_result2");
   std::unique_ptr<wing::Instance> db;
   EnsureDB(db);
 
   AnalyzeAllTable(*db);
   std::ofstream out("__job_benchmark_result2");
-  auto [tuple_counts, result] = GetExecutionTime(*db, test_sql2);
+  auto [tuple_counts, result] = CompareExecutionTime(*db, test_sql2);
   DB_INFO("Use {}s", result);
   out << tuple_counts << " " << result;
 }
@@ -283,14 +410,14 @@ TEST(Benchmark, JoinOrder10Q2) {
 TEST(Benchmark, JoinOrder10Q3) {
   using namespace wing;
   using namespace wing::wing_testing;
-  // std::filesystem::remove("__imdb");
+  // RemoveDB("__imdb");
   std::filesystem::remove("__job_benchmark_result3");
   std::unique_ptr<wing::Instance> db;
   EnsureDB(db);
 
   AnalyzeAllTable(*db);
   std::ofstream out("__job_benchmark_result3");
-  auto [tuple_counts, result] = GetExecutionTime(*db, test_sql3);
+  auto [tuple_counts, result] = CompareExecutionTime(*db, test_sql3);
   DB_INFO("Use {}s", result);
   out << tuple_counts << " " << result;
 }
@@ -299,14 +426,136 @@ TEST(Benchmark, JoinOrder10Q3) {
 TEST(Benchmark, JoinOrder10Q4) {
   using namespace wing;
   using namespace wing::wing_testing;
-  // std::filesystem::remove("__imdb");
+  // RemoveDB("__imdb");
   std::filesystem::remove("__job_benchmark_result4");
   std::unique_ptr<wing::Instance> db;
   EnsureDB(db);
 
   AnalyzeAllTable(*db);
   std::ofstream out("__job_benchmark_result4");
-  auto [tuple_counts, result] = GetExecutionTime(*db, test_sql4);
+  auto [tuple_counts, result] = CompareExecutionTime(*db, test_sql4);
   DB_INFO("Use {}s", result);
   out << tuple_counts << " " << result;
-}
\ No newline at end of file
+}
+
+TEST(Benchmark, JoinOrderParallel) {
+  using namespace wing;
+  std::unique_ptr<wing::Instance> db;
+  EnsureDB(db);
+
+  AnalyzeAllTable(*db);
+  for (auto file_name : {test_sql1, test_sql2, test_sql3, test_sql4})
+    CompareThreads(*db, file_name);
+}
+
+// The JIT compiles the joins and the aggregation of each query into one
+// function. Without the JIT, both runs are interpreted.
+TEST(Benchmark, JoinOrderJit) {
+  using namespace wing;
+  std::unique_ptr<wing::Instance> db;
+  EnsureDB(db);
+
+  AnalyzeAllTable(*db);
+  for (auto file_name : {test_sql1, test_sql2, test_sql3, test_sql4})
+    CompareJit(*db, file_name);
+}
+
+// GROUP BY with few groups (role_id), which are pre-aggregated in the tables
+// of the threads, and with many groups (person_id), which overflow them.
+TEST(Benchmark, GroupByParallel) {
+  using namespace wing;
+  std::unique_ptr<wing::Instance> db;
+  EnsureDB(db);
+
+  for (auto sql : {"select role_id, count(*), sum(person_id), max(movie_id) from cast_info group by role_id;",
+           "select person_id, count(*), sum(role_id), avg(movie_id) from cast_info group by person_id;",
+           "select movie_id, person_role_id, count(*) from cast_info group by movie_id, person_role_id;"}) {
+    std::vector<std::string> expected;
+    double serial_time = 0;
+    for (size_t threads : {1, 2, 4, 8}) {
+      db->SetThreads(threads);
+      StopWatch sw;
+      auto result = db->Execute(sql);
+      EXPECT_TRUE(result.Valid());
+      std::vector<std::string> rows;
+      while (auto tuple = result.Next())
+        rows.push_back(fmt::format("{} {}", tuple.ReadInt(0), tuple.ReadInt(1)));
+      double time = sw.GetTimeInSeconds();
+      std::sort(rows.begin(), rows.end());
+      if (threads == 1) {
+        expected = std::move(rows);
+        serial_time = time;
+        DB_INFO("{}: {} groups, 1 thread {}s", sql, expected.size(), time);
+      } else {
+        EXPECT_EQ(rows, expected);
+        DB_INFO("{}: {} threads {}s, speedup {:.2f}x", sql, threads, time, serial_time / time);
+      }
+    }
+  }
+  db->SetThreads(1);
+}
+
+// The bytes of the fields of "columns" in the rows of "table", where a string
+// has its characters, and the 4 bytes of its size and of its offset. Return the number of rows and
+// the average bytes per row.
+static std::pair<size_t, double> BytesPerRow(wing::Instance& db, const std::string& table, const wing::OutputSchema& columns) {
+  using namespace wing;
+  std::string sql = "select ";
+  for (size_t i = 0; i < columns.Size(); i++)
+    sql += (i ? ", " : "") + columns[i].column_name_;
+  auto result = db.Execute(sql + " from " + table + ";");
+  EXPECT_TRUE(result.Valid());
+  size_t rows = 0, bytes = 0;
+  while (auto tuple = result.Next()) {
+    rows++;
+    for (size_t i = 0; i < columns.Size(); i++) {
+      if (columns[i].type_ == FieldType::CHAR || columns[i].type_ == FieldType::VARCHAR)
+        bytes += 4 + sizeof(uint32_t) + tuple.ReadString(i).size();
+      else
+        bytes += columns[i].size_;
+    }
+  }
+  return {rows, rows ? (double)bytes / rows : 0};
+}
+
+// For each scan whose columns are pruned, report the bytes per row of the
+// columns it outputs, which are deserialized and copied by the joins, and of
+// all columns of the table, which are deserialized without pruning.
+TEST(Benchmark, PruneColumns) {
+  using namespace wing;
+  std::unique_ptr<wing::Instance> db;
+  EnsureDB(db);
+
+  AnalyzeAllTable(*db);
+  for (auto file_name : {test_sql1, test_sql2, test_sql3, test_sql4}) {
+    for (auto& sql : ReadSQLFromFile(file_name)) {
+      auto plan = db->GetPlan(sql);
+      ASSERT_TRUE(plan);
+      double pruned_bytes = 0, all_bytes = 0;
+      std::function<void(const PlanNode*)> visit = [&](const PlanNode* node) {
+        if (node == nullptr)
+          return;
+        const OutputSchema* table_schema = nullptr;
+        const std::string* table = nullptr;
+        if (node->type_ == PlanType::SeqScan) {
+          table_schema = &static_cast<const SeqScanPlanNode*>(node)->table_schema_;
+          table = &static_cast<const SeqScanPlanNode*>(node)->table_name_;
+        } else if (node->type_ == PlanType::RangeScan) {
+          table_schema = &static_cast<const RangeScanPlanNode*>(node)->table_schema_;
+          table = &static_cast<const RangeScanPlanNode*>(node)->table_name_;
+        }
+        if (table_schema != nullptr && table_schema->Size() > 0) {
+          auto [rows, pruned] = BytesPerRow(*db, *table, node->output_schema_);
+          auto [_, all] = BytesPerRow(*db, *table, *table_schema);
+          DB_INFO("{}: {} of {} columns, {:.1f} of {:.1f} bytes per row", *table, node->output_schema_.Size(), table_schema->Size(), pruned, all);
+          pruned_bytes += rows * pruned;
+          all_bytes += rows * all;
+        }
+        visit(node->ch_.get());
+        visit(node->ch2_.get());
+      };
+      visit(plan.get());
+      DB_INFO("{}: {:.1f}MB of {:.1f}MB of the scanned rows are deserialized", file_name, pruned_bytes / 1e6, all_bytes / 1e6);
+    }
+  }
+}
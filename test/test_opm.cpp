@@ -13,7 +13,7 @@
 TEST(OptimizerTest, PushdownTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0201");
+  RemoveDB("__tmp0201");
   auto db = std::make_unique<wing::Instance>("__tmp0201", SAKURA_USE_JIT_FLAG);
   {
     ResultSet result;
@@ -85,13 +85,13 @@ TEST(OptimizerTest, PushdownTest) {
   }
 
   db = nullptr;
-  std::filesystem::remove("__tmp0201");
+  RemoveDB("__tmp0201");
 }
 
 // TEST(OptimizerTest, ProjectFoldTest) {
 //   using namespace wing;
 //   using namespace wing::wing_testing;
-//   std::filesystem::remove("__tmp0202");
+//   RemoveDB("__tmp0202");
 //   auto db = std::make_unique<wing::Instance>("__tmp0202",
 //   SAKURA_USE_JIT_FLAG);
 //   {
@@ -122,7 +122,7 @@ TEST(OptimizerTest, PushdownTest) {
 //     DB_INFO("Use: {} s", sw.GetTimeInSeconds());
 //   }
 //   db = nullptr;
-//   std::filesystem::remove("__tmp0202");
+//   RemoveDB("__tmp0202");
 // }
 
 TEST(StatsTest, HyperLLTest) {
@@ -168,7 +168,7 @@ TEST(StatsTest, CountMinSketchTest) {
 TEST(OptimizerTest, JoinCommuteTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0203");
+  RemoveDB("__tmp0203");
   auto db = std::make_unique<wing::Instance>("__tmp0203", SAKURA_USE_JIT_FLAG);
   {
     EXPECT_TRUE(db->Execute("create table B(a int64 auto_increment primary "
@@ -285,13 +285,13 @@ TEST(OptimizerTest, JoinCommuteTest) {
   }
 
   db = nullptr;
-  std::filesystem::remove("__tmp0203");
+  RemoveDB("__tmp0203");
 }
 
 TEST(OptimizerTest, JoinAssociate4Test) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0204");
+  RemoveDB("__tmp0204");
   auto db = std::make_unique<wing::Instance>("__tmp0204", SAKURA_USE_JIT_FLAG);
   // There is a cafe called Cats'eye which has some cat employees.
   // The cat dba only stores the id of the referenced information in table Cats.
@@ -339,13 +339,13 @@ TEST(OptimizerTest, JoinAssociate4Test) {
     DB_INFO("Use: {} s", sw.GetTimeInSeconds());
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0204");
+  RemoveDB("__tmp0204");
 }
 
 TEST(OptimizerTest, JoinAssociate5Test) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0205");
+  RemoveDB("__tmp0205");
   auto db = std::make_unique<wing::Instance>("__tmp0205", SAKURA_USE_JIT_FLAG);
   // There is a cafe called Cats'eye which has some cat employees.
   // The cat dba only stores the id of the referenced information in table Cats.
@@ -431,7 +431,7 @@ TEST(OptimizerTest, JoinAssociate5Test) {
     
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0205");
+  RemoveDB("__tmp0205");
 }
 
 template<typename PKType, typename T, T(wing::wing_testing::Value::*ReadPKMethod)() const, typename GenRandomKeyFunc, typename RTGenType, typename DBType, typename GenValueClauseFunc>
@@ -579,7 +579,7 @@ RTGenType&& tuple_gen, DBType* db, GenRandomKeyFunc&& rgen_func, GenValueClauseF
 TEST(OptimizerTest, IntegerRangeScanTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0205");
+  RemoveDB("__tmp0205");
   auto db = std::make_unique<wing::Instance>("__tmp0205", SAKURA_USE_JIT_FLAG);
   // Insert key-value data
   // Read the corresponding value of a random key while inserting.
@@ -594,13 +594,13 @@ TEST(OptimizerTest, IntegerRangeScanTest) {
     [&rgen](){return rgen();}, [](int64_t x) { return x; });
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0205");
+  RemoveDB("__tmp0205");
 }
 
 TEST(OptimizerTest, StringRangeScanTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0206");
+  RemoveDB("__tmp0206");
   auto db = std::make_unique<wing::Instance>("__tmp0206", SAKURA_USE_JIT_FLAG);
   {
     EXPECT_TRUE(
@@ -620,13 +620,13 @@ TEST(OptimizerTest, StringRangeScanTest) {
     }, [](std::string x) { return "'" + x + "'"; });
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0206");
+  RemoveDB("__tmp0206");
 }
 
 TEST(OptimizerTest, FloatRangeScanTest) {
   using namespace wing;
   using namespace wing::wing_testing;
-  std::filesystem::remove("__tmp0207");
+  RemoveDB("__tmp0207");
   auto db = std::make_unique<wing::Instance>("__tmp0207", SAKURA_USE_JIT_FLAG);
   // Insert key-value data
   // Read the corresponding value of a random key while inserting.
@@ -644,5 +644,5 @@ TEST(OptimizerTest, FloatRangeScanTest) {
     }, [](double x) -> std::string { return fmt::format("{:.10f}", x); });
   }
   db = nullptr;
-  std::filesystem::remove("__tmp0207");
+  RemoveDB("__tmp0207");
 }
\ No newline at end of file
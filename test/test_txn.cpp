@@ -43,7 +43,7 @@ void ExpectTupleLockSetSize(
 }
 
 auto SetUpDummyStorage() -> BPlusTreeStorage {
-  std::filesystem::remove("__tmp_dummy");
+  RemoveDB("__tmp_dummy");
   std::filesystem::path path("__tmp_dummy");
   auto ret = BPlusTreeStorage::Open(std::move(path), true, 32 * 1024);
   if (ret.index() == 1)
@@ -574,7 +574,7 @@ TEST(LockManagerTest, DISABLED_WoundWaitTest) {
 }
 
 TEST(QueryTest, SimpleAbortTest) {
-  std::filesystem::remove("__tmp0100");
+  RemoveDB("__tmp0100");
   auto db = std::make_unique<wing::Instance>("__tmp0100", SAKURA_USE_JIT_FLAG);
   auto &txn_manager = db->GetTxnManager();
   EXPECT_TRUE(db->Execute("create table Numbers(t varchar(30) primary key, a "
@@ -600,7 +600,7 @@ TEST(QueryTest, SimpleAbortTest) {
 }
 
 TEST(QueryTest, RollbackTest) {
-  std::filesystem::remove("__tmp0100");
+  RemoveDB("__tmp0100");
   auto db = std::make_unique<wing::Instance>("__tmp0100", SAKURA_USE_JIT_FLAG);
   auto &txn_manager = db->GetTxnManager();
   EXPECT_TRUE(db->Execute("create table Numbers(t varchar(30) primary key, a "
@@ -633,8 +633,128 @@ TEST(QueryTest, RollbackTest) {
       CheckAns(format("{}", res_data2.ReadString(0)), answer, res_data2, 3));
 }
 
+static TableSchema WALTestSchema() {
+  std::vector<ColumnSchema> columns{ColumnSchema("a", FieldType::VARCHAR, 20),
+      ColumnSchema("b", FieldType::VARCHAR, 200)};
+  auto storage_columns = columns;
+  return TableSchema("t", std::move(columns), std::move(storage_columns), 0,
+      false, false, {});
+}
+
+TEST(WALTest, Recovery) {
+  constexpr size_t BUF_PAGES = 64;
+  auto key = [](int i) { return format("{:08}", i); };
+  auto value = [](int i, int version) {
+    return std::string(200, (version == 1 ? 'a' : 'A') + i % 26);
+  };
+  auto open = [&](std::string path) {
+    auto ret = BPlusTreeStorage::Open(path, true, BUF_PAGES);
+    if (ret.index() == 1)
+      throw std::get<1>(ret).to_string();
+    return std::move(std::get<0>(ret));
+  };
+  auto modify = [](BPlusTreeStorage &storage, TxnManager &txn_manager,
+                    Txn *txn, auto &&func) {
+    txn_manager.GetLockManager().AcquireTableLock("t", LockMode::IX, txn);
+    auto handle = storage.GetModifyHandle(std::make_unique<TxnExecCtx>(
+        txn->txn_id_, "t", &txn_manager.GetLockManager()));
+    func(*handle);
+  };
+  // Rows 0..499 are updated, 500..999 are deleted and 2000..2999 are inserted
+  // by the committed txn. 5000 is inserted by the last committed txn.
+  auto check = [&](BPlusTreeStorage &storage) {
+    TxnManager txn_manager(storage);
+    auto txn = txn_manager.Begin();
+    txn_manager.GetLockManager().AcquireTableLock("t", LockMode::S, txn);
+    ASSERT_EQ(storage.TupleNum("t"), 2501);
+    auto handle = storage.GetSearchHandle(std::make_unique<TxnExecCtx>(
+        txn->txn_id_, "t", &txn_manager.GetLockManager()));
+    for (int i = 0; i < 3500; i++) {
+      auto ret = handle->Search(key(i));
+      if (i >= 500 && i < 1000) {
+        ASSERT_EQ(ret, nullptr) << i;
+        continue;
+      }
+      if (i >= 3000) {
+        ASSERT_EQ(ret, nullptr) << i;
+        continue;
+      }
+      ASSERT_NE(ret, nullptr) << i;
+      auto expected = value(i, i < 500 || i >= 2000 ? 2 : 1);
+      ASSERT_EQ(std::string_view(reinterpret_cast<const char *>(ret), 200),
+          expected)
+          << i;
+    }
+    ASSERT_NE(handle->Search(key(5000)), nullptr);
+    txn_manager.Commit(txn);
+  };
+
+  RemoveDB("__tmp_wal");
+  RemoveDB("__tmp_wal_crash");
+  {
+    auto storage = open("__tmp_wal");
+    TxnManager txn_manager(storage);
+    ASSERT_FALSE(storage.Create(WALTestSchema()).has_value());
+    auto t1 = txn_manager.Begin();
+    modify(storage, txn_manager, t1, [&](ModifyHandle &h) {
+      for (int i = 0; i < 2000; i++)
+        ASSERT_TRUE(h.Insert(key(i), value(i, 1)));
+    });
+    txn_manager.Commit(t1);
+    ASSERT_TRUE(storage.Checkpoint());
+    auto t2 = txn_manager.Begin();
+    modify(storage, txn_manager, t2, [&](ModifyHandle &h) {
+      for (int i = 0; i < 500; i++)
+        ASSERT_TRUE(h.Update(key(i), value(i, 2)));
+      for (int i = 500; i < 1000; i++)
+        ASSERT_TRUE(h.Delete(key(i)));
+      for (int i = 2000; i < 3000; i++)
+        ASSERT_TRUE(h.Insert(key(i), value(i, 2)));
+    });
+    txn_manager.Commit(t2);
+    // The loser. Its modifications are flushed by evictions and by the commit
+    // of the next txn, but must not survive the crash.
+    auto t3 = txn_manager.Begin();
+    modify(storage, txn_manager, t3, [&](ModifyHandle &h) {
+      for (int i = 1000; i < 1500; i++)
+        ASSERT_TRUE(h.Update(key(i), value(i, 2)));
+      for (int i = 1500; i < 2000; i++)
+        ASSERT_TRUE(h.Delete(key(i)));
+      for (int i = 3000; i < 3500; i++)
+        ASSERT_TRUE(h.Insert(key(i), value(i, 2)));
+    });
+    auto t4 = txn_manager.Begin();
+    modify(storage, txn_manager, t4, [&](ModifyHandle &h) {
+      ASSERT_TRUE(h.Insert(key(5000), value(5000, 1)));
+    });
+    txn_manager.Commit(t4);
+    ASSERT_FALSE(storage.Checkpoint());
+    // Crash: take the files as they are now. The log is copied after the
+    // database file, since pages are journaled before they are written.
+    std::filesystem::copy_file("__tmp_wal", "__tmp_wal_crash");
+    std::filesystem::copy_file("__tmp_wal.wal", "__tmp_wal_crash.wal");
+    txn_manager.Abort(t3);
+    check(storage);
+  }
+  {
+    auto storage = open("__tmp_wal_crash");
+    check(storage);
+  }
+  {
+    // Recovery is idempotent, and a clean shutdown needs no recovery.
+    auto storage = open("__tmp_wal_crash");
+    check(storage);
+  }
+  {
+    auto storage = open("__tmp_wal");
+    check(storage);
+  }
+  RemoveDB("__tmp_wal");
+  RemoveDB("__tmp_wal_crash");
+}
+
 TEST(AnomalyQueryTest, PhantomReadTest) {
-  std::filesystem::remove("__tmp0100");
+  RemoveDB("__tmp0100");
   auto db = std::make_unique<wing::Instance>("__tmp0100", SAKURA_USE_JIT_FLAG);
   auto &txn_manager = db->GetTxnManager();
   EXPECT_TRUE(db->Execute("create table Numbers(t varchar(30) primary key, a "
@@ -668,7 +788,7 @@ TEST(AnomalyQueryTest, PhantomReadTest) {
 }
 
 TEST(AnomalyQueryTest, DirtyReadTest) {
-  std::filesystem::remove("__tmp0100");
+  RemoveDB("__tmp0100");
   auto db = std::make_unique<wing::Instance>("__tmp0100", SAKURA_USE_JIT_FLAG);
   auto &txn_manager = db->GetTxnManager();
   EXPECT_TRUE(db->Execute("create table Numbers(t varchar(30) primary key, a "
@@ -709,7 +829,7 @@ TEST(AnomalyQueryTest, DirtyReadTest) {
 
 auto InitWithTable(int init_balance, std::string file_name)
     -> std::unique_ptr<wing::Instance> {
-  std::filesystem::remove(file_name);
+  RemoveDB(file_name);
   auto db = std::make_unique<wing::Instance>(file_name, SAKURA_USE_JIT_FLAG);
   auto &txn_manager = db->GetTxnManager();
   ExecAsATxnUntilCommit(
@@ -886,7 +1006,7 @@ TEST(AnomalyQueryTest, WriteSkewTest) {
 void TransferMoneyTest(uint32_t repetition_cnt, uint32_t txn_cnt) {
   uint32_t init_balance = std::max(10000U, txn_cnt);
   for (uint32_t i = 0; i < repetition_cnt; i++) {
-    std::filesystem::remove("__tmp_TransferMoneyTest");
+    RemoveDB("__tmp_TransferMoneyTest");
     auto db = std::make_unique<wing::Instance>(
         "__tmp_TransferMoneyTest", SAKURA_USE_JIT_FLAG);
     auto &txn_manager = db->GetTxnManager();
@@ -956,7 +1076,7 @@ TEST(ConcurrentQueryTest, TransferMoneyTest1_R100T100) {
 void TransferMoneyTestThreePeople(uint32_t repetition_cnt, uint32_t txn_cnt) {
   uint32_t init_balance = std::max(10000U, txn_cnt);
   for (uint32_t i = 0; i < repetition_cnt; i++) {
-    std::filesystem::remove("__tmp_TransferMoneyTest");
+    RemoveDB("__tmp_TransferMoneyTest");
     auto db = std::make_unique<wing::Instance>(
         "__tmp_TransferMoneyTest", SAKURA_USE_JIT_FLAG);
     auto &txn_manager = db->GetTxnManager();
@@ -1072,7 +1192,7 @@ TEST(TxnBenchmark, BenchmarkTable) {
 
   std::uniform_int_distribution<int> uniform_dist(0, TOTAL_TABLE_CNT - 1);
 
-  std::filesystem::remove("__tmp_BenchTest");
+  RemoveDB("__tmp_BenchTest");
   auto db =
       std::make_unique<wing::Instance>("__tmp_BenchTest", SAKURA_USE_JIT_FLAG);
   auto &txn_manager = db->GetTxnManager();
@@ -1151,7 +1271,7 @@ TEST(TxnBenchmark, BenchmarkTuple) {
 
   std::uniform_int_distribution<int> uniform_dist(0, TOTAL_TUPLE_CNT - 1);
 
-  std::filesystem::remove("__tmp_BenchTest");
+  RemoveDB("__tmp_BenchTest");
   auto db =
       std::make_unique<wing::Instance>("__tmp_BenchTest", SAKURA_USE_JIT_FLAG);
   auto &txn_manager = db->GetTxnManager();
@@ -1216,4 +1336,64 @@ TEST(TxnBenchmark, BenchmarkTuple) {
   std::filesystem::remove("__txn_benchmark_result2");
   std::ofstream out("__txn_benchmark_result2");
   out << commit_cnt;
-}
\ No newline at end of file
+}
+
+TEST(TxnBenchmark, GroupCommit) {
+  // Each txn inserts a tuple and commits. Concurrent commits share fsyncs of
+  // the log.
+  constexpr int DURATION_MS = 1000;
+  for (int thread_num : {1, 2, 4, 8, 16, 32}) {
+    RemoveDB("__tmp_BenchTest");
+    auto ret = BPlusTreeStorage::Open("__tmp_BenchTest", true, 32 * 1024);
+    ASSERT_EQ(ret.index(), 0);
+    auto storage = std::move(std::get<0>(ret));
+    TxnManager txn_manager(storage);
+    std::vector<ColumnSchema> columns{
+        ColumnSchema("a", FieldType::INT64, 8),
+        ColumnSchema("b", FieldType::INT64, 8)};
+    auto storage_columns = columns;
+    ASSERT_FALSE(storage
+                     .Create(TableSchema("t", std::move(columns),
+                         std::move(storage_columns), 0, false, false, {}))
+                     .has_value());
+    auto before = storage.GetLogStats();
+    std::atomic<uint64_t> commit_cnt = 0;
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < thread_num; i++) {
+      threads.push_back(std::thread([&, i]() {
+        for (int64_t j = 0;; j++) {
+          auto now = std::chrono::high_resolution_clock::now();
+          if (std::chrono::duration_cast<std::chrono::milliseconds>(
+                  now - start_time)
+                  .count() > DURATION_MS)
+            break;
+          auto txn = txn_manager.Begin();
+          txn_manager.GetLockManager().AcquireTableLock(
+              "t", LockMode::IX, txn);
+          auto handle = storage.GetModifyHandle(std::make_unique<TxnExecCtx>(
+              txn->txn_id_, "t", &txn_manager.GetLockManager()));
+          int64_t key = j * thread_num + i;
+          EXPECT_TRUE(handle->Insert(
+              std::string_view(reinterpret_cast<const char *>(&key), 8),
+              std::string_view(reinterpret_cast<const char *>(&key), 8)));
+          txn_manager.Commit(txn);
+          commit_cnt += 1;
+        }
+      }));
+    }
+    for (auto &t : threads)
+      t.join();
+    double secs = std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - start_time)
+                      .count();
+    auto after = storage.GetLogStats();
+    EXPECT_EQ(storage.TupleNum("t"), commit_cnt);
+    std::cout << fmt::format(
+                     "{} committers: {:.0f} commits/s, {:.2f} commits per sync",
+                     thread_num, commit_cnt / secs,
+                     double(after.commits - before.commits) /
+                         std::max<size_t>(after.syncs - before.syncs, 1))
+              << std::endl;
+  }
+}